@@ -27,6 +27,7 @@ using namespace std;
 #include "math.h"
 #include "configoptions.h"
 #include "individual.h"
+#include "checkpoint.h"
 
 /* The next 3 lovely lines are used to cause the build to fail.  This is useful for making 
    	sure that our automated build system is finding build errors
@@ -103,6 +104,12 @@ Adaptation::Adaptation(const GeneralGamlConfig *gc){
 	improvetotal = new FLOAT_TYPE[intervalsToStore];
 	anyModel = new FLOAT_TYPE[intervalsToStore]; anyModelnum = new int[intervalsToStore];
 
+	computeWeighted = gc->computeWeightedAdaptation;
+	randNNIwork = new FLOAT_TYPE[intervalsToStore]; randSPRwork = new FLOAT_TYPE[intervalsToStore];
+	limSPRwork = new FLOAT_TYPE[intervalsToStore]; randRecomwork = new FLOAT_TYPE[intervalsToStore];
+	bipartRecomwork = new FLOAT_TYPE[intervalsToStore]; onlyBrlenwork = new FLOAT_TYPE[intervalsToStore];
+	anyModelwork = new FLOAT_TYPE[intervalsToStore];
+
 #ifdef MPI_VERSION
 	bestFromRemote=new FLOAT_TYPE[intervalsToStore];bestFromRemoteNum=new int[intervalsToStore];
 #endif
@@ -120,6 +127,8 @@ Adaptation::Adaptation(const GeneralGamlConfig *gc){
 	onlyBrlen[i] = 0.0; onlyBrlennum[i] = 0;
 	improvetotal[i] = 0.0;
 	anyModel[i] = 0.0; anyModelnum[i] = 0;
+	randNNIwork[i] = randSPRwork[i] = limSPRwork[i] = randRecomwork[i] = 0.0;
+	bipartRecomwork[i] = onlyBrlenwork[i] = anyModelwork[i] = 0.0;
 #ifdef MPI_VERSION
 	bestFromRemote[i]=0.0;	bestFromRemoteNum[i]=0;
 #endif
@@ -141,6 +150,9 @@ Adaptation::~Adaptation(){
 	delete []onlyBrlen ; delete []onlyBrlennum ;
 	delete []improvetotal ;
 	delete []anyModel ; delete []anyModelnum ;
+	delete []randNNIwork ; delete []randSPRwork ; delete []limSPRwork ;
+	delete []randRecomwork ; delete []bipartRecomwork ;
+	delete []onlyBrlenwork ; delete []anyModelwork ;
 	}
 
 void Adaptation::SetChangeableVariablesFromConfAfterReadingCheckpoint(const GeneralGamlConfig *gc){
@@ -164,6 +176,7 @@ void Adaptation::SetChangeableVariablesFromConfAfterReadingCheckpoint(const Gene
 	randSPRweight = gc->randSPRweight;
 	limSPRweight = gc->limSPRweight;
 	limSPRrange = gc->limSPRrange;
+	computeWeighted = gc->computeWeightedAdaptation;
 	}
 
 
@@ -305,6 +318,136 @@ void Adaptation::ReadFromCheckpoint(FILE *in){
 	fread((char *) anyModelnum, sizeof(int), intervalsToStore, in);
 	}
 
+//the portable checkpoint format, which lists the scalars individually.  Unlike the older format this also
+//saves the mutation work, so that weighted adaptation carries on through a restart
+void Adaptation::WriteCheckpoint(CheckpointWriter &out) const{
+	out.PutInt(intervalsToStore);
+	out.PutInt(intervalLength);
+	out.PutDouble(lastgenscore);
+	out.PutDouble(laststepscore);
+	out.PutDouble(improveOverStoredIntervals);
+	out.PutBool(reset);
+
+	out.PutDouble(startOptPrecision);
+	out.PutDouble(branchOptPrecision);
+	out.PutDouble(minOptPrecision);
+	out.PutDouble(precReductionFactor);
+	out.PutInt(numPrecReductions);
+
+	out.PutDouble(topoWeight);
+	out.PutDouble(modWeight);
+	out.PutDouble(brlenWeight);
+
+	out.PutDouble(randNNIweight);
+	out.PutDouble(origRandNNIweight);
+	out.PutDouble(randSPRweight);
+	out.PutDouble(limSPRweight);
+
+	out.PutDouble(recTopImproveSize);
+	out.PutDouble(exNNIprob);
+	out.PutDouble(exlimSPRprob);
+
+	out.PutDouble(topoMutateProb);
+	out.PutDouble(randNNIprob);
+	out.PutDouble(randSPRprob);
+	out.PutDouble(limSPRprob);
+	out.PutDouble(modelMutateProb);
+	out.PutInt(limSPRrange);
+
+	out.PutDoubles(improvetotal, intervalsToStore);
+	out.PutDoubles(randNNI, intervalsToStore);
+	out.PutInts(randNNInum, intervalsToStore);
+	out.PutDoubles(exNNI, intervalsToStore);
+	out.PutInts(exNNInum, intervalsToStore);
+	out.PutDoubles(randSPR, intervalsToStore);
+	out.PutInts(randSPRnum, intervalsToStore);
+	out.PutDoubles(limSPR, intervalsToStore);
+	out.PutInts(limSPRnum, intervalsToStore);
+	out.PutDoubles(exlimSPR, intervalsToStore);
+	out.PutInts(exlimSPRnum, intervalsToStore);
+	out.PutDoubles(randRecom, intervalsToStore);
+	out.PutInts(randRecomnum, intervalsToStore);
+	out.PutDoubles(bipartRecom, intervalsToStore);
+	out.PutInts(bipartRecomnum, intervalsToStore);
+	out.PutDoubles(onlyBrlen, intervalsToStore);
+	out.PutInts(onlyBrlennum, intervalsToStore);
+	out.PutDoubles(anyModel, intervalsToStore);
+	out.PutInts(anyModelnum, intervalsToStore);
+
+	out.PutDoubles(randNNIwork, intervalsToStore);
+	out.PutDoubles(randSPRwork, intervalsToStore);
+	out.PutDoubles(limSPRwork, intervalsToStore);
+	out.PutDoubles(randRecomwork, intervalsToStore);
+	out.PutDoubles(bipartRecomwork, intervalsToStore);
+	out.PutDoubles(onlyBrlenwork, intervalsToStore);
+	out.PutDoubles(anyModelwork, intervalsToStore);
+	}
+
+void Adaptation::ReadCheckpoint(CheckpointReader &in){
+	//the arrays have already been allocated with this length
+	in.ExpectCount(intervalsToStore, "adaptation intervals");
+	intervalLength = in.GetInt();
+	lastgenscore = in.GetDouble();
+	laststepscore = in.GetDouble();
+	improveOverStoredIntervals = in.GetDouble();
+	reset = in.GetBool();
+
+	startOptPrecision = in.GetDouble();
+	branchOptPrecision = in.GetDouble();
+	minOptPrecision = in.GetDouble();
+	precReductionFactor = in.GetDouble();
+	numPrecReductions = in.GetInt();
+
+	topoWeight = in.GetDouble();
+	modWeight = in.GetDouble();
+	brlenWeight = in.GetDouble();
+
+	randNNIweight = in.GetDouble();
+	origRandNNIweight = in.GetDouble();
+	randSPRweight = in.GetDouble();
+	limSPRweight = in.GetDouble();
+
+	recTopImproveSize = in.GetDouble();
+	exNNIprob = in.GetDouble();
+	exlimSPRprob = in.GetDouble();
+
+	topoMutateProb = in.GetDouble();
+	randNNIprob = in.GetDouble();
+	randSPRprob = in.GetDouble();
+	limSPRprob = in.GetDouble();
+	modelMutateProb = in.GetDouble();
+	limSPRrange = in.GetInt();
+
+	const char *what = "adaptation intervals";
+	in.GetDoubles(improvetotal, intervalsToStore, what);
+	in.GetDoubles(randNNI, intervalsToStore, what);
+	in.GetInts(randNNInum, intervalsToStore, what);
+	in.GetDoubles(exNNI, intervalsToStore, what);
+	in.GetInts(exNNInum, intervalsToStore, what);
+	in.GetDoubles(randSPR, intervalsToStore, what);
+	in.GetInts(randSPRnum, intervalsToStore, what);
+	in.GetDoubles(limSPR, intervalsToStore, what);
+	in.GetInts(limSPRnum, intervalsToStore, what);
+	in.GetDoubles(exlimSPR, intervalsToStore, what);
+	in.GetInts(exlimSPRnum, intervalsToStore, what);
+	in.GetDoubles(randRecom, intervalsToStore, what);
+	in.GetInts(randRecomnum, intervalsToStore, what);
+	in.GetDoubles(bipartRecom, intervalsToStore, what);
+	in.GetInts(bipartRecomnum, intervalsToStore, what);
+	in.GetDoubles(onlyBrlen, intervalsToStore, what);
+	in.GetInts(onlyBrlennum, intervalsToStore, what);
+	in.GetDoubles(anyModel, intervalsToStore, what);
+	in.GetInts(anyModelnum, intervalsToStore, what);
+
+	in.GetDoubles(randNNIwork, intervalsToStore, what);
+	in.GetDoubles(randSPRwork, intervalsToStore, what);
+	in.GetDoubles(limSPRwork, intervalsToStore, what);
+	in.GetDoubles(randRecomwork, intervalsToStore, what);
+	in.GetDoubles(bipartRecomwork, intervalsToStore, what);
+	in.GetDoubles(onlyBrlenwork, intervalsToStore, what);
+	in.GetDoubles(anyModelwork, intervalsToStore, what);
+	}
+
 
 void Adaptation::PrepareForNextInterval(){
  //if we're on the first generation of a new recording period, shift everything over
@@ -325,6 +468,10 @@ void Adaptation::PrepareForNextInterval(){
 
 		onlyBrlen[i] = onlyBrlen[i-1];onlyBrlennum[i] = onlyBrlennum[i-1];
 		anyModel[i] = anyModel[i-1]; anyModelnum[i] = anyModelnum[i-1];
+
+		randNNIwork[i] = randNNIwork[i-1]; randSPRwork[i] = randSPRwork[i-1]; limSPRwork[i] = limSPRwork[i-1];
+		randRecomwork[i] = randRecomwork[i-1]; bipartRecomwork[i] = bipartRecomwork[i-1];
+		onlyBrlenwork[i] = onlyBrlenwork[i-1]; anyModelwork[i] = anyModelwork[i-1];
 //		slopes[i] = slopes[i-1];
 #ifdef MPI_VERSION
 		bestFromRemote[i] = bestFromRemote[i-1];
@@ -351,6 +498,9 @@ void Adaptation::PrepareForNextInterval(){
 
 	onlyBrlen[0] = 0.0;onlyBrlennum[0] = 0;
 	anyModel[0] = 0.0;anyModelnum[0] = 0;
+
+	randNNIwork[0] = randSPRwork[0] = limSPRwork[0] = randRecomwork[0] = 0.0;
+	bipartRecomwork[0] = onlyBrlenwork[0] = anyModelwork[0] = 0.0;
 #ifdef MPI_VERSION
 	bestFromRemote[0]=0.0;bestFromRemoteNum[0]=0;
 #endif
@@ -369,6 +519,13 @@ void Adaptation::OutputProbs(ofstream &plog, int gen){
 	plog << randNNIprob << "\t" << randSPRprob << "\t" << limSPRprob << endl;
 	}
 
+FLOAT_TYPE Adaptation::ImprovePerMutation(FLOAT_TYPE improve, int num, FLOAT_TYPE work, FLOAT_TYPE workPerMutation) const{
+	if(computeWeighted && work > ZERO_POINT_ZERO && workPerMutation > ZERO_POINT_ZERO)
+		return (improve / work) * workPerMutation;
+	if(num > 0) return improve / num;
+	return ZERO_POINT_ZERO;
+	}
+
 void Adaptation::UpdateProbs(){
 	FLOAT_TYPE topoTot=0.0, modTot=0.0, onlyBrlenTot=0.0;
 	int numTopos=0, numMod=0, numOnlyBrlen=0;
@@ -377,6 +534,8 @@ void Adaptation::UpdateProbs(){
 	int totNumRandNNI=0, totNumLimSPR=0, totNumRandSPR=0;
 	FLOAT_TYPE totBipartRecom=0.0;
 	int totNumBipartRecom=0;
+	FLOAT_TYPE topoWork=0.0, modWork=0.0, onlyBrlenWork=0.0;
+	FLOAT_TYPE totRandNNIwork=0.0, totLimSPRwork=0.0, totRandSPRwork=0.0, totBipartRecomWork=0.0;
 
 #ifdef MPI_VERSION
 	FLOAT_TYPE totalFromRemote;
@@ -417,21 +576,31 @@ void Adaptation::UpdateProbs(){
 #endif
 		totNumRandSPR += randSPRnum[i];	
 
+		topoWork += randNNIwork[i] + randSPRwork[i] + limSPRwork[i];
+		modWork += anyModelwork[i];
+		onlyBrlenWork += onlyBrlenwork[i];
+		totRandNNIwork += randNNIwork[i];
+		totLimSPRwork += limSPRwork[i];
+		totRandSPRwork += randSPRwork[i];
+		totBipartRecomWork += bipartRecomwork[i];
+
 #ifdef	MPI_VERSION
 	totalFromRemote += bestFromRemote[i];
 #endif
 		}
 	
+	//with computeWeighted the improvements are per unit of work rather than per mutation, rescaled by
+	//the average work of a mutation so that they stay comparable with the weights that are added below
+	FLOAT_TYPE workPerMutation = ZERO_POINT_ZERO;
+	if(numTopos + numMod + numOnlyBrlen > 0)
+		workPerMutation = (topoWork + modWork + onlyBrlenWork) / (numTopos + numMod + numOnlyBrlen);
+
 	FLOAT_TYPE perTopo, perModel, perBrlen;
-	if(numTopos!=0) perTopo=(topoTot/numTopos);
-	else perTopo=0.0;
-	if(numMod!=0) perModel=(modTot/numMod);
-	else perModel=0.0;
-	if(numOnlyBrlen>0) perBrlen=(onlyBrlenTot/numOnlyBrlen);
-	else perBrlen= 0.0;
+	perTopo = ImprovePerMutation(topoTot, numTopos, topoWork, workPerMutation);
+	perModel = ImprovePerMutation(modTot, numMod, modWork, workPerMutation);
+	perBrlen = ImprovePerMutation(onlyBrlenTot, numOnlyBrlen, onlyBrlenWork, workPerMutation);
 	FLOAT_TYPE perBipartRecom;
-	if(totNumBipartRecom > 0) perBipartRecom=(totBipartRecom/totNumBipartRecom);
-	else perBipartRecom=0.0;
+	perBipartRecom = ImprovePerMutation(totBipartRecom, totNumBipartRecom, totBipartRecomWork, workPerMutation);
 	
 	//version 0.95b3 - The reduction of precision that used to appear here has been
 	//moved to Adaptation::ReducePrecision, which is called from Run, MasterMaster and
@@ -497,9 +666,9 @@ void Adaptation::UpdateProbs(){
 #endif
 	//Because NNI's chosen by an SPR mutator are marked as NNI's, this needs to be done to keep from 
 	//giving NNI's some prob even when the weight was 0.0
-	FLOAT_TYPE perRandNNI= (randNNIweight == ZERO_POINT_ZERO ? ZERO_POINT_ZERO : totRandNNI/totNumRandNNI + randNNIweight);
-	FLOAT_TYPE perLimSPR=  (limSPRweight  == ZERO_POINT_ZERO ? ZERO_POINT_ZERO : totLimSPR/totNumLimSPR + limSPRweight);
-	FLOAT_TYPE perRandSPR= (limSPRweight  == ZERO_POINT_ZERO ? ZERO_POINT_ZERO : totRandSPR/totNumRandSPR + randSPRweight);
+	FLOAT_TYPE perRandNNI= (randNNIweight == ZERO_POINT_ZERO ? ZERO_POINT_ZERO : ImprovePerMutation(totRandNNI, totNumRandNNI, totRandNNIwork, workPerMutation) + randNNIweight);
+	FLOAT_TYPE perLimSPR=  (limSPRweight  == ZERO_POINT_ZERO ? ZERO_POINT_ZERO : ImprovePerMutation(totLimSPR, totNumLimSPR, totLimSPRwork, workPerMutation) + limSPRweight);
+	FLOAT_TYPE perRandSPR= (limSPRweight  == ZERO_POINT_ZERO ? ZERO_POINT_ZERO : ImprovePerMutation(totRandSPR, totNumRandSPR, totRandSPRwork, workPerMutation) + randSPRweight);
 	
 #ifdef GANESH
 	FLOAT_TYPE perRandPECR=totRandPECR/totNumRandPECR + randPECRweight;
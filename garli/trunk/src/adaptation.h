@@ -26,6 +26,8 @@ using namespace std;
 #include "configoptions.h"
 
 class MFILE;
+class CheckpointWriter;
+class CheckpointReader;
 
 class Adaptation{
 	public:
@@ -97,6 +99,18 @@ class Adaptation{
 
 	FLOAT_TYPE *anyModel;
 	int *anyModelnum;
+
+	//the likelihood work done by each type of mutation (CLA calculations, likelihood evaluations and
+	//Newton-Raphson iterations), used instead of the number of mutations when computeWeighted is on.
+	//These are only in the portable checkpoint format (WriteCheckpoint), since the older one is read as raw memory
+	FLOAT_TYPE *randNNIwork;
+	FLOAT_TYPE *randSPRwork;
+	FLOAT_TYPE *limSPRwork;
+	FLOAT_TYPE *randRecomwork;
+	FLOAT_TYPE *bipartRecomwork;
+	FLOAT_TYPE *onlyBrlenwork;
+	FLOAT_TYPE *anyModelwork;
+	bool computeWeighted;
 	
 #ifdef MPI_VERSION
 	FLOAT_TYPE *fromRemoteSubtree;
@@ -111,6 +125,7 @@ class Adaptation{
 	void SetChangeableVariablesFromConfAfterReadingCheckpoint(const GeneralGamlConfig *gc);
 	void PrepareForNextInterval();
 	void UpdateProbs();
+	FLOAT_TYPE ImprovePerMutation(FLOAT_TYPE improve, int num, FLOAT_TYPE work, FLOAT_TYPE workPerMutation) const;
 	void OutputProbs(ofstream &plog, int gen);
 	void BeginProbLog(ofstream &plot, int gen);
 	bool ReducePrecision(){
@@ -127,6 +142,8 @@ class Adaptation{
 
 	void WriteToCheckpoint(OUTPUT_CLASS &) const;
 	void ReadFromCheckpoint(FILE *);
+	void WriteCheckpoint(CheckpointWriter &out) const;
+	void ReadCheckpoint(CheckpointReader &in);
 
 };
 
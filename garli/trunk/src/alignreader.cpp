@@ -0,0 +1,446 @@
+// GARLI version 2.1 source code
+// Copyright 2005-2014 Derrick J. Zwickl
+// email: garli.support@gmail.com
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cstdio>
+#include <cstring>
+#include <cctype>
+#include <algorithm>
+
+#include "defs.h"
+#include "alignreader.h"
+#include "patternhash.h"
+#include "outputman.h"
+
+extern OutputManager outman;
+
+//the bitwise nucleotide coding, as in SequenceData::CharToBitwiseRepresentation.  Zero means that the
+//character isn't handled here
+static unsigned char nucleotideCodes[256];
+
+static void InitializeNucleotideCodes(){
+	if(nucleotideCodes['A'] != 0) return;
+	const char *symbols = "ACGTUMRSVWYHKDBN?-";
+	const unsigned char codes[] = {1, 2, 4, 8, 8, 3, 5, 6, 7, 9, 10, 11, 12, 13, 14, 15, 15, 15};
+	for(int s = 0;symbols[s] != '\0';s++){
+		nucleotideCodes[(unsigned char) symbols[s]] = codes[s];
+		nucleotideCodes[(unsigned char) tolower(symbols[s])] = codes[s];
+		}
+	}
+
+//NCL turns underscores in fasta and phylip names into spaces, and the labels need to be the same as when
+//the file is read by NCL, e.g. to match a starting tree
+static void AssignLabel(string &label, const char *start, const char *end){
+	label.assign(start, end);
+	replace(label.begin(), label.end(), '_', ' ');
+	}
+
+static inline bool IsSpace(char c){
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+	}
+
+//compares a column with one already stored in a contiguous block of patterns
+struct SameColumn{
+	const vector<unsigned char> &store;
+	const unsigned char *col;
+	int nTax;
+	SameColumn(const vector<unsigned char> &s, const unsigned char *c, int n) : store(s), col(c), nTax(n){}
+	bool operator()(int index) const {
+		return memcmp(&store[(size_t) index * nTax], col, nTax) == 0;
+		}
+	};
+
+//the unique columns found in one block of sites
+struct BlockPatterns{
+	vector<unsigned char> patterns;
+	vector<PatternHash> hashes;
+	vector<int> counts;
+	vector<vector<int> > sites;
+	int badChar;
+	};
+
+StreamingAlignmentReader::StreamingAlignmentReader() : fileData(NULL), fileSize(0), nTax(0), nChar(0){
+	InitializeNucleotideCodes();
+	}
+
+StreamingAlignmentReader::~StreamingAlignmentReader(){
+	Clear();
+	}
+
+void StreamingAlignmentReader::Clear(){
+	CloseFile();
+	labels.clear();
+	records.clear();
+	patterns.clear();
+	counts.clear();
+	sites.clear();
+	nTax = nChar = 0;
+	}
+
+bool StreamingAlignmentReader::OpenFile(const char *filename){
+	if(!file.Open(filename))
+		return false;
+	fileData = file.Data();
+	fileSize = file.Size();
+	return true;
+	}
+
+void StreamingAlignmentReader::CloseFile(){
+	file.Close();
+	fileData = NULL;
+	fileSize = 0;
+	}
+
+bool StreamingAlignmentReader::Read(const char *filename){
+	Clear();
+	if(!OpenFile(filename))
+		return false;
+
+	const char *pos = fileData;
+	const char *end = fileData + fileSize;
+	while(pos < end && IsSpace(*pos))
+		pos++;
+	bool ok;
+	if(pos < end && *pos == '>')
+		ok = IndexFasta();
+	else
+		ok = IndexPhylip();
+	if(ok)
+		ok = HashColumns();
+
+	//the sequences aren't needed once the patterns are found
+	records.clear();
+	CloseFile();
+	if(!ok){
+		Clear();
+		return false;
+		}
+	return true;
+	}
+
+//finds where the characters of a sequence are.  For fasta, expectedChars is -1 and the sequence is everything
+//up to end.  For phylip the sequence ends after expectedChars non-whitespace characters.  Returns the number of
+//characters, or -1 if the sequence couldn't be read
+int StreamingAlignmentReader::LayoutSequence(const char *start, const char *end, int expectedChars, SequenceRecord &rec, const char *&after){
+	rec.data = start;
+	rec.lineWidth = 0;
+	rec.eolLength = 0;
+	rec.compacted.clear();
+
+	const char *eol = (const char *) memchr(start, '\n', end - start);
+	const char *lineEnd = (eol == NULL ? end : eol);
+	int eolLength = 1;
+	if(lineEnd > start && *(lineEnd - 1) == '\r'){
+		lineEnd--;
+		eolLength = 2;
+		}
+	size_t width = lineEnd - start;
+
+	if(expectedChars < 0){
+		//fasta.  Every line but the last must be the width of the first, and the rest must be whitespace
+		size_t total = width;
+		bool regular = (width > 0);
+		const char *line = (eol == NULL ? end : eol + 1);
+		bool sawShort = false;
+		while(regular && line < end){
+			const char *nextEol = (const char *) memchr(line, '\n', end - line);
+			const char *thisEnd = (nextEol == NULL ? end : nextEol);
+			int thisEolLength = 1;
+			if(thisEnd > line && *(thisEnd - 1) == '\r'){
+				thisEnd--;
+				thisEolLength = 2;
+				}
+			size_t thisWidth = thisEnd - line;
+			if(thisWidth > 0){
+				if(sawShort || thisWidth > width || (nextEol != NULL && thisEolLength != eolLength))
+					regular = false;
+				else{
+					if(thisWidth < width)
+						sawShort = true;
+					total += thisWidth;
+					}
+				}
+			else
+				sawShort = true;
+			line = (nextEol == NULL ? end : nextEol + 1);
+			}
+		if(regular){
+			if(total > width){
+				rec.lineWidth = width;
+				rec.eolLength = eolLength;
+				}
+			after = end;
+			return (int) total;
+			}
+		}
+	else{
+		//phylip.  Check that the line breaks fall where they would if every line was the same width
+		bool regular = (width > 0);
+		size_t numFullLines = 0;
+		if(regular){
+			if(width >= (size_t) expectedChars){
+				//only trailing whitespace is allowed after the sequence
+				for(const char *c = start + expectedChars;regular && c < lineEnd;c++)
+					if(!IsSpace(*c)) regular = false;
+				}
+			else{
+				numFullLines = (expectedChars - 1) / width;
+				for(size_t l = 0;regular && l < numFullLines;l++){
+					const char *brk = start + (l + 1) * width + l * eolLength;
+					if(brk + eolLength > end || brk[eolLength - 1] != '\n' || (eolLength == 2 && brk[0] != '\r'))
+						regular = false;
+					}
+				const char *last = start + expectedChars + numFullLines * eolLength;
+				if(regular && (last > end || (last < end && !IsSpace(*last))))
+					regular = false;
+				}
+			}
+		if(regular){
+			if(numFullLines > 0){
+				rec.lineWidth = width;
+				rec.eolLength = eolLength;
+				}
+			after = start + expectedChars + numFullLines * eolLength;
+			return expectedChars;
+			}
+		}
+
+	//irregular wrapping or spaces within the sequence, so take just this sequence out of the file
+	const char *c = start;
+	for(;c < end && (expectedChars < 0 || (int) rec.compacted.size() < expectedChars);c++){
+		if(!IsSpace(*c))
+			rec.compacted.push_back(*c);
+		}
+	if(expectedChars >= 0 && (int) rec.compacted.size() < expectedChars)
+		return -1;
+	rec.data = (rec.compacted.empty() ? start : &rec.compacted[0]);
+	rec.lineWidth = 0;
+	after = c;
+	return (int) rec.compacted.size();
+	}
+
+bool StreamingAlignmentReader::IndexFasta(){
+	//find the start of each sequence, which is a '>' at the start of a line.  The file is scanned in chunks in parallel
+	int numChunks = 1;
+#ifdef OPEN_MP
+	numChunks = omp_get_max_threads() * 4;
+#endif
+	size_t chunkSize = fileSize / numChunks + 1;
+	vector<vector<size_t> > chunkStarts(numChunks);
+#ifdef OPEN_MP
+#pragma omp parallel for schedule(dynamic)
+#endif
+	for(int ch = 0;ch < numChunks;ch++){
+		size_t from = min(fileSize, ch * chunkSize);
+		size_t to = min(fileSize, from + chunkSize);
+		const char *p = fileData + from;
+		const char *chunkEnd = fileData + to;
+		while(p < chunkEnd){
+			p = (const char *) memchr(p, '>', chunkEnd - p);
+			if(p == NULL) break;
+			if(p == fileData || *(p - 1) == '\n' || *(p - 1) == '\r')
+				chunkStarts[ch].push_back(p - fileData);
+			p++;
+			}
+		}
+	vector<size_t> starts;
+	for(int ch = 0;ch < numChunks;ch++)
+		starts.insert(starts.end(), chunkStarts[ch].begin(), chunkStarts[ch].end());
+	if(starts.empty()) return false;
+
+	nTax = (int) starts.size();
+	labels.resize(nTax);
+	records.resize(nTax);
+	vector<int> lengths(nTax);
+#ifdef OPEN_MP
+#pragma omp parallel for schedule(dynamic)
+#endif
+	for(int t = 0;t < nTax;t++){
+		const char *recStart = fileData + starts[t] + 1;
+		const char *recEnd = (t + 1 < nTax ? fileData + starts[t + 1] : fileData + fileSize);
+		const char *eol = (const char *) memchr(recStart, '\n', recEnd - recStart);
+		if(eol == NULL){
+			lengths[t] = -1;
+			continue;
+			}
+		//the whole definition line is the name, as with NCL
+		const char *nameStart = recStart;
+		const char *nameEnd = eol;
+		while(nameStart < nameEnd && IsSpace(*nameStart)) nameStart++;
+		while(nameEnd > nameStart && IsSpace(*(nameEnd - 1))) nameEnd--;
+		AssignLabel(labels[t], nameStart, nameEnd);
+		const char *after;
+		lengths[t] = LayoutSequence(eol + 1, recEnd, -1, records[t], after);
+		}
+
+	nChar = lengths[0];
+	for(int t = 0;t < nTax;t++){
+		if(labels[t].empty() || lengths[t] != nChar){
+			if(lengths[t] >= 0 && lengths[t] != nChar)
+				outman.UserMessage("\tSequences are not all the same length (%s has %d characters, %s has %d).", labels[0].c_str(), nChar, labels[t].c_str(), lengths[t]);
+			return false;
+			}
+		}
+	return nChar > 0;
+	}
+
+static bool ReadPositiveInt(const char *&pos, const char *end, int &val){
+	while(pos < end && (*pos == ' ' || *pos == '\t')) pos++;
+	if(pos == end || !isdigit(*pos)) return false;
+	val = 0;
+	while(pos < end && isdigit(*pos)){
+		val = val * 10 + (*pos - '0');
+		if(val > 1000000000) return false;
+		pos++;
+		}
+	return val > 0;
+	}
+
+bool StreamingAlignmentReader::IndexPhylip(){
+	const char *pos = fileData;
+	const char *end = fileData + fileSize;
+	while(pos < end && IsSpace(*pos)) pos++;
+	if(!ReadPositiveInt(pos, end, nTax) || !ReadPositiveInt(pos, end, nChar))
+		return false;
+	//anything else on the dimensions line (e.g. interleaving or weight options) is left to NCL
+	while(pos < end && (*pos == ' ' || *pos == '\t' || *pos == '\r')) pos++;
+	if(pos < end && *pos != '\n')
+		return false;
+
+	//sequential format, with relaxed (whitespace delimited) names.  As in NCL, interleaved is only tried
+	//if this doesn't work
+	labels.resize(nTax);
+	records.resize(nTax);
+	for(int t = 0;t < nTax;t++){
+		while(pos < end && IsSpace(*pos)) pos++;
+		const char *nameStart = pos;
+		while(pos < end && !IsSpace(*pos)) pos++;
+		if(pos == nameStart || pos == end) return false;
+		AssignLabel(labels[t], nameStart, pos);
+		while(pos < end && IsSpace(*pos)) pos++;
+		const char *after;
+		if(LayoutSequence(pos, end, nChar, records[t], after) != nChar)
+			return false;
+		pos = after;
+		}
+	while(pos < end && IsSpace(*pos)) pos++;
+	return pos == end;
+	}
+
+void StreamingAlignmentReader::CopyColumnBlock(const SequenceRecord &rec, int firstChar, int numChars, char *out) const{
+	if(rec.lineWidth == 0){
+		memcpy(out, rec.data + firstChar, numChars);
+		return;
+		}
+	size_t c = firstChar;
+	size_t stop = (size_t) firstChar + numChars;
+	while(c < stop){
+		size_t line = c / rec.lineWidth;
+		size_t offset = c - line * rec.lineWidth;
+		size_t num = min(rec.lineWidth - offset, stop - c);
+		memcpy(out, rec.data + line * (rec.lineWidth + rec.eolLength) + offset, num);
+		out += num;
+		c += num;
+		}
+	}
+
+//Encode and hash the columns in blocks of sites, a number of blocks at a time in parallel.  Each block is
+//first reduced to its own unique columns, which are then merged in order into the overall patterns, so the
+//result doesn't depend on the number of threads.
+bool StreamingAlignmentReader::HashColumns(){
+	//aim for a few MB of column buffer per thread
+	int blockSize = max(64, min(nChar, (4 << 20) / nTax));
+	int numBlocks = (nChar + blockSize - 1) / blockSize;
+	int blocksPerRound = 1;
+#ifdef OPEN_MP
+	blocksPerRound = omp_get_max_threads();
+#endif
+
+	PatternHashTable table(1024);
+	int badChar = 0;
+	for(int firstBlock = 0;firstBlock < numBlocks && badChar == 0;firstBlock += blocksPerRound){
+		int numThisRound = min(blocksPerRound, numBlocks - firstBlock);
+		vector<BlockPatterns> blocks(numThisRound);
+#ifdef OPEN_MP
+#pragma omp parallel for schedule(dynamic)
+#endif
+		for(int b = 0;b < numThisRound;b++){
+			BlockPatterns &block = blocks[b];
+			block.badChar = 0;
+			int firstChar = (firstBlock + b) * blockSize;
+			int num = min(blockSize, nChar - firstChar);
+			vector<char> row(num);
+			vector<unsigned char> cols((size_t) num * nTax);
+			for(int t = 0;t < nTax;t++){
+				CopyColumnBlock(records[t], firstChar, num, &row[0]);
+				for(int c = 0;c < num;c++){
+					unsigned char code = nucleotideCodes[(unsigned char) row[c]];
+					if(code == 0 && block.badChar == 0)
+						block.badChar = (unsigned char) row[c];
+					cols[(size_t) c * nTax + t] = code;
+					}
+				}
+			if(block.badChar != 0) continue;
+
+			PatternHashTable local(num);
+			for(int c = 0;c < num;c++){
+				const unsigned char *col = &cols[(size_t) c * nTax];
+				PatternHash h = HashPattern(col, nTax);
+				int numLocal = (int) block.counts.size();
+				int p = local.FindOrInsert(h, numLocal, SameColumn(block.patterns, col, nTax));
+				if(p == numLocal){
+					block.patterns.insert(block.patterns.end(), col, col + nTax);
+					block.hashes.push_back(h);
+					block.counts.push_back(1);
+					block.sites.push_back(vector<int>(1, firstChar + c));
+					}
+				else{
+					block.counts[p]++;
+					block.sites[p].push_back(firstChar + c);
+					}
+				}
+			}
+
+		for(int b = 0;b < numThisRound && badChar == 0;b++){
+			BlockPatterns &block = blocks[b];
+			if(block.badChar != 0){
+				badChar = block.badChar;
+				break;
+				}
+			for(int p = 0;p < (int) block.counts.size();p++){
+				const unsigned char *col = &block.patterns[(size_t) p * nTax];
+				int numGlobal = (int) counts.size();
+				int g = table.FindOrInsert(block.hashes[p], numGlobal, SameColumn(patterns, col, nTax));
+				if(g == numGlobal){
+					patterns.insert(patterns.end(), col, col + nTax);
+					counts.push_back(block.counts[p]);
+					sites.push_back(vector<int>());
+					sites.back().swap(block.sites[p]);
+					}
+				else{
+					counts[g] += block.counts[p];
+					sites[g].insert(sites[g].end(), block.sites[p].begin(), block.sites[p].end());
+					}
+				}
+			}
+		}
+	if(badChar != 0){
+		if(isprint(badChar))
+			outman.UserMessage("\tCharacter '%c' is not handled by the streaming reader.", (char) badChar);
+		return false;
+		}
+	return true;
+	}
@@ -0,0 +1,85 @@
+// GARLI version 2.1 source code
+// Copyright 2005-2014 Derrick J. Zwickl
+// email: garli.support@gmail.com
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef ALIGN_READER_H
+#define ALIGN_READER_H
+
+#include <vector>
+#include <string>
+
+#include "mappedfile.h"
+
+using namespace std;
+
+//Reads large nucleotide FASTA or sequential PHYLIP files (streamingdatareader = 1) without going through NCL.
+//The file is memory mapped and never copied as a whole.  Each sequence is located by an index of where it
+//starts and how its lines are wrapped, and site columns are then encoded in blocks (in parallel with OpenMP)
+//and hashed directly into unique patterns.  Only the unique patterns, their counts and the sites that
+//they represent are kept, so memory use is proportional to the compressed matrix rather than the alignment.
+//Read returns false for anything that it doesn't handle (interleaved files, unusual characters, sequences
+//of different lengths), and the file should then be read by NCL as usual, which also gives proper errors.
+class StreamingAlignmentReader{
+	//where the characters of one sequence are.  Character c is at data[c + (c / lineWidth) * eolLength],
+	//or data[c] if the sequence isn't wrapped.  Sequences with irregular wrapping or embedded spaces are
+	//compacted into their own buffer.
+	struct SequenceRecord{
+		const char *data;
+		size_t lineWidth;
+		int eolLength;
+		vector<char> compacted;
+		};
+
+	MappedFile file;
+	const char *fileData;
+	size_t fileSize;
+
+	int nTax;
+	int nChar;
+	vector<string> labels;
+	vector<SequenceRecord> records;
+
+	vector<unsigned char> patterns;//nTax states for each unique pattern
+	vector<int> counts;
+	vector<vector<int> > sites;
+
+	bool OpenFile(const char *filename);
+	void CloseFile();
+	bool IndexFasta();
+	bool IndexPhylip();
+	int LayoutSequence(const char *start, const char *end, int expectedChars, SequenceRecord &rec, const char *&after);
+	bool HashColumns();
+	void CopyColumnBlock(const SequenceRecord &rec, int firstChar, int numChars, char *out) const;
+
+public:
+	StreamingAlignmentReader();
+	~StreamingAlignmentReader();
+
+	bool Read(const char *filename);
+	void Clear();
+
+	int NTax() const {return nTax;}
+	int NChar() const {return nChar;}
+	const string &TaxonLabel(int t) const {return labels[t];}
+	const vector<string> &TaxonLabels() const {return labels;}
+	int NumPatterns() const {return (int) counts.size();}
+	//the patterns use the bitwise nucleotide coding of NucleotideData (A = 1, C = 2, G = 4, T = 8)
+	const unsigned char *Pattern(int p) const {return &patterns[(size_t) p * nTax];}
+	int PatternCount(int p) const {return counts[p];}
+	const vector<int> &PatternSites(int p) const {return sites[p];}
+	};
+
+#endif
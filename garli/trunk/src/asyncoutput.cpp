@@ -0,0 +1,311 @@
+// GARLI version 2.1 source code
+// Copyright 2005-2014 Derrick J. Zwickl
+// email: garli.support@gmail.com
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <cstdlib>
+#include <cstring>
+
+#ifdef UNIX
+#include <time.h>
+#include <sys/time.h>
+#endif
+
+#include "asyncoutput.h"
+
+AsyncOutput asyncOut;
+
+#ifdef UNIX
+static void AsyncOutputAtExit(){
+	asyncOut.Stop();
+	}
+
+//acquire and release, so that a record is complete before the index that covers it is seen to move
+template<class T> inline T LoadAcquire(volatile T *p){
+	return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+	}
+
+template<class T> inline void StoreRelease(volatile T *p, T val){
+	__atomic_store_n(p, val, __ATOMIC_RELEASE);
+	}
+
+static void SleepMilliseconds(int ms){
+	timespec t;
+	t.tv_sec = 0;
+	t.tv_nsec = ms * 1000000L;
+	nanosleep(&t, NULL);
+	}
+#endif
+
+AsyncStreamBuf::AsyncStreamBuf(AsyncOutput *o, int i) : owner(o), index(i){
+	setp(buffer, buffer + ASYNC_STREAM_BUFFER);
+	}
+
+void AsyncStreamBuf::Push(){
+	size_t len = pptr() - pbase();
+	if(len > 0)
+		owner->Push(index, pbase(), len);
+	setp(buffer, buffer + ASYNC_STREAM_BUFFER);
+	}
+
+int AsyncStreamBuf::overflow(int c){
+	Push();
+	if(c != EOF){
+		*pptr() = (char) c;
+		pbump(1);
+		return c;
+		}
+	return 0;
+	}
+
+int AsyncStreamBuf::sync(){
+	Push();
+	return 0;
+	}
+
+AsyncOutput::AsyncOutput() : ring(NULL), capacity(0), head(0), tail(0), pushLock(0),
+	flushRequested(0), flushDone(0), stopRequested(false), running(false){
+	for(int s = 0;s < MAX_ASYNC_STREAMS;s++){
+		streams[s].file = NULL;
+		streams[s].target = NULL;
+		streams[s].buf = NULL;
+		streams[s].dirty = false;
+		}
+	}
+
+AsyncOutput::~AsyncOutput(){
+	Stop();
+	}
+
+bool AsyncOutput::Start(size_t ringBytes){
+#ifdef UNIX
+	if(running) return true;
+	if(ringBytes < 4096 || (ringBytes & (ringBytes - 1)) != 0) return false;
+	ring = (char *) malloc(ringBytes);
+	if(ring == NULL) return false;
+	capacity = ringBytes;
+	head = tail = 0;
+	flushRequested = flushDone = 0;
+	stopRequested = false;
+	pthread_mutex_init(&mutex, NULL);
+	pthread_cond_init(&wake, NULL);
+	if(pthread_create(&thread, NULL, ThreadMain, this) != 0){
+		pthread_cond_destroy(&wake);
+		pthread_mutex_destroy(&mutex);
+		free(ring);
+		ring = NULL;
+		return false;
+		}
+	running = true;
+	static bool registered = false;
+	if(!registered){
+		atexit(AsyncOutputAtExit);
+		registered = true;
+		}
+	return true;
+#else
+	return false;
+#endif
+	}
+
+//flushes everything, puts the original buffers back into any streams that are still attached and
+//stops the writer.  Output after this is synchronous
+void AsyncOutput::Stop(){
+#ifdef UNIX
+	if(!running) return;
+	for(int s = 0;s < MAX_ASYNC_STREAMS;s++)
+		if(streams[s].file != NULL) Detach(*streams[s].file);
+	StoreRelease(&stopRequested, true);
+	WakeWriter();
+	pthread_join(thread, NULL);
+	pthread_cond_destroy(&wake);
+	pthread_mutex_destroy(&mutex);
+	free(ring);
+	ring = NULL;
+	running = false;
+#endif
+	}
+
+int AsyncOutput::FindStream(const ofstream &f) const{
+	for(int s = 0;s < MAX_ASYNC_STREAMS;s++)
+		if(streams[s].file == &f) return s;
+	return -1;
+	}
+
+void AsyncOutput::Attach(ofstream &f){
+	if(!running || !f.is_open() || FindStream(f) >= 0) return;
+	int s = 0;
+	while(s < MAX_ASYNC_STREAMS && streams[s].file != NULL)
+		s++;
+	//if all of the slots are in use the stream just stays synchronous
+	if(s == MAX_ASYNC_STREAMS) return;
+	//anything the stream has already buffered goes out first
+	f.flush();
+	streams[s].target = f.rdbuf();
+	streams[s].buf = new AsyncStreamBuf(this, s);
+	streams[s].file = &f;
+	//ofstream::rdbuf() always returns the filebuf, but the stream itself writes through basic_ios::rdbuf
+	ios::iostate state = f.rdstate();
+	static_cast<ostream &>(f).rdbuf(streams[s].buf);
+	f.clear(state);
+	}
+
+void AsyncOutput::Detach(ofstream &f){
+	int s = FindStream(f);
+	if(s < 0) return;
+	Flush();
+	ios::iostate state = f.rdstate();
+	static_cast<ostream &>(f).rdbuf(f.rdbuf());
+	f.clear(state);
+	delete streams[s].buf;
+	streams[s].buf = NULL;
+	streams[s].target = NULL;
+	streams[s].file = NULL;
+	}
+
+void AsyncOutput::Close(ofstream &f){
+	Detach(f);
+	f.close();
+	}
+
+void AsyncOutput::Flush(){
+#ifdef UNIX
+	if(!running) return;
+	for(int s = 0;s < MAX_ASYNC_STREAMS;s++)
+		if(streams[s].file != NULL) streams[s].buf->Push();
+	unsigned request = flushRequested + 1;
+	StoreRelease(&flushRequested, request);
+	WakeWriter();
+	while((int) (LoadAcquire(&flushDone) - request) < 0){
+		WakeWriter();
+		SleepMilliseconds(1);
+		}
+#endif
+	}
+
+void AsyncOutput::Push(int index, const char *data, size_t len){
+#ifdef UNIX
+	while(__sync_lock_test_and_set(&pushLock, 1))
+		;
+	//big writes are split so that a record always fits
+	while(len > 0){
+		size_t chunk = (len < capacity / 4 ? len : capacity / 4);
+		PushRecord(index, data, chunk);
+		data += chunk;
+		len -= chunk;
+		}
+	__sync_lock_release(&pushLock);
+#endif
+	}
+
+void AsyncOutput::PushRecord(int index, const char *data, size_t len){
+#ifdef UNIX
+	size_t recBytes = (sizeof(RecordHeader) + len + 7) & ~((size_t) 7);
+	size_t h = head;
+	size_t pos = h & (capacity - 1);
+	size_t toEnd = capacity - pos;
+	size_t needed = recBytes + (toEnd < recBytes ? toEnd : 0);
+	//the only time that the search waits on output
+	while(capacity - (h - LoadAcquire(&tail)) < needed){
+		WakeWriter();
+		SleepMilliseconds(1);
+		}
+	bool wasEmpty = (h == LoadAcquire(&tail));
+	if(toEnd < recBytes){
+		RecordHeader *wrap = (RecordHeader *) (ring + pos);
+		wrap->index = -1;
+		wrap->length = 0;
+		pos = 0;
+		}
+	RecordHeader *rec = (RecordHeader *) (ring + pos);
+	rec->index = index;
+	rec->length = (unsigned) len;
+	memcpy(ring + pos + sizeof(RecordHeader), data, len);
+	StoreRelease(&head, h + needed);
+	if(wasEmpty) WakeWriter();
+#endif
+	}
+
+void AsyncOutput::WakeWriter(){
+#ifdef UNIX
+	pthread_cond_signal(&wake);
+#endif
+	}
+
+#ifdef UNIX
+void *AsyncOutput::ThreadMain(void *arg){
+	((AsyncOutput *) arg)->WriterLoop();
+	return NULL;
+	}
+
+void AsyncOutput::WriterLoop(){
+	while(true){
+		size_t t = tail;
+		if(t != LoadAcquire(&head)){
+			size_t pos = t & (capacity - 1);
+			RecordHeader *rec = (RecordHeader *) (ring + pos);
+			size_t consumed;
+			if(rec->index < 0)
+				consumed = capacity - pos;
+			else{
+				Stream &s = streams[rec->index];
+				s.target->sputn(ring + pos + sizeof(RecordHeader), rec->length);
+				s.dirty = true;
+				consumed = (sizeof(RecordHeader) + rec->length + 7) & ~((size_t) 7);
+				}
+			//done with the space before the producer can reuse it
+			StoreRelease(&tail, t + consumed);
+			continue;
+			}
+
+		unsigned request = LoadAcquire(&flushRequested);
+		if(request != flushDone){
+			for(int s = 0;s < MAX_ASYNC_STREAMS;s++){
+				if(streams[s].dirty){
+					streams[s].target->pubsync();
+					streams[s].dirty = false;
+					}
+				}
+			StoreRelease(&flushDone, request);
+			continue;
+			}
+		if(LoadAcquire(&stopRequested)) break;
+
+		//nothing to do, so wait to be woken.  The timeout covers a wakeup that is missed because it came
+		//between the checks above and the wait, and idle time is used to get output out of the process
+		pthread_mutex_lock(&mutex);
+		timeval now;
+		gettimeofday(&now, NULL);
+		timespec until;
+		until.tv_sec = now.tv_sec;
+		until.tv_nsec = now.tv_usec * 1000L + 100000000L;
+		if(until.tv_nsec >= 1000000000L){
+			until.tv_sec++;
+			until.tv_nsec -= 1000000000L;
+			}
+		int waited = pthread_cond_timedwait(&wake, &mutex, &until);
+		pthread_mutex_unlock(&mutex);
+		if(waited != 0 && tail == LoadAcquire(&head)){
+			for(int s = 0;s < MAX_ASYNC_STREAMS;s++){
+				if(streams[s].dirty){
+					streams[s].target->pubsync();
+					streams[s].dirty = false;
+					}
+				}
+			}
+		}
+	}
+#endif
@@ -0,0 +1,124 @@
+// GARLI version 2.1 source code
+// Copyright 2005-2014 Derrick J. Zwickl
+// email: garli.support@gmail.com
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef ASYNC_OUTPUT_H
+#define ASYNC_OUTPUT_H
+
+#include <fstream>
+#include <streambuf>
+
+#ifdef UNIX
+#include <pthread.h>
+#endif
+
+using namespace std;
+
+#define MAX_ASYNC_STREAMS 32
+#define ASYNC_STREAM_BUFFER 8192
+#define ASYNC_RING_BYTES (8 * 1024 * 1024)
+
+class AsyncOutput;
+
+//The buffer that an attached ofstream writes through.  Output collects here and is handed to the ring
+//when this fills or the stream is flushed (endl, flush()), so flushing a stream never waits on the disk.
+class AsyncStreamBuf : public streambuf{
+	AsyncOutput *owner;
+	int index;
+	char buffer[ASYNC_STREAM_BUFFER];
+
+public:
+	AsyncStreamBuf(AsyncOutput *o, int i);
+	void Push();
+
+protected:
+	int overflow(int c);
+	int sync();
+	};
+
+//Writes output files from a background thread (asyncoutput = 1, UNIX only) so that the search never waits
+//on a slow or stalled filesystem.  Attached ofstreams write into a ring buffer, and the writer thread
+//copies that into the streams' own file buffers and flushes them whenever it is idle.  The writer never
+//takes a lock on the ring.  Writers of streams are serialized against each other by a spin lock, and only
+//wait if the ring is full.
+//Flush() returns once everything written so far is out of the process.  It is called when checkpoints
+//are written, and streams must be closed with Close() rather than ofstream::close().  Anything still
+//attached at exit is flushed by an atexit handler.
+//If the writer isn't running, Attach does nothing and everything is written synchronously as before.
+class AsyncOutput{
+	struct Stream{
+		ofstream *file;
+		streambuf *target;//the file's own filebuf
+		AsyncStreamBuf *buf;
+		bool dirty;//written by the writer thread and not yet flushed
+		};
+	//each record in the ring is a header followed by the data, padded to a multiple of 8 bytes.  A header
+	//with index -1 means that the rest of the ring is unused and the next record is at the start
+	struct RecordHeader{
+		int index;
+		unsigned length;
+		};
+
+	Stream streams[MAX_ASYNC_STREAMS];
+	char *ring;
+	size_t capacity;
+	//total bytes ever written to and read from the ring.  head is only changed by the producers and tail by
+	//the writer thread
+	volatile size_t head;
+	volatile size_t tail;
+	volatile int pushLock;
+	volatile unsigned flushRequested;
+	volatile unsigned flushDone;
+	volatile bool stopRequested;
+	bool running;
+#ifdef UNIX
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	pthread_cond_t wake;
+	static void *ThreadMain(void *arg);
+#endif
+
+	void WriterLoop();
+	void WakeWriter();
+	void PushRecord(int index, const char *data, size_t len);
+	int FindStream(const ofstream &f) const;
+
+	//not copyable
+	AsyncOutput(const AsyncOutput &);
+	AsyncOutput &operator=(const AsyncOutput &);
+
+public:
+	AsyncOutput();
+	~AsyncOutput();
+
+	//ringBytes must be a power of two.  Returns false if the writer can't be started
+	bool Start(size_t ringBytes);
+	void Stop();
+	bool Running() const {return running;}
+
+	void Attach(ofstream &f);
+	void Detach(ofstream &f);
+	void Close(ofstream &f);
+	void Flush();
+
+	//used by AsyncStreamBuf
+	void Push(int index, const char *data, size_t len);
+	};
+
+extern AsyncOutput asyncOut;
+
+#endif
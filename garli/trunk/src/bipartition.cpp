@@ -20,12 +20,12 @@
 #include "reconnode.h"
 
 int Bipartition::nBlocks;
-int Bipartition:: blockBits;
+const int Bipartition::blockBits;
 int Bipartition::ntax;
-unsigned int Bipartition::largestBlockDigit;
-unsigned int Bipartition::allBitsOn;
+BipartBlock Bipartition::largestBlockDigit;
+BipartBlock Bipartition::allBitsOn;
 char * Bipartition::str;
-unsigned int Bipartition::partialBlockMask;
+BipartBlock Bipartition::partialBlockMask;
 
 bool Constraint::allBackbone;
 bool Constraint::anyBackbone;
@@ -50,11 +50,10 @@ void Constraint::SetConstraintStatics(bool allBack, bool anyBack, bool oneMask){
 	}
 
 void Bipartition::SetBipartitionStatics(int nt){
-	Bipartition::blockBits=sizeof(int)*8;
 	Bipartition::ntax=nt;
-	Bipartition::nBlocks=(int)ceil((FLOAT_TYPE)nt/(FLOAT_TYPE)Bipartition::blockBits);
-	Bipartition::largestBlockDigit=1<<(Bipartition::blockBits-1);
-	Bipartition::allBitsOn=(unsigned int)(pow(2.0, Bipartition::blockBits)-1);
+	Bipartition::nBlocks=(nt + Bipartition::blockBits - 1) / Bipartition::blockBits;
+	Bipartition::largestBlockDigit=(BipartBlock)1<<(Bipartition::blockBits-1);
+	Bipartition::allBitsOn=~(BipartBlock)0;
 	Bipartition::str=new char[nt+1];
 	Bipartition::str[nt] = '\0';
 	Bipartition::SetPartialBlockMask();	
@@ -62,7 +61,7 @@ void Bipartition::SetBipartitionStatics(int nt){
 
 void Bipartition::SetPartialBlockMask(){
 		partialBlockMask=0;
-		unsigned int bit=largestBlockDigit;
+		BipartBlock bit=largestBlockDigit;
 		for(int b=0;b<ntax%blockBits;b++){
 			partialBlockMask += bit;
 			bit = bit >> 1;
@@ -330,9 +329,9 @@ void Bipartition::NumericalOutput(string &out, const Bipartition *mask){
 	char temp[100];
 	if(mask != NULL){
 		for(int i=0;i<nBlocks;i++){
-			unsigned int t=rep[i];
-			unsigned int m=mask->rep[i];
-			unsigned int bit = largestBlockDigit;
+			BipartBlock t=rep[i];
+			BipartBlock m=mask->rep[i];
+			BipartBlock bit = largestBlockDigit;
 			for(int j=0;j<blockBits;j++){
 				if(i*blockBits+j >= ntax) break;
 				if(bit & m){
@@ -353,8 +352,8 @@ void Bipartition::NumericalOutput(string &out, const Bipartition *mask){
 		}
 	else{
 		for(int i=0;i<nBlocks;i++){
-			unsigned int t=rep[i];
-			unsigned int bit = largestBlockDigit;
+			BipartBlock t=rep[i];
+			BipartBlock bit = largestBlockDigit;
 			for(int j=0;j<blockBits;j++){
 				if(i*blockBits+j >= ntax) break;
 				if(bit & t){
@@ -26,38 +26,123 @@
 #include <cassert>
 #include <set>
 
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
 using namespace std;
 
 #include "errorexception.h"
 
 class Constraint;
 
+//bipartitions are stored in 64 bit blocks, with taxon 1 being the highest bit of the first block
+typedef unsigned long long BipartBlock;
+
+//bipartitions with this many blocks or fewer (256 taxa) are stored within the object itself, 
+//avoiding an allocation every time one is created or copied
+#define INLINE_BIPART_BLOCKS 4
+
+//number of leading zero bits, which is the (zero based) position of the first taxon present in a block.
+//blk must not be zero
+inline int BlockLeadingZeros(BipartBlock blk){
+#if defined(__GNUC__)
+	return __builtin_clzll(blk);
+#elif defined(_MSC_VER) && defined(_WIN64)
+	unsigned long idx;
+	_BitScanReverse64(&idx, blk);
+	return 63 - (int) idx;
+#else
+	int n = 0;
+	while(!(blk & ((BipartBlock)1 << 63))){
+		blk = blk << 1;
+		n++;
+		}
+	return n;
+#endif
+	}
+
+inline int BlockPopCount(BipartBlock blk){
+#if defined(__GNUC__)
+	return __builtin_popcountll(blk);
+#elif defined(_MSC_VER) && defined(_WIN64)
+	return (int) __popcnt64(blk);
+#else
+	int n = 0;
+	while(blk){
+		blk &= blk - 1;
+		n++;
+		}
+	return n;
+#endif
+	}
+
 class Bipartition{
 	public:	
-	unsigned int *rep;
+	BipartBlock *rep;
 	static int nBlocks;
-	static int blockBits;
+	static const int blockBits = 64;
 	static int ntax;
-	static unsigned int largestBlockDigit;
-	static unsigned int allBitsOn;
+	static BipartBlock largestBlockDigit;
+	static BipartBlock allBitsOn;
 	static char* str;
-	static unsigned int partialBlockMask;//this can be used to mask out the bits that
+	static BipartBlock partialBlockMask;//this can be used to mask out the bits that
 										// aren't used in the last block.  This becomes
 										//important if we start doing complements. Bits
 										//that represent actual taxa are ON
+	private:
+	BipartBlock inlineRep[INLINE_BIPART_BLOCKS];
 
+	void AllocateRep(){
+		if(nBlocks <= INLINE_BIPART_BLOCKS) rep = inlineRep;
+		else rep = new BipartBlock[nBlocks];
+		}
+
+	//returns true if ((a ^ b ^ flip) & mask) is zero for the first n blocks, where flip is either zero 
+	//(for equality) or all bits on (for equality with the complement).  The mask may be NULL.
+	static bool BlocksMatch(const BipartBlock *a, const BipartBlock *b, const BipartBlock *mask, BipartBlock flip, int n){
+		int i = 0;
+#ifdef __AVX2__
+		const __m256i vflip = _mm256_set1_epi64x((long long) flip);
+		for(;i + 4 <= n;i += 4){
+			__m256i diff = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *) (a + i)), _mm256_loadu_si256((const __m256i *) (b + i)));
+			diff = _mm256_xor_si256(diff, vflip);
+			if(mask){
+				if(!_mm256_testz_si256(diff, _mm256_loadu_si256((const __m256i *) (mask + i))))
+					return false;
+				}
+			else if(!_mm256_testz_si256(diff, diff))
+				return false;
+			}
+#endif
+		if(mask){
+			for(;i < n;i++)
+				if((a[i] ^ b[i] ^ flip) & mask[i])
+					return false;
+			}
+		else{
+			for(;i < n;i++)
+				if(a[i] ^ b[i] ^ flip)
+					return false;
+			}
+		return true;
+		}
+
+	public:
 	Bipartition(){
-		rep=new unsigned int[nBlocks];
+		AllocateRep();
 		ClearBipartition();
 		}
 	Bipartition(const Bipartition &b){//copy constructor
-		rep=new unsigned int[nBlocks];
-		memcpy(rep, b.rep, nBlocks*sizeof(int));
-		//for(int i=0;i<nBlocks;i++) rep[i] = b.rep[i];
+		AllocateRep();
+		memcpy(rep, b.rep, nBlocks*sizeof(BipartBlock));
 		}
 
 	Bipartition(const char *c){//construct from a ***.... string
-		rep=new unsigned int[nBlocks];
+		AllocateRep();
 		ClearBipartition();
 		size_t len=strlen(c);
 		assert(len == ntax);
@@ -69,7 +154,7 @@ class Bipartition{
 		}
 
 	~Bipartition(){
-		if(rep!=NULL) delete []rep;
+		if(rep!=NULL && rep != inlineRep) delete []rep;
 		rep=NULL;
 		}	
 
@@ -88,7 +173,7 @@ class Bipartition{
 	static void SetPartialBlockMask();
 	
 	void ClearBipartition(){
-		memset(rep, 0L, sizeof(int) * nBlocks);
+		memset(rep, 0L, sizeof(BipartBlock) * nBlocks);
 		}
 	
 	void operator+=(const Bipartition *rhs){
@@ -112,17 +197,19 @@ class Bipartition{
 		}
 
 	void operator=(const Bipartition *rhs){
-		memcpy(rep, rhs->rep, nBlocks*sizeof(int));
+		memcpy(rep, rhs->rep, nBlocks*sizeof(BipartBlock));
 		}
 
 	void operator=(const Bipartition &rhs){
-		memcpy(rep, rhs.rep, nBlocks*sizeof(int));
+		memcpy(rep, rhs.rep, nBlocks*sizeof(BipartBlock));
 		}
 
 	int CountOnBits() const{
 		int num=0;
-		for(int i=1;i<=ntax;i++)
-			if(ContainsTaxon(i)) num++;
+		int i;
+		for(i=0;i<nBlocks-1;i++)
+			num += BlockPopCount(rep[i]);
+		num += BlockPopCount(rep[i] & partialBlockMask);
 		return num;
 		}
 
@@ -155,17 +242,17 @@ class Bipartition{
 
 	void FillAllBits(){
 		//the argument here is what to fill each _byte_ of the ints with
-		memset(rep, 0xFF, sizeof(int) * nBlocks);
+		memset(rep, 0xFF, sizeof(BipartBlock) * nBlocks);
 		}
 
+	//the comparisons all check the full blocks with BlocksMatch (vectorized if AVX2 is available) 
+	//and then the last block with the partialBlockMask applied
 	bool EqualsEquals(const Bipartition &rhs) const{
 		//assert(this->ContainsTaxon(1));
 		//assert(rhs.ContainsTaxon(1));
-		int i;
-		for(i=0;i<nBlocks-1;i++){
-			if(rep[i] != rhs.rep[i]) 
-				return false;
-			}
+		int i = nBlocks-1;
+		if(!BlocksMatch(rep, rhs.rep, NULL, 0, i))
+			return false;
 		if((rep[i]&partialBlockMask)!=((rhs.rep[i])&partialBlockMask)) 
 			return false;
 		return true;
@@ -174,11 +261,9 @@ class Bipartition{
 	bool MaskedEqualsEquals(const Bipartition &rhs, const Bipartition &mask) const{
 		//assert(this->ContainsTaxon(1));
 		//assert(rhs.ContainsTaxon(1));
-		int i;
-		for(i=0;i<nBlocks-1;i++){
-			if((rep[i] & mask.rep[i]) != (rhs.rep[i] & mask.rep[i])) 
-				return false;
-			}
+		int i = nBlocks-1;
+		if(!BlocksMatch(rep, rhs.rep, mask.rep, 0, i))
+			return false;
 		if((rep[i] & partialBlockMask & mask.rep[i]) != ((rhs.rep[i]) & partialBlockMask & mask.rep[i])) 
 			return false;
 		return true;
@@ -193,11 +278,9 @@ class Bipartition{
 		}
 
 	bool ComplementEqualsEquals(const Bipartition &rhs) const{
-		int i;
-		for(i=0;i<nBlocks-1;i++){
-			if(~rep[i]!=rhs.rep[i]) 
-				return false;
-			}
+		int i = nBlocks-1;
+		if(!BlocksMatch(rep, rhs.rep, NULL, allBitsOn, i))
+			return false;
 			
 		if(((~rep[i])&partialBlockMask)!=(rhs.rep[i]&partialBlockMask)) 
 			return false;
@@ -208,53 +291,42 @@ class Bipartition{
 	bool MaskedComplementEqualsEquals(const Bipartition &rhs, const Bipartition &mask) const{
 		//assert(this->ContainsTaxon(1));
 		//assert(rhs.ContainsTaxon(1));
-		int i;
-		for(i=0;i<nBlocks-1;i++){
-			if((~rep[i] & mask.rep[i]) != (rhs.rep[i] & mask.rep[i])) 
-				return false;
-			}
+		int i = nBlocks-1;
+		if(!BlocksMatch(rep, rhs.rep, mask.rep, allBitsOn, i))
+			return false;
 		if((~rep[i] & partialBlockMask & mask.rep[i]) != ((rhs.rep[i]) & partialBlockMask & mask.rep[i])) 
 			return false;
 		return true;
 		}
 
+	//complements in the same pass as the check if taxon 1 isn't present
 	void Standardize(){
-		if(ContainsFirstTaxon())
-			return;
-		else
-			Complement();
+		const BipartBlock flip = (ContainsFirstTaxon() ? 0 : allBitsOn);
+		for(int i=0;i<nBlocks;i++){
+			rep[i] ^= flip;
+			}
 		}
 	
 	int FirstPresentTaxon() const{
 		int blk=0;
-		unsigned int tmp=rep[blk];
+		BipartBlock tmp=rep[blk];
 		while(tmp == 0) 
 			tmp=rep[++blk];
 		
-		int t=blockBits*blk+1;
-		while( ! (tmp & largestBlockDigit)){
-			tmp = tmp << 1;
-			t++;
-			}
-		return t;
+		return blockBits*blk + BlockLeadingZeros(tmp) + 1;
 		}
 
 	int FirstNonPresentTaxon() const{
 		int blk=0;
-		unsigned int tmp=rep[blk];
+		BipartBlock tmp=rep[blk];
 		while(tmp==allBitsOn) 
 			tmp=rep[++blk];
 		
-		int t=blockBits*blk+1;
-		while((tmp & largestBlockDigit)){
-			tmp = tmp << 1;
-			t++;
-			}
-		return t;
+		return blockBits*blk + BlockLeadingZeros(~tmp) + 1;
 		}
 
 	bool ContainsTaxon(int t) const{
-		unsigned int tmp=rep[(t-1)/blockBits];
+		BipartBlock tmp=rep[(t-1)/blockBits];
 		if(tmp & largestBlockDigit>>((t-1)%blockBits)) 
 			return true;
 		return false;
@@ -280,6 +352,29 @@ class Bipartition{
 			}
 		}
 
+	//a 64 bit hash that is identical for a bipartition and its complement, so that it can be used
+	//to look up bipartitions regardless of standardization.  The unused bits of the last block are masked.
+	unsigned long long ComplementNormalizedHash() const{
+		BipartBlock flip = (ContainsFirstTaxon() ? 0 : allBitsOn);
+		unsigned long long h = 0x9E3779B97F4A7C15ULL;
+		for(int i=0;i<nBlocks;i++){
+			BipartBlock b = rep[i] ^ flip;
+			if(i == nBlocks - 1) b &= partialBlockMask;
+			h ^= b;
+			h *= 0xFF51AFD7ED558CCDULL;
+			h ^= h >> 32;
+			}
+		return h;
+		}
+
+	//when rhs is a subset of this or disjoint from it this removes or adds it, respectively.
+	//Used for updating bipartitions incrementally when a subtree moves
+	void EqualsXOR(const Bipartition &rhs){
+		for(int i=0;i<nBlocks;i++){
+			rep[i] = rep[i] ^ rhs.rep[i];
+			}
+		}
+
 	void AndEquals(const Bipartition &rhs){
 		//sets the calling bipart to be the bitwise AND of it and the argument
 		for(int i=0;i<nBlocks;i++){
@@ -307,7 +402,7 @@ bool HasIntersection(const Bipartition &rhs, const Bipartition *mask) const
 			}
 #ifdef _BETTER_BIPART
 		else{
-			unsigned sum = 0;
+			BipartBlock sum = 0;
 			for(i=0;i<nBlocks-1;i++){
 				sum |= ((rep[i] & rhs.rep[i]) & mask->rep[i]);
 				}
@@ -344,7 +439,7 @@ bool HasIntersection(const Bipartition &rhs, const Bipartition *mask) const
 			}
 #ifdef _BETTER_BIPART
 		else{
-			unsigned sum = 0;
+			BipartBlock sum = 0;
 			for(i=0;i<nBlocks-1;i++){
 				sum |= ((rep[i] & ~rhs.rep[i]) & mask->rep[i]); 
 				}
@@ -380,7 +475,7 @@ bool HasIntersection(const Bipartition &rhs, const Bipartition *mask) const
 			}
 #ifdef _BETTER_BIPART
 		else{
-			unsigned sum = 0;
+			BipartBlock sum = 0;
 			for(i=0;i<nBlocks-1;i++){
 				sum |= ((~rep[i] & rhs.rep[i]) & mask->rep[i]); 
 				}
@@ -416,7 +511,7 @@ bool HasIntersection(const Bipartition &rhs, const Bipartition *mask) const
 			}
 #ifdef _BETTER_BIPART
 		else{
-			unsigned sum = 0;
+			BipartBlock sum = 0;
 			for(i=0;i<nBlocks-1;i++){
 				sum |= ((~rep[i] & ~rhs.rep[i]) & mask->rep[i]); 
 				}
@@ -491,9 +586,9 @@ bool HasIntersection(const Bipartition &rhs, const Bipartition *mask) const
 		rep[(taxNum-1)/blockBits]|=(largestBlockDigit>>((taxNum-1)%blockBits));
 		return this;
 		}
-	char * Output(){
+	char * Output() const{
 		for(int i=0;i<nBlocks;i++){
-			unsigned int t=rep[i];
+			BipartBlock t=rep[i];
 			for(int j=0;j<blockBits;j++){
 				if(i*blockBits+j >= ntax) break;
 				if(t&largestBlockDigit) str[i*blockBits+j]='*';
@@ -506,16 +601,16 @@ bool HasIntersection(const Bipartition &rhs, const Bipartition *mask) const
 	
 /*
 	void BinaryOutput(ofstream &out){
-		int size = nBlocks * sizeof(unsigned int);
+		int size = nBlocks * sizeof(BipartBlock);
 		out.write((char*) rep, size);
 		}
 */
 	void BinaryOutput(OUTPUT_CLASS &out){
-		out.WRITE_TO_FILE(rep, sizeof(unsigned int), nBlocks);
+		out.WRITE_TO_FILE(rep, sizeof(BipartBlock), nBlocks);
 		}
 
 	void BinaryInput(FILE* &in){
-		fread((char*) rep, sizeof(unsigned int), nBlocks, in);
+		fread((char*) rep, sizeof(BipartBlock), nBlocks, in);
 		}
 
 	vector<int> NodenumsFromBipart(){
@@ -0,0 +1,325 @@
+// GARLI version 2.1 source code
+// Copyright 2005-2014 Derrick J. Zwickl
+// email: garli.support@gmail.com
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <cstdio>
+#include <ctime>
+#include <cassert>
+
+#ifdef UNIX
+#include <unistd.h>
+#endif
+
+#include "checkpoint.h"
+#include "outputman.h"
+
+extern OutputManager outman;
+
+static const char checkpointMagic[8] = {'G', 'A', 'R', 'L', 'I', 'C', 'H', 'K'};
+enum{CHECKPOINT_FILE = 0, CHECKPOINT_JOURNAL = 1};
+//magic, version, kind and id
+static const size_t checkpointHeaderBytes = 8 + 4 + 4 + 8;
+
+//the usual CRC-32 (as in zip and png), with the table filled in before main
+static unsigned crcTable[256];
+static struct CrcTableInitializer{
+	CrcTableInitializer(){
+		for(unsigned n = 0;n < 256;n++){
+			unsigned c = n;
+			for(int k = 0;k < 8;k++)
+				c = (c & 1) ? 0xedb88320U ^ (c >> 1) : c >> 1;
+			crcTable[n] = c;
+			}
+		}
+	} crcTableInitializer;
+
+unsigned Crc32(const unsigned char *data, size_t len){
+	unsigned c = 0xffffffffU;
+	for(size_t i = 0;i < len;i++)
+		c = crcTable[(c ^ data[i]) & 0xff] ^ (c >> 8);
+	return c ^ 0xffffffffU;
+	}
+
+static void MakeHeader(CheckpointWriter &header, unsigned kind, unsigned long long id){
+	header.PutBytes(checkpointMagic, 8);
+	header.PutUInt32(CHECKPOINT_FORMAT_VERSION);
+	header.PutUInt32(kind);
+	header.PutUInt64(id);
+	}
+
+static void MakeRecordFrame(CheckpointWriter &frame, const vector<unsigned char> &record){
+	frame.PutUInt64(record.size());
+	frame.PutUInt32(Crc32(record.empty() ? NULL : &record[0], record.size()));
+	}
+
+static bool ReadWholeFile(const char *name, vector<unsigned char> &contents){
+	FILE *in = fopen(name, "rb");
+	if(in == NULL) return false;
+	contents.clear();
+	unsigned char buf[65536];
+	size_t num;
+	while((num = fread(buf, 1, sizeof(buf), in)) > 0)
+		contents.insert(contents.end(), buf, buf + num);
+	bool ok = (ferror(in) == 0);
+	fclose(in);
+	return ok;
+	}
+
+//checks a header, returning the kind of file and its id
+static bool ReadHeader(const vector<unsigned char> &contents, const char *name, unsigned &kind, unsigned long long &id){
+	if(contents.size() < checkpointHeaderBytes || memcmp(&contents[0], checkpointMagic, 8) != 0)
+		return false;
+	CheckpointReader in(&contents[8], checkpointHeaderBytes - 8);
+	unsigned version = in.GetUInt32();
+	if(version > CHECKPOINT_FORMAT_VERSION)
+		throw ErrorException("Checkpoint file %s was written by a newer version of GARLI (format version %d,\n\tthis version reads up to %d).", name, version, CHECKPOINT_FORMAT_VERSION);
+	kind = in.GetUInt32();
+	id = in.GetUInt64();
+	return true;
+	}
+
+//reads the record starting at pos, returning false if it is incomplete or fails its CRC
+static bool ReadRecord(const vector<unsigned char> &contents, size_t &pos, vector<unsigned char> &record){
+	if(contents.size() - pos < 12) return false;
+	CheckpointReader in(&contents[pos], 12);
+	unsigned long long len = in.GetUInt64();
+	unsigned crc = in.GetUInt32();
+	if(len > contents.size() - pos - 12) return false;
+	const unsigned char *start = &contents[pos + 12];
+	if(Crc32(start, (size_t) len) != crc) return false;
+	record.assign(start, start + len);
+	pos += 12 + (size_t) len;
+	return true;
+	}
+
+CheckpointFile::CheckpointFile() : background(false), baseId(0), baseBytes(0), journalBytes(0), journalRecords(0),
+	pendingFull(false), pendingNewJournal(false), pendingId(0), busy(false), stopRequested(false), threadRunning(false){
+	}
+
+CheckpointFile::~CheckpointFile(){
+	StopThread();
+	}
+
+void CheckpointFile::Setup(const string &ofprefix, bool inBackground){
+	//the writer thread uses the filenames
+	Wait();
+	filename = CheckpointFilename(ofprefix);
+	journalName = filename + ".journal";
+	//whatever is on disk now (from a restart or an earlier run) isn't something that this run can add to
+	baseId = 0;
+	journalBytes = baseBytes = 0;
+	journalRecords = 0;
+	background = inBackground;
+	if(!background)
+		StopThread();
+	}
+
+//the writer thread is only started when the first checkpoint is written.  If it can't be, writes are synchronous
+void CheckpointFile::StartThread(){
+#ifdef UNIX
+	if(threadRunning) return;
+	stopRequested = false;
+	busy = false;
+	pthread_mutex_init(&mutex, NULL);
+	pthread_cond_init(&cond, NULL);
+	if(pthread_create(&thread, NULL, ThreadMain, this) == 0)
+		threadRunning = true;
+	else{
+		pthread_cond_destroy(&cond);
+		pthread_mutex_destroy(&mutex);
+		}
+#endif
+	}
+
+void CheckpointFile::StopThread(){
+#ifdef UNIX
+	if(!threadRunning) return;
+	pthread_mutex_lock(&mutex);
+	stopRequested = true;
+	pthread_cond_broadcast(&cond);
+	pthread_mutex_unlock(&mutex);
+	pthread_join(thread, NULL);
+	pthread_cond_destroy(&cond);
+	pthread_mutex_destroy(&mutex);
+	threadRunning = false;
+#endif
+	}
+
+void CheckpointFile::Commit(CheckpointWriter &record, bool full){
+	assert(!filename.empty());
+	Wait();
+	if(background)
+		StartThread();
+	if(full){
+		//anything unique to this checkpoint will do, as long as it isn't zero
+		static unsigned counter = 0;
+		baseId = ((unsigned long long) time(NULL) << 24) ^ ((unsigned long long) (size_t) this << 4) ^ ++counter;
+		if(baseId == 0) baseId = 1;
+		baseBytes = record.Size();
+		journalBytes = 0;
+		journalRecords = 0;
+		}
+	else{
+		assert(baseId != 0);
+		journalBytes += record.Size();
+		journalRecords++;
+		}
+	bool newJournal = (!full && journalRecords == 1);
+
+#ifdef UNIX
+	if(threadRunning){
+		pthread_mutex_lock(&mutex);
+		pending.swap(record.Buffer());
+		pendingFull = full;
+		pendingNewJournal = newJournal;
+		pendingId = baseId;
+		busy = true;
+		pthread_cond_broadcast(&cond);
+		pthread_mutex_unlock(&mutex);
+		record.Clear();
+		return;
+		}
+#endif
+	string err = WriteRecord(record.Buffer(), full, newJournal, baseId);
+	record.Clear();
+	if(!err.empty()){
+		baseId = 0;
+		throw ErrorException("%s", err.c_str());
+		}
+	}
+
+void CheckpointFile::Wait(){
+#ifdef UNIX
+	if(!threadRunning) return;
+	pthread_mutex_lock(&mutex);
+	while(busy)
+		pthread_cond_wait(&cond, &mutex);
+	string err = error;
+	error.clear();
+	pthread_mutex_unlock(&mutex);
+	if(!err.empty()){
+		//the state of the files is unknown, so start over
+		baseId = 0;
+		throw ErrorException("%s", err.c_str());
+		}
+#endif
+	}
+
+#ifdef UNIX
+void *CheckpointFile::ThreadMain(void *arg){
+	((CheckpointFile *) arg)->WriterLoop();
+	return NULL;
+	}
+
+void CheckpointFile::WriterLoop(){
+	pthread_mutex_lock(&mutex);
+	while(true){
+		while(!busy && !stopRequested)
+			pthread_cond_wait(&cond, &mutex);
+		if(!busy) break;
+		pthread_mutex_unlock(&mutex);
+		string err = WriteRecord(pending, pendingFull, pendingNewJournal, pendingId);
+		pthread_mutex_lock(&mutex);
+		error = err;
+		pending.clear();
+		busy = false;
+		pthread_cond_broadcast(&cond);
+		}
+	pthread_mutex_unlock(&mutex);
+	}
+#endif
+
+string CheckpointFile::WriteRecord(const vector<unsigned char> &record, bool full, bool newJournal, unsigned long long id) const{
+	CheckpointWriter header;
+	string name;
+	const char *mode;
+	if(full){
+		//the new checkpoint only replaces the old one once it is completely written
+		name = filename + ".tmp";
+		mode = "wb";
+		MakeHeader(header, CHECKPOINT_FILE, id);
+		}
+	else{
+		name = journalName;
+		//the first record after a full checkpoint starts a new journal
+		mode = (newJournal ? "wb" : "ab");
+		if(newJournal) MakeHeader(header, CHECKPOINT_JOURNAL, id);
+		}
+	MakeRecordFrame(header, record);
+
+	FILE *out = fopen(name.c_str(), mode);
+	if(out == NULL)
+		return "Could not open checkpoint file " + name + " for writing";
+	bool ok = fwrite(header.Data(), 1, header.Size(), out) == header.Size();
+	if(!record.empty())
+		ok = ok && fwrite(&record[0], 1, record.size(), out) == record.size();
+	ok = (fflush(out) == 0) && ok;
+#ifdef UNIX
+	//make sure that the data are actually on disk before the rename makes them the checkpoint
+	ok = (fsync(fileno(out)) == 0) && ok;
+#endif
+	ok = (fclose(out) == 0) && ok;
+	if(!ok)
+		return "Error writing checkpoint file " + name + " (disk full?)";
+
+	if(full){
+#ifndef UNIX
+		//rename won't replace an existing file on Windows
+		remove(filename.c_str());
+#endif
+		if(rename(name.c_str(), filename.c_str()) != 0)
+			return "Could not move " + name + " into place as " + filename;
+		//the journal belongs to the previous checkpoint
+		remove(journalName.c_str());
+		}
+	return "";
+	}
+
+void CheckpointFile::Load(const string &ofprefix, vector<vector<unsigned char> > &records){
+	string name = CheckpointFilename(ofprefix);
+	vector<unsigned char> contents;
+	if(ReadWholeFile(name.c_str(), contents) == false)
+		throw ErrorException("Could not read checkpoint file %s!", name.c_str());
+	unsigned kind;
+	unsigned long long id;
+	if(ReadHeader(contents, name.c_str(), kind, id) == false || kind != CHECKPOINT_FILE)
+		throw ErrorException("File %s is not a GARLI checkpoint file.", name.c_str());
+	records.clear();
+	records.push_back(vector<unsigned char>());
+	size_t pos = checkpointHeaderBytes;
+	if(ReadRecord(contents, pos, records.back()) == false)
+		throw ErrorException("Error reading checkpoint file %s.\n\tA problem may have occured writing the file to disk, or the file may have been overwritten or truncated.\n\tUnfortunately you'll need to start the run again from scratch.", name.c_str());
+
+	string jname = name + ".journal";
+	if(ReadWholeFile(jname.c_str(), contents) == false)
+		return;
+	unsigned long long jid;
+	if(ReadHeader(contents, jname.c_str(), kind, jid) == false || kind != CHECKPOINT_JOURNAL || jid != id){
+		//left over from before the checkpoint file was last rewritten
+		return;
+		}
+	pos = checkpointHeaderBytes;
+	while(pos < contents.size()){
+		vector<unsigned char> rec;
+		if(ReadRecord(contents, pos, rec) == false){
+			outman.UserMessage("NOTE: the last record of checkpoint journal %s is incomplete (the program\n\tprobably stopped while writing it) and will be ignored", jname.c_str());
+			break;
+			}
+		records.push_back(vector<unsigned char>());
+		records.back().swap(rec);
+		}
+	}
@@ -0,0 +1,257 @@
+// GARLI version 2.1 source code
+// Copyright 2005-2014 Derrick J. Zwickl
+// email: garli.support@gmail.com
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <vector>
+#include <string>
+#include <cstring>
+
+#ifdef UNIX
+#include <pthread.h>
+#endif
+
+#include "errorexception.h"
+
+using namespace std;
+
+//the version of the checkpoint format written.  Readers accept anything up to this.  Fields added to the end
+//of a section don't need a new version, since older readers skip whatever is left of a section
+#define CHECKPOINT_FORMAT_VERSION 1
+
+#define CHECKPOINT_TAG(a, b, c, d) (((unsigned) (a) << 24) | ((unsigned) (b) << 16) | ((unsigned) (c) << 8) | (unsigned) (d))
+
+//a full checkpoint is written instead of an incremental one once the journal has this many records
+#define CHECKPOINT_MAX_JOURNAL_RECORDS 50
+
+unsigned Crc32(const unsigned char *data, size_t len);
+
+//Accumulates checkpoint data field by field, in a fixed (little endian) byte order and with floating point
+//values always stored as doubles, so that a checkpoint can be read by any build of the program on any
+//platform.  Fields are grouped into tagged sections that record their own length.
+class CheckpointWriter{
+	vector<unsigned char> buffer;
+	vector<size_t> openSections;
+
+public:
+	void PutBytes(const void *data, size_t numBytes){
+		buffer.insert(buffer.end(), (const unsigned char *) data, (const unsigned char *) data + numBytes);
+		}
+	void PutUInt32(unsigned val){
+		for(int b = 0;b < 4;b++)
+			buffer.push_back((unsigned char) (val >> (8 * b)));
+		}
+	void PutUInt64(unsigned long long val){
+		for(int b = 0;b < 8;b++)
+			buffer.push_back((unsigned char) (val >> (8 * b)));
+		}
+	void PutInt(int val) {PutUInt32((unsigned) val);}
+	void PutInt64(long long val) {PutUInt64((unsigned long long) val);}
+	void PutBool(bool val) {buffer.push_back(val ? 1 : 0);}
+	void PutDouble(double val){
+		unsigned long long bits;
+		memcpy(&bits, &val, sizeof(bits));
+		PutUInt64(bits);
+		}
+	//the length is stored first, and compared with what the reader expects (see CheckpointReader::ExpectCount)
+	template<class T>
+	void PutDoubles(const T *vals, int num){
+		PutInt(num);
+		for(int i = 0;i < num;i++)
+			PutDouble((double) vals[i]);
+		}
+	void PutInts(const int *vals, int num){
+		PutInt(num);
+		for(int i = 0;i < num;i++)
+			PutInt(vals[i]);
+		}
+	//sections nest, and must be ended in the reverse order that they were begun
+	void BeginSection(unsigned tag){
+		PutUInt32(tag);
+		openSections.push_back(buffer.size());
+		PutUInt64(0);
+		}
+	void EndSection(){
+		size_t start = openSections.back();
+		openSections.pop_back();
+		unsigned long long len = buffer.size() - start - 8;
+		for(int b = 0;b < 8;b++)
+			buffer[start + b] = (unsigned char) (len >> (8 * b));
+		}
+	void Append(const CheckpointWriter &other){
+		buffer.insert(buffer.end(), other.buffer.begin(), other.buffer.end());
+		}
+	void Clear(){
+		buffer.clear();
+		openSections.clear();
+		}
+	size_t Size() const {return buffer.size();}
+	const unsigned char *Data() const {return buffer.empty() ? NULL : &buffer[0];}
+	vector<unsigned char> &Buffer() {return buffer;}
+	};
+
+//Reads back what a CheckpointWriter wrote.  Anything that runs past the end of the data, or that doesn't
+//match the current run, throws
+class CheckpointReader{
+	const unsigned char *pos;
+	const unsigned char *end;
+
+	void Need(unsigned long long numBytes) const{
+		if((unsigned long long) (end - pos) < numBytes)
+			throw ErrorException("Checkpoint file is truncated or corrupt.\n\tUnfortunately you'll need to start the run again from scratch.");
+		}
+
+public:
+	CheckpointReader() : pos(NULL), end(NULL){}
+	CheckpointReader(const unsigned char *start, size_t numBytes) : pos(start), end(start + numBytes){}
+	void GetBytes(void *dest, size_t numBytes){
+		Need(numBytes);
+		memcpy(dest, pos, numBytes);
+		pos += numBytes;
+		}
+	unsigned GetUInt32(){
+		Need(4);
+		unsigned val = 0;
+		for(int b = 0;b < 4;b++)
+			val |= (unsigned) pos[b] << (8 * b);
+		pos += 4;
+		return val;
+		}
+	unsigned long long GetUInt64(){
+		Need(8);
+		unsigned long long val = 0;
+		for(int b = 0;b < 8;b++)
+			val |= (unsigned long long) pos[b] << (8 * b);
+		pos += 8;
+		return val;
+		}
+	int GetInt() {return (int) GetUInt32();}
+	long long GetInt64() {return (long long) GetUInt64();}
+	bool GetBool(){
+		Need(1);
+		return *pos++ != 0;
+		}
+	double GetDouble(){
+		unsigned long long bits = GetUInt64();
+		double val;
+		memcpy(&val, &bits, sizeof(val));
+		return val;
+		}
+	//a count written by PutDoubles or PutInts (or directly) that has to match the current run
+	void ExpectCount(int expected, const char *what){
+		int num = GetInt();
+		if(num != expected)
+			throw ErrorException("The checkpoint has %d %s, but the current run has %d.\n\tThe checkpoint seems to be from a different run or configuration!", num, what, expected);
+		}
+	template<class T>
+	void GetDoubles(T *vals, int num, const char *what){
+		ExpectCount(num, what);
+		for(int i = 0;i < num;i++)
+			vals[i] = (T) GetDouble();
+		}
+	void GetInts(int *vals, int num, const char *what){
+		ExpectCount(num, what);
+		for(int i = 0;i < num;i++)
+			vals[i] = GetInt();
+		}
+	//returns a reader for the contents of the next section, and moves past it.  Whatever isn't read from the
+	//returned reader (fields added by later versions) is simply skipped
+	CheckpointReader NextSection(unsigned &tag){
+		tag = GetUInt32();
+		unsigned long long len = GetUInt64();
+		Need(len);
+		CheckpointReader contents(pos, (size_t) len);
+		pos += len;
+		return contents;
+		}
+	//the same, but the section must be the one expected
+	CheckpointReader Section(unsigned expectedTag){
+		unsigned tag;
+		CheckpointReader contents = NextSection(tag);
+		if(tag != expectedTag)
+			throw ErrorException("Checkpoint file is corrupt (unexpected section).\n\tUnfortunately you'll need to start the run again from scratch.");
+		return contents;
+		}
+	bool AtEnd() const {return pos == end;}
+	};
+
+//The checkpoint file (<ofprefix>.check) and its journal (<ofprefix>.check.journal).  Each starts with a
+//header holding the format version and an id for the full checkpoint, and is followed by records that
+//carry their length and a CRC-32.  The checkpoint file holds one record with the complete state, and is
+//written to a temporary file that is then renamed over the old one, so that a complete checkpoint is
+//always on disk.  Incremental checkpoints are appended to the journal as one record each, holding only
+//what has changed.  A record cut short by the program being killed fails its CRC and is ignored.  The
+//journal is removed whenever a full checkpoint is written, and a journal with an id that doesn't match the
+//checkpoint file is ignored.
+//With background writing (UNIX only) Commit hands the record to a writer thread and returns, after first
+//waiting for the previous write.  Errors in the writer are reported by the next Commit or Wait.
+class CheckpointFile{
+	string filename;
+	string journalName;
+	bool background;
+
+	//bookkeeping for deciding when a full checkpoint is needed.  Only used by the main thread
+	unsigned long long baseId;
+	size_t baseBytes;
+	size_t journalBytes;
+	int journalRecords;
+
+	//the record being written, owned by the writer thread while busy is set
+	vector<unsigned char> pending;
+	bool pendingFull;
+	bool pendingNewJournal;
+	unsigned long long pendingId;
+	bool busy;
+	bool stopRequested;
+	string error;
+	bool threadRunning;
+#ifdef UNIX
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	static void *ThreadMain(void *arg);
+	void WriterLoop();
+#endif
+	//does the actual writing, returning an error message or an empty string
+	string WriteRecord(const vector<unsigned char> &record, bool full, bool newJournal, unsigned long long id) const;
+	void StartThread();
+	void StopThread();
+
+	//not copyable
+	CheckpointFile(const CheckpointFile &);
+	CheckpointFile &operator=(const CheckpointFile &);
+
+public:
+	CheckpointFile();
+	~CheckpointFile();
+
+	static string CheckpointFilename(const string &ofprefix) {return ofprefix + ".check";}
+	void Setup(const string &ofprefix, bool inBackground);
+	//whether the next checkpoint has to be a full one
+	bool NeedFull() const {return baseId == 0 || journalRecords >= CHECKPOINT_MAX_JOURNAL_RECORDS || journalBytes > baseBytes;}
+	//writes a record, taking its contents
+	void Commit(CheckpointWriter &record, bool full);
+	//waits for any write in progress, and throws if it failed
+	void Wait();
+
+	//reads the full checkpoint and any complete journal records after it, in order
+	static void Load(const string &ofprefix, vector<vector<unsigned char> > &records);
+	};
+
+#endif
@@ -49,6 +49,7 @@ class ClaManager{
 	int numClas;
 	int numHolders;
 	int maxUsed;
+	unsigned long long numRecycled;//arrays taken back from holders by RecycleClas
 	CondLikeArraySet **allClas; //these are the actual sets of arrays to be used in calculations, but will assigned to 
 							 //nodes via a CondLikeArrayHolder.  There may be a limited number						 
 
@@ -84,6 +85,7 @@ class ClaManager{
 */
 	ClaManager(int nnod, int nClas, int nHolders, const ModelPartition *mods, const DataPartition *data) : numNodes(nnod), numClas(nClas), numHolders(nHolders){
 		maxUsed=0;
+		numRecycled=0;
 		allClas=new CondLikeArraySet*[numClas];
 		claStack.reserve(numClas);
 		for(int i=numClas-1;i>=0;i--){
@@ -118,6 +120,7 @@ class ClaManager{
 	int MaxUsedClas() {return maxUsed;}
 	int NumFreeClas() {return (int) claStack.size();}
 	int NumFreeHolders() {return (int) holderStack.size();}
+	unsigned long long NumRecycledClas() {return numRecycled;}
 
 
 	int AssignClaHolder();
@@ -96,6 +96,7 @@ void ClaManager::RecycleClas(){
 				holders[i].SetReclaimLevel(0);
 				holders[i].theSet=NULL;
 				numReclaimed++;
+				numRecycled++;
 				}
 			}
 		if(memLevel < 2) 
@@ -111,6 +112,7 @@ void ClaManager::RecycleClas(){
 				holders[i].SetReclaimLevel(0);
 				holders[i].theSet=NULL;
 				numReclaimed++;
+				numRecycled++;
 				}
 			}
 		if(numReclaimed == 20) 
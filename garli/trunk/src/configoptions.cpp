@@ -20,6 +20,9 @@
 #include <iostream>
 #include <vector>
 #include <climits>
+#include <cstdlib>
+#include <algorithm>
+#include <cctype>
 
 using namespace std;
 
@@ -44,7 +47,9 @@ GeneralGamlConfig::GeneralGamlConfig(){
 	outputPhylipTree = false;
 	outputCurrentBestTopology = false;
 	collapseBranches = false;
+	outputSplitFrequencies = false;
 	outputSitelikelihoods = 0;
+	siteLikelihoodFormat = "text";
 	reportRunProgress = 0;
 
 	//starting the run
@@ -61,8 +66,11 @@ GeneralGamlConfig::GeneralGamlConfig(){
 	megsClaMemory = 512;
 	restart = false;
 	checkpoint = false;
+	incrementalCheckpoints = false;
+	backgroundCheckpoints = true;
 	significantTopoChange = (FLOAT_TYPE)0.01;
 	searchReps = 1;
+	parallelReplicates = 1;
 	//this isn't for general consumption, but lets me easily enable hacked in features
 	runmode = 0;
 	scoreOnly = false;
@@ -74,6 +82,7 @@ GeneralGamlConfig::GeneralGamlConfig(){
 	alternateAlignmentMode = "none";
 
 	attachmentsPerTaxon = 50;
+	stepwiseProcesses = 1;
 
 	siteWindowLength = 0;
 	siteWindowStride = 0;
@@ -81,6 +90,16 @@ GeneralGamlConfig::GeneralGamlConfig(){
 	combineAdjacentIdenticalGapPatterns = false;
 
 	usePatternManager = true;
+	streamingDataReader = false;
+	dataCache = false;
+	packedTipData = false;
+	profile = false;
+	profileReportInterval = 300;
+	hardwareCounters = false;
+	hardwareCounterFlopEvent = 0;
+	telemetryEvery = 0;
+	telemetryFormat = "json";
+	asyncOutput = false;
 	rootAtBranchMidpoint = false;
 	useOptBoundedForBlen = false;
 	optimizeInputOnly = false;
@@ -117,6 +136,7 @@ GeneralGamlConfig::GeneralGamlConfig(){
 		limSPRweight = (FLOAT_TYPE)0.6;
 	modWeight = (FLOAT_TYPE)0.05;
 	brlenWeight = (FLOAT_TYPE)0.2;
+	computeWeightedAdaptation = false;
 
 	intervalLength = 100;
 	intervalsToStore = 5;
@@ -133,6 +153,7 @@ GeneralGamlConfig::GeneralGamlConfig(){
 	inferInternalStateProbs = false;
 	bootstrapReps = 0;
 	resampleProportion = 1.0;
+	rellBootstrapReps = 0;
 
 	sendInterval = 60.0;
 
@@ -176,7 +197,12 @@ int GeneralGamlConfig::Read(const char* fname, bool isMaster /*=false*/)	{
 	errors += cr.GetPositiveNonZeroDoubleOption("scorethreshforterm", improveOverStoredIntervalsThresh);
 	cr.GetPositiveNonZeroDoubleOption("significanttopochange", significantTopoChange, true);
 	cr.GetUnsignedNonZeroOption("attachmentspertaxon", attachmentsPerTaxon, true);
+	cr.GetUnsignedNonZeroOption("stepwiseprocesses", stepwiseProcesses, true);
 	cr.GetUnsignedOption("outputsitelikelihoods", outputSitelikelihoods, true);
+	cr.GetStringOption("sitelikelihoodformat", siteLikelihoodFormat, true);
+	transform(siteLikelihoodFormat.begin(), siteLikelihoodFormat.end(), siteLikelihoodFormat.begin(), ::tolower);
+	if(siteLikelihoodFormat != "text" && siteLikelihoodFormat != "binary")
+		throw ErrorException("sitelikelihoodformat must be either \"text\" or \"binary\"");
 	cr.GetBoolOption("reportrunprogress", reportRunProgress, true);
 	cr.GetBoolOption("optimizeinputonly", optimizeInputOnly, true);
 
@@ -185,12 +211,33 @@ int GeneralGamlConfig::Read(const char* fname, bool isMaster /*=false*/)	{
 	cr.GetBoolOption("outputmostlyuselessfiles", outputMostlyUselessFiles, true);
 	cr.GetBoolOption("outputphyliptree", outputPhylipTree, true);
 	cr.GetBoolOption("collapsebranches", collapseBranches, true);
+	cr.GetBoolOption("outputsplitfrequencies", outputSplitFrequencies, true);
 	cr.GetIntOption("genthreshforswapterm", swapTermThreshold, true);
 
 	cr.GetStringOption("arbitrarystring", arbitraryString, true);
 	cr.GetUnsignedOption("windowlength", siteWindowLength, true);
 	cr.GetUnsignedOption("windowstride", siteWindowStride, true);
 	cr.GetBoolOption("usepatternmanager", usePatternManager, true);
+	cr.GetBoolOption("streamingdatareader", streamingDataReader, true);
+	cr.GetBoolOption("datacache", dataCache, true);
+	cr.GetBoolOption("packedtipdata", packedTipData, true);
+	cr.GetBoolOption("profile", profile, true);
+	cr.GetUnsignedOption("profilereportinterval", profileReportInterval, true);
+	cr.GetBoolOption("hardwarecounters", hardwareCounters, true);
+	string flopEvent;
+	if(cr.GetStringOption("hardwarecounterflopevent", flopEvent, true) == 0 && flopEvent.empty() == false){
+		//in hex, as perf list shows them (e.g. 0x1fc7), with or without the 0x
+		char *end;
+		hardwareCounterFlopEvent = strtoull(flopEvent.c_str(), &end, 16);
+		if(*end != '\0' || hardwareCounterFlopEvent == 0)
+			throw ErrorException("hardwarecounterflopevent must be a raw event code in hex, such as 0x1fc7");
+		}
+	cr.GetUnsignedOption("telemetryevery", telemetryEvery, true);
+	cr.GetStringOption("telemetryformat", telemetryFormat, true);
+	transform(telemetryFormat.begin(), telemetryFormat.end(), telemetryFormat.begin(), ::tolower);
+	if(telemetryFormat != "json" && telemetryFormat != "csv")
+		throw ErrorException("telemetryformat must be either \"json\" or \"csv\"");
+	cr.GetBoolOption("asyncoutput", asyncOutput, true);
 	cr.GetStringOption("parametervaluestring", parameterValueString, true);
 	cr.GetBoolOption("combineadjacentidenticalgappatterns", combineAdjacentIdenticalGapPatterns, true);
 
@@ -208,8 +255,11 @@ int GeneralGamlConfig::Read(const char* fname, bool isMaster /*=false*/)	{
 
 	cr.GetBoolOption("restart", restart, true);
 	cr.GetBoolOption("writecheckpoints", checkpoint, true);
+	cr.GetBoolOption("incrementalcheckpoints", incrementalCheckpoints, true);
+	cr.GetBoolOption("backgroundcheckpoints", backgroundCheckpoints, true);
 
 	cr.GetUnsignedNonZeroOption("searchreps", searchReps, true);
+	cr.GetUnsignedNonZeroOption("parallelreplicates", parallelReplicates, true);
 	cr.GetUnsignedOption("runmode", runmode, true);
 	cr.GetBoolOption("scoreonly", scoreOnly, true);
 
@@ -218,6 +268,7 @@ int GeneralGamlConfig::Read(const char* fname, bool isMaster /*=false*/)	{
 	cr.GetUnsignedOption("bootstrapreps", bootstrapReps, true);
 	cr.GetPositiveNonZeroDoubleOption("resampleproportion", resampleProportion, true);
 	cr.GetBoolOption("inferinternalstateprobs", inferInternalStateProbs, true);
+	cr.GetUnsignedOption("rellbootstrapreps", rellBootstrapReps, true);
 
 	cr.GetBoolOption("workphasedivision", workPhaseDivision, true);
 
@@ -274,6 +325,7 @@ int GeneralGamlConfig::Read(const char* fname, bool isMaster /*=false*/)	{
 	errors += cr.GetPositiveDoubleOption("randnniweight", randNNIweight);
 	errors += cr.GetPositiveDoubleOption("randsprweight", randSPRweight);	
 	errors += cr.GetPositiveDoubleOption("limsprweight", limSPRweight);
+	cr.GetBoolOption("computeweightedadaptation", computeWeightedAdaptation, true);
 	
 	cr.GetPositiveNonZeroDoubleOption("uniqueswapbias", uniqueSwapBias, true);
 	cr.GetPositiveNonZeroDoubleOption("distanceswapbias", distanceSwapBias, true);
@@ -283,6 +335,7 @@ int GeneralGamlConfig::Read(const char* fname, bool isMaster /*=false*/)	{
 	cr.GetUnsignedOption("bootstrapreps", bootstrapReps, true);
 	cr.GetPositiveNonZeroDoubleOption("resampleproportion", resampleProportion, true);
 	cr.GetBoolOption("inferinternalstateprobs", inferInternalStateProbs, true);
+	cr.GetUnsignedOption("rellbootstrapreps", rellBootstrapReps, true);
 #ifdef MPI_VERSION
 	if(bootstrapReps != 0) throw ErrorException("Sorry, Bootstrap not yet implemented in parallel GARLI!");
 #endif
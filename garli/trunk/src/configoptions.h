@@ -61,6 +61,7 @@ class GeneralGamlConfig{
 	bool outputCurrentBestTopology;
 
 	bool collapseBranches;
+	bool outputSplitFrequencies;
 	//this is just a string that I can use for whatever I want in special runmodes
 	string arbitraryString;
 	unsigned int siteWindowLength;
@@ -68,6 +69,16 @@ class GeneralGamlConfig{
 	bool combineAdjacentIdenticalGapPatterns;
 
 	bool usePatternManager;
+	bool streamingDataReader;
+	bool dataCache;
+	bool packedTipData;
+	bool profile;
+	unsigned profileReportInterval;
+	bool hardwareCounters;
+	unsigned long long hardwareCounterFlopEvent;//a raw perf event code, 0 if FLOPs aren't counted
+	unsigned telemetryEvery;
+	string telemetryFormat;
+	bool asyncOutput;
 	bool rootAtBranchMidpoint;
 	bool useOptBoundedForBlen;
 	string parameterValueString;
@@ -87,11 +98,15 @@ class GeneralGamlConfig{
 	FLOAT_TYPE availableMemory;
 	bool restart;
 	bool checkpoint;
+	bool incrementalCheckpoints;
+	bool backgroundCheckpoints;
 	FLOAT_TYPE significantTopoChange;
 	string outgroupString;
 	unsigned searchReps;
+	unsigned parallelReplicates;
 	unsigned runmode;
 	unsigned outputSitelikelihoods;
+	string siteLikelihoodFormat;
 	bool reportRunProgress;
 	bool scoreOnly;
 
@@ -106,6 +121,7 @@ class GeneralGamlConfig{
 	int swapTermThreshold;
 
 	unsigned attachmentsPerTaxon;
+	unsigned stepwiseProcesses;
 
 	bool workPhaseDivision;
 
@@ -149,6 +165,7 @@ class GeneralGamlConfig{
 //      FLOAT_TYPE randPECRweight;
 	FLOAT_TYPE modWeight;
 	FLOAT_TYPE brlenWeight;
+	bool computeWeightedAdaptation;
 
 	unsigned intervalLength;
 	unsigned intervalsToStore;
@@ -165,6 +182,7 @@ class GeneralGamlConfig{
 	unsigned bootstrapReps;
 	FLOAT_TYPE resampleProportion;
 	bool inferInternalStateProbs;
+	unsigned rellBootstrapReps;
 
 #ifdef INCLUDE_PERTURBATION
 	//perturbation parameters
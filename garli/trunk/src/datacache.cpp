@@ -0,0 +1,165 @@
+// GARLI version 2.1 source code
+// Copyright 2005-2014 Derrick J. Zwickl
+// email: garli.support@gmail.com
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cstdio>
+
+#include "defs.h"
+#include "datacache.h"
+#include "configoptions.h"
+#include "outputman.h"
+
+extern OutputManager outman;
+
+//this must be incremented whenever the layout of the cache or of the processed data changes
+static const unsigned cacheFormatVersion = 1;
+static const char cacheMagic[8] = {'G', 'A', 'R', 'L', 'I', 'D', 'C', '\0'};
+
+string DataCache::ConfigKey(const GeneralGamlConfig &conf){
+	char str[100];
+	sprintf(str, "int=%d float=%d ignorestopcodons=%d", (int) sizeof(int), (int) sizeof(FLOAT_TYPE), (int) conf.ignoreStopCodons);
+	string key = str;
+	for(vector<ConfigModelSettings>::const_iterator it = conf.configModelSets.begin();it != conf.configModelSets.end();it++)
+		key += " datatype=" + it->datatype + " geneticcode=" + it->geneticCode;
+	return key;
+	}
+
+bool DataCache::HashDataFile(const char *datafname, PatternHash &hash){
+	MappedFile data;
+	if(!data.Open(datafname)) return false;
+	hash = HashPattern(data.Data(), data.Size());
+	return true;
+	}
+
+bool DataCache::Load(const char *cacheName, const PatternHash &dataHash, const string &configKey){
+	Close();
+	if(!file.Open(cacheName)) return false;
+	try{
+		DataCacheReader in(file.Data(), file.Data() + file.Size());
+		char magic[8];
+		in.GetArray(magic, 8);
+		if(memcmp(magic, cacheMagic, 8) != 0 || in.Get<unsigned>() != cacheFormatVersion || in.Get<PatternHash>() != dataHash){
+			Close();
+			return false;
+			}
+		//the payload is checksummed, so that a damaged cache is rebuilt rather than used
+		unsigned long long payloadSize = in.Get<unsigned long long>();
+		PatternHash payloadHash = in.Get<PatternHash>();
+		if(payloadSize != in.Remaining() || HashPattern(in.Position(), in.Remaining()) != payloadHash){
+			outman.UserMessage("NOTE: data cache file %s is damaged and will be rebuilt", cacheName);
+			Close();
+			return false;
+			}
+		if(in.GetString() != configKey){
+			Close();
+			return false;
+			}
+		int nTax = in.Get<int>();
+		for(int t = 0;t < nTax;t++)
+			taxonLabels.push_back(in.GetString());
+		int numSubsets = in.Get<int>();
+		for(int s = 0;s < numSubsets;s++){
+			int garliSubsetNum = in.Get<int>();
+			int charblockNum = in.Get<int>();
+			string charblockName = in.GetString();
+			int partitionSubsetNum = in.Get<int>();
+			string partitionSubsetName = in.GetString();
+			DataSubsetInfo::type readAs = (DataSubsetInfo::type) in.Get<int>();
+			DataSubsetInfo::type usedAs = (DataSubsetInfo::type) in.Get<int>();
+			subsetInfo.push_back(DataSubsetInfo(garliSubsetNum, charblockNum, charblockName, partitionSubsetNum, partitionSubsetName, readAs, usedAs));
+			size_t len;
+			const char *start = in.GetBlock(len);
+			subsetStart.push_back(start);
+			subsetEnd.push_back(start + len);
+			}
+		if(!in.AtEnd() || numSubsets == 0){
+			Close();
+			return false;
+			}
+		}
+	catch(ErrorException &){
+		Close();
+		return false;
+		}
+	return true;
+	}
+
+void DataCache::Close(){
+	file.Close();
+	taxonLabels.clear();
+	subsetInfo.clear();
+	subsetStart.clear();
+	subsetEnd.clear();
+	}
+
+void DataCache::ReadSubset(int s, SequenceData *data) const{
+	DataCacheReader in(subsetStart[s], subsetEnd[s]);
+	data->ReadCache(in);
+	if(!in.AtEnd())
+		throw ErrorException("Data cache file is truncated or corrupt");
+	}
+
+void DataCache::Write(const char *cacheName, const PatternHash &dataHash, const string &configKey, const vector<string> &labels, const vector<DataSubsetInfo> &info, const DataPartition &data){
+	assert((int) info.size() == data.NumSubsets());
+	DataCacheWriter payload;
+	payload.PutString(configKey);
+	payload.Put((int) labels.size());
+	for(vector<string>::const_iterator it = labels.begin();it != labels.end();it++)
+		payload.PutString(*it);
+	payload.Put((int) data.NumSubsets());
+	for(int s = 0;s < data.NumSubsets();s++){
+		payload.Put(info[s].garliSubsetNum);
+		payload.Put(info[s].charblockNum);
+		payload.PutString(info[s].charblockName);
+		payload.Put(info[s].partitionSubsetNum);
+		payload.PutString(info[s].partitionSubsetName);
+		payload.Put((int) info[s].readAs);
+		payload.Put((int) info[s].usedAs);
+		DataCacheWriter sub;
+		data.GetSubset(s)->WriteCache(sub);
+		payload.PutVector(sub.Buffer());
+		}
+
+	const vector<char> &buf = payload.Buffer();
+	DataCacheWriter header;
+	header.PutArray(cacheMagic, 8);
+	header.Put(cacheFormatVersion);
+	header.Put(dataHash);
+	header.Put((unsigned long long) buf.size());
+	header.Put(HashPattern(&buf[0], buf.size()));
+
+	//write to a temporary file and then move it into place, so that an interrupted run never leaves
+	//a partial cache behind
+	string tempName = string(cacheName) + ".tmp";
+	FILE *out = fopen(tempName.c_str(), "wb");
+	if(out == NULL){
+		outman.UserMessage("NOTE: could not write data cache file %s", cacheName);
+		return;
+		}
+	bool ok = fwrite(&header.Buffer()[0], 1, header.Buffer().size(), out) == header.Buffer().size();
+	ok = ok && fwrite(&buf[0], 1, buf.size(), out) == buf.size();
+	ok = (fclose(out) == 0) && ok;
+#ifndef UNIX
+	//rename won't replace an existing file on Windows
+	if(ok) remove(cacheName);
+#endif
+	if(!ok || rename(tempName.c_str(), cacheName) != 0){
+		remove(tempName.c_str());
+		outman.UserMessage("NOTE: could not write data cache file %s", cacheName);
+		return;
+		}
+	outman.UserMessage("Processed data saved to cache file %s", cacheName);
+	}
@@ -0,0 +1,148 @@
+// GARLI version 2.1 source code
+// Copyright 2005-2014 Derrick J. Zwickl
+// email: garli.support@gmail.com
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DATA_CACHE_H
+#define DATA_CACHE_H
+
+#include <vector>
+#include <string>
+#include <cstring>
+
+#include "errorexception.h"
+#include "mappedfile.h"
+#include "patternhash.h"
+#include "sequencedata.h"
+
+using namespace std;
+
+class GeneralGamlConfig;
+
+//Accumulates the binary contents of a data cache.  Everything is written in the native layout, since the
+//cache is only ever read back on the machine (or at least the kind of machine) that wrote it
+class DataCacheWriter{
+	vector<char> buffer;
+
+public:
+	void PutBytes(const void *data, size_t numBytes){
+		buffer.insert(buffer.end(), (const char *) data, (const char *) data + numBytes);
+		}
+	template<class T>
+	void Put(const T &val){
+		PutBytes(&val, sizeof(T));
+		}
+	template<class T>
+	void PutArray(const T *vals, size_t num){
+		if(num > 0) PutBytes(vals, num * sizeof(T));
+		}
+	template<class T>
+	void PutVector(const vector<T> &vals){
+		Put((unsigned long long) vals.size());
+		if(!vals.empty()) PutArray(&vals[0], vals.size());
+		}
+	void PutString(const string &str){
+		Put((unsigned long long) str.length());
+		PutBytes(str.data(), str.length());
+		}
+	const vector<char> &Buffer() const {return buffer;}
+	};
+
+//Reads back what a DataCacheWriter wrote, directly from the mapped cache file
+class DataCacheReader{
+	const char *pos;
+	const char *end;
+
+public:
+	DataCacheReader(const char *start, const char *stop) : pos(start), end(stop){}
+	void GetBytes(void *dest, size_t numBytes){
+		if((size_t) (end - pos) < numBytes)
+			throw ErrorException("Data cache file is truncated or corrupt");
+		memcpy(dest, pos, numBytes);
+		pos += numBytes;
+		}
+	template<class T>
+	T Get(){
+		T val;
+		GetBytes(&val, sizeof(T));
+		return val;
+		}
+	template<class T>
+	void GetArray(T *dest, size_t num){
+		if(num > 0) GetBytes(dest, num * sizeof(T));
+		}
+	template<class T>
+	void GetVector(vector<T> &vals){
+		unsigned long long num = Get<unsigned long long>();
+		if(num > (unsigned long long) (end - pos) / sizeof(T))
+			throw ErrorException("Data cache file is truncated or corrupt");
+		vals.resize((size_t) num);
+		if(num > 0) GetArray(&vals[0], (size_t) num);
+		}
+	string GetString(){
+		unsigned long long len = Get<unsigned long long>();
+		if(len > (unsigned long long) (end - pos))
+			throw ErrorException("Data cache file is truncated or corrupt");
+		string str(pos, (size_t) len);
+		pos += len;
+		return str;
+		}
+	//returns a block written by PutVector from a char vector, without copying it
+	const char *GetBlock(size_t &numBytes){
+		unsigned long long len = Get<unsigned long long>();
+		if(len > (unsigned long long) (end - pos))
+			throw ErrorException("Data cache file is truncated or corrupt");
+		const char *start = pos;
+		pos += len;
+		numBytes = (size_t) len;
+		return start;
+		}
+	const char *Position() const {return pos;}
+	size_t Remaining() const {return end - pos;}
+	bool AtEnd() const {return pos == end;}
+	};
+
+//A binary copy of the fully processed data (datacache = 1), stored next to the data file as
+//<datafname>.garlicache.  It holds the taxon labels and, for each data subset, the compressed
+//patterns, counts, constant site information and column mappings, so that a later run on the same
+//data (restarts, jobloop jobs, repeated analyses) can skip NCL parsing, codon/amino acid translation
+//and pattern compression entirely.  The cache is only used if it was made from identical data file
+//contents and the same data related settings (see ConfigKey), and is otherwise silently rebuilt.
+class DataCache{
+	MappedFile file;
+	vector<string> taxonLabels;
+	vector<DataSubsetInfo> subsetInfo;
+	vector<const char *> subsetStart;
+	vector<const char *> subsetEnd;
+
+public:
+	static string CacheFilename(const string &datafname) {return datafname + ".garlicache";}
+	//the settings that affect the processed data
+	static string ConfigKey(const GeneralGamlConfig &conf);
+	static bool HashDataFile(const char *datafname, PatternHash &hash);
+
+	//returns false if there is no usable cache for this data and configuration
+	bool Load(const char *cacheName, const PatternHash &dataHash, const string &configKey);
+	void Close();
+	static void Write(const char *cacheName, const PatternHash &dataHash, const string &configKey, const vector<string> &labels, const vector<DataSubsetInfo> &info, const DataPartition &data);
+
+	const vector<string> &TaxonLabels() const {return taxonLabels;}
+	int NumSubsets() const {return (int) subsetInfo.size();}
+	const DataSubsetInfo &SubsetInfo(int s) const {return subsetInfo[s];}
+	//fills a newly created data object of the appropriate type with subset s
+	void ReadSubset(int s, SequenceData *data) const;
+	};
+
+#endif
@@ -34,6 +34,9 @@ using namespace std;
 #include "model.h"
 #include "garlireader.h"
 #include "stopwatch.h"
+#include "alignreader.h"
+#include "datacache.h"
+#include "patternhash.h"
 
 //extern ModelSpecification modSpec;
 
@@ -237,26 +240,67 @@ int SitePattern::MinScore(set<unsigned char> patt, int bound, unsigned char bits
 	return min_sc_this_lvl;
 	}
 
-//Collapse merges like patterns, transfering over the counts and site numbers represented by each sucessive identical column.
-//Patterns that are assigned zero counts here will be removed in Pack(), but will still contribute to the numNonMissingRealSitesInOrigMatrix, except
-//for those with zero states (= missing)
-void PatternManager::NewCollapse(){
-	list<SitePattern>::iterator first;
-	list<SitePattern>::iterator second  = patterns.begin();
-
-	while(second != patterns.end()){
-		first = second++;
-		while(second != patterns.end() && (*first == *second)){
-			(*first).count += (*second).count;
-			(*first).siteNumbers.insert((*first).siteNumbers.end(), (*second).siteNumbers.begin(), (*second).siteNumbers.end());
-			//if a wtset was used, this definitely doesn't need to be the case
-			//assert((*first).count == (*first).siteNumbers.size());
-			(*second).count = 0;
-			second++;
+//compares two of the patterns being collapsed, by index
+struct SamePattern{
+	const vector<SitePattern *> &pats;
+	int pat;
+	SamePattern(const vector<SitePattern *> &p, int pa) : pats(p), pat(pa){}
+	bool operator()(int other) const {
+		return pats[other]->stateVec == pats[pat]->stateVec;
+		}
+	};
+
+struct SitePatternPtrLess{
+	bool operator()(const SitePattern *lhs, const SitePattern *rhs) const {
+		return *lhs < *rhs;
+		}
+	};
+
+//Collapse merges like patterns, finding identical ones with a 128 bit hash of each (verified by full comparison)
+//rather than by sorting all of them.  Blocks of patterns are collapsed in parallel, then the blocks are merged in
+//order.  The counts and site numbers of duplicates are transfered to the first copy of each pattern, and duplicates
+//and missing patterns are left with zero counts, so that they are dropped in NewSortedPack().
+void PatternManager::NewHashCollapse(){
+	vector<SitePattern *> pats;
+	pats.reserve(patterns.size());
+	for(list<SitePattern>::iterator pit = patterns.begin();pit != patterns.end();pit++)
+		pats.push_back(&(*pit));
+	int numPats = pats.size();
+	size_t patBytes = numTax * sizeof(StateVector::value_type);
+	vector<PatternHash> hashes(numPats);
+	//firstCopy is the first identical pattern within the same block, and then overall
+	vector<int> firstCopy(numPats);
+
+	const int blockSize = 4096;
+	int numBlocks = (numPats + blockSize - 1) / blockSize;
+#ifdef OPEN_MP
+#pragma omp parallel for schedule(dynamic)
+#endif
+	for(int b = 0;b < numBlocks;b++){
+		int start = b * blockSize;
+		int end = min(numPats, start + blockSize);
+		PatternHashTable local(end - start);
+		for(int p = start;p < end;p++){
+			hashes[p] = HashPattern(&pats[p]->stateVec[0], patBytes);
+			firstCopy[p] = local.FindOrInsert(hashes[p], p, SamePattern(pats, p));
+			}
+		}
+
+	PatternHashTable table(numPats / 4);
+	for(int p = 0;p < numPats;p++){
+		//a pattern matching an earlier one in its block needs no lookup, since that one was already merged
+		if(firstCopy[p] == p)
+			firstCopy[p] = table.FindOrInsert(hashes[p], p, SamePattern(pats, p));
+		else
+			firstCopy[p] = firstCopy[firstCopy[p]];
+		if(firstCopy[p] != p){
+			SitePattern *first = pats[firstCopy[p]];
+			first->count += pats[p]->count;
+			first->siteNumbers.insert(first->siteNumbers.end(), pats[p]->siteNumbers.begin(), pats[p]->siteNumbers.end());
+			pats[p]->count = 0;
 			}
 		}
-	//this will zero the count of all missing pats, which will make them not get put into the uniquePatterns
-	//list in NewPack
+
 	for(list<SitePattern>::iterator pit = patterns.begin();pit != patterns.end();pit++){
 		if((*pit).numStates == 0){
 			(*pit).count = 0;
@@ -264,20 +308,17 @@ void PatternManager::NewCollapse(){
 		}
 	}
 
-void PatternManager::NewSort(){
-	//this is the stl list sort function, using SitePattern::operator<
-	patterns.sort();
-	}
-
-// This version of pack copies unique patterns from the patterns list into the uniquePatterns list
-void PatternManager::NewPack(){
+//copies the remaining unique patterns into uniquePatterns, sorted with SitePattern::operator<.  Since they
+//are all different the order is fully determined, and only the unique patterns need to be sorted
+void PatternManager::NewSortedPack(){
+	vector<SitePattern *> unique;
 	for(list<SitePattern>::iterator pit = patterns.begin();pit != patterns.end();pit++){
-		if(pit->numStates > 0){
-			if(pit->count > 0){ 
-				uniquePatterns.push_back(*pit);
-				}
-			}
+		if(pit->numStates > 0 && pit->count > 0)
+			unique.push_back(&(*pit));
 		}
+	sort(unique.begin(), unique.end(), SitePatternPtrLess());
+	for(vector<SitePattern *>::iterator uit = unique.begin();uit != unique.end();uit++)
+		uniquePatterns.push_back(**uit);
 	pman_numPatterns = uniquePatterns.size();
 	compressed = true;
 	}
@@ -287,9 +328,8 @@ void PatternManager::NewPack(){
 //this will only be used for nuc/AA/codon data
 void PatternManager::ProcessPatterns(){
 	CalcPatternTypesAndNumStates();
-	NewSort();
-	NewCollapse();
-	NewPack();
+	NewHashCollapse();
+	NewSortedPack();
 	NewDetermineConstantSites();
 	}
 
@@ -303,8 +343,10 @@ void PatternManager::CalcPatternTypesAndNumStates(){
 
 	pman_numMissingChars = pman_numConstantChars = pman_numInformativeChars = pman_numUninformVariableChars = pman_numNonMissingRealCountsInOrigMatrix = 0;
 
-	pman_numRealSitesInOrigMatrix = patterns.size();
+	//patterns usually represent a single column at this point, but those from the streaming reader are already collapsed
+	pman_numRealSitesInOrigMatrix = 0;
 	for(list<SitePattern>::iterator pit = patterns.begin();pit != patterns.end();pit++){
+		pman_numRealSitesInOrigMatrix += pit->siteNumbers.size();
 		int t = pit->CalcPatternTypeAndNumStates(s);
 		//Fixed 2 bugs - It is important to calculate numNonMissingRealCountsInOrigMatrix here from counts of the  
 		//the generally unpacked data, because it could effectively be partially packed due to the use of a wtset, 
@@ -375,9 +417,9 @@ void PatternManager::NewDetermineConstantSites(){
 //This takes the unique pattern types and uses their siteNumbers vector to map back to the original
 //ordering of sites, as used to tbe stored in the number array.
 void PatternManager::FillNumberVector(vector<int> &nums) const{
-	if(nums.size() != patterns.size()){
+	if((int) nums.size() != pman_numRealSitesInOrigMatrix){
 		nums.clear();
-		nums.resize(patterns.size());
+		nums.resize(pman_numRealSitesInOrigMatrix);
 		}
 	
 	//this is necessary so that all missing patterns, which should already have been removed from
@@ -526,6 +568,96 @@ void DataMatrix::CreateMatrixFromOtherMatrix(const DataMatrix &other, int startI
 
 	}
 
+void DataMatrix::CreateMatrixFromStreamedAlignment(const StreamingAlignmentReader &aln){
+	if(!usePatternManager)
+		throw ErrorException("The streaming data reader requires the pattern manager (usepatternmanager = 1)");
+	//only allocate the taxon labels here.  The compressed matrix is allocated when the patterns are taken back
+	//out of the patman
+	NewMatrix(aln.NTax(), 0);
+	MEM_NEW_ARRAY(origDataNumber,int,aln.NChar());
+	for(int j = 0;j < aln.NChar();j++)
+		origDataNumber[j] = j;
+	numRealSitesInOrigMatrix = numNonMissingRealSitesInOrigMatrix = aln.NChar();
+	patman.Initialize(aln.NTax(), maxNumStates);
+
+	for(int t = 0;t < nTax;t++)
+		SetTaxonLabel(t, NxsString::GetEscaped(aln.TaxonLabel(t)).c_str());
+
+	//these are already unique, but go through the usual sorting and packing
+	for(int p = 0;p < aln.NumPatterns();p++){
+		SitePattern thisPat;
+		const unsigned char *states = aln.Pattern(p);
+		thisPat.stateVec.assign(states, states + nTax);
+		thisPat.siteNumbers = aln.PatternSites(p);
+		thisPat.SetCount(aln.PatternCount(p));
+		patman.AddPattern(thisPat);
+		}
+	}
+
+void DataMatrix::WriteCache(DataCacheWriter &out) const{
+	//only matrices that were processed by the patman are cached
+	assert(usePatternManager && numConditioningPatterns == 0);
+	out.Put(nTax);
+	out.Put(maxNumStates);
+	out.Put(fullyAmbigChar);
+	out.Put(numPatterns);
+	out.Put(numRealSitesInOrigMatrix);
+	out.Put(numNonMissingRealSitesInOrigMatrix);
+	out.Put(numNonMissingRealCountsInOrigMatrix);
+	out.Put(numMissingChars);
+	out.Put(numConstantChars);
+	out.Put(numInformativeChars);
+	out.Put(numVariableUninformChars);
+	out.Put(lastConstant);
+	out.Put(dense);
+	out.PutString(wtsetName);
+	for(int t = 0;t < nTax;t++)
+		out.PutString(taxonLabel[t]);
+	for(int t = 0;t < nTax;t++)
+		out.PutArray(matrix[t], numPatterns);
+	out.PutVector(newNumber);
+	out.PutVector(newCount);
+	out.PutVector(newNumStates);
+	out.PutVector(newConstStates);
+	out.PutArray(origDataNumber, numRealSitesInOrigMatrix);
+	}
+
+void DataMatrix::ReadCache(DataCacheReader &in){
+	if(!usePatternManager)
+		throw ErrorException("The data cache requires the pattern manager (usepatternmanager = 1)");
+	int nt = in.Get<int>();
+	maxNumStates = in.Get<int>();
+	fullyAmbigChar = in.Get<unsigned char>();
+	int nPat = in.Get<int>();
+	//as in CreateMatrixFromStreamedAlignment, the uncompressed matrix is never allocated
+	NewMatrix(nt, 0);
+	ResizeCharacterNumberDependentVariables(nPat);
+	numRealSitesInOrigMatrix = in.Get<int>();
+	numNonMissingRealSitesInOrigMatrix = in.Get<int>();
+	numNonMissingRealCountsInOrigMatrix = in.Get<int>();
+	numMissingChars = in.Get<int>();
+	numConstantChars = in.Get<int>();
+	numInformativeChars = in.Get<int>();
+	numVariableUninformChars = in.Get<int>();
+	lastConstant = in.Get<int>();
+	dense = in.Get<int>();
+	wtsetName = in.GetString();
+	for(int t = 0;t < nTax;t++)
+		SetTaxonLabel(t, in.GetString().c_str());
+	for(int t = 0;t < nTax;t++)
+		in.GetArray(matrix[t], numPatterns);
+	in.GetVector(newNumber);
+	in.GetVector(newCount);
+	in.GetVector(newNumStates);
+	in.GetVector(newConstStates);
+	MEM_NEW_ARRAY(origDataNumber,int,numRealSitesInOrigMatrix);
+	in.GetArray(origDataNumber, numRealSitesInOrigMatrix);
+
+	CalcEmpiricalFreqs();
+	ReserveOriginalCounts();
+	OutputDataSummary();
+	}
+
 void DataMatrix::OutputDataSummary() const{
 	//outman.UserMessage("\n#######################################################");
 	outman.UserMessage("\tSummary of data:");
@@ -1873,18 +2005,6 @@ int DataMatrix::BootstrapReweight(int seedToUse, FLOAT_TYPE resampleProportion){
 	else
 		countsAlias = count;
 
-	FLOAT_TYPE *cumProbs = new FLOAT_TYPE[numPatterns];
-	
-	FLOAT_TYPE p=0.0;
-	cumProbs[0]=(FLOAT_TYPE) origCountsAlias[0] / ((FLOAT_TYPE) numNonMissingRealCountsInOrigMatrix);
-
-	countsAlias[0] = 0;
-	for(int i = 1;i < numPatterns;i++){
-		cumProbs[i] = cumProbs[i-1] + (FLOAT_TYPE) origCountsAlias[i] / ((FLOAT_TYPE) numNonMissingRealCountsInOrigMatrix);
-		countsAlias[i] = 0;
-		}
-	cumProbs[numPatterns - 1] = 1.0;
-
 	//ofstream deb("counts.log", ios::app);
 	//ofstream deb("counts.log");
 
@@ -1892,13 +2012,7 @@ int DataMatrix::BootstrapReweight(int seedToUse, FLOAT_TYPE resampleProportion){
 	int numToSample = (int) (((FLOAT_TYPE)numNonMissingRealCountsInOrigMatrix * resampleProportion) + 0.5);
 	if(numToSample != numNonMissingRealCountsInOrigMatrix) outman.UserMessage("Resampling %d characters (%.2f%%).\n", numToSample, resampleProportion*100);
 
-	for(int c=0;c<numToSample;c++){
-		FLOAT_TYPE p=rnd.uniform();
-		int pat=0; 
-		while(p > cumProbs[pat]) 
-			pat++;
-		countsAlias[pat]++;
-		}
+	ResampleCounts(origCountsAlias, numPatterns, numToSample, countsAlias);
 /*
 	for(int i = 0;i < numPatterns;i++)
 		deb << i << "\t" << origCountsAlias[i] << "\t" << countsAlias[i] <<  endl;
@@ -1915,8 +2029,7 @@ int DataMatrix::BootstrapReweight(int seedToUse, FLOAT_TYPE resampleProportion){
 		else 
 			numZero++;
 		}
-	delete []cumProbs;
-	assert(totCounts == numNonMissingRealCountsInOrigMatrix);
+	assert(totCounts == numToSample);
 	assert(nonZeroCharCount + numZero == numPatterns);
 
 	int nextSeed = rnd.seed();
@@ -1924,6 +2037,63 @@ int DataMatrix::BootstrapReweight(int seedToUse, FLOAT_TYPE resampleProportion){
 	return nextSeed;
 	}
 
+//Multinomial resampling of sites with Walker's alias method, which takes O(numPats + numToSample) rather than
+//searching the cumulative probabilities for each site.  Exactly one uniform deviate is used per sampled site, 
+//as with the old cumulative search, so the state of the rng afterwards (and therefore the seed for the next 
+//bootstrap replicate) is unchanged.  Patterns with a count of zero are never drawn.
+void DataMatrix::ResampleCounts(const int *origCounts, int numPats, int numToSample, int *newCounts){
+	double total = 0.0;
+	int anyPositive = 0;
+	for(int i = 0;i < numPats;i++){
+		newCounts[i] = 0;
+		total += origCounts[i];
+		if(origCounts[i] > 0) anyPositive = i;
+		}
+	assert(total > 0.0);
+
+	//Vose's construction.  Each pattern's probability is scaled so that the mean is 1.0, then deficits 
+	//are topped up from patterns with a surplus
+	vector<double> prob(numPats);
+	vector<int> alias(numPats);
+	vector<int> small, large;
+	for(int i = 0;i < numPats;i++){
+		prob[i] = origCounts[i] * numPats / total;
+		alias[i] = i;
+		if(prob[i] < 1.0) small.push_back(i);
+		else large.push_back(i);
+		}
+	while(small.empty() == false && large.empty() == false){
+		int s = small.back();
+		small.pop_back();
+		int l = large.back();
+		alias[s] = l;
+		prob[l] -= 1.0 - prob[s];
+		if(prob[l] < 1.0){
+			large.pop_back();
+			small.push_back(l);
+			}
+		}
+	//anything left over is 1.0 but for rounding error
+	for(vector<int>::iterator it = large.begin();it != large.end();it++)
+		prob[*it] = 1.0;
+	for(vector<int>::iterator it = small.begin();it != small.end();it++){
+		if(origCounts[*it] > 0)
+			prob[*it] = 1.0;
+		else{
+			prob[*it] = 0.0;
+			alias[*it] = anyPositive;
+			}
+		}
+
+	for(int c = 0;c < numToSample;c++){
+		double u = rnd.uniform() * numPats;
+		int pat = min((int) u, numPats - 1);
+		if(u - pat >= prob[pat])
+			pat = alias[pat];
+		newCounts[pat]++;
+		}
+	}
+
 void DataMatrix::CheckForIdenticalTaxonNames(){
 	const char *name1, *name2;
 	vector< pair<int, int> > identicals;
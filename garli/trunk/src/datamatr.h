@@ -32,6 +32,9 @@ using namespace std;
 #include "errorexception.h"
 
 class GarliReader;
+class StreamingAlignmentReader;
+class DataCacheWriter;
+class DataCacheReader;
 
 typedef FLOAT_TYPE** DblPtrPtr;
 #define MAX_STATES (8*sizeof(unsigned char))
@@ -141,9 +144,8 @@ class PatternManager{
 		uniquePatterns.clear();
 		constStates.clear();
 		}
-	virtual void NewCollapse();
-	virtual void NewPack();
-	virtual void NewSort();
+	virtual void NewHashCollapse();
+	virtual void NewSortedPack();
 	virtual void NewDetermineConstantSites();
 
 public:
@@ -349,6 +351,7 @@ protected:
 		int     unsigned charToInt( unsigned char d ) const { return (int)d; }
 
 		int NTax() const { return nTax; }
+		int MaxNumStates() const { return maxNumStates; }
 		void SetNTax(int ntax) { nTax = ntax; }
 
 		virtual int NChar() const { return numPatterns; }
@@ -442,7 +445,10 @@ protected:
 			}
 
 		unsigned char *GetRow( int i) const {
-			assert( matrix );
+			//the rows are freed once nucleotide tips are packed (see NucleotideData::MakePackedTips), after
+			//which the data can only be read through Matrix()
+			if(matrix == NULL)
+				throw ErrorException("Internal error: the unpacked data matrix was requested after it was freed.\n\tTry packedtipdata = 0.");
 			assert( i >= 0 );
 			assert( i < nTax );
 			return matrix[i];
@@ -507,7 +513,7 @@ protected:
   			}
   		}
       void RestoreOriginalCounts(){
-			if(origCounts == NULL) 
+			if(origCounts == NULL && newOrigCounts.size() == 0) 
 				return;
       		for(int i=0;i<numPatterns;i++){
 				if(newCount.size() > 0){
@@ -520,11 +526,20 @@ protected:
       		}
       void Reweight(FLOAT_TYPE prob);
       virtual int BootstrapReweight(int seedToUse, FLOAT_TYPE resampleProportion);
+	  //draws numToSample sites with replacement in proportion to the first numPats origCounts, using the global rng
+	  static void ResampleCounts(const int *origCounts, int numPats, int numToSample, int *newCounts);
 	  void CountMissingCharsByColumn(vector<int> &vec);
 	  void MakeWeightSetString(NxsCharactersBlock &charblock, string &wtstring, string name);
       void MakeWeightSetString(std::string &wtstring, string name);
 
 	  void CreateMatrixFromOtherMatrix(const DataMatrix &other, int startIndex, int endIndex);
+	  //fills the pattern manager with patterns that were already found by the streaming reader.  The uncompressed
+	  //matrix is never allocated
+	  void CreateMatrixFromStreamedAlignment(const StreamingAlignmentReader &aln);
+	  //store or restore the fully processed (compressed) matrix for the data cache.  ReadCache leaves the
+	  //object as ProcessPatterns would
+	  virtual void WriteCache(DataCacheWriter &out) const;
+	  virtual void ReadCache(DataCacheReader &in);
 };
 
 #endif
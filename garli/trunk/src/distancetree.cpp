@@ -0,0 +1,240 @@
+// GARLI version 2.1 source code
+// Copyright 2005-2014 Derrick J. Zwickl
+// email: garli.support@gmail.com
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cstdio>
+#include <cmath>
+#include <cassert>
+
+#include "defs.h"
+#include "distancetree.h"
+#include "sequencedata.h"
+#include "tree.h"
+
+DistanceStartingTree::DistanceStartingTree(const DataPartition *data){
+	nTax = data->NTax();
+	for(int p = 0;p < data->NumSubsets();p++){
+		const SequenceData *curData = data->GetSubset(p);
+		DistanceSubset sub;
+		sub.nStates = (curData->IsNucleotide() ? 4 : curData->MaxNumStates());
+		sub.nChar = curData->NChar();
+		sub.counts.assign(curData->GetCounts(), curData->GetCounts() + sub.nChar);
+		sub.states.resize(nTax * sub.nChar);
+		for(int t = 0;t < nTax;t++){
+			for(int c = 0;c < sub.nChar;c++){
+				unsigned char datum = curData->Matrix(t, c);
+				unsigned char st = ambiguous;
+				if(curData->IsNucleotide()){
+					//nucleotides are stored as a bitwise set of states
+					for(int s = 0;s < 4;s++)
+						if(datum == (1 << s)) st = s;
+					}
+				else if(datum < sub.nStates) st = datum;
+				sub.states[t * sub.nChar + c] = st;
+				}
+			}
+		subsets.push_back(sub);
+		}
+	}
+
+//returns the corrected distance, or -1.0 if the taxa have no unambiguous sites in common
+double DistanceStartingTree::PairDistance(int t1, int t2) const{
+	double weightedDist = 0.0;
+	double totalCompared = 0.0;
+	for(vector<DistanceSubset>::const_iterator sub = subsets.begin();sub != subsets.end();sub++){
+		const unsigned char *s1 = &sub->states[t1 * sub->nChar];
+		const unsigned char *s2 = &sub->states[t2 * sub->nChar];
+		const int *counts = &sub->counts[0];
+		int compared = 0;
+		int differ = 0;
+		//written without branches so that the compiler can vectorize it
+		for(int c = 0;c < sub->nChar;c++){
+			int valid = (s1[c] != ambiguous) & (s2[c] != ambiguous);
+			compared += valid * counts[c];
+			differ += (valid & (s1[c] != s2[c])) * counts[c];
+			}
+		if(compared == 0) continue;
+
+		//Jukes-Cantor correction for this number of states.  Saturated distances are truncated
+		double b = 1.0 - 1.0 / sub->nStates;
+		double p = min(differ / (double) compared, 0.95 * b);
+		weightedDist += -b * log(1.0 - p / b) * compared;
+		totalCompared += compared;
+		}
+	if(totalCompared == 0.0) return -1.0;
+	return weightedDist / totalCompared;
+	}
+
+void DistanceStartingTree::CalculateDistances(){
+	dist.assign((size_t) nTax * (nTax - 1) / 2, 0.0);
+#ifdef OPEN_MP
+#pragma omp parallel for schedule(dynamic)
+#endif
+	for(int t1 = 1;t1 < nTax;t1++){
+		for(int t2 = 0;t2 < t1;t2++)
+			dist[Index(t1, t2)] = PairDistance(t1, t2);
+		}
+
+	//pairs without any sites in common get the mean of the others
+	double sum = 0.0;
+	int num = 0;
+	for(vector<double>::iterator it = dist.begin();it != dist.end();it++){
+		if(*it >= 0.0){
+			sum += *it;
+			num++;
+			}
+		}
+	double fill = (num > 0 ? sum / num : 1.0);
+	for(vector<double>::iterator it = dist.begin();it != dist.end();it++)
+		if(*it < 0.0) *it = fill;
+	}
+
+void DistanceStartingTree::AppendNewick(int n, double len, const vector<int> &left, const vector<int> &right, const vector<double> &lens, string &newick) const{
+	char str[50];
+	if(n < nTax){
+		sprintf(str, "%d", n + 1);
+		newick += str;
+		}
+	else{
+		newick += "(";
+		AppendNewick(left[n], lens[left[n]], left, right, lens, newick);
+		newick += ",";
+		AppendNewick(right[n], lens[right[n]], left, right, lens, newick);
+		newick += ")";
+		}
+	//negative lengths are possible with NJ
+	len = max(len, (double) Tree::min_brlen);
+	len = min(len, (double) Tree::max_brlen);
+	sprintf(str, ":%.8f", len);
+	newick += str;
+	}
+
+void DistanceStartingTree::BuildBIONJ(string &newick){
+	assert(nTax > 2 && dist.size() > 0);
+	//The matrices are indexed by "slot" rather than node.  When two nodes are joined the new node takes
+	//the slot of the first and the last active slot is moved into that of the second, so the active
+	//nodes always occupy slots 0 to r-1
+	vector<double> &d = dist;
+	var = dist;
+	vector<int> slotNode(nTax);
+	vector<double> sums(nTax, 0.0);
+	for(int a = 0;a < nTax;a++){
+		slotNode[a] = a;
+		for(int b = 0;b < nTax;b++)
+			if(a != b) sums[a] += d[Index(a, b)];
+		}
+	int numNodes = 2 * nTax - 2;
+	vector<int> left(numNodes, -1), right(numNodes, -1);
+	vector<double> lens(numNodes, 0.0);
+	int nextNode = nTax;
+
+	for(int r = nTax;r > 3;r--){
+		//find the pair minimizing the Q criterion.  Ties go to the lowest slots, so the result doesn't
+		//depend on the number of threads
+		double bestQ = 0.0;
+		int bestA = -1, bestB = -1;
+#ifdef OPEN_MP
+#pragma omp parallel
+#endif
+		{
+		double localQ = 0.0;
+		int localA = -1, localB = -1;
+#ifdef OPEN_MP
+#pragma omp for schedule(dynamic)
+#endif
+		for(int a = 1;a < r;a++){
+			for(int b = 0;b < a;b++){
+				double q = (r - 2) * d[Index(a, b)] - sums[a] - sums[b];
+				if(localA < 0 || q < localQ || (q == localQ && (a < localA || (a == localA && b < localB)))){
+					localQ = q;
+					localA = a;
+					localB = b;
+					}
+				}
+			}
+#ifdef OPEN_MP
+#pragma omp critical
+#endif
+		{
+		if(localA >= 0 && (bestA < 0 || localQ < bestQ || (localQ == bestQ && (localA < bestA || (localA == bestA && localB < bestB))))){
+			bestQ = localQ;
+			bestA = localA;
+			bestB = localB;
+			}
+		}
+		}
+		int a = bestA, b = bestB;
+
+		double dab = d[Index(a, b)];
+		double vab = var[Index(a, b)];
+		double lenA = 0.5 * (dab + (sums[a] - sums[b]) / (r - 2));
+		double lenB = dab - lenA;
+
+		//BIONJ weighting of the two joined nodes, based on the variances of their distances
+		double lambda = 0.5;
+		if(vab > 0.0){
+			double varDiff = 0.0;
+			for(int k = 0;k < r;k++)
+				if(k != a && k != b) varDiff += var[Index(b, k)] - var[Index(a, k)];
+			lambda = 0.5 + varDiff / (2.0 * (r - 2) * vab);
+			lambda = max(0.0, min(1.0, lambda));
+			}
+
+		int newNode = nextNode++;
+		left[newNode] = slotNode[a];
+		right[newNode] = slotNode[b];
+		lens[slotNode[a]] = lenA;
+		lens[slotNode[b]] = lenB;
+
+		double newSum = 0.0;
+		for(int k = 0;k < r;k++){
+			if(k == a || k == b) continue;
+			double dak = d[Index(a, k)], dbk = d[Index(b, k)];
+			double dNew = lambda * (dak - lenA) + (1.0 - lambda) * (dbk - lenB);
+			var[Index(a, k)] = lambda * var[Index(a, k)] + (1.0 - lambda) * var[Index(b, k)] - lambda * (1.0 - lambda) * vab;
+			d[Index(a, k)] = dNew;
+			sums[k] += dNew - dak - dbk;
+			newSum += dNew;
+			}
+		sums[a] = newSum;
+		slotNode[a] = newNode;
+
+		//fill the hole left by b with the last slot
+		int last = r - 1;
+		if(b != last){
+			for(int k = 0;k < last;k++){
+				if(k == b) continue;
+				d[Index(b, k)] = d[Index(last, k)];
+				var[Index(b, k)] = var[Index(last, k)];
+				}
+			sums[b] = sums[last];
+			slotNode[b] = slotNode[last];
+			}
+		}
+
+	//the last three nodes form the basal trifurcation
+	double d01 = d[Index(0, 1)], d02 = d[Index(0, 2)], d12 = d[Index(1, 2)];
+	lens[slotNode[0]] = 0.5 * (d01 + d02 - d12);
+	lens[slotNode[1]] = 0.5 * (d01 + d12 - d02);
+	lens[slotNode[2]] = 0.5 * (d02 + d12 - d01);
+
+	newick = "(";
+	for(int s = 0;s < 3;s++){
+		if(s > 0) newick += ",";
+		AppendNewick(slotNode[s], lens[slotNode[s]], left, right, lens, newick);
+		}
+	newick += ");";
+	}
@@ -0,0 +1,64 @@
+// GARLI version 2.1 source code
+// Copyright 2005-2014 Derrick J. Zwickl
+// email: garli.support@gmail.com
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef DISTANCE_TREE_H
+#define DISTANCE_TREE_H
+
+#include <vector>
+#include <string>
+
+using namespace std;
+
+#include "defs.h"
+
+class DataPartition;
+
+//Builds a starting tree (streefname = nj) with the BIONJ algorithm (Gascuel 1997) from pairwise distances.
+//The distances are calculated over the patterns of all data subsets, weighted by the pattern counts, and corrected
+//for multiple hits with the Jukes-Cantor formula for the number of states in each subset.  Distances and BIONJ
+//variances are stored as lower triangular matrices, so memory use is about n^2 doubles.
+class DistanceStartingTree{
+	//the patterns of one subset, as a single state per taxon or ambiguous.  Partially ambiguous
+	//nucleotides are treated as missing
+	struct DistanceSubset{
+		int nStates;
+		int nChar;
+		vector<unsigned char> states;//nTax rows of nChar
+		vector<int> counts;
+		};
+	vector<DistanceSubset> subsets;
+	int nTax;
+
+	vector<double> dist;
+	vector<double> var;
+
+	static const unsigned char ambiguous = 255;
+	static size_t Index(int a, int b){
+		return (a > b ? (size_t) a * (a - 1) / 2 + b : (size_t) b * (b - 1) / 2 + a);
+		}
+	double PairDistance(int t1, int t2) const;
+	void AppendNewick(int n, double len, const vector<int> &left, const vector<int> &right, const vector<double> &lens, string &newick) const;
+
+public:
+	DistanceStartingTree(const DataPartition *data);
+	//fills the distance matrix, in parallel if OpenMP is enabled
+	void CalculateDistances();
+	//the tree description uses taxon numbers and includes branch lengths
+	void BuildBIONJ(string &newick);
+	};
+
+#endif
@@ -42,6 +42,9 @@
 #include "adaptation.h"
 #include "sequencedata.h"
 #include "garlireader.h"
+#include "alignreader.h"
+#include "datacache.h"
+#include "checkpoint.h"
 
 #include "funcs.h"
 #include "tree.h"
@@ -54,6 +57,7 @@
 typedef int pid_type;
 #else
 #include <sys/types.h>
+#include <sys/wait.h>
 #include <unistd.h>
 #define PID_FUNC() getpid()
 typedef pid_t pid_type;
@@ -121,6 +125,258 @@ int CheckRestartNumber(const string str){
 	return num;
 	}
 
+#if defined(UNIX) && !defined(SUBROUTINE_GARLI) && !defined(BOINC)
+//the output file prefix of one parallel replicate job
+static string JobPrefix(const string &ofprefix, int job){
+	char temp[20];
+	if(job < 10) sprintf(temp, ".run0%d", job);
+	else sprintf(temp, ".run%d", job);
+	return ofprefix + temp;
+	}
+
+//Runs the search replicates (or bootstrap replicates) as independent jobs, at most conf.parallelReplicates at once.
+//Each job is a forked process with its own Population, random number stream, memory budget (the total
+//availablememory divided among the workers) and output files (ofprefix.runXX, as in the MPI version).  The
+//processed data are shared between them copy-on-write.  When a job finishes the next one in the queue is started.
+//A finished job leaves a marker file (ofprefix.runXX.done), and on restart those jobs aren't run again.  At the end
+//the results of all jobs are gathered into the files that a sequential run would have written.
+//Returns the number of jobs that failed.
+int RunParallelReplicates(MasterGamlConfig &conf, DataPartition &dataPart, DataPartition &rawPart, bool usedNCL){
+	int numJobs = (conf.bootstrapReps > 0 ? conf.bootstrapReps : conf.searchReps);
+	int numWorkers = min((int) conf.parallelReplicates, numJobs);
+	outman.UserMessage("Running %d %s replicates in %d parallel processes.  The output of each is in files named %s.runXX.*", numJobs, (conf.bootstrapReps > 0 ? "bootstrap" : "search"), numWorkers, conf.ofprefix.c_str());
+
+	//draw the seeds in advance so that the jobs don't depend on the order in which they are run
+	vector<int> jobSeeds;
+	for(int j = 0;j < numJobs;j++)
+		jobSeeds.push_back(rnd.random_int(1000000) + 1);
+
+	//the datasets of each bootstrap rep are drawn from the same chain of seeds as in a sequential run, 
+	//so if bootstrapseed is specified the resampled datasets are identical
+	vector<int> bootSeeds;
+	if(conf.bootstrapReps > 0){
+		int seed = (conf.bootstrapSeed > 0 ? conf.bootstrapSeed : rnd.random_int(1000000) + 1);
+		for(int j = 0;j < numJobs;j++){
+			bootSeeds.push_back(seed);
+			for(int p = 0;p < dataPart.NumSubsets();p++)
+				seed = dataPart.GetSubset(p)->BootstrapReweight(seed, conf.resampleProportion);
+			}
+		for(int p = 0;p < dataPart.NumSubsets();p++)
+			dataPart.GetSubset(p)->RestoreOriginalCounts();
+		}
+
+	//jobs that finished before a restart are kept as they are
+	vector<bool> jobFinished(numJobs, false);
+	int numFinished = 0;
+	for(int j = 0;j < numJobs;j++){
+		string marker = JobPrefix(conf.ofprefix, j) + ".done";
+		if(conf.restart){
+			if(FileExists(marker.c_str())){
+				jobFinished[j] = true;
+				numFinished++;
+				}
+			}
+		else
+			remove(marker.c_str());
+		}
+	if(numFinished > 0)
+		outman.UserMessage("%d replicates already finished before the restart and won't be run again", numFinished);
+
+	//anything buffered would otherwise be written again by each child
+	outman.flush();
+	cout.flush();
+
+	int nextJob = 0, running = 0, failed = 0;
+	map<pid_t, int> jobOfPid;
+	while(nextJob < numJobs || running > 0){
+		while(nextJob < numJobs && jobFinished[nextJob])
+			nextJob++;
+		if(nextJob < numJobs && running < numWorkers){
+			int job = nextJob++;
+			pid_t pid = fork();
+			if(pid < 0)
+				throw ErrorException("Could not start process for replicate %d", job);
+			if(pid == 0){
+#ifdef OPEN_MP
+				//OpenMP regions may already have run in the parent (i.e., when reading the data), and its thread
+				//pool doesn't exist in the child.  Using it there can hang, so each job uses a single thread
+				omp_set_num_threads(1);
+#endif
+				MasterGamlConfig jobConf = conf;
+				jobConf.ofprefix = JobPrefix(conf.ofprefix, job);
+				//a job that hadn't written a checkpoint before the restart starts from scratch
+				if(jobConf.restart && !FileExists(CheckpointFile::CheckpointFilename(jobConf.ofprefix).c_str()))
+					jobConf.restart = false;
+				jobConf.parallelReplicates = 1;
+				jobConf.randseed = jobSeeds[job];
+				if(jobConf.availableMemory > 0) jobConf.availableMemory /= numWorkers;
+				if(jobConf.megsClaMemory > 0) jobConf.megsClaMemory /= numWorkers;
+				if(conf.bootstrapReps > 0){
+					jobConf.bootstrapReps = 1;
+					jobConf.bootstrapSeed = bootSeeds[job];
+					}
+				else
+					jobConf.searchReps = 1;
+				rnd.set_seed(jobSeeds[job]);
+
+				string logName = jobConf.ofprefix + ".screen.log";
+				outman.SetNoOutput(true);
+				if(jobConf.restart) outman.SetLogFileForAppend(logName.c_str());
+				else outman.SetLogFile(logName.c_str());
+				//each job starts its own writer thread, since the parent's isn't started before forking (and
+				//wouldn't exist in the child anyway)
+				if(jobConf.asyncOutput || (jobConf.outputSitelikelihoods > 0 && jobConf.siteLikelihoodFormat == "binary")){
+					if(asyncOut.Start(ASYNC_RING_BYTES) && jobConf.asyncOutput)
+						asyncOut.Attach(*outman.GetLogStream());
+					}
+				int status = 0;
+				Population *pop = NULL;
+				try{
+					outman.UserMessage("Replicate %d (of %d) of the run in %s.screen.log, random seed %d", job + 1, numJobs, conf.ofprefix.c_str(), jobSeeds[job]);
+					pop = new Population();
+					pop->usedNCL = usedNCL;
+					pop->Setup(&jobConf, &dataPart, &rawPart, 1, 0);
+					pop->SetOutputDetails();
+					if(pop->conf->restart) 
+						pop->conf->restart = pop->ReadStateFiles();
+					pop->SetOutputDetails();
+					if(pop->conf->bootstrapReps == 0)
+						pop->PerformSearch();
+					else
+						pop->Bootstrap();
+					pop->FinalizeOutputStreams(2);
+					}
+				catch(ErrorException &err){
+					outman.UserMessage("\nERROR: %s\n\n", err.message);
+					if(pop != NULL){
+						pop->FinalizeOutputStreams(0);
+						pop->FinalizeOutputStreams(1);
+						pop->FinalizeOutputStreams(2);
+						}
+					status = 1;
+					}
+				catch(int error){
+					if(error == Population::nomem) outman.UserMessage("not able to allocate enough memory!!!");
+					status = 1;
+					}
+				if(pop != NULL) delete pop;
+				outman.CloseLogFile();
+				//the exit handler that normally drains the writer is skipped by _exit
+				asyncOut.Stop();
+				//skip the destructors and exit handlers of the copy of the parent
+				_exit(status);
+				}
+			jobOfPid[pid] = job;
+			running++;
+			outman.UserMessage("started replicate %d (process %d)", job + 1, (int) pid);
+			}
+		else{
+			int status;
+			pid_t pid = wait(&status);
+			if(pid < 0) break;
+			running--;
+			int job = jobOfPid[pid];
+			if(WIFEXITED(status) && WEXITSTATUS(status) == 0){
+				outman.UserMessage("finished replicate %d", job + 1);
+				jobFinished[job] = true;
+				ofstream marker((JobPrefix(conf.ofprefix, job) + ".done").c_str());
+				}
+			else{
+				outman.UserMessage("***replicate %d failed.  See %s.run%s%d.screen.log for details", job + 1, conf.ofprefix.c_str(), (job < 10 ? "0" : ""), job);
+				failed++;
+				}
+			}
+		}
+
+	//gather the bootstrap trees into a single file.  They are numbered consecutively, so if some jobs
+	//failed the file has fewer trees and says which replicates are missing
+	if(conf.bootstrapReps > 0){
+		string filename = conf.ofprefix + ".boot.tre";
+		ofstream out(filename.c_str());
+		dataPart.BeginNexusTreesBlock(out);
+		int numTrees = 0;
+		string missing;
+		for(int j = 0;j < numJobs;j++){
+			ifstream in((JobPrefix(conf.ofprefix, j) + ".boot.tre").c_str());
+			string line;
+			bool found = false;
+			while(jobFinished[j] && !found && getline(in, line)){
+				string::size_type pos = line.find("tree bootrep1=");
+				if(pos == string::npos) continue;
+				char treeName[50];
+				sprintf(treeName, "tree bootrep%d=", numTrees + 1);
+				line.replace(pos, strlen("tree bootrep1="), treeName);
+				out << line << "\n";
+				numTrees++;
+				found = true;
+				}
+			if(!found){
+				char num[20];
+				sprintf(num, "%s%d", (missing.length() > 0 ? ", " : ""), j + 1);
+				missing += num;
+				}
+			}
+		if(missing.length() > 0)
+			out << "[NOTE: this file is missing the trees of bootstrap replicates " << missing << ", which did not complete]\n";
+		out << "end;\n";
+		out.close();
+		outman.UserMessage("Collected %d bootstrap trees into %s", numTrees, filename.c_str());
+		if(missing.length() > 0)
+			outman.UserMessage("WARNING: %d of %d bootstrap trees are missing, from replicates %s.\n\tRestart the run (restart = 1) to run only those replicates again.", numJobs - numTrees, numJobs, missing.c_str());
+		}
+	//gather the best tree of each search replicate, as a sequential run with searchreps would.  All of them go
+	//to ofprefix.best.all.tre and the best scoring one to ofprefix.best.tre
+	else{
+		vector<string> repTrees(numJobs);
+		int bestJob = -1;
+		double bestScore = 0.0;
+		for(int j = 0;j < numJobs;j++){
+			if(jobFinished[j] == false) continue;
+			ifstream in((JobPrefix(conf.ofprefix, j) + ".best.tre").c_str());
+			string line;
+			while(getline(in, line)){
+				string::size_type treePos = line.find("tree ");
+				string::size_type scorePos = line.find("[!GarliScore ");
+				string::size_type eqPos = line.find('=');
+				if(treePos == string::npos || scorePos == string::npos || eqPos == string::npos) continue;
+				//the description of the tree follows the name
+				repTrees[j] = line.substr(eqPos + 1);
+				double score = atof(line.c_str() + scorePos + strlen("[!GarliScore "));
+				if(bestJob == -1 || score > bestScore){
+					bestJob = j;
+					bestScore = score;
+					}
+				break;
+				}
+			}
+		if(bestJob == -1)
+			outman.UserMessage("WARNING: no search replicate completed, so there are no trees to collect");
+		else{
+			string allName = conf.ofprefix + ".best.all.tre";
+			ofstream all(allName.c_str());
+			dataPart.BeginNexusTreesBlock(all);
+			for(int j = 0;j < numJobs;j++){
+				if(repTrees[j].length() == 0) continue;
+				all << "tree rep" << j + 1 << (j == bestJob ? "BEST" : "") << " =" << repTrees[j] << "\n";
+				}
+			all << "end;\n";
+			all.close();
+
+			string bestName = conf.ofprefix + ".best.tre";
+			ofstream best(bestName.c_str());
+			dataPart.BeginNexusTreesBlock(best);
+			best << "tree bestREP" << bestJob + 1 << " =" << repTrees[bestJob] << "\nend;\n";
+			best.close();
+			outman.UserMessage("Collected the trees of the search replicates into %s", allName.c_str());
+			outman.UserMessage("Replicate %d had the best score (%.4f).  Its tree was saved to %s", bestJob + 1, bestScore, bestName.c_str());
+			}
+		}
+	if(failed > 0)
+		outman.UserMessage("%d of %d replicates failed", failed, numJobs);
+	return failed;
+	}
+#endif
+
 void UsageMessage(char *execName){
 #ifdef SUBROUTINE_GARLI
 	OutputVersion();
@@ -158,6 +414,9 @@ void UsageMessage(char *execName){
 	outman.UserMessage                 ("  -v, --version		print version information and exit");
 	outman.UserMessage                 ("  -h, --help		print this help and exit");
 	outman.UserMessage                 ("  -t			run internal tests (requires dataset and config file)");
+	outman.UserMessage                 ("  --bench		time the likelihood kernels (requires dataset and config file)");
+	outman.UserMessage                 ("  --hwcounters		profile the likelihood kernels with hardware counters (Linux only,");
+	outman.UserMessage                 ("				same as hardwarecounters = 1 in the config file)");
 	outman.UserMessage                 ("  -V			validate: load config file and data, validate config file, data, starting trees"); 
 	outman.UserMessage                 ("				and constraint files, print required memory and selected model, then exit");
 #ifdef CUDA_GPU
@@ -238,7 +497,14 @@ int main( int argc, char* argv[] )	{
 #endif
 
 	bool runTests = false;
+#ifdef GARLI_BENCH
+	//the garli-bench build only runs the kernel benchmarks
+	bool runBench = true;
+#else
+	bool runBench = false;
+#endif
 	bool validateMode = false;
+	bool hardwareCounters = false;
     if (argc > 1) {
     	int curarg=1;
         while(curarg<argc){
@@ -259,6 +525,8 @@ int main( int argc, char* argv[] )	{
 						}
 						[pool release];
 #endif				
+					else if(!_stricmp(argv[curarg], "--bench")) runBench = true;
+					else if(!_stricmp(argv[curarg], "--hwcounters")) hardwareCounters = true;
 					else if(argv[curarg][1]=='t') runTests = true;
 					else if(!strcmp(argv[curarg], "-v") || !_stricmp(argv[curarg], "--version")){
 						OutputVersion();
@@ -315,6 +583,7 @@ int main( int argc, char* argv[] )	{
 			MasterGamlConfig conf;
 			bool confOK;
 			confOK = ((conf.Read(conf_name.c_str()) < 0) == false);
+			if(hardwareCounters) conf.hardwareCounters = true;
 
 #ifdef SUBROUTINE_GARLI
 			//override the ofprefix here, tacking .runXX onto it 
@@ -466,7 +735,38 @@ int main( int argc, char* argv[] )	{
 			//read the datafile with the NCL-based GarliReader - should allow nexus, phylip and fasta
 			outman.UserMessage("###################################################\nREADING OF DATA");
 			GarliReader &reader = GarliReader::GetInstance();
-			bool usedNCL = reader.ReadData(datafile.c_str(), *modSpecSet.GetModSpec(0));
+			//data that was processed by an earlier run can be loaded from the data cache instead.  Data files that
+			//are also the source of the starting tree are always read by NCL
+			DataCache cache;
+			PatternHash dataHash;
+			string cacheName = DataCache::CacheFilename(datafile);
+			bool cacheData = conf.dataCache && conf.usePatternManager && conf.streefname != datafile && DataCache::HashDataFile(datafile.c_str(), dataHash);
+			bool useCache = false;
+			if(cacheData){
+				useCache = cache.Load(cacheName.c_str(), dataHash, DataCache::ConfigKey(conf));
+				if(useCache){
+					outman.UserMessage("Using processed data from cache file %s", cacheName.c_str());
+					reader.CreateTaxaBlock(cache.TaxonLabels());
+					}
+				}
+			//large unpartitioned nucleotide fasta or phylip files can optionally bypass NCL.  Anything that the
+			//streaming reader doesn't handle is read by NCL as usual
+			StreamingAlignmentReader streamed;
+			bool useStreamed = false;
+			if(!useCache && conf.streamingDataReader && conf.usePatternManager && conf.configModelSets.size() == 1 && modSpecSet.GetModSpec(0)->IsNucleotide()
+				&& FileExists(datafile.c_str()) && !FileIsNexus(datafile.c_str())){
+				outman.UserMessage("Attempting to read data file with the streaming reader:\n\t%s ...", datafile.c_str());
+				useStreamed = streamed.Read(datafile.c_str());
+				if(useStreamed){
+					outman.UserMessage("\nData read successfully (%d sequences, %d characters, %d unique columns).", streamed.NTax(), streamed.NChar(), streamed.NumPatterns());
+					reader.CreateTaxaBlock(streamed.TaxonLabels());
+					}
+				else
+					outman.UserMessage("Streaming reader could not read the data file, trying NCL instead.\n");
+				}
+			bool usedNCL = true;
+			if(!useStreamed && !useCache)
+				usedNCL = reader.ReadData(datafile.c_str(), *modSpecSet.GetModSpec(0));
 			if(! usedNCL) 
 				throw ErrorException("There was a problem reading the data file.");
 			
@@ -476,11 +776,23 @@ int main( int argc, char* argv[] )	{
 
 			//currently data subsets will be created for each separate characters block, and/or for each
 			//part of a char partition within a characters block
-			int numCharBlocks = reader.GetNumCharactersBlocks(taxblock);
-			if(numCharBlocks == 0) throw ErrorException("No character data (in characters/data blocks) found in datafile");
+			int numCharBlocks = (useStreamed || useCache ? 0 : reader.GetNumCharactersBlocks(taxblock));
+			if(numCharBlocks == 0 && !useStreamed && !useCache) throw ErrorException("No character data (in characters/data blocks) found in datafile");
 			vector<pair<NxsCharactersBlock *, NxsUnsignedSet> > effectiveMatrices;
 
 			outman.UserMessage("\n###################################################\nPARTITIONING OF DATA AND MODELS");
+			//streamed data has no characters block, and is always a single subset
+			if(useStreamed){
+				dataSubInfo.push_back(DataSubsetInfo(0, 0, "", -1, "", DataSubsetInfo::NUCLEOTIDE, DataSubsetInfo::NUCLEOTIDE));
+				effectiveMatrices.push_back(make_pair((NxsCharactersBlock *) NULL, NxsUnsignedSet()));
+				}
+			//nor does cached data, but the subsets are as they were originally read
+			if(useCache){
+				for(int s = 0;s < cache.NumSubsets();s++){
+					dataSubInfo.push_back(cache.SubsetInfo(s));
+					effectiveMatrices.push_back(make_pair((NxsCharactersBlock *) NULL, NxsUnsignedSet()));
+					}
+				}
 			//loop over characters blocks
 			for(int c = 0;c < numCharBlocks;c++){
 				NxsCharactersBlock *charblock = reader.GetCharactersBlock(taxblock, c);
@@ -620,9 +932,31 @@ int main( int argc, char* argv[] )	{
 				//for nstate data the effective matrices will be further broken up into implied matrices that each have the same number of observed states
 				//the implied matrix number will be that number of states
 				int actuallyUsedImpliedMatrixIndex = 0;
-				int maxObservedStates = effectiveMatrices[dataChunk].first->GetMaxObsNumStates(false);
+				int maxObservedStates = (useStreamed || useCache ? 4 : effectiveMatrices[dataChunk].first->GetMaxObsNumStates(false));
 				//for Mk the impliedMatrix number is the number of states
 				for(int impliedMatrix = 2;impliedMatrix < (modSpec->IsMkTypeModel() ? maxObservedStates + 1 : 3);impliedMatrix++){
+					if(useCache){
+						//only sequence data is cached, so there is a single, already processed matrix for each subset
+						if(modSpec->IsCodon()){
+							CodonData *dat = new CodonData(modSpec->geneticCode);
+							if(modSpec->IsF1x4StateFrequencies()) dat->SetF1X4Freqs();
+							else if(modSpec->IsF3x4StateFrequencies()) dat->SetF3X4Freqs();
+							else if(modSpec->IsEmpiricalStateFrequencies()) dat->SetCodonTableFreqs();
+							data = dat;
+							}
+						else if(modSpec->IsAminoAcid())
+							data = new AminoacidData();
+						else if(modSpec->IsNucleotide())
+							data = new NucleotideData();
+						else throw ErrorException("Data cache file %s does not match the specified data types", cacheName.c_str());
+						data->SetUsePatternManager(true);
+						cache.ReadSubset(dataChunk, data);
+						dataPart.AddSubset(data);
+						dataSubInfo[dataChunk].totalCharacters = data->TotalNChar();
+						dataSubInfo[dataChunk].uniqueCharacters = data->NChar();
+						actuallyUsedImpliedMatrixIndex++;
+						continue;
+						}
 					if(modSpec->IsMkTypeModel() && !modSpec->IsOrientedGap()){
 						bool isOrdered = (modSpec->IsOrderedNState() || modSpec->IsOrderedNStateV());
 						bool isBinary = modSpec->IsBinary() || modSpec->IsBinaryNotAllZeros();
@@ -645,7 +979,10 @@ int main( int argc, char* argv[] )	{
 						data->SetUsePatternManager(0);
 					
 					//if no charpart was specified, the second argument here will be empty
-					data->CreateMatrixFromNCL(effectiveMatrices[dataChunk].first, effectiveMatrices[dataChunk].second);
+					if(useStreamed)
+						data->CreateMatrixFromStreamedAlignment(streamed);
+					else
+						data->CreateMatrixFromNCL(effectiveMatrices[dataChunk].first, effectiveMatrices[dataChunk].second);
 
 #ifdef SINGLE_PRECISION_FLOATS
 					if(modSpec->IsMkTypeModel() || modSpec->IsOrientedGap()) throw ErrorException("Sorry, Mk/Mkv type models have not yet been tested with single precision.");
@@ -760,6 +1097,26 @@ int main( int argc, char* argv[] )	{
 							modSpecSet.SetInferSubsetRates(true);
 				}
 			
+			streamed.Clear();
+			cache.Close();
+
+			//save the processed data for next time.  Only sequence data is cached, and not if the data file
+			//also contains trees or a garli block, which would otherwise be lost when loading from the cache
+			if(cacheData && !useCache){
+				bool cacheable = (reader.FoundModelString() == false && reader.GetNumTreesBlocks(taxblock) == 0);
+				for(int s = 0;s < dataPart.NumSubsets();s++){
+					const SequenceData *sub = dataPart.GetSubset(s);
+					if(!(sub->IsNucleotide() || sub->IsAminoAcid() || sub->IsCodon()) || !sub->GetUsePatternManager())
+						cacheable = false;
+					}
+				if(cacheable){
+					vector<string> labels;
+					for(unsigned t = 0;t < taxblock->GetNTax();t++)
+						labels.push_back(taxblock->GetTaxonLabel(t));
+					DataCache::Write(cacheName.c_str(), dataHash, DataCache::ConfigKey(conf), labels, dataSubInfo, dataPart);
+					}
+				}
+
 			//this depends on the fact that an extra taxon slot was allocated but not yet used
 			if(modSpecSet.AnyOrientedGap()){
 				NxsTaxaBlock *tax = reader.GetTaxaBlock(0);
@@ -771,6 +1128,30 @@ int main( int argc, char* argv[] )	{
 			//could deallocate the storage in the NCL reader here, which saves a bit of memory but isn't critical
 			//reader.DeleteCharacterBlocksFromFactories();
 			
+			if(conf.parallelReplicates > 1 && conf.runmode == 0 && conf.optimizeInputOnly == false && validateMode == false && runTests == false && runBench == false){
+#if defined(UNIX) && !defined(SUBROUTINE_GARLI) && !defined(BOINC)
+				if(conf.rellBootstrapReps > 0)
+					throw ErrorException("rellbootstrapreps requires all search replicates to be run in a single process (parallelreplicates = 1)");
+				int failed = RunParallelReplicates(conf, dataPart, rawPart, usedNCL);
+				dataPart.Delete();
+				modSpecSet.Delete();
+				outman.CloseLogFile();
+				return (failed > 0 ? 1 : 0);
+#else
+				throw ErrorException("parallelreplicates is only available in the unix version");
+#endif
+				}
+
+			//the writer thread is only started here, so that parallel replicate processes don't fork with it (they
+			//start their own).  Binary site likelihoods are always written through it when possible
+			if(conf.asyncOutput || (conf.outputSitelikelihoods > 0 && conf.siteLikelihoodFormat == "binary")){
+				if(asyncOut.Start(ASYNC_RING_BYTES)){
+					if(conf.asyncOutput && outman.GetLogStream() != NULL)
+						asyncOut.Attach(*outman.GetLogStream());
+					}
+				else if(conf.asyncOutput) outman.UserMessage("NOTE: asyncoutput is only available in the unix version.  Output will be written normally.");
+				}
+
 			//allocate the population
 			pop = new Population();
 			pop->usedNCL = usedNCL;
@@ -784,6 +1165,12 @@ int main( int argc, char* argv[] )	{
 				outman.UserMessage("******Successfully completed tests.******");
 				return 0;
 				}
+			if(runBench){
+				outman.UserMessage("starting kernel benchmarks...");
+				pop->RunKernelBenchmark();
+				outman.UserMessage("******Completed kernel benchmarks.******");
+				return 0;
+				}
 
 			if(conf.optimizeInputOnly)
 				conf.runmode = 11;
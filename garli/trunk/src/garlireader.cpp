@@ -396,6 +396,26 @@ bool GarliReader::ReadData(const char* filename, const ModelSpecification &mSpec
 	return true;
 	}
 
+void GarliReader::CreateTaxaBlock(const vector<string> &labels){
+	ostringstream nex;
+	nex << "#NEXUS\nbegin taxa;\ndimensions ntax=" << labels.size() << ";\ntaxlabels";
+	for(vector<string>::const_iterator it = labels.begin();it != labels.end();it++){
+		//the labels are already as NCL would have read them, so always quote them so that they're taken literally
+		string quoted = *it;
+		for(string::size_type q = quoted.find('\'');q != string::npos;q = quoted.find('\'', q + 2))
+			quoted.insert(q, 1, '\'');
+		nex << "\n'" << quoted << "'";
+		}
+	nex << ";\nend;\n";
+	istringstream in(nex.str());
+	try{
+		ReadStream(in, NEXUS_FORMAT);
+		}
+	catch(NxsException &err){
+		throw ErrorException("%s", err.msg.c_str());
+		}
+	}
+
 //verifies that we got the right number/type of blocks and returns the Characters block to be used
 const NxsCharactersBlock *GarliReader::CheckBlocksAndGetCorrectCharblock(const ModelSpecification &mSpec) const{
 	const int numTaxaBlocks = GetNumTaxaBlocks();
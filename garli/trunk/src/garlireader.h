@@ -196,6 +196,9 @@ class GarliReader
 		//Garli's matrices are created
 		void DeleteCharacterBlocksFromFactories();
 		bool ReadData(const char* filename, const ModelSpecification &modspec);
+		//creates a taxa block for data that was read without NCL (by the streaming reader), so that trees and
+		//outgroups can still refer to taxa by name
+		void CreateTaxaBlock(const vector<string> &labels);
 		const NxsCharactersBlock *CheckBlocksAndGetCorrectCharblock(const ModelSpecification &modspec) const;
 		static string GetDefaultIntWeightSet(const NxsCharactersBlock *charblock, vector<int> &wset);
 		};
@@ -21,6 +21,15 @@
 #include <iomanip>
 #include <sstream>
 
+#ifdef UNIX
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#endif
+
 using namespace std;
 
 #include "defs.h"
@@ -38,6 +47,8 @@ using namespace std;
 #include "outputman.h"
 #include "reconnode.h"
 #include "utility.h"
+#include "parsimony.h"
+#include "distancetree.h"
 
 extern int memLevel;
 extern int calcCount;
@@ -56,7 +67,7 @@ extern FLOAT_TYPE globalBest;
 Individual::Individual() : dirty(1), fitness(0.0), 
 	reproduced(false), willreproduce(false), parent(-1),
 	willrecombine(false), recombinewith(-1), topo(-1), mutated_brlen(0), 
-	mutation_type(0), accurateSubtrees(0){
+	mutation_type(0), mutation_work(0), accurateSubtrees(0){
 	 
  	treeStruct=NULL;
 //	mod=new Model();
@@ -66,7 +77,7 @@ Individual::Individual(const Individual *other) :
 	dirty(1), fitness(0.0), 
 	reproduced(false), willreproduce(false), parent(-1),
 	willrecombine(false), recombinewith(-1), topo(-1), mutated_brlen(0), 
-	mutation_type(0), accurateSubtrees(0){
+	mutation_type(0), mutation_work(0), accurateSubtrees(0){
 
 	//mod=new Model();
 	treeStruct=new Tree();
@@ -286,7 +297,214 @@ void Individual::MakeRandomTree(int nTax){
 	treeStruct->AssignCLAsFromMaster();
 	}
 
-void Individual::MakeStepwiseTree(int nTax, int attachesPerTaxon, FLOAT_TYPE optPrecision ){
+//this is much faster than the likelihood stepwise tree, and ignores the model entirely.  It can't
+//currently be used with constraints
+void Individual::MakeParsimonyTree(){
+	assert(Tree::constraints.empty());
+	ParsimonyStartingTree pars(Tree::dataPart);
+	string newick;
+	int score = pars.Build(newick);
+	outman.UserMessage("parsimony score of starting tree: %d", score);
+
+	//branch lengths are included, so this doesn't draw random ones
+	treeStruct = new Tree(newick.c_str(), true);
+	treeStruct->AssignCLAsFromMaster();
+	}
+
+void Individual::MakeDistanceTree(){
+	assert(Tree::constraints.empty());
+	DistanceStartingTree dist(Tree::dataPart);
+	dist.CalculateDistances();
+	string newick;
+	dist.BuildBIONJ(newick);
+
+	treeStruct = new Tree(newick.c_str(), true);
+	treeStruct->AssignCLAsFromMaster();
+	}
+
+//scores every numProcs-th attachment point starting at first, each beginning from the tree in backup
+static void ScoreAttachments(Individual &scratchI, const Individual *backup, int addedNum, vector<ReconNode> &attempted, int first, int numProcs, FLOAT_TYPE optPrecision){
+	Tree *scratchT = scratchI.treeStruct;
+	for(int b = first;b < (int) attempted.size();b += numProcs){
+		//try a reattachment point
+		scratchT->SPRMutate(addedNum, &attempted[b], optPrecision, 0);
+		//record the score
+		attempted[b].chooseProb = scratchT->lnL;
+		//restore the tree
+		scratchI.CopySecByRearrangingNodesOfFirst(scratchT, backup, true);
+		}
+	}
+
+#ifdef UNIX
+//Worker processes for scoring the attachment points during stepwise addition.  They are forked once, after the
+//first three taxa are placed, and then run the same addition loop as the parent in lockstep.  Each process
+//scores every numProcs-th point, and after each taxon the scores are exchanged through a socket so that every
+//process chooses the same point and the trees stay identical.  A reduction of the rescaling frequency is
+//exchanged along with the scores, and the work counts of the workers are added to the parent's at the end.
+//If a worker fails its points are scored by the parent from then on.
+class StepwiseWorkers{
+	int numProcs;
+	int rank;//0 in the parent
+	vector<pid_t> pids;
+	vector<int> fds;//in the parent one per worker, in a worker only fds[0], the connection to the parent
+	vector<unsigned long long> startCounts;
+	void (*oldPipeHandler)(int);
+
+	static bool WriteAll(int fd, const void *buf, size_t len){
+		const char *c = (const char *) buf;
+		while(len > 0){
+			ssize_t w = write(fd, c, len);
+			if(w < 0 && errno == EINTR) continue;
+			if(w <= 0) return false;
+			c += w;
+			len -= w;
+			}
+		return true;
+		}
+	static bool ReadAll(int fd, void *buf, size_t len){
+		char *c = (char *) buf;
+		while(len > 0){
+			ssize_t r = read(fd, c, len);
+			if(r < 0 && errno == EINTR) continue;
+			if(r <= 0) return false;
+			c += r;
+			len -= r;
+			}
+		return true;
+		}
+	void Drop(int p){
+		close(fds[p]);
+		fds[p] = -1;
+		}
+
+	//not copyable
+	StepwiseWorkers(const StepwiseWorkers &);
+	StepwiseWorkers &operator=(const StepwiseWorkers &);
+
+public:
+	StepwiseWorkers(int procs) : numProcs(max(procs, 1)), rank(0), oldPipeHandler(NULL){
+		if(numProcs == 1) return;
+		//a failed worker shows up as a broken socket, which shouldn't kill the parent
+		oldPipeHandler = signal(SIGPIPE, SIG_IGN);
+		//anything still buffered would be written again by the copies in the workers
+		outman.flush();
+		asyncOut.Flush();
+		pids.assign(numProcs, -1);
+		fds.assign(numProcs, -1);
+		for(int p = 1;p < numProcs;p++){
+			int sv[2];
+			if(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0)
+				continue;
+			pid_t pid = fork();
+			if(pid == 0){
+				close(sv[0]);
+				//the connections to the other workers belong to the parent
+				for(int q = 1;q < p;q++)
+					if(fds[q] >= 0) close(fds[q]);
+				fds.assign(1, sv[1]);
+				pids.clear();
+				rank = p;
+#ifdef OPEN_MP
+				//the thread pool of the parent doesn't exist in the child
+				omp_set_num_threads(1);
+#endif
+				//the workers share the screen and log file with the parent
+				outman.SilenceForChildProcess();
+				const vector<ProfileCounter *> &counters = ProfileCounter::All();
+				for(vector<ProfileCounter *>::const_iterator c = counters.begin();c != counters.end();c++)
+					startCounts.push_back((*c)->Total());
+				return;
+				}
+			close(sv[1]);
+			if(pid < 0)
+				close(sv[0]);
+			else{
+				pids[p] = pid;
+				fds[p] = sv[0];
+				}
+			}
+		}
+
+	~StepwiseWorkers(){
+		//a worker only gets here if something was thrown, and must not return into the copy of the parent
+		if(rank != 0)
+			_exit(1);
+		if(numProcs == 1) return;
+		for(int p = 1;p < numProcs;p++){
+			if(fds[p] >= 0) close(fds[p]);
+			if(pids[p] > 0){
+				int status;
+				waitpid(pids[p], &status, 0);
+				}
+			}
+		signal(SIGPIPE, oldPipeHandler);
+		}
+
+	//scores this process' share of the points and exchanges the scores with the other processes
+	void ScoreAttachments(Individual &scratchI, const Individual *backup, int addedNum, vector<ReconNode> &attempted, FLOAT_TYPE optPrecision){
+		::ScoreAttachments(scratchI, backup, addedNum, attempted, rank, numProcs, optPrecision);
+		if(numProcs == 1) return;
+		int num = attempted.size();
+		if(rank != 0){
+			bool ok = true;
+			for(int b = rank;b < num && ok;b += numProcs)
+				ok = WriteAll(fds[0], &attempted[b].chooseProb, sizeof(FLOAT_TYPE));
+			ok = ok && WriteAll(fds[0], &Tree::rescaleEvery, sizeof(unsigned));
+			for(int b = 0;b < num && ok;b++)
+				ok = ReadAll(fds[0], &attempted[b].chooseProb, sizeof(FLOAT_TYPE));
+			ok = ok && ReadAll(fds[0], &Tree::rescaleEvery, sizeof(unsigned));
+			//the parent is gone
+			if(!ok) _exit(1);
+			return;
+			}
+		unsigned rescale = Tree::rescaleEvery;
+		for(int p = 1;p < numProcs;p++){
+			bool ok = (fds[p] >= 0);
+			for(int b = p;b < num && ok;b += numProcs)
+				ok = ReadAll(fds[p], &attempted[b].chooseProb, sizeof(FLOAT_TYPE));
+			unsigned workerRescale;
+			ok = ok && ReadAll(fds[p], &workerRescale, sizeof(unsigned));
+			if(ok)
+				rescale = min(rescale, workerRescale);
+			else{
+				if(fds[p] >= 0) Drop(p);
+				::ScoreAttachments(scratchI, backup, addedNum, attempted, p, numProcs, optPrecision);
+				rescale = min(rescale, Tree::rescaleEvery);
+				}
+			}
+		Tree::rescaleEvery = rescale;
+		for(int p = 1;p < numProcs;p++){
+			if(fds[p] < 0) continue;
+			bool ok = true;
+			for(int b = 0;b < num && ok;b++)
+				ok = WriteAll(fds[p], &attempted[b].chooseProb, sizeof(FLOAT_TYPE));
+			if(!(ok && WriteAll(fds[p], &rescale, sizeof(unsigned))))
+				Drop(p);
+			}
+		}
+
+	//workers send the work they did to the parent and exit
+	void Finish(){
+		if(numProcs == 1) return;
+		const vector<ProfileCounter *> &counters = ProfileCounter::All();
+		vector<unsigned long long> work(counters.size());
+		if(rank != 0){
+			for(unsigned c = 0;c < counters.size();c++)
+				work[c] = counters[c]->Total() - startCounts[c];
+			bool ok = (work.empty() || WriteAll(fds[0], &work[0], work.size() * sizeof(unsigned long long)));
+			_exit(ok ? 0 : 1);
+			}
+		for(int p = 1;p < numProcs;p++){
+			if(fds[p] < 0 || work.empty()) continue;
+			if(ReadAll(fds[p], &work[0], work.size() * sizeof(unsigned long long)))
+				for(unsigned c = 0;c < counters.size();c++)
+					counters[c]->Add(work[c]);
+			}
+		}
+	};
+#endif
+
+void Individual::MakeStepwiseTree(int nTax, int attachesPerTaxon, FLOAT_TYPE optPrecision, int numProcesses /*=1*/){
 	treeStruct=new Tree();
 	treeStruct->modPart = &modPart;
 	treeStruct->AssignCLAsFromMaster();
@@ -361,6 +579,9 @@ void Individual::MakeStepwiseTree(int nTax, int attachesPerTaxon, FLOAT_TYPE opt
 */
 	CopySecByRearrangingNodesOfFirst(treeStruct, &scratchI, true);
 
+#ifdef UNIX
+	StepwiseWorkers workers(numProcesses);
+#endif
 	for( int i = 3; i < n; i++ ) {
 		//select a random node
 		int pos = rnd.random_int( taxset.Size() );
@@ -386,33 +607,31 @@ void Individual::MakeStepwiseTree(int nTax, int attachesPerTaxon, FLOAT_TYPE opt
 		
 //			stepout << i << "\t" << k << "\t" << bestScore << "\t";
 
-		//start swappin
-		int num=0;
-		//for(list<ReconNode>::iterator b = scratchT->sprRang.begin();b != scratchT->sprRang.end();b++){
-		ReconList attempted;
-		while(num < attachesPerTaxon && scratchT->sprRang.size() > 0){
+		//choose all of the attachment points to try before scoring any of them.  Scoring doesn't use random 
+		//numbers, so this draws exactly the same points as choosing them one at a time, but the result
+		//doesn't depend on the order in which they are scored
+		vector<ReconNode> attempted;
+		while((int) attempted.size() < attachesPerTaxon && scratchT->sprRang.size() > 0){
 			int connectNum = rnd.random_int(scratchT->sprRang.size());
-			listIt broken = scratchT->sprRang.NthElement(connectNum);
-			//try a reattachment point
-			scratchT->SPRMutate(added->nodeNum, &(*broken), optPrecision, 0);
-			//record the score
-			broken->chooseProb = scratchT->lnL;
-			attempted.AddNode(*broken);
+			attempted.push_back(*(scratchT->sprRang.NthElement(connectNum)));
 			scratchT->sprRang.RemoveNthElement(connectNum);
-//			stepout << scratchT->lnL << "\t";
-			//restore the tree
-			scratchI.CopySecByRearrangingNodesOfFirst(scratchT, this, true);
-			num++;
 			}
-		//now find the best score
+
+		//start swappin.  Each attachment is scored starting from the same tree (the backup in this individual)
+#ifdef UNIX
+		workers.ScoreAttachments(scratchI, this, added->nodeNum, attempted, optPrecision);
+#else
+		ScoreAttachments(scratchI, this, added->nodeNum, attempted, 0, 1, optPrecision);
+#endif
+		//now find the best score.  Ties go to the attachment drawn first
 		ReconNode *best = NULL;
 		
 		//For debugging, add to random place, to check correct filtering of attachment points for constraints
 /*
 		if(attempted.size() != 0)
-			best = attempted.RandomReconNode();
+			best = &attempted[rnd.random_int(attempted.size())];
 */
-		for(list<ReconNode>::iterator b = attempted.begin();b != attempted.end();b++){
+		for(vector<ReconNode>::iterator b = attempted.begin();b != attempted.end();b++){
 			if((*b).chooseProb > bestScore){
 				best = &(*b);
 				bestScore = (*b).chooseProb;
@@ -465,6 +684,10 @@ void Individual::MakeStepwiseTree(int nTax, int attachesPerTaxon, FLOAT_TYPE opt
 			outman.UserMessage("\nOptimizing branchlengths... improved %.3f lnL", bimprove);
 			}
 		}		
+#ifdef UNIX
+	//the workers exit here
+	workers.Finish();
+#endif
 
 //	stepout.close();
 	outman.UserMessage("");
@@ -76,6 +76,7 @@ class Individual
 			 	anyModel	= rates | pi | alpha | pinv | muScale | subsetRate | indel
 			 	};
 		int mutated_brlen;//the number of brlen muts
+		unsigned long long mutation_work;//likelihood work done by the last mutation, see Population::PerformMutation
 		bool accurateSubtrees;
 
 		//Model *mod;
@@ -121,7 +122,9 @@ class Individual
 		void DuplicateIndivWithoutCLAs(const Individual *sourceOfInformation);
 		void ResetIndiv();
 		void MakeRandomTree(int nTax);
-		void MakeStepwiseTree(int nTax, int attemptsPerTaxon, FLOAT_TYPE optPrecision );
+		void MakeStepwiseTree(int nTax, int attemptsPerTaxon, FLOAT_TYPE optPrecision, int numProcesses = 1);
+		void MakeParsimonyTree();
+		void MakeDistanceTree();
 	};
 
 
@@ -134,6 +137,7 @@ inline void Individual::ResetIndiv(){
 	reproduced=willreproduce=willrecombine=false;
 	recombinewith=-1;
 	mutation_type=mutated_brlen=0;
+	mutation_work=0;
 	}
 
 #define BIPART_BASED_RECOM
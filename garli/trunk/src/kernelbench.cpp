@@ -0,0 +1,275 @@
+// GARLI version 2.1 source code
+// Copyright 2005-2014 Derrick J. Zwickl
+// email: garli.support@gmail.com
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+//Microbenchmarks of the individual likelihood kernels (garli-bench, or Garli --bench).  The data, model
+//and starting tree are set up exactly as for a normal run, and each kernel is then timed in isolation on
+//CLAs and matrices that belong only to the benchmark, so that nothing but the kernel itself is measured.
+//Results go to <ofprefix>.bench.log as one tab separated line per subset and kernel.
+
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+using namespace std;
+
+#include "defs.h"
+#include "population.h"
+#include "individual.h"
+#include "sequencedata.h"
+#include "tree.h"
+#include "condlike.h"
+#include "clamanager.h"
+#include "model.h"
+#include "outputman.h"
+#include "utility.h"
+
+extern OutputManager outman;
+
+//each kernel is repeated until it has run for at least this long
+#define BENCH_MIN_SECONDS 0.25
+#define BENCH_MIN_CALLS 5
+
+enum BenchKernel{
+	BENCH_CLA_INT_INT,
+	BENCH_CLA_INT_TERM,
+	BENCH_CLA_TERM_TERM,
+	BENCH_SCORE_INT,
+	BENCH_SCORE_TERM,
+	BENCH_DERIVS_INT,
+	BENCH_DERIVS_TERM,
+	BENCH_RESCALE,
+	BENCH_PMAT,
+	BENCH_DERIV_MATS,
+	NUM_BENCH_KERNELS
+	};
+
+//everything needed to call the kernels for one subset
+class KernelBenchSubset{
+	Tree *tree;
+	Model *mod;
+	int modIndex;
+	int dataIndex;
+	int nchar, nstates, nrates;
+	bool nuc, packed;
+
+	vector<FLOAT_TYPE> leftArr, rightArr, destArr, rescaleSource;
+	vector<int> leftUnder, rightUnder, destUnder;
+	CondLikeArray leftCLA, rightCLA, destCLA;
+
+	vector<FLOAT_TYPE> leftPr, rightPr, d1mat, d2mat;
+	char *tip1, *tip2;
+	const unsigned char *packed1, *packed2;
+	const unsigned *ambigMap;
+	FLOAT_TYPE sink;
+
+	static void FillArray(vector<FLOAT_TYPE> &arr, unsigned salt){
+		//arbitrary but reproducible values in (0.05, 0.95)
+		for(unsigned i = 0;i < arr.size();i++)
+			arr[i] = (FLOAT_TYPE) (0.05 + 0.9 * (((i + salt) * 2654435761u) % 1000) / 1000.0);
+		}
+
+public:
+	KernelBenchSubset(Tree *t, Model *m, const ClaSpecifier &spec)
+		: tree(t), mod(m), modIndex(spec.modelIndex), dataIndex(spec.dataIndex),
+		leftCLA(), rightCLA(), destCLA(), sink(ZERO_POINT_ZERO){
+
+		nchar = tree->dataPart->GetSubset(dataIndex)->NChar();
+		nstates = mod->NStates();
+		nrates = mod->NRateCats();
+		nuc = mod->IsNucleotide();
+
+		int size = nchar * nstates * nrates;
+		leftArr.resize(size);
+		rightArr.resize(size);
+		destArr.resize(size);
+		rescaleSource.resize(size);
+		FillArray(leftArr, 1);
+		FillArray(rightArr, 2);
+		FillArray(rescaleSource, 3);
+		//small enough that every site needs rescaling, but not so small that the rescaling frequency changes
+		for(int i = 0;i < size;i++)
+			rescaleSource[i] *= 1.0e-10;
+		leftUnder.assign(nchar, 0);
+		rightUnder.assign(nchar, 0);
+		destUnder.assign(nchar, 0);
+		leftCLA = CondLikeArray(nchar, nstates, nrates);
+		rightCLA = CondLikeArray(nchar, nstates, nrates);
+		destCLA = CondLikeArray(nchar, nstates, nrates);
+		leftCLA.Assign(&leftArr[0], &leftUnder[0]);
+		rightCLA.Assign(&rightArr[0], &rightUnder[0]);
+		destCLA.Assign(&destArr[0], &destUnder[0]);
+
+		//the model's own matrices are overwritten by the pmat timings, so take copies
+		int matSize = nrates * nstates * nstates;
+		FLOAT_TYPE *m1 = NULL, *m2 = NULL;
+		mod->CalcPmats(0.05, 0.15, m1, m2);
+		leftPr.assign(m1, m1 + matSize);
+		rightPr.assign(m2, m2 + matSize);
+		FLOAT_TYPE ***pr, ***one, ***two;
+		mod->CalcDerivatives(0.05, pr, one, two);
+		d1mat.assign(**one, **one + matSize);
+		d2mat.assign(**two, **two + matSize);
+
+		//two tips to use as terminal children
+		TreeNode *t1 = tree->allNodes[1], *t2 = tree->allNodes[2];
+		tip1 = t1->tipData[dataIndex];
+		tip2 = t2->tipData[dataIndex];
+		packed1 = (nuc ? t1->packedTipData[dataIndex] : NULL);
+		packed2 = (nuc ? t2->packedTipData[dataIndex] : NULL);
+		packed = (packed1 != NULL);
+#ifdef OPEN_MP
+		ambigMap = (nuc && !packed ? t1->ambigMap[dataIndex] : NULL);
+#else
+		ambigMap = NULL;
+#endif
+		}
+
+	int NChar() const {return nchar;}
+	int NStates() const {return nstates;}
+	int NRateCats() const {return nrates;}
+	bool Supported() const {return mod->IsOrientedGap() == false;}
+
+	string DataType() const {
+		if(nuc) return packed ? "nucleotide(packed)" : "nucleotide";
+		if(mod->GetModSpec()->IsCodon()) return "codon";
+		if(mod->GetModSpec()->IsAminoAcid()) return "aminoacid";
+		return "nstate";
+		}
+
+	const char *KernelName(int k) const {
+		switch(k){
+			case BENCH_CLA_INT_INT: return nuc ? "CalcFullCLAInternalInternal" : "CalcFullCLAInternalInternalNState";
+			case BENCH_CLA_INT_TERM: return nuc ? (packed ? "CalcFullCLAInternalTerminalPacked" : "CalcFullCLAInternalTerminal") : "CalcFullCLAInternalTerminalNState";
+			case BENCH_CLA_TERM_TERM: return nuc ? (packed ? "CalcFullCLATerminalTerminalPacked" : "CalcFullCLATerminalTerminal") : "CalcFullCLATerminalTerminalNState";
+			case BENCH_SCORE_INT: return nuc ? "GetScorePartialInternalRateHet" : "GetScorePartialInternalNState";
+			case BENCH_SCORE_TERM: return nuc ? (packed ? "GetScorePartialTerminalPacked" : "GetScorePartialTerminalRateHet") : "GetScorePartialTerminalNState";
+			case BENCH_DERIVS_INT: return nuc ? "GetDerivsPartialInternal" : (nrates > 1 ? "GetDerivsPartialInternalNStateRateHet" : "GetDerivsPartialInternalNState");
+			case BENCH_DERIVS_TERM: return nuc ? (packed ? "GetDerivsPartialTerminalPacked" : "GetDerivsPartialTerminal") : (nrates > 1 ? "GetDerivsPartialTerminalNStateRateHet" : "GetDerivsPartialTerminalNState");
+			case BENCH_RESCALE: return nuc ? "RescaleRateHet" : "RescaleRateHetNState";
+			case BENCH_PMAT: return "AltCalcPmat";
+			case BENCH_DERIV_MATS: return "CalcDerivatives";
+			}
+		return "";
+		}
+
+	//makes one call of kernel k, returning the number of ticks spent in the kernel itself
+	unsigned long long Call(int k){
+		FLOAT_TYPE d1 = ZERO_POINT_ZERO, d2 = ZERO_POINT_ZERO;
+		FLOAT_TYPE *m1 = NULL, *m2 = NULL;
+		FLOAT_TYPE ***pr, ***one, ***two;
+		if(k == BENCH_RESCALE){
+			//the rescaling is done in place, so it needs fresh values each time
+			memcpy(&destArr[0], &rescaleSource[0], sizeof(FLOAT_TYPE) * destArr.size());
+			memset(&destUnder[0], 0, sizeof(int) * nchar);
+			}
+		unsigned long long start = ProfilerTimeStamp();
+		switch(k){
+			case BENCH_CLA_INT_INT:
+				if(nuc) tree->CalcFullCLAInternalInternal(&destCLA, &leftCLA, &rightCLA, &leftPr[0], &rightPr[0], modIndex, dataIndex);
+				else tree->CalcFullCLAInternalInternalNState(&destCLA, &leftCLA, &rightCLA, &leftPr[0], &rightPr[0], modIndex, dataIndex);
+				break;
+			case BENCH_CLA_INT_TERM:
+				if(packed) tree->CalcFullCLAInternalTerminalPacked(&destCLA, &leftCLA, &leftPr[0], &rightPr[0], packed1, modIndex, dataIndex);
+				else if(nuc) tree->CalcFullCLAInternalTerminal(&destCLA, &leftCLA, &leftPr[0], &rightPr[0], tip1, ambigMap, modIndex, dataIndex);
+				else tree->CalcFullCLAInternalTerminalNState(&destCLA, &leftCLA, &leftPr[0], &rightPr[0], tip1, modIndex, dataIndex);
+				break;
+			case BENCH_CLA_TERM_TERM:
+				if(packed) tree->CalcFullCLATerminalTerminalPacked(&destCLA, &leftPr[0], &rightPr[0], packed1, packed2, modIndex, dataIndex);
+				else if(nuc) tree->CalcFullCLATerminalTerminal(&destCLA, &leftPr[0], &rightPr[0], tip1, tip2, modIndex, dataIndex);
+				else tree->CalcFullCLATerminalTerminalNState(&destCLA, &leftPr[0], &rightPr[0], tip1, tip2, modIndex, dataIndex);
+				break;
+			case BENCH_SCORE_INT:
+				if(nuc) sink += tree->GetScorePartialInternalRateHet(&leftCLA, &rightCLA, &leftPr[0], modIndex, dataIndex);
+				else sink += tree->GetScorePartialInternalNState(&leftCLA, &rightCLA, &leftPr[0], modIndex, dataIndex);
+				break;
+			case BENCH_SCORE_TERM:
+				if(packed) sink += tree->GetScorePartialTerminalPacked(&leftCLA, &leftPr[0], packed1, modIndex, dataIndex);
+				else if(nuc) sink += tree->GetScorePartialTerminalRateHet(&leftCLA, &leftPr[0], tip1, modIndex, dataIndex);
+				else sink += tree->GetScorePartialTerminalNState(&leftCLA, &leftPr[0], tip1, modIndex, dataIndex);
+				break;
+			case BENCH_DERIVS_INT:
+				if(nuc) tree->GetDerivsPartialInternal(&leftCLA, &rightCLA, &leftPr[0], &d1mat[0], &d2mat[0], d1, d2, modIndex, dataIndex);
+				else if(nrates > 1) tree->GetDerivsPartialInternalNStateRateHet(&leftCLA, &rightCLA, &leftPr[0], &d1mat[0], &d2mat[0], d1, d2, modIndex, dataIndex);
+				else tree->GetDerivsPartialInternalNState(&leftCLA, &rightCLA, &leftPr[0], &d1mat[0], &d2mat[0], d1, d2, modIndex, dataIndex);
+				break;
+			case BENCH_DERIVS_TERM:
+				if(packed) tree->GetDerivsPartialTerminalPacked(&leftCLA, &leftPr[0], &d1mat[0], &d2mat[0], packed1, d1, d2, modIndex, dataIndex);
+				else if(nuc) tree->GetDerivsPartialTerminal(&leftCLA, &leftPr[0], &d1mat[0], &d2mat[0], tip1, d1, d2, modIndex, dataIndex, ambigMap);
+				else if(nrates > 1) tree->GetDerivsPartialTerminalNStateRateHet(&leftCLA, &leftPr[0], &d1mat[0], &d2mat[0], tip1, d1, d2, modIndex, dataIndex);
+				else tree->GetDerivsPartialTerminalNState(&leftCLA, &leftPr[0], &d1mat[0], &d2mat[0], tip1, d1, d2, modIndex, dataIndex);
+				break;
+			case BENCH_RESCALE:
+				if(nuc) tree->RescaleRateHet(&destCLA, dataIndex);
+				else tree->RescaleRateHetNState(&destCLA, dataIndex);
+				break;
+			case BENCH_PMAT:
+				//a negative length skips the second matrix, so this is a single AltCalcPmat
+				mod->CalcPmats(0.05, -1.0, m1, m2);
+				sink += m1[1];
+				break;
+			case BENCH_DERIV_MATS:
+				mod->CalcDerivatives(0.05, pr, one, two);
+				sink += ***one;
+				break;
+			}
+		unsigned long long end = ProfilerTimeStamp();
+		sink += d1 + d2;
+		return end - start;
+		}
+	};
+
+void Population::RunKernelBenchmark(){
+	//like RunTests, this assumes that Setup has been called
+	SeedPopulationWithStartingTree(1);
+	Tree *tree0 = indiv[0].treeStruct;
+	ModelPartition *modPart = &indiv[0].modPart;
+
+	char fname[500];
+	sprintf(fname, "%s.bench.log", conf->ofprefix.c_str());
+	ofstream out(fname);
+	out << "subset\tdatatype\tstates\tratecats\tpatterns\tkernel\tcalls\ttotal_s\tns_per_call\tns_per_pattern\n";
+
+	double ticksPerSec = (double) ProfilerTicksPerSecond();
+	outman.UserMessage("\nKernel benchmarks (written to %s):", fname);
+	for(vector<ClaSpecifier>::iterator specs = claSpecs.begin();specs != claSpecs.end();specs++){
+		KernelBenchSubset bench(tree0, modPart->GetModel((*specs).modelIndex), *specs);
+		if(bench.Supported() == false){
+			outman.UserMessage("subset %d: kernels for this model type are not benchmarked", (*specs).dataIndex + 1);
+			continue;
+			}
+		outman.UserMessage("subset %d: %s, %d states, %d rate cats, %d patterns", (*specs).dataIndex + 1, bench.DataType().c_str(), bench.NStates(), bench.NRateCats(), bench.NChar());
+		for(int k = 0;k < NUM_BENCH_KERNELS;k++){
+			//one untimed call to touch the memory
+			bench.Call(k);
+			unsigned long long ticks = 0;
+			int calls = 0;
+			while(calls < BENCH_MIN_CALLS || ticks < BENCH_MIN_SECONDS * ticksPerSec){
+				ticks += bench.Call(k);
+				calls++;
+				}
+			double total = ticks / ticksPerSec;
+			double perCall = 1.0e9 * total / calls;
+			outman.UserMessage("  %-40s %12.1f ns/call %10.3f ns/pattern", bench.KernelName(k), perCall, perCall / bench.NChar());
+			out << (*specs).dataIndex + 1 << "\t" << bench.DataType() << "\t" << bench.NStates() << "\t" << bench.NRateCats() << "\t"
+				<< bench.NChar() << "\t" << bench.KernelName(k) << "\t" << calls << "\t" << total << "\t" << perCall << "\t" << perCall / bench.NChar() << "\n";
+			}
+		}
+	out.close();
+	}
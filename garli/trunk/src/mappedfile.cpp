@@ -0,0 +1,82 @@
+// GARLI version 2.1 source code
+// Copyright 2005-2014 Derrick J. Zwickl
+// email: garli.support@gmail.com
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cstdio>
+
+#ifdef UNIX
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "defs.h"
+#include "mappedfile.h"
+
+bool MappedFile::Open(const char *filename){
+	Close();
+#ifdef UNIX
+	int fd = open(filename, O_RDONLY);
+	if(fd < 0) return false;
+	struct stat st;
+	if(fstat(fd, &st) != 0 || st.st_size == 0){
+		close(fd);
+		return false;
+		}
+	void *addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	//the mapping stays valid after the descriptor is closed
+	close(fd);
+	if(addr != MAP_FAILED){
+		data = (const char *) addr;
+		size = st.st_size;
+		mapped = true;
+		return true;
+		}
+#endif
+	//otherwise just read the whole thing
+	FILE *inf = fopen(filename, "rb");
+	if(inf == NULL) return false;
+	fseek(inf, 0, SEEK_END);
+	long fileSize = ftell(inf);
+	fseek(inf, 0, SEEK_SET);
+	if(fileSize <= 0){
+		fclose(inf);
+		return false;
+		}
+	copy.resize(fileSize);
+	size_t got = fread(&copy[0], 1, fileSize, inf);
+	fclose(inf);
+	if(got != (size_t) fileSize){
+		copy.clear();
+		return false;
+		}
+	data = &copy[0];
+	size = fileSize;
+	return true;
+	}
+
+void MappedFile::Close(){
+#ifdef UNIX
+	if(mapped)
+		munmap((void *) data, size);
+#endif
+	mapped = false;
+	vector<char>().swap(copy);
+	data = NULL;
+	size = 0;
+	}
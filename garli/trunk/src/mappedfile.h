@@ -0,0 +1,50 @@
+// GARLI version 2.1 source code
+// Copyright 2005-2014 Derrick J. Zwickl
+// email: garli.support@gmail.com
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <vector>
+#include <cstddef>
+
+using namespace std;
+
+//Read only access to the whole contents of a file.  Under UNIX the file is memory mapped, so nothing is
+//copied until pages are touched.  Otherwise (or if mapping fails) the file is read into memory in one go.
+class MappedFile{
+	const char *data;
+	size_t size;
+	vector<char> copy;//only used if the file can't be mapped
+	bool mapped;
+
+	//not copyable
+	MappedFile(const MappedFile &);
+	MappedFile &operator=(const MappedFile &);
+
+public:
+	MappedFile() : data(NULL), size(0), mapped(false){}
+	~MappedFile(){Close();}
+
+	//returns false if the file can't be opened or is empty
+	bool Open(const char *filename);
+	void Close();
+
+	const char *Data() const {return data;}
+	size_t Size() const {return size;}
+	};
+
+#endif
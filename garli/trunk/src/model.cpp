@@ -26,11 +26,13 @@ using namespace std;
 #include "individual.h"
 #include "sequencedata.h"
 #include "rng.h"
+#include "checkpoint.h"
 
 #undef ALIGN_MODEL
 
 Profiler ProfCalcPmat("CalcPmat      ");
 Profiler ProfCalcEigen("CalcEigen     ");
+ProfileCounter CountPmats("PmatBuilds");
 					 
 extern rng rnd;
 extern vector<DataSubsetInfo> dataSubInfo;
@@ -98,6 +100,8 @@ Model::~Model(){
 	delete []EigValderiv;
 	delete []EigValderiv2;
 	delete []blen_multiplier;
+	if(packedTipTables != NULL)
+		delete []packedTipTables;
 
 #ifndef ALIGN_MODEL
 	Delete3DArray(eigvecs);
@@ -219,6 +223,12 @@ void Model::AllocateEigenVariables(){
 	deriv1=New3DAlignedArray<MODEL_FLOAT>(NRateCats(), nstates, nstates);
 	deriv2=New3DAlignedArray<MODEL_FLOAT>(NRateCats(), nstates, nstates);
 #endif
+
+	//room for the three lookup tables (pmat and two derivatives) of the packed nucleotide tip kernels
+	if(nstates == 4)
+		packedTipTables = new FLOAT_TYPE[3*16*4*NRateCats()];
+	else
+		packedTipTables = NULL;
 	}
 
 void Model::UpdateQMat(){
@@ -852,6 +862,7 @@ void Model::CalcPmats(FLOAT_TYPE blen1, FLOAT_TYPE blen2, FLOAT_TYPE *&mat1, FLO
 	if(this->modSpec->IsOrientedGap()){
 		if(!(blen1 < ZERO_POINT_ZERO)){
 			CalcOrientedGapPmat(blen1, pmat1);
+			CountPmats.Add();
 #ifdef SINGLE_PRECISION_FLOATS
 			ChangeMatrixPrecision(nstates * nstates * modSpec->numRateCats, pmat1, fpmat1);
 			mat1 = **fpmat1;
@@ -861,6 +872,7 @@ void Model::CalcPmats(FLOAT_TYPE blen1, FLOAT_TYPE blen2, FLOAT_TYPE *&mat1, FLO
 			}
 		if(!(blen2 < ZERO_POINT_ZERO)){
 			CalcOrientedGapPmat(blen2, pmat2);
+			CountPmats.Add();
 #ifdef SINGLE_PRECISION_FLOATS
 			ChangeMatrixPrecision(nstates * nstates * modSpec->numRateCats, pmat2, fpmat2);
 			mat2 = **fpmat2;
@@ -872,6 +884,7 @@ void Model::CalcPmats(FLOAT_TYPE blen1, FLOAT_TYPE blen2, FLOAT_TYPE *&mat1, FLO
 	else{
 		if(!(blen1 < ZERO_POINT_ZERO)){
 			AltCalcPmat(blen1, pmat1);
+			CountPmats.Add();
 #ifdef SINGLE_PRECISION_FLOATS
 			ChangeMatrixPrecision(nstates * nstates * modSpec->numRateCats, pmat1, fpmat1);
 			mat1 = **fpmat1;
@@ -881,6 +894,7 @@ void Model::CalcPmats(FLOAT_TYPE blen1, FLOAT_TYPE blen2, FLOAT_TYPE *&mat1, FLO
 			}
 		if(!(blen2 < ZERO_POINT_ZERO)){
 			AltCalcPmat(blen2, pmat2);
+			CountPmats.Add();
 #ifdef SINGLE_PRECISION_FLOATS
 			ChangeMatrixPrecision(nstates * nstates * modSpec->numRateCats, pmat2, fpmat2);
 			mat2 = **fpmat2;
@@ -3715,6 +3729,73 @@ void Model::ReadBinaryFormattedModel(FILE *in){
 		}
 	}
 
+//the same parameters as OutputBinaryFormattedModel, but in the portable checkpoint format, with counts
+//that are checked against the current model when reading
+void Model::WriteCheckpoint(CheckpointWriter &out) const{
+	vector<FLOAT_TYPE> vals;
+	if(NumRelRates() > 0 && (modSpec->IsAminoAcid() == false || modSpec->IsUserSpecifiedRateMatrix() || modSpec->IsEstimateAAMatrix() || modSpec->IsTwoSerineRateMatrix())){
+		for(int i=0;i<NumRelRates();i++)
+			vals.push_back(Rates(i));
+		}
+	out.PutDoubles(vals.empty() ? (FLOAT_TYPE *) NULL : &vals[0], (int) vals.size());
+
+	out.PutInt((int) omegas.size());
+	for(int i=0;i<omegas.size();i++){
+		out.PutDouble(*omegas[i]);
+		out.PutDouble(*omegaProbs[i]);
+		}
+
+	vals.clear();
+	for(int i=0;i<NStates();i++)
+		vals.push_back(StateFreq(i));
+	out.PutDoubles(&vals[0], (int) vals.size());
+
+	if(modSpec->IsFlexRateHet()){
+		out.PutDoubles(rateMults, NRateCats());
+		out.PutDoubles(rateProbs, NRateCats());
+		}
+	out.PutDouble(modSpec->IsGammaRateHet() ? Alpha() : ZERO_POINT_ZERO);
+	out.PutDouble(PropInvar());
+	if(IsOrientedGap()){
+		out.PutDouble(*insertRate);
+		out.PutDouble(*deleteRate);
+		}
+	}
+
+void Model::ReadCheckpoint(CheckpointReader &in){
+	if(NumRelRates() > 0 && (modSpec->IsAminoAcid() == false || modSpec->IsUserSpecifiedRateMatrix() || modSpec->IsEstimateAAMatrix() || modSpec->IsTwoSerineRateMatrix())){
+		vector<FLOAT_TYPE> r(NumRelRates());
+		in.GetDoubles(&r[0], NumRelRates(), "relative rates");
+		SetRmat(&r[0], false, false);
+		}
+	else in.ExpectCount(0, "relative rates");
+
+	in.ExpectCount((int) omegas.size(), "omega categories");
+	for(int i=0;i<omegas.size();i++){
+		*omegas[i] = in.GetDouble();
+		*omegaProbs[i] = in.GetDouble();
+		}
+
+	vector<FLOAT_TYPE> b(NStates());
+	in.GetDoubles(&b[0], NStates(), "state frequencies");
+	SetPis(&b[0], false, false);
+
+	if(modSpec->IsFlexRateHet()){
+		in.GetDoubles(rateMults, NRateCats(), "rate categories");
+		in.GetDoubles(rateProbs, NRateCats(), "rate categories");
+		}
+	FLOAT_TYPE a = in.GetDouble();
+	if(modSpec->IsGammaRateHet())
+		SetAlpha(a, false);
+	FLOAT_TYPE p = in.GetDouble();
+	if(PropInvar() != ZERO_POINT_ZERO)
+		SetPinv(p, false);
+	if(IsOrientedGap()){
+		*insertRate = in.GetDouble();
+		*deleteRate = in.GetDouble();
+		}
+	}
+
 void Model::MultiplyByJonesAAMatrix(){
 	int modNum=0;
 	MODEL_FLOAT **qmatOffset = qmat[modNum];
@@ -4947,6 +5028,30 @@ void ModelPartition::WriteModelPartitionCheckpoint(OUTPUT_CLASS &out) const {
 		}
 	}
 
+void ModelPartition::WriteCheckpoint(CheckpointWriter &out) const{
+	vector<FLOAT_TYPE> rates;
+	if(NumModelSets() > 1){
+		for(int s = 0;s < (int) NumSubsetRates();s++)
+			rates.push_back(subsetRates[s]);
+		}
+	out.PutDoubles(rates.empty() ? (FLOAT_TYPE *) NULL : &rates[0], (int) rates.size());
+	out.PutInt((int) modSets.size());
+	for(int m = 0;m < (int) modSets.size(); m++)
+		GetModelSet(m)->WriteCheckpoint(out);
+	}
+
+void ModelPartition::ReadCheckpoint(CheckpointReader &in){
+	if(NumModelSets() > 1){
+		vector<FLOAT_TYPE> rates(NumSubsetRates());
+		in.GetDoubles(&rates[0], NumSubsetRates(), "subset rates");
+		SetSubsetRates(rates, false);
+		}
+	else in.ExpectCount(0, "subset rates");
+	in.ExpectCount((int) modSets.size(), "model sets");
+	for(int m = 0;m < (int) modSets.size(); m++)
+		GetModelSet(m)->ReadCheckpoint(in);
+	}
+
 void ModelPartition::ReadModelPartitionCheckpoint(FILE *in) {
 	if(NumModelSets() > 1){	
 		FLOAT_TYPE *dummy = new FLOAT_TYPE;
@@ -38,6 +38,8 @@ class ModelSpecification;
 class ModelSpecificationSet;
 class MFILE;
 class Individual;
+class CheckpointWriter;
+class CheckpointReader;
 class ClaSpecifier;
 
 extern rng rnd;
@@ -1131,6 +1133,9 @@ class Model{
 	//Newton Raphson crap
 	MODEL_FLOAT ***deriv1, ***deriv2;
 
+	//filled from the current pmat or derivatives by each packed tip kernel call, so they are only allocated once
+	FLOAT_TYPE *packedTipTables;
+
 	//this will be a little bigger than necessary with some codes, but dynamically allocating a static is a bit of a pain
 	//Making these no longer static, to allow different codes for different
 	//partition subsets
@@ -1152,6 +1157,7 @@ class Model{
 
 	Model(int num){
         code = NULL;
+		packedTipTables = NULL;
 		stateFreqs.reserve(4);
 		relNucRates.reserve(6);
 		paramsToMutate.reserve(5);
@@ -1209,6 +1215,8 @@ class Model{
 	void OutputAminoAcidRMatrixMessage(ostream &out);
 
 	void ReadBinaryFormattedModel(FILE *);
+	void WriteCheckpoint(CheckpointWriter &out) const;
+	void ReadCheckpoint(CheckpointReader &in);
 	void FillQMatLookup();
 	void SetJonesAAFreqs();
 	void SetMtMamAAFreqs();
@@ -1958,6 +1966,8 @@ class Model{
 #endif
 		}
 
+	//scratch for Tree::FillPackedTipTable, three tables of 16*4*NRateCats() entries
+	FLOAT_TYPE *PackedTipTables() {return packedTipTables;}
 	const FLOAT_TYPE *GetRateProbs() {
 		//this is silly, but use the rateProbs as a holder to return the omegaProbs, which are in a vector of double pointers
 		if(modSpec->IsNonsynonymousRateHet())
@@ -2047,6 +2057,16 @@ public:
 			(*modit)->ReadBinaryFormattedModel(in);
 			}
 		}
+	void WriteCheckpoint(CheckpointWriter &out) const{
+		for(vector<Model*>::const_iterator modit = mods.begin();modit != mods.end();modit++){
+			(*modit)->WriteCheckpoint(out);
+			}
+		}
+	void ReadCheckpoint(CheckpointReader &in){
+		for(vector<Model*>::iterator modit = mods.begin();modit != mods.end();modit++){
+			(*modit)->ReadCheckpoint(in);
+			}
+		}
 	void SetDefaultModelSetParameters(SequenceData *data){
 		for(vector<Model*>::iterator modit = mods.begin();modit != mods.end();modit++){
 			(*modit)->SetDefaultModelParameters(data);
@@ -2201,6 +2221,8 @@ public:
 	void FillGarliFormattedModelStrings(string &s) const;
 	void WriteModelPartitionCheckpoint(OUTPUT_CLASS &out) const;
 	void ReadModelPartitionCheckpoint(FILE *in);
+	void WriteCheckpoint(CheckpointWriter &out) const;
+	void ReadCheckpoint(CheckpointReader &in);
 	};
 
 typedef void (Model::*SetParamFunc) (int, FLOAT_TYPE);
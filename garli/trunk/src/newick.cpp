@@ -0,0 +1,123 @@
+// GARLI version 2.1 source code
+// Copyright 2005-2014 Derrick J. Zwickl
+// email: garli.support@gmail.com
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+
+#include "newick.h"
+
+static const double powersOfTen[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+static const unsigned long long intPowersOfTen[] = {1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL,
+	1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL,
+	1000000000000ULL, 10000000000000ULL, 100000000000000ULL, 1000000000000000ULL};
+
+//writes the digits of val and returns the number written
+static int FormatUnsigned(unsigned long long val, char *out){
+	char digits[24];
+	int num = 0;
+	do{
+		digits[num++] = (char) ('0' + val % 10);
+		val /= 10;
+		}while(val > 0);
+	for(int d = 0;d < num;d++)
+		out[d] = digits[num - 1 - d];
+	return num;
+	}
+
+int FormatFixed(double val, int decimals, char *out){
+	//the scaled value is within 2^-11 of the exact product below 2^42, so rounding it gives the same
+	//result as sprintf's exact rounding unless it is within 2^-8 of halfway
+	if(val > 0.0 && decimals >= 0 && decimals <= 15){
+		double scaled = val * powersOfTen[decimals];
+		if(scaled < 4398046511104.0){
+			double whole = floor(scaled);
+			double frac = scaled - whole;
+			if(fabs(frac - 0.5) > 0.00390625){
+				unsigned long long rounded = (unsigned long long) whole + (frac > 0.5 ? 1 : 0);
+				unsigned long long intPart = rounded / intPowersOfTen[decimals];
+				unsigned long long fracPart = rounded - intPart * intPowersOfTen[decimals];
+				char *p = out + FormatUnsigned(intPart, out);
+				if(decimals > 0){
+					*p++ = '.';
+					for(int d = decimals - 1;d >= 0;d--){
+						p[d] = (char) ('0' + fracPart % 10);
+						fracPart /= 10;
+						}
+					p += decimals;
+					}
+				*p = '\0';
+				return (int) (p - out);
+				}
+			}
+		}
+	return sprintf(out, "%.*f", decimals, val);
+	}
+
+bool ParseDouble(const char *s, const char *&end, double &val){
+	const char *p = s;
+	bool negative = false;
+	if(*p == '-' || *p == '+'){
+		negative = (*p == '-');
+		p++;
+		}
+	unsigned long long mantissa = 0;
+	int numDigits = 0, significant = 0, exponent = 0;
+	for(;*p >= '0' && *p <= '9';p++, numDigits++){
+		if(significant > 0 || *p != '0') significant++;
+		mantissa = mantissa * 10 + (*p - '0');
+		}
+	if(*p == '.'){
+		for(p++;*p >= '0' && *p <= '9';p++, numDigits++){
+			if(significant > 0 || *p != '0') significant++;
+			mantissa = mantissa * 10 + (*p - '0');
+			exponent--;
+			}
+		}
+	//a single rounding of an exactly representable mantissa and power of ten (Clinger's fast path)
+	if(numDigits > 0 && significant <= 19 && *p != 'e' && *p != 'E' && *p != 'x' && *p != 'X' && mantissa <= (1ULL << 53) && exponent >= -22){
+		val = (double) mantissa / powersOfTen[-exponent];
+		if(negative) val = -val;
+		end = p;
+		return true;
+		}
+	char *strtodEnd;
+	val = strtod(s, &strtodEnd);
+	end = strtodEnd;
+	return end != s;
+	}
+
+void NewickBuffer::AppendInt(int val){
+	char str[24];
+	int len = 0;
+	if(val < 0){
+		str[len++] = '-';
+		len += FormatUnsigned(-(long long) val, str + len);
+		}
+	else
+		len = FormatUnsigned(val, str);
+	Append(str, len);
+	}
+
+void NewickBuffer::AppendFixed(double val, int decimals){
+	char str[512];
+	int len = FormatFixed(val, decimals, str);
+	Append(str, len);
+	}
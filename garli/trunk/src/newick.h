@@ -0,0 +1,89 @@
+// GARLI version 2.1 source code
+// Copyright 2005-2014 Derrick J. Zwickl
+// email: garli.support@gmail.com
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef NEWICK_H
+#define NEWICK_H
+
+#include <vector>
+#include <string>
+#include <cstring>
+#include <ostream>
+
+using namespace std;
+
+//Writes val with the given number of decimal places, with exactly the same result as sprintf's "%.*f", and
+//returns the number of characters written.  Ordinary branch lengths are formatted with integer arithmetic,
+//and anything else (including values too close to halfway between two outputs to be sure of the rounding)
+//goes through sprintf.  out must have room for the widest possible result, which is about 330 characters
+int FormatFixed(double val, int decimals, char *out);
+
+//Reads a number as strtod would, starting at s, and sets end to the character after it (or to s if there
+//is no number).  Plain decimals with no more than 19 significant digits, such as branch lengths written by
+//FormatFixed, are converted directly and are still correctly rounded.  Anything else goes to strtod
+bool ParseDouble(const char *s, const char *&end, double &val);
+
+//A null terminated character buffer that grows as needed, used to build tree descriptions.  Clear() keeps
+//the memory, so a buffer that is reused for every tree written stops allocating once it is big enough
+class NewickBuffer{
+	vector<char> buffer;
+	size_t length;
+
+	void Grow(size_t needed){
+		size_t size = buffer.size() * 2;
+		while(size < needed)
+			size *= 2;
+		buffer.resize(size);
+		}
+
+public:
+	NewickBuffer() : buffer(1024), length(0){
+		buffer[0] = '\0';
+		}
+	void Clear(){
+		length = 0;
+		buffer[0] = '\0';
+		}
+	void Append(char c){
+		if(length + 2 > buffer.size())
+			Grow(length + 2);
+		buffer[length++] = c;
+		buffer[length] = '\0';
+		}
+	void Append(const char *str, size_t len){
+		if(length + len + 1 > buffer.size())
+			Grow(length + len + 1);
+		memcpy(&buffer[length], str, len);
+		length += len;
+		buffer[length] = '\0';
+		}
+	void Append(const string &str){
+		Append(str.data(), str.length());
+		}
+	void AppendInt(int val);
+	void AppendFixed(double val, int decimals);
+
+	const char *c_str() const {return &buffer[0];}
+	size_t Length() const {return length;}
+	};
+
+inline ostream &operator<<(ostream &out, const NewickBuffer &buf){
+	out.write(buf.c_str(), buf.Length());
+	return out;
+	}
+
+#endif
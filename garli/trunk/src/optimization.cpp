@@ -28,6 +28,7 @@ Profiler ProfIntDeriv ("IntDeriv      ");
 Profiler ProfTermDeriv("TermDeriv     ");
 Profiler ProfModDeriv ("ModDeriv      ");
 Profiler ProfNewton   ("Newton-Raphson");
+ProfileCounter CountNRIterations("NRIterations");
 extern Profiler ProfEQVectors;
 
 #if !defined(STEP_TOL)
@@ -821,7 +822,7 @@ FLOAT_TYPE Tree::OptimizeBranchLength(FLOAT_TYPE optPrecision, TreeNode *nd, boo
 /*	ofstream opttrees;
 	if(num == 1) opttrees.open("everyTree.tre");
 	else opttrees.open("everyTree.tre", ios::app);
-	char treeString[20000];
+	NewickBuffer treeString;
 	root->MakeNewick(treeString, false, true);
 	opttrees <<  "utree tree" << num++ << "_" << nd->nodeNum << "=" << treeString << ";" << endl;
 	opttrees.close();
@@ -1141,6 +1142,9 @@ pair<FLOAT_TYPE, FLOAT_TYPE> Tree::CalcDerivativesRateHet(TreeNode *nd1, TreeNod
 				else
 					GetDerivsPartialTerminalNState(claOne, **prmat, **deriv1, **deriv2, childData, d1, d2, (*specs).modelIndex, (*specs).dataIndex);
 				}
+			else if(nd2->packedTipData[(*specs).dataIndex] != NULL){
+				GetDerivsPartialTerminalPacked(claOne, **prmat, **deriv1, **deriv2, nd2->packedTipData[(*specs).dataIndex], d1, d2, (*specs).modelIndex, (*specs).dataIndex);
+				}
 			else {
 	#ifdef OPEN_MP	
 				assert(nd2->ambigMap.size() > (*specs).dataIndex);
@@ -1442,6 +1446,7 @@ if(nd->nodeNum == 8){
 			try{
 				scoreOK=true;
 				derivs = CalcDerivativesRateHet(nd->anc, nd);
+				CountNRIterations.Add();
 				if(iter == 0) initialL = lnL;
 				optCalcs++;
 				}catch(int err){
@@ -2073,8 +2078,8 @@ inline FLOAT_TYPE CallBranchLikeRateHet(TreeNode *thisnode, Tree *thistree, FLOA
 	opt.close();
 
 	ofstream opttrees("opttrees.tre", ios::app);
-		char treeString[20000];
-		thistree->root->MakeNewick(treeString, false);
+		NewickBuffer treeString;
+		thistree->root->MakeNewick(treeString, false, true);
 		opttrees <<  "utree tree1=" << treeString << ";" << endl;
 		opttrees.close();
 	//if(thisnode->left!=NULL) thistree->TraceDirtynessToRoot(thisnode);
@@ -2578,6 +2583,129 @@ void Tree::GetDerivsPartialTerminal(const CondLikeArray *partialCLA, const FLOAT
 	assert(FloatingPointEquals(lnL, poo, 1e-8));
 */	}
 	
+//the same as GetDerivsPartialTerminal, but for a tip with packed data
+void Tree::GetDerivsPartialTerminalPacked(const CondLikeArray *partialCLA, const FLOAT_TYPE *prmat, const FLOAT_TYPE *d1mat, const FLOAT_TYPE *d2mat, const unsigned char *Ldata, FLOAT_TYPE &d1Tot, FLOAT_TYPE &d2Tot, int modIndex, int dataIndex){
+	const FLOAT_TYPE *partial=partialCLA->arr;
+	const SequenceData *data = dataPart->GetSubset(dataIndex);
+	Model *mod = modPart->GetModel(modIndex);
+	const int nchar=data->NChar();
+	const int nRateCats=mod->NRateCats();
+	const int stride=4*nRateCats;
+
+	const int *countit=data->GetCounts();
+	const FLOAT_TYPE *rateProb=mod->GetRateProbs();
+	const int lastConst=data->LastConstant();
+	const int *conBases=data->GetConstStates();
+	const FLOAT_TYPE prI=mod->PropInvar();
+
+	FLOAT_TYPE freqs[4];
+	for(int i=0;i<4;i++) 
+		freqs[i]=mod->StateFreq(i);
+
+	//derivatives of missing data are zero
+	FLOAT_TYPE *tables = mod->PackedTipTables();
+	FillPackedTipTable(prmat, nRateCats, ONE_POINT_ZERO, &tables[0]);
+	FillPackedTipTable(d1mat, nRateCats, ZERO_POINT_ZERO, &tables[16*stride]);
+	FillPackedTipTable(d2mat, nRateCats, ZERO_POINT_ZERO, &tables[2*16*stride]);
+	const FLOAT_TYPE *prTable = &tables[0];
+	const FLOAT_TYPE *d1Table = &tables[16*stride];
+	const FLOAT_TYPE *d2Table = &tables[2*16*stride];
+
+#ifdef UNIX
+	posix_madvise((void*)partial, nchar*4*nRateCats*sizeof(FLOAT_TYPE), POSIX_MADV_SEQUENTIAL);
+#endif
+
+	FLOAT_TYPE tot1=ZERO_POINT_ZERO, tot2=ZERO_POINT_ZERO, totL=ZERO_POINT_ZERO, grandSumL=ZERO_POINT_ZERO;//can't use d1Tot and d2Tot in OMP reduction because they are references
+
+	FLOAT_TYPE siteL, siteD1, siteD2;
+	FLOAT_TYPE La, Lc, Lg, Lt;
+	FLOAT_TYPE D1a, D1c, D1g, D1t;
+	FLOAT_TYPE D2a, D2c, D2g, D2t;
+	FLOAT_TYPE unscaledlnL;
+
+	vector<FLOAT_TYPE> siteLikes(nchar);
+
+#ifdef OMP_TERMDERIV
+	#ifdef LUMP_LIKES
+		#pragma omp parallel for private(partial, siteL, siteD1, siteD2, unscaledlnL, La, Lc, Lg, Lt, D1a, D1c, D1g, D1t, D2a, D2c, D2g, D2t) reduction(+ : tot1, tot2, totL, grandSumL)
+	#else
+		#pragma omp parallel for private(partial, siteL, siteD1, siteD2, unscaledlnL, La, Lc, Lg, Lt, D1a, D1c, D1g, D1t, D2a, D2c, D2g, D2t) reduction(+ : tot1, tot2, totL)
+	#endif
+	for(int i=0;i<nchar;i++){
+		partial = &partialCLA->arr[i*stride];
+#else
+	for(int i=0;i<nchar;i++){
+#endif
+#ifdef USE_COUNTS_IN_BOOT
+		if(countit[i] > 0){
+#else
+		if(1){
+#endif
+			const int offset = PackedTipState(Ldata, i) * stride;
+			const FLOAT_TYPE *pr = &prTable[offset];
+			const FLOAT_TYPE *d1 = &d1Table[offset];
+			const FLOAT_TYPE *d2 = &d2Table[offset];
+			La=Lc=Lg=Lt=D1a=D1c=D1g=D1t=D2a=D2c=D2g=D2t=ZERO_POINT_ZERO;
+			for(int r=0;r<nRateCats;r++){
+				La  += pr[0] * partial[0] * rateProb[r];
+				D1a += d1[0] * partial[0] * rateProb[r];
+				D2a += d2[0] * partial[0] * rateProb[r];
+				Lc  += pr[1] * partial[1] * rateProb[r];
+				D1c += d1[1] * partial[1] * rateProb[r];
+				D2c += d2[1] * partial[1] * rateProb[r];
+				Lg  += pr[2] * partial[2] * rateProb[r];
+				D1g += d1[2] * partial[2] * rateProb[r];
+				D2g += d2[2] * partial[2] * rateProb[r];
+				Lt  += pr[3] * partial[3] * rateProb[r];
+				D1t += d1[3] * partial[3] * rateProb[r];
+				D2t += d2[3] * partial[3] * rateProb[r];
+				pr += 4;
+				d1 += 4;
+				d2 += 4;
+				partial += 4;
+				}
+			if((mod->NoPinvInModel() == false) && (i<=lastConst)){
+				FLOAT_TYPE btot=ZERO_POINT_ZERO;
+				if(conBases[i]&1) btot+=freqs[0];
+				if(conBases[i]&2) btot+=freqs[1];
+				if(conBases[i]&4) btot+=freqs[2];
+				if(conBases[i]&8) btot+=freqs[3];
+				siteL  = ((La*freqs[0]+Lc*freqs[1]+Lg*freqs[2]+Lt*freqs[3]) + (prI*btot)*exp((FLOAT_TYPE)partialCLA->underflow_mult[i]));
+				}
+			else
+				siteL  = ((La*freqs[0]+Lc*freqs[1]+Lg*freqs[2]+Lt*freqs[3]));
+
+			assert(La >= 0.0f && Lc >= 0.0f && Lg >= 0.0f && Lt >= 0.0f);
+
+			unscaledlnL = log(siteL) - partialCLA->underflow_mult[i];
+			totL += unscaledlnL * countit[i];
+			siteD1 = (((D1a*freqs[0]+D1c*freqs[1]+D1g*freqs[2]+D1t*freqs[3])) / siteL);
+			tot1+= siteD1 * countit[i];			
+			siteD2=((D2a*freqs[0]+D2c*freqs[1]+D2g*freqs[2]+D2t*freqs[3]) / siteL) - (siteD1 * siteD1);
+			tot2 += siteD2 * countit[i];
+			}
+		if(sitelikeLevel != 0){
+			siteLikes[i] = unscaledlnL;
+			}
+#ifdef LUMP_LIKES
+		if((i + 1) % LUMP_FREQ == 0){
+			grandSumL += totL;
+			totL = ZERO_POINT_ZERO;
+			}
+		}
+	totL += grandSumL;
+#else
+		}
+#endif
+	if(sitelikeLevel != 0){
+		OutputSiteLikelihoods(dataIndex, siteLikes, partialCLA->underflow_mult, NULL);
+		}
+
+	d1Tot = tot1;
+	d2Tot = tot2;
+	lnL += totL;
+	}
+	
 void Tree::GetDerivsPartialTerminalNState(const CondLikeArray *partialCLA, const FLOAT_TYPE *prmat, const FLOAT_TYPE *d1mat, const FLOAT_TYPE *d2mat, const char *Ldat, FLOAT_TYPE &d1Tot, FLOAT_TYPE &d2Tot, int modIndex, int dataIndex){
 	//this function assumes that the pmat is arranged with nstates^2 entries for the
 	//first rate, followed by nstates^2 for the second, etc.
@@ -24,6 +24,8 @@
 #include <iostream>
 //#include <xiosbase>
 
+#include "asyncoutput.h"
+
 using namespace std;
 
 class fmtflags;
@@ -45,7 +47,7 @@ class OutputManager{
 			}
 			
 		~OutputManager(){
-			if(log==true) logOut.close();
+			if(log==true) asyncOut.Close(logOut);
 			}
 
 		bool IsLogSet(){
@@ -59,7 +61,7 @@ class OutputManager{
 		void SetLogFile(const char *logname){
 			log=true;
 			if(logOut.is_open()){
-				logOut.close();
+				asyncOut.Close(logOut);
 				logOut.clear();
 				}
 			logOut.open(logname);
@@ -78,20 +80,26 @@ class OutputManager{
 		void SetLogFileForAppend(const char *logname){
 			log=true;
 			if(logOut.is_open()){
-				logOut.close();
+				asyncOut.Close(logOut);
 				logOut.clear();
 				}
 			logOut.open(logname, ios::app);
 			}
 
 		void CloseLogFile(){
-			logOut.close();
+			asyncOut.Close(logOut);
 			}
 
 		void SetNoOutput(bool o){
 			noOutput=o;	
 			}
 
+		//for a forked worker process, which shares the screen and log file with its parent
+		void SilenceForChildProcess(){
+			noOutput=true;
+			log=false;
+			}
+
 		void precision(const int p){
 			defaultOut->precision(p);
 			if(log==true) logOut.precision(p);
@@ -0,0 +1,376 @@
+// GARLI version 2.1 source code
+// Copyright 2005-2014 Derrick J. Zwickl
+// email: garli.support@gmail.com
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cstdio>
+#include <cstring>
+#include <cassert>
+
+#include "defs.h"
+#include "parsimony.h"
+#include "sequencedata.h"
+#include "tree.h"
+#include "rng.h"
+
+extern rng rnd;
+
+ParsimonyStartingTree::ParsimonyStartingTree(const DataPartition *data){
+	nTax = data->NTax();
+	setWords = 0;
+	maxWords = 0;
+	totalWeight = 0.0;
+	for(int p = 0;p < data->NumSubsets();p++){
+		const SequenceData *curData = data->GetSubset(p);
+		PackedSubset sub;
+		//nucleotide data is already stored as a bitwise set of states, everything else as a single state
+		//with the fully ambiguous state being numbered after the real ones
+		sub.nStates = (curData->IsNucleotide() ? 4 : curData->MaxNumStates());
+		//one bit per packed pattern
+		sub.nWords = (curData->NChar() + wordBits - 1) / wordBits;
+		sub.setOffset = setWords;
+		sub.weightOffset = (int) weightPlanes.size();
+		const int *counts = curData->GetCounts();
+		int maxCount = 1;
+		for(int c = 0;c < curData->NChar();c++){
+			if(counts[c] > maxCount) maxCount = counts[c];
+			totalWeight += counts[c];
+			}
+		sub.nWeightBits = 0;
+		while(maxCount >> sub.nWeightBits) sub.nWeightBits++;
+
+		weightPlanes.resize(weightPlanes.size() + sub.nWeightBits * sub.nWords, 0);
+		for(int c = 0;c < curData->NChar();c++){
+			FitchWord bit = (FitchWord) 1 << (c % wordBits);
+			for(int b = 0;b < sub.nWeightBits;b++)
+				if((counts[c] >> b) & 1) weightPlanes[sub.weightOffset + b * sub.nWords + c / wordBits] |= bit;
+			}
+		setWords += sub.nStates * sub.nWords;
+		if(sub.nWords > maxWords) maxWords = sub.nWords;
+		subsets.push_back(sub);
+		}
+
+	int numNodes = 2 * nTax - 2;
+	downSets.assign(numNodes * setWords, 0);
+	upSets.assign(numNodes * setWords, 0);
+	edgeSets.assign(numNodes * setWords, 0);
+	scratchSet.assign(setWords, 0);
+	scratchAny.assign(maxWords, 0);
+	anc.assign(numNodes, -1);
+	left.assign(numNodes, -1);
+	right.assign(numNodes, -1);
+	downChanged.assign(numNodes, 0);
+
+	for(int t = 0;t < nTax;t++){
+		for(int p = 0;p < data->NumSubsets();p++){
+			const SequenceData *curData = data->GetSubset(p);
+			const PackedSubset &sub = subsets[p];
+			FitchWord *tipSet = DownSet(t) + sub.setOffset;
+			for(int c = 0;c < sub.nWords * wordBits;c++){
+				FitchWord bit = (FitchWord) 1 << (c % wordBits);
+				int word = c / wordBits;
+				//padding past the last pattern is treated as missing, and has no weight anyway
+				int datum = (c < curData->NChar() ? curData->Matrix(t, c) : -1);
+				for(int st = 0;st < sub.nStates;st++){
+					bool on;
+					if(datum < 0) on = true;
+					else if(curData->IsNucleotide()) on = ((datum >> st) & 1) != 0;
+					else on = (datum >= sub.nStates || datum == st);
+					if(on) tipSet[st * sub.nWords + word] |= bit;
+					}
+				}
+			}
+		}
+	}
+
+//The basic Fitch step.  For each pattern, if the two sets intersect the result is the intersection,
+//otherwise it is the union and a change is counted (weighted by the pattern count).  out may be one of the inputs.
+//If out is NULL and limit isn't negative, counting stops as soon as the changes exceed limit
+int ParsimonyStartingTree::Join(const FitchWord *a, const FitchWord *b, FitchWord *out, int limit /*=-1*/){
+	int changes = 0;
+	FitchWord *any = &scratchAny[0];
+	for(vector<PackedSubset>::const_iterator sub = subsets.begin();sub != subsets.end();sub++){
+		const int nw = sub->nWords;
+		const FitchWord *subA = a + sub->setOffset;
+		const FitchWord *subB = b + sub->setOffset;
+		for(int w = 0;w < nw;w++)
+			any[w] = 0;
+		for(int st = 0;st < sub->nStates;st++){
+			const FitchWord *stA = subA + st * nw;
+			const FitchWord *stB = subB + st * nw;
+			for(int w = 0;w < nw;w++)
+				any[w] |= stA[w] & stB[w];
+			}
+		if(out != NULL){
+			FitchWord *subOut = out + sub->setOffset;
+			for(int st = 0;st < sub->nStates;st++){
+				const FitchWord *stA = subA + st * nw;
+				const FitchWord *stB = subB + st * nw;
+				FitchWord *stOut = subOut + st * nw;
+				for(int w = 0;w < nw;w++)
+					stOut[w] = (stA[w] & stB[w]) | (~any[w] & (stA[w] | stB[w]));
+				}
+			}
+		const FitchWord *weights = &weightPlanes[sub->weightOffset];
+		for(int w = 0;w < nw;w++){
+			FitchWord noIntersection = ~any[w];
+			if(noIntersection == 0) continue;
+			for(int b = 0;b < sub->nWeightBits;b++)
+				changes += BlockPopCount(noIntersection & weights[b * nw + w]) << b;
+			if(changes > limit && limit >= 0 && out == NULL)
+				return changes;
+			}
+		}
+	return changes;
+	}
+
+bool ParsimonyStartingTree::JoinInto(const FitchWord *a, const FitchWord *b, FitchWord *dest){
+	Join(a, b, &scratchSet[0]);
+	if(memcmp(&scratchSet[0], dest, setWords * sizeof(FitchWord)) == 0)
+		return false;
+	memcpy(dest, &scratchSet[0], setWords * sizeof(FitchWord));
+	return true;
+	}
+
+void ParsimonyStartingTree::ReplaceDes(int par, int oldDes, int newDes){
+	if(par == 0) rootDes = newDes;
+	else if(left[par] == oldDes) left[par] = newDes;
+	else{
+		assert(right[par] == oldDes);
+		right[par] = newDes;
+		}
+	anc[newDes] = par;
+	}
+
+//attach node sub (with its subtree) to the branch below node "below", using the unattached internal node newInternal
+void ParsimonyStartingTree::Attach(int sub, int newInternal, int below){
+	ReplaceDes(anc[below], below, newInternal);
+	left[newInternal] = below;
+	right[newInternal] = sub;
+	anc[below] = newInternal;
+	anc[sub] = newInternal;
+	}
+
+//remove node sub (with its subtree) from the tree, returning the internal node that it was attached with
+int ParsimonyStartingTree::Detach(int sub){
+	int par = anc[sub];
+	int sib = (left[par] == sub ? right[par] : left[par]);
+	ReplaceDes(anc[par], par, sib);
+	anc[sub] = -1;
+	return par;
+	}
+
+void ParsimonyStartingTree::CollectPreorder(int start, vector<int> &order) const{
+	order.clear();
+	vector<int> stack(1, start);
+	while(stack.empty() == false){
+		int n = stack.back();
+		stack.pop_back();
+		order.push_back(n);
+		if(n >= nTax){
+			stack.push_back(right[n]);
+			stack.push_back(left[n]);
+			}
+		}
+	}
+
+//recalculates the down and up sets of the whole tree, and returns the score
+int ParsimonyStartingTree::Traverse(){
+	CollectPreorder(rootDes, preorder);
+	int score = 0;
+	for(vector<int>::reverse_iterator it = preorder.rbegin();it != preorder.rend();it++)
+		if(*it >= nTax) score += Join(DownSet(left[*it]), DownSet(right[*it]), DownSet(*it));
+	score += Join(DownSet(0), DownSet(rootDes), NULL);
+
+	memcpy(UpSet(rootDes), DownSet(0), setWords * sizeof(FitchWord));
+	for(vector<int>::iterator it = preorder.begin();it != preorder.end();it++){
+		if(*it >= nTax){
+			Join(UpSet(*it), DownSet(right[*it]), UpSet(left[*it]));
+			Join(UpSet(*it), DownSet(left[*it]), UpSet(right[*it]));
+			}
+		Join(DownSet(*it), UpSet(*it), EdgeSet(*it));
+		}
+	return score;
+	}
+
+//Brings the sets up to date after Attach or Detach changed the descendents of node changed (0 if rootDes
+//itself was replaced).  Every stored set is always the Fitch set of the stored sets it was calculated from,
+//so the down sets only need recalculating towards the root until one comes out the same.  The up sets are
+//then recalculated from there, only descending into a node if its up set or its own down set changed, and
+//the edge sets of exactly those nodes are redone.  Typically this touches a small part of the tree, rather
+//than the whole thing as Traverse does.
+void ParsimonyStartingTree::UpdateSets(int changed){
+	int top = changed;
+	while(top != 0){
+		//the node whose descendents changed always counts as changed, since its own up set may be stale
+		if(JoinInto(DownSet(left[top]), DownSet(right[top]), DownSet(top)) == false && top != changed)
+			break;
+		downChanged[top] = 1;
+		changedPath.push_back(top);
+		top = anc[top];
+		}
+
+	//the sets of top (if it isn't the root tip) and everything above it are unchanged
+	upStack.clear();
+	if(top == 0){
+		bool upChanged = memcmp(UpSet(rootDes), DownSet(0), setWords * sizeof(FitchWord)) != 0;
+		if(upChanged)
+			memcpy(UpSet(rootDes), DownSet(0), setWords * sizeof(FitchWord));
+		if(upChanged || downChanged[rootDes]){
+			Join(DownSet(rootDes), UpSet(rootDes), EdgeSet(rootDes));
+			if(rootDes >= nTax) upStack.push_back(rootDes);
+			}
+		}
+	else upStack.push_back(top);
+
+	while(upStack.empty() == false){
+		int n = upStack.back();
+		upStack.pop_back();
+		int des[2] = {left[n], right[n]};
+		for(int d = 0;d < 2;d++){
+			if(JoinInto(UpSet(n), DownSet(des[1 - d]), UpSet(des[d])) || downChanged[des[d]]){
+				Join(DownSet(des[d]), UpSet(des[d]), EdgeSet(des[d]));
+				if(des[d] >= nTax) upStack.push_back(des[d]);
+				}
+			}
+		}
+
+	for(vector<int>::iterator it = changedPath.begin();it != changedPath.end();it++)
+		downChanged[*it] = 0;
+	changedPath.clear();
+	}
+
+//Attaching anything to a branch increases the score by exactly the number of changes between what is
+//attached and the edge set of the branch.  Once the cost is known to be over limit (if it isn't negative)
+//the count stops, and something over limit is returned
+int ParsimonyStartingTree::AttachmentCost(int n, const FitchWord *sub, int limit /*=-1*/){
+	return Join(EdgeSet(n), sub, NULL, limit);
+	}
+
+//returns the node below the best branch in preorder, breaking ties randomly
+int ParsimonyStartingTree::BestAttachment(const FitchWord *sub, int &cost){
+	int best = -1;
+	int ties = 0;
+	for(vector<int>::iterator it = preorder.begin();it != preorder.end();it++){
+		int c = AttachmentCost(*it, sub, (best < 0 ? -1 : cost));
+		if(best < 0 || c < cost){
+			best = *it;
+			cost = c;
+			ties = 1;
+			}
+		else if(c == cost){
+			ties++;
+			if(rnd.random_int(ties) == 0) best = *it;
+			}
+		}
+	return best;
+	}
+
+//Tries pruning each subtree and reattaching it to every other branch, taking any that improve the score.
+//The sets are updated incrementally after each prune and regraft, so each regraft is scored from the
+//edge sets with a single Fitch step
+bool ParsimonyStartingTree::SPRRound(int &score){
+	bool improved = false;
+	vector<int> order;
+	CollectPreorder(rootDes, order);
+	for(vector<int>::iterator it = order.begin();it != order.end();it++){
+		int sub = *it;
+		if(sub == rootDes) continue;
+		int par = anc[sub];
+		int sib = (left[par] == sub ? right[par] : left[par]);
+		int connector = Detach(sub);
+		UpdateSets(anc[sib]);
+		CollectPreorder(rootDes, preorder);
+		int origCost = AttachmentCost(sib, DownSet(sub));
+		int cost;
+		int best = BestAttachment(DownSet(sub), cost);
+		if(cost < origCost)
+			improved = true;
+		else best = sib;
+		Attach(sub, connector, best);
+		UpdateSets(connector);
+		}
+	score = Traverse();
+	return improved;
+	}
+
+void ParsimonyStartingTree::AppendNewick(int n, string &newick){
+	char str[50];
+	if(n < nTax){
+		sprintf(str, "%d", n + 1);
+		newick += str;
+		}
+	else{
+		newick += "(";
+		AppendNewick(left[n], newick);
+		newick += ",";
+		AppendNewick(right[n], newick);
+		newick += ")";
+		}
+	sprintf(str, ":%.8f", BranchLength(n));
+	newick += str;
+	}
+
+//the proportion of changes between the two sides of the branch below n
+FLOAT_TYPE ParsimonyStartingTree::BranchLength(int n){
+	FLOAT_TYPE len = (totalWeight > 0.0 ? (FLOAT_TYPE) (Join(DownSet(n), UpSet(n), NULL) / totalWeight) : Tree::exp_starting_brlen);
+	len = max(len, Tree::min_brlen);
+	return min(len, Tree::max_brlen);
+	}
+
+int ParsimonyStartingTree::Build(string &newick){
+	assert(nTax > 3);
+	//random addition order, with taxon 1 always at the root
+	vector<int> order;
+	for(int t = 1;t < nTax;t++)
+		order.push_back(t);
+	for(int i = (int) order.size() - 1;i > 0;i--){
+		int j = rnd.random_int(i + 1);
+		int tmp = order[i];
+		order[i] = order[j];
+		order[j] = tmp;
+		}
+
+	int nextInternal = nTax;
+	rootDes = nextInternal++;
+	anc[rootDes] = 0;
+	left[rootDes] = order[0];
+	right[rootDes] = order[1];
+	anc[order[0]] = anc[order[1]] = rootDes;
+
+	Traverse();
+	for(unsigned i = 2;i < order.size();i++){
+		int cost;
+		int best = BestAttachment(DownSet(order[i]), cost);
+		Attach(order[i], nextInternal, best);
+		UpdateSets(nextInternal++);
+		CollectPreorder(rootDes, preorder);
+		}
+
+	int score;
+	while(SPRRound(score));
+
+	//the unrooted tree has a basal trifurcation at rootDes, so taxon 1 gets the branch below it
+	newick = "(";
+	char str[50];
+	sprintf(str, "1:%.8f", BranchLength(rootDes));
+	newick += str;
+	newick += ",";
+	AppendNewick(left[rootDes], newick);
+	newick += ",";
+	AppendNewick(right[rootDes], newick);
+	newick += ");";
+	return score;
+	}
@@ -0,0 +1,106 @@
+// GARLI version 2.1 source code
+// Copyright 2005-2014 Derrick J. Zwickl
+// email: garli.support@gmail.com
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PARSIMONY_H
+#define PARSIMONY_H
+
+#include <vector>
+#include <string>
+
+using namespace std;
+
+#include "defs.h"
+#include "bipartition.h"
+
+class DataPartition;
+
+//the state sets hold one bit per packed pattern.  This is independent of the Bipartition blocks, although 
+//BlockPopCount is used for counting, so a word can't be wider than a BipartBlock
+typedef unsigned long long FitchWord;
+
+//Builds a starting tree (streefname = parsimony) by randomized stepwise addition under Fitch parsimony,
+//followed by rounds of SPR rearrangements until the score no longer improves.
+//The state sets are bit packed, with one word holding one bit of each of wordBits patterns for a single state,
+//so that a Fitch step for a word of patterns is a handful of bitwise ops.  The pattern counts are also
+//stored as bit planes, so that the weighted number of changes is found with popcounts.
+//The down and up sets are kept current as the tree changes (see UpdateSets), so adding a taxon or trying
+//an SPR only recalculates the sets that the change actually affects rather than traversing the whole tree.
+//Nodes 0 to nTax-1 are the tips, and the tree is rooted at tip 0 (taxon 1), which has a single descendent.
+class ParsimonyStartingTree{
+	static const int wordBits = 8 * sizeof(FitchWord);
+	//the patterns of each data subset are packed separately, since the number of states can differ
+	struct PackedSubset{
+		int nStates;
+		int nWords;
+		int setOffset;//offset of this subset's words within a state set
+		int weightOffset;//offset of this subset's words in weightPlanes
+		int nWeightBits;
+		};
+	vector<PackedSubset> subsets;
+	int nTax;
+	int setWords;//words in one complete state set
+	int maxWords;
+	double totalWeight;
+
+	vector<FitchWord> weightPlanes;
+	//downSets[n] is the Fitch set of the subtree descended from node n.  upSets[n] is the set of
+	//the rest of the tree, as seen from n's branch.  For the tips downSets holds the observed data.
+	vector<FitchWord> downSets;
+	vector<FitchWord> upSets;
+	//edgeSets[n] is the join of the down and up sets of n's branch, which is all that is needed to score
+	//attaching something there
+	vector<FitchWord> edgeSets;
+	vector<FitchWord> scratchSet;
+	vector<FitchWord> scratchAny;
+
+	vector<int> anc, left, right;
+	int rootDes;
+	//all nodes below the root in preorder, as of the last call to CollectPreorder(rootDes, preorder)
+	vector<int> preorder;
+	//marks the nodes whose down sets were changed by the current call to UpdateSets
+	vector<char> downChanged;
+	vector<int> changedPath;
+	vector<int> upStack;
+
+	FitchWord *DownSet(int n) {return &downSets[n * setWords];}
+	FitchWord *UpSet(int n) {return &upSets[n * setWords];}
+	FitchWord *EdgeSet(int n) {return &edgeSets[n * setWords];}
+
+	//fills out (if not NULL) with the Fitch set of joining a and b, and returns the weighted number of changes
+	int Join(const FitchWord *a, const FitchWord *b, FitchWord *out, int limit=-1);
+	//joins a and b into the set stored at dest, and returns whether that changed it
+	bool JoinInto(const FitchWord *a, const FitchWord *b, FitchWord *dest);
+	void ReplaceDes(int par, int oldDes, int newDes);
+	void Attach(int sub, int newInternal, int below);
+	int Detach(int sub);
+	void CollectPreorder(int start, vector<int> &order) const;
+	int Traverse();
+	void UpdateSets(int changed);
+	//cost of attaching something with state set sub to the branch below node n, with the sets current
+	int AttachmentCost(int n, const FitchWord *sub, int limit=-1);
+	int BestAttachment(const FitchWord *sub, int &cost);
+	bool SPRRound(int &score);
+	void AppendNewick(int n, string &newick);
+	FLOAT_TYPE BranchLength(int n);
+
+public:
+	ParsimonyStartingTree(const DataPartition *data);
+	//returns the parsimony score, and fills the tree description with taxon numbers and branch lengths
+	int Build(string &newick);
+	};
+
+#endif
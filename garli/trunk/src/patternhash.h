@@ -0,0 +1,132 @@
+// GARLI version 2.1 source code
+// Copyright 2005-2014 Derrick J. Zwickl
+// email: garli.support@gmail.com
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef PATTERN_HASH_H
+#define PATTERN_HASH_H
+
+#include <vector>
+#include <cstring>
+
+using namespace std;
+
+//A 128 bit hash of a site pattern (or any other block of memory), made of two independently mixed 64 bit halves
+struct PatternHash{
+	unsigned long long h1;
+	unsigned long long h2;
+
+	PatternHash() : h1(0), h2(0){}
+	bool operator==(const PatternHash &rhs) const {return h1 == rhs.h1 && h2 == rhs.h2;}
+	bool operator!=(const PatternHash &rhs) const {return !(*this == rhs);}
+	};
+
+inline unsigned long long MixPatternHashWord(unsigned long long x){
+	x ^= x >> 33;
+	x *= 0xff51afd7ed558ccdULL;
+	x ^= x >> 33;
+	x *= 0xc4ceb9fe1a85ec53ULL;
+	x ^= x >> 33;
+	return x;
+	}
+
+inline PatternHash HashPattern(const void *data, size_t numBytes){
+	const unsigned char *bytes = (const unsigned char *) data;
+	PatternHash h;
+	h.h1 = 0x9e3779b97f4a7c15ULL ^ numBytes;
+	h.h2 = 0x632be59bd9b4e019ULL + numBytes;
+	size_t b = 0;
+	for(;b + 8 <= numBytes;b += 8){
+		unsigned long long w;
+		memcpy(&w, bytes + b, 8);
+		h.h1 = (h.h1 ^ w) * 0x87c37b91114253d5ULL;
+		h.h1 = (h.h1 << 31) | (h.h1 >> 33);
+		h.h2 = (h.h2 + w) * 0x4cf5ad432745937fULL;
+		h.h2 ^= h.h2 >> 29;
+		}
+	if(b < numBytes){
+		unsigned long long w = 0;
+		memcpy(&w, bytes + b, numBytes - b);
+		h.h1 = (h.h1 ^ w) * 0x87c37b91114253d5ULL;
+		h.h2 = (h.h2 + w) * 0x4cf5ad432745937fULL;
+		}
+	h.h1 = MixPatternHashWord(h.h1 + h.h2);
+	h.h2 = MixPatternHashWord(h.h2 ^ h.h1);
+	return h;
+	}
+
+//An open addressing table mapping pattern hashes to the index of a pattern stored elsewhere by the caller.
+//Identical hashes are not trusted - the caller supplies a functor that compares a stored pattern (by index)
+//with the one being looked up, so a collision only costs a comparison.
+class PatternHashTable{
+	struct Entry{
+		PatternHash hash;
+		int index;
+		};
+	vector<Entry> entries;
+	size_t mask;
+	size_t numStored;
+
+	void Grow(){
+		vector<Entry> old;
+		old.swap(entries);
+		Entry empty;
+		empty.index = -1;
+		entries.assign(old.size() * 2, empty);
+		mask = entries.size() - 1;
+		for(vector<Entry>::iterator it = old.begin();it != old.end();it++){
+			if(it->index < 0) continue;
+			size_t slot = it->hash.h1 & mask;
+			while(entries[slot].index >= 0)
+				slot = (slot + 1) & mask;
+			entries[slot] = *it;
+			}
+		}
+
+public:
+	PatternHashTable(size_t expected = 1024){
+		Reset(expected);
+		}
+	void Reset(size_t expected){
+		size_t size = 16;
+		while(size < expected * 2)
+			size *= 2;
+		Entry empty;
+		empty.index = -1;
+		entries.assign(size, empty);
+		mask = size - 1;
+		numStored = 0;
+		}
+	size_t Size() const {return numStored;}
+
+	//returns the index of a stored pattern that is identical to the one with hash h, or stores newIndex
+	//and returns it if there isn't one.  isSame(i) must return whether stored pattern i is identical.
+	template<class Comparer>
+	int FindOrInsert(const PatternHash &h, int newIndex, const Comparer &isSame){
+		size_t slot = h.h1 & mask;
+		while(entries[slot].index >= 0){
+			if(entries[slot].hash == h && isSame(entries[slot].index))
+				return entries[slot].index;
+			slot = (slot + 1) & mask;
+			}
+		entries[slot].hash = h;
+		entries[slot].index = newIndex;
+		if(++numStored * 2 > entries.size())
+			Grow();
+		return newIndex;
+		}
+	};
+
+#endif
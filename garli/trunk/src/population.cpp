@@ -55,26 +55,33 @@ using namespace std;
 #include "outputman.h"
 #include "model.h"
 #include "garlireader.h"
+#include "asyncoutput.h"
+#include "sitelikes.h"
 
-#ifdef ENABLE_CUSTOM_PROFILER
 #include "utility.h"
-extern Profiler ProfIntInt;
-extern Profiler ProfIntTerm;
-extern Profiler ProfTermTerm;
-extern Profiler ProfRescale;
-extern Profiler ProfScoreInt;
-extern Profiler ProfScoreTerm;
-extern Profiler ProfIntDeriv;
-extern Profiler ProfTermDeriv;
-extern Profiler ProfCalcPmat;
-extern Profiler ProfCalcEigen;
-extern Profiler ProfModDeriv;
-extern Profiler ProfNewton;
-extern Profiler ProfEQVectors;
-#endif
 
 extern OutputManager outman;
 extern bool interactive;
+extern ProfileCounter CountLnLEvals, CountClaIntInt, CountClaIntTerm, CountClaTermTerm;
+extern ProfileCounter CountPmats, CountNRIterations;
+
+//the categories of mutation that work is attributed to and that are reported in the telemetry.  These
+//are in the order of mutationWork and the arrays filled in OutputTelemetry
+static const char *mutationCategoryNames[NUM_MUTATION_CATEGORIES] = {"randNNI", "limSPR", "randSPR", "bipartRecom", "randRecom", "brlen", "model"};
+
+//the category that a mutation_type falls into, or -1 if it isn't one of them (or no mutation was done).
+//Topology changes take precedence over model changes, and a mutation is only brlen if nothing else was done
+static int MutationCategory(int typ){
+	if(typ <= 0) return -1;
+	if(typ & Individual::randNNI) return 0;
+	if(typ & (Individual::limSPR | Individual::limSPRCon)) return 1;
+	if(typ & (Individual::randSPR | Individual::randSPRCon)) return 2;
+	if(typ & Individual::bipartRecom) return 3;
+	if(typ & Individual::randRecom) return 4;
+	if(typ & Individual::anyModel) return 6;
+	if(typ & Individual::brlen) return 5;
+	return -1;
+	}
 bool swapBasedTerm = false;
 
 int memLevel;
@@ -168,11 +175,20 @@ void InterruptMessage( int )
 	askQuitNow = 1;
 }
 
+void TerminateMessage( int )
+{
+	askQuitNow = 2;
+}
+
 void TurnOnSignalCatching()
 {//if SIGINT (generally Ctrl-C) isn't already set to be ignored, set it to the custom handler 
 	if( signal( SIGINT, SIG_IGN ) != SIG_IGN ){
 		signal( SIGINT, InterruptMessage );
 		}
+	//with asynchronous output SIGTERM also stops the run gracefully, so that buffered output isn't lost
+	if( asyncOut.Running() && signal( SIGTERM, SIG_IGN ) != SIG_IGN ){
+		signal( SIGTERM, TerminateMessage );
+		}
 }
 
 void TurnOffSignalCatching()
@@ -180,9 +196,17 @@ void TurnOffSignalCatching()
 	if( signal( SIGINT, SIG_IGN ) != SIG_IGN ){
 		signal( SIGINT, SIG_DFL );
 		}
+	if( asyncOut.Running() && signal( SIGTERM, SIG_IGN ) != SIG_IGN ){
+		signal( SIGTERM, SIG_DFL );
+		}
 }
 
 bool CheckForUserSignal(){
+	//SIGTERM doesn't ask, even in interactive mode
+	if(askQuitNow == 2){
+		TurnOffSignalCatching();
+		return true;
+		}
 	//this will be set if the user raises a signal with ctrl-C
 	if(askQuitNow == 1){
 		char c;
@@ -237,6 +261,11 @@ bool CheckForUserSignal(){
 //
 //
 
+//streefname either names a file containing a starting tree and/or model, or one of the ways of generating a starting tree
+bool StartingTreeIsGenerated(const string &streefname){
+	return (_stricmp(streefname.c_str(), "random") == 0) || (_stricmp(streefname.c_str(), "stepwise") == 0) || (_stricmp(streefname.c_str(), "parsimony") == 0) || (_stricmp(streefname.c_str(), "nj") == 0);
+	}
+
 void ClearDebugLogs(){
 	//most of the debug logs just append to the current log, so clear them out here
 	#ifndef NDEBUG
@@ -269,6 +298,17 @@ void ClearDebugLogs(){
 
 Population::~Population()
 {
+	//the output streams are about to go away, so anything pending has to be written now
+	asyncOut.Detach(fate);
+	asyncOut.Detach(log);
+	asyncOut.Detach(treeLog);
+	asyncOut.Detach(probLog);
+	asyncOut.Detach(bootLog);
+	asyncOut.Detach(bootLogPhylip);
+	asyncOut.Detach(swapLog);
+	asyncOut.Detach(telemetry);
+	siteLikeOut.Close();
+
 	if(indiv != NULL){
 		for (unsigned i = 0; i < total_size; ++i)	{
 			for (unsigned j = 0; j < total_size; ++j)	{
@@ -294,9 +334,6 @@ Population::~Population()
 		MEM_DELETE_ARRAY(cumfit); // cumfit has length params.nindivs
 	}
 
-	if( treeString!=NULL)
-		MEM_DELETE_ARRAY(treeString);
-
 	for(vector<Tree*>::iterator vit=unusedTrees.begin();vit!=unusedTrees.end();vit++){
 		delete *vit;
 		}
@@ -381,6 +418,8 @@ void Population::CheckForIncompatibleConfigEntries(){
 		throw(ErrorException("You cannont infer internal states during a bootstrap run!"));
 	if(conf->outputSitelikelihoods > 0 && conf->bootstrapReps > 0) 
 		throw(ErrorException("You cannont output site likelihoods during a bootstrap run!"));
+	if(conf->rellBootstrapReps > 0 && conf->bootstrapReps > 0 && (StartingTreeIsGenerated(conf->streefname) || !FileIsNexus(conf->streefname.c_str()))) 
+		throw(ErrorException("Using rellbootstrapreps in a bootstrap run requires candidate starting trees in a Nexus streefname file"));
 	if(conf->startOptPrec < conf->minOptPrec)
 		throw ErrorException("startoptprec must be equal to or greater than minoptprec");
 
@@ -441,6 +480,12 @@ void Population::Setup(GeneralGamlConfig *c, DataPartition *d, DataPartition *ra
 
 	adap=new Adaptation(conf);
 
+#ifndef BOINC
+	checkpointFile.Setup(conf->ofprefix, conf->backgroundCheckpoints);
+	checkpointHashes.clear();
+	Tree::attemptedSwaps.TrackChanges(conf->incrementalCheckpoints && conf->uniqueSwapBias != ONE_POINT_ZERO);
+#endif
+
 #ifdef INCLUDE_PERTURBATION
 	pertMan = new PerturbManager(conf);
 #endif
@@ -451,20 +496,27 @@ void Population::Setup(GeneralGamlConfig *c, DataPartition *d, DataPartition *ra
 		paraMan = new ParallelManager(dataPart->NTax(), nprocs, mastConf);
 		}
 	
-	//use RTTI to check if the data subsets are nuclotide, and if so make ambig strings
+	//the telemetry includes the time spent in each kernel
+	if(conf->profile || conf->telemetryEvery > 0 || conf->hardwareCounters)
+		Profiler::Enable(true);
+	if(conf->hardwareCounters){
+		if(Profiler::EnableHardwareCounters(conf->hardwareCounterFlopEvent))
+			outman.UserMessage("Counting hardware events in the likelihood kernels (reported in the profile log)");
+		else
+			outman.UserMessage("NOTE: hardware counters could not be opened (they require Linux with perf_event_paranoid <= 2),\n\tso only times will be profiled");
+		}
+
+	//use RTTI to check if the data subsets are nuclotide, and if so make ambig strings (or packed tips)
 	for(int ds = 0;ds < dataPart->NumSubsets();ds++){
 		NucleotideData *nuc = dynamic_cast<NucleotideData *>(dataPart->GetSubset(ds));
-		if(nuc != NULL)
-			nuc->MakeAmbigStrings();
+		if(nuc != NULL){
+			if(conf->packedTipData)
+				nuc->MakePackedTips();
+			else
+				nuc->MakeAmbigStrings();
+			}
 		}
 		
-	//allocate the treeString
-	//remember that we also encode internal node numbers sometimes
-	FLOAT_TYPE taxsize=log10((FLOAT_TYPE) ((FLOAT_TYPE)dataPart->NTax())*dataPart->NTax()*2);
-	stringSize=(int)((dataPart->NTax()*2)*(10+DEF_PRECISION)+taxsize);
-	treeString=new char[stringSize];
-	treeString[stringSize - 1]='\0';
-
 	//allocate the indiv array
 	indiv = new Individual[total_size];
 	newindiv = new Individual[total_size];
@@ -587,7 +639,7 @@ void Population::Setup(GeneralGamlConfig *c, DataPartition *d, DataPartition *ra
 	GetConstraints();
 
 	//try to get nexus starting tree/trees from file, which we don't want to do within the PerformSearch loop
-	if((_stricmp(conf->streefname.c_str(), "random") != 0)  && (_stricmp(conf->streefname.c_str(), "stepwise") != 0))
+	if(!StartingTreeIsGenerated(conf->streefname))
 		if(FileIsNexus(conf->streefname.c_str())){
 			LoadNexusStartingConditions();
 			}
@@ -749,7 +801,19 @@ void Population::GenerateTreesOnly(int nTrees){
 	else if((_stricmp(conf->streefname.c_str(), "stepwise") == 0)){
 		outman.UserMessageNoCR("Making stepwise trees compatible with constraints... ");
 		for(int i=0;i<nTrees;i++){
-			indiv[0].MakeStepwiseTree(dataPart->NTax(), conf->attachmentsPerTaxon, adap->branchOptPrecision);
+			indiv[0].MakeStepwiseTree(dataPart->NTax(), conf->attachmentsPerTaxon, adap->branchOptPrecision, conf->stepwiseProcesses);
+			AppendTreeToTreeLog(-1, 0);
+			indiv[0].treeStruct->RemoveTreeFromAllClas();
+			delete indiv[0].treeStruct;
+			indiv[0].treeStruct=NULL;
+			if(!(i % 100)) outman.UserMessageNoCR("%d ", i);
+			}
+		}
+	//SeedPopulationWithStartingTree has already rejected constraints and rooted models for this
+	else if((_stricmp(conf->streefname.c_str(), "parsimony") == 0)){
+		outman.UserMessageNoCR("Making parsimony stepwise addition trees... ");
+		for(int i=0;i<nTrees;i++){
+			indiv[0].MakeParsimonyTree();
 			AppendTreeToTreeLog(-1, 0);
 			indiv[0].treeStruct->RemoveTreeFromAllClas();
 			delete indiv[0].treeStruct;
@@ -757,6 +821,17 @@ void Population::GenerateTreesOnly(int nTrees){
 			if(!(i % 100)) outman.UserMessageNoCR("%d ", i);
 			}
 		}
+	//the BIONJ tree doesn't depend on random numbers, so only one is made
+	else if((_stricmp(conf->streefname.c_str(), "nj") == 0)){
+		outman.UserMessageNoCR("Making BIONJ tree... ");
+		indiv[0].MakeDistanceTree();
+		AppendTreeToTreeLog(-1, 0);
+		indiv[0].treeStruct->RemoveTreeFromAllClas();
+		delete indiv[0].treeStruct;
+		indiv[0].treeStruct=NULL;
+		}
+	else
+		throw ErrorException("Only random, stepwise, parsimony or nj trees can be generated (runmode > 20), not streefname = %s", conf->streefname.c_str());
 	FinalizeOutputStreams(0);
 	}
 
@@ -982,7 +1057,7 @@ void Population::ValidateInput(int rep){
 #ifdef INPUT_RECOMBINATION
 	if(0)
 #else
-	if((_stricmp(conf->streefname.c_str(), "random") != 0) && (_stricmp(conf->streefname.c_str(), "stepwise") != 0))
+	if(!StartingTreeIsGenerated(conf->streefname))
 		//some starting file has been specified - Cases 3-11
 #endif
 	{
@@ -1055,7 +1130,7 @@ void Population::ValidateInput(int rep){
 	//Here we'll error out if something was fixed but didn't appear
 	for(int ms = 0;ms < modSpecSet.NumSpecs();ms++){
 		const ModelSpecification *modSpec = modSpecSet.GetModSpec(ms);
-		if((_stricmp(conf->streefname.c_str(), "random") == 0) || (_stricmp(conf->streefname.c_str(), "stepwise") == 0)){
+		if(StartingTreeIsGenerated(conf->streefname)){
 			//if no streefname file was specified, the param values should be in a garli block with the dataset
 			if(modSpec->IsNucleotide() && modSpec->IsUserSpecifiedStateFrequencies() && !modSpec->gotStateFreqsFromFile) 
 				throw(ErrorException("state frequencies specified as fixed, but no\n\tGarli block found in %s!!" , conf->datafname.c_str()));
@@ -1083,7 +1158,7 @@ void Population::ValidateInput(int rep){
 		}
 
 	//the treestruct could be null if there was a start file that contained no tree
-	if((_stricmp(conf->streefname.c_str(), "random") != 0) && (_stricmp(conf->streefname.c_str(), "stepwise") != 0) && (indiv[0].treeStruct != NULL)){
+	if(!StartingTreeIsGenerated(conf->streefname) && (indiv[0].treeStruct != NULL)){
 		bool foundPolytomies = indiv[0].treeStruct->ArbitrarilyBifurcate();
 		if(foundPolytomies) outman.UserMessage("WARNING: Polytomies found in start tree.  These were arbitrarily resolved.");
 	
@@ -1161,7 +1236,7 @@ void Population::SeedPopulationWithStartingTree(int rep){
 #ifdef INPUT_RECOMBINATION
 	if(0)
 #else
-	if((_stricmp(conf->streefname.c_str(), "random") != 0) && (_stricmp(conf->streefname.c_str(), "stepwise") != 0))
+	if(!StartingTreeIsGenerated(conf->streefname))
 		//some starting file has been specified - Cases 3-11
 #endif
 	{
@@ -1180,8 +1255,12 @@ void Population::SeedPopulationWithStartingTree(int rep){
 			int numTrees = treesblock->GetNumTrees();
 			if(numTrees > 0){
 				int treeNum = (rank+rep-1) % numTrees;
+				//with RELL screening each bootstrap replicate starts from the candidate that its resampled data favor
+				bool rellChoice = (conf->bootstrapReps > 0 && (int) rellCandidateLikes.size() == numTrees);
+				if(rellChoice)
+					treeNum = RELLBestTree(rellCandidateLikes);
 				indiv[0].GetStartingTreeFromNCL(treesblock, treeNum, dataPart->NTax());
-				outman.UserMessage("Obtained starting tree %d from Nexus", treeNum+1);
+				outman.UserMessage("Obtained starting tree %d from Nexus%s", treeNum+1, (rellChoice ? " (best RELL score for this replicate)" : ""));
 				}
 			else throw ErrorException("Problem getting tree(s) from NCL!");
 			}
@@ -1226,7 +1305,7 @@ void Population::SeedPopulationWithStartingTree(int rep){
 	//Here we'll error out if something was fixed but didn't appear
 	for(int ms = 0;ms < modSpecSet.NumSpecs();ms++){
 		const ModelSpecification *modSpec = modSpecSet.GetModSpec(ms);
-		if((_stricmp(conf->streefname.c_str(), "random") == 0) || (_stricmp(conf->streefname.c_str(), "stepwise") == 0)){
+		if(StartingTreeIsGenerated(conf->streefname)){
 			//if no streefname file was specified, the param values should be in a garli block with the dataset
 			if(modSpec->IsNucleotide() && modSpec->IsUserSpecifiedStateFrequencies() && !modSpec->gotStateFreqsFromFile) 
 				throw(ErrorException("state frequencies specified as fixed, but no\n\tGarli block found in %s!!" , conf->datafname.c_str()));
@@ -1277,7 +1356,25 @@ void Population::SeedPopulationWithStartingTree(int rep){
 		globalBest = ZERO_POINT_ZERO;
 		//DEBUG - haven't worked this out with the rooted tree yet, since the fake root needs to be in the tree before it is scored
 		assert(!indiv[0].treeStruct->rootWithDummy);
-		indiv[0].MakeStepwiseTree(dataPart->NTax(), conf->attachmentsPerTaxon, adap->branchOptPrecision);
+		//the stepwise workers are forked from this process, so don't leave a checkpoint half written
+		if(conf->stepwiseProcesses > 1)
+			checkpointFile.Wait();
+		indiv[0].MakeStepwiseTree(dataPart->NTax(), conf->attachmentsPerTaxon, adap->branchOptPrecision, conf->stepwiseProcesses);
+		}
+	else if(_stricmp(conf->streefname.c_str(), "parsimony") == 0 || _stricmp(conf->streefname.c_str(), "nj") == 0){
+		if(Tree::constraints.empty() == false)
+			throw ErrorException("Sorry, %s starting trees currently cannot be made compatible with constraints.\n\tTry streefname = stepwise or random, or provide your own starting tree.", conf->streefname.c_str());
+		if(Tree::rootWithDummy)
+			throw ErrorException("Sorry, %s starting trees currently cannot be used with rooted models.\n\tTry streefname = random, or provide your own starting tree.", conf->streefname.c_str());
+		if(_stricmp(conf->streefname.c_str(), "nj") == 0){
+			outman.UserMessage("creating BIONJ starting tree...");
+			indiv[0].MakeDistanceTree();
+			}
+		else{
+			outman.UserMessage("creating parsimony stepwise addition starting tree...");
+			indiv[0].MakeParsimonyTree();
+			}
+		indiv[0].SetDirty();
 		}
 	else if(_stricmp(conf->streefname.c_str(), "random") == 0 || indiv[0].treeStruct == NULL){
 		if(Tree::constraints.empty()) outman.UserMessage("creating random starting tree...");
@@ -1690,6 +1787,7 @@ void Population::WriteStateFiles(){
 
 #else
 void Population::WriteStateFiles(){
+#ifdef BOINC
 	char aname[128];
 	char pname[128];
 	char sname[128];
@@ -1702,7 +1800,6 @@ void Population::WriteStateFiles(){
 	//2. write the state of the population, including the seed, generation, elapsed time,
 	//	 lastTopoImprove and specifications of the current individuals
 	//3. if we are keeping track of swaps, write a checkpoint for that
-#ifdef BOINC
 	//The BOINC provided MFILE class handily allows writing to it before it is actually
 	//open and attached to any file.  It buffers the information, and flushes it upon closing
 	//of the file.  This is good, because all of the checkpoint information can be gathered
@@ -1738,22 +1835,11 @@ void Population::WriteStateFiles(){
 
 	boinc_checkpoint_completed();
 #else
-	//it would be nice to be able to do something like what is done for BOINC above (buffering output and
-	//then writing all at once), maybe with a stringstream, but I couldn't get that to work
-	ofstream aout(aname, ios::out | ios::binary);
-	adap->WriteToCheckpoint(aout);
-	aout.close();
-	
-	ofstream pout(pname, ios::out | ios::binary);
-	WritePopulationCheckpoint(pout);
-	pout.close();
-
-	if(conf->uniqueSwapBias != ONE_POINT_ZERO){
-		ofstream sout(sname, ios::out | ios::binary);
-		Tree::attemptedSwaps.WriteSwapCheckpoint(sout);
-		sout.close();
-		}
+	//everything goes into a single portable checkpoint file, which is written atomically
+	WriteCheckpoint();
 #endif
+	//the logs should be at least as current as the checkpoint
+	asyncOut.Flush();
 	}
 #endif
 
@@ -1761,6 +1847,15 @@ void Population::WriteStateFiles(){
 bool Population::ReadStateFiles(){
 	char name[100];
 
+#ifndef BOINC
+	//checkpoints are normally in the portable format.  The separate binary files read below are from older
+	//versions (or BOINC)
+	if(FileExists(CheckpointFile::CheckpointFilename(conf->ofprefix).c_str())){
+		ReadCheckpoint();
+		return true;
+		}
+#endif
+
 	//read the adaptation binary checkpoint
 	sprintf(name, "%s.adap.check", conf->ofprefix.c_str());
 	FILE *in;
@@ -1775,7 +1870,7 @@ bool Population::ReadStateFiles(){
 		//for the MPI version we don't care if checkpoint files weren't found
 		return false;
 	#else
-		throw(ErrorException("Could not find checkpoint file %s!\nEither the previous run was not writing checkpoints (checkpoint = 0),\nthe checkpoint files were moved/deleted or the ofprefix setting\nin the config file was changed.", name));
+		throw(ErrorException("Could not find checkpoint file %s!\nEither the previous run was not writing checkpoints (checkpoint = 0),\nthe checkpoint files were moved/deleted or the ofprefix setting\nin the config file was changed.", CheckpointFile::CheckpointFilename(conf->ofprefix).c_str()));
 	#endif
 		}
 	in = fopen(name, "rb");
@@ -1950,12 +2045,201 @@ void Population::ReadPopulationCheckpoint(){
 	globalBest = bestFitness;
 	}
 
+#define CHECKPOINT_POPULATION CHECKPOINT_TAG('P', 'O', 'P', 'N')
+#define CHECKPOINT_ADAPTATION CHECKPOINT_TAG('A', 'D', 'A', 'P')
+#define CHECKPOINT_INDIVIDUAL CHECKPOINT_TAG('I', 'N', 'D', 'V')
+#define CHECKPOINT_SWAPS CHECKPOINT_TAG('S', 'W', 'A', 'P')
+
+//Writes the whole state of the search as a record of the portable checkpoint (see CheckpointFile).  The
+//current individuals and stored trees are each a section numbered by slot, and with incrementalcheckpoints
+//a journal record only holds the ones whose contents have changed since they were last written, along
+//with the swaps that have changed.  Everything is encoded here, and the file itself may then be written by
+//a background thread (backgroundcheckpoints) while the search carries on.
+void Population::WriteCheckpoint(){
+	assert(!timeTermination && !userTermination);
+	unsigned numSlots = total_size + storedTrees.size();
+	bool full = (conf->incrementalCheckpoints == false || checkpointFile.NeedFull() || checkpointHashes.size() != numSlots);
+	CheckpointWriter record;
+
+	record.BeginSection(CHECKPOINT_POPULATION);
+	record.PutInt64(rnd.seed());
+	record.PutInt(stopwatch.SplitTime());
+	record.PutInt(total_size);
+	record.PutInt((int) storedTrees.size());
+	record.PutInt(rank);
+	record.PutInt(bestIndiv);
+	record.PutInt(bestAccurateIndiv);
+	record.PutInt(subtreeNode);
+	record.PutInt(subtreeDefNumber);
+	record.PutUInt32(gen);
+	record.PutUInt32(currentBootstrapRep);
+	record.PutInt(lastBootstrapSeed);
+	record.PutInt(nextBootstrapSeed);
+	record.PutUInt32(currentSearchRep);
+	record.PutUInt32(lastTopoImprove);
+	record.PutUInt32(lastPrecisionReduction);
+	record.PutUInt32(lastUniqueSwap);
+	record.PutUInt32(ntopos);
+	record.PutBool(finishedGenerations);
+	record.PutBool(finishedRep);
+	record.PutInt(initialRefinePass);
+	record.PutInt(finalRefinePass);
+	record.PutDouble(bestFitness);
+	record.PutDouble(prevBestFitness);
+	record.PutDouble(tot_fraction_done);
+	record.PutDouble(rep_fraction_done);
+	record.EndSection();
+
+	record.BeginSection(CHECKPOINT_ADAPTATION);
+	adap->WriteCheckpoint(record);
+	record.EndSection();
+
+	checkpointHashes.resize(numSlots);
+	CheckpointWriter ind;
+	for(unsigned i = 0;i < numSlots;i++){
+		Individual *cur = (i < total_size ? &indiv[i] : storedTrees[i - total_size]);
+		ind.Clear();
+		ind.PutInt(i);
+		cur->modPart.WriteCheckpoint(ind);
+		cur->treeStruct->WriteCheckpoint(ind);
+		PatternHash h = HashPattern(ind.Data(), ind.Size());
+		if(full || h != checkpointHashes[i]){
+			record.BeginSection(CHECKPOINT_INDIVIDUAL);
+			record.Append(ind);
+			record.EndSection();
+			checkpointHashes[i] = h;
+			}
+		}
+
+	if(conf->uniqueSwapBias != ONE_POINT_ZERO){
+		record.BeginSection(CHECKPOINT_SWAPS);
+		Tree::attemptedSwaps.WriteCheckpoint(record, !full);
+		record.EndSection();
+		}
+
+	checkpointFile.Commit(record, full);
+	}
+
+void Population::ReadCheckpointIndividual(Individual *ind, CheckpointReader &in){
+	in.GetInt();//the slot
+	for(int m = 0;m < modSpecSet.NumSpecs();m++){
+		//it would make more sense to have this happen at a lower level, but the data are needed
+		ind->modPart.GetModelSet(m)->SetDefaultModelSetParameters(dataPart->GetSubset(m));
+		}
+	ind->modPart.ReadCheckpoint(in);
+
+	ind->treeStruct = new Tree();
+	ind->treeStruct->ReadCheckpoint(in);
+	ind->treeStruct->AssignCLAsFromMaster();
+	ind->treeStruct->modPart=&ind->modPart;
+	ind->SetDirty();
+	ind->treeStruct->root->CheckTreeFormation();
+	ind->CalcFitness(0);
+	}
+
+//Reads the portable checkpoint and any journal records after it.  Only the last copy of each section is
+//used, except that the swap sections are applied in order, since incremental ones only hold changes.
+void Population::ReadCheckpoint(){
+	vector<vector<unsigned char> > records;
+	CheckpointFile::Load(conf->ofprefix, records);
+
+	CheckpointReader pin, ain;
+	vector<CheckpointReader> indSections;
+	for(vector<vector<unsigned char> >::iterator rec = records.begin();rec != records.end();rec++){
+		if(rec->empty()) continue;
+		CheckpointReader in(&(*rec)[0], rec->size());
+		while(in.AtEnd() == false){
+			unsigned tag;
+			CheckpointReader section = in.NextSection(tag);
+			if(tag == CHECKPOINT_POPULATION) pin = section;
+			else if(tag == CHECKPOINT_ADAPTATION) ain = section;
+			else if(tag == CHECKPOINT_INDIVIDUAL){
+				CheckpointReader peek = section;
+				unsigned slot = peek.GetUInt32();
+				if(slot >= indSections.size()) indSections.resize(slot + 1);
+				indSections[slot] = section;
+				}
+			else if(tag == CHECKPOINT_SWAPS){
+				if(conf->uniqueSwapBias != ONE_POINT_ZERO)
+					Tree::attemptedSwaps.ReadCheckpoint(section);
+				}
+			//anything else is from a later version of the format, and is skipped
+			}
+		}
+
+	adap->ReadCheckpoint(ain);
+
+	rnd.set_seed((long) pin.GetInt64());
+	stopwatch.AddPreviousTime(pin.GetInt());
+	pin.ExpectCount(total_size, "individuals");
+	unsigned numStored = pin.GetInt();
+	rank = pin.GetInt();
+	bestIndiv = pin.GetInt();
+	bestAccurateIndiv = pin.GetInt();
+	subtreeNode = pin.GetInt();
+	subtreeDefNumber = pin.GetInt();
+	gen = pin.GetUInt32();
+	currentBootstrapRep = pin.GetUInt32();
+	lastBootstrapSeed = pin.GetInt();
+	nextBootstrapSeed = pin.GetInt();
+	currentSearchRep = pin.GetUInt32();
+	lastTopoImprove = pin.GetUInt32();
+	lastPrecisionReduction = pin.GetUInt32();
+	lastUniqueSwap = pin.GetUInt32();
+	ntopos = pin.GetUInt32();
+	finishedGenerations = pin.GetBool();
+	finishedRep = pin.GetBool();
+	initialRefinePass = pin.GetInt();
+	finalRefinePass = pin.GetInt();
+	bestFitness = pin.GetDouble();
+	prevBestFitness = pin.GetDouble();
+	tot_fraction_done = pin.GetDouble();
+	rep_fraction_done = pin.GetDouble();
+
+	if(indSections.size() < total_size + numStored || bestIndiv < 0 || bestIndiv >= (int) total_size)
+		throw ErrorException("Checkpoint file is truncated or corrupt.\n\tUnfortunately you'll need to start the run again from scratch.");
+
+	//if were restarting a bootstrap run we need to change to the bootstrapped data
+	//now, so that scoring below is correct
+	if(conf->bootstrapReps > 0){
+		int s = dataPart->BootstrapReweight(lastBootstrapSeed, conf->resampleProportion);
+		assert(s == nextBootstrapSeed);
+		}
+
+	for(unsigned i=0;i<total_size;i++){
+		assert(modSpecSet.NumSpecs() == indiv[i].modPart.NumModelSets());
+		ReadCheckpointIndividual(&indiv[i], indSections[i]);
+		}
+
+	//trees stored from completed search reps
+	for(unsigned i=0;i<numStored;i++){
+		Individual *ind = new Individual;
+		ReadCheckpointIndividual(ind, indSections[total_size + i]);
+		ind->treeStruct->RemoveTreeFromAllClas();
+		storedTrees.push_back(ind);
+		}
+
+	//as far as the TopologyList is concerned, each individual will be considered different
+	ntopos = total_size;
+	if(fabs(bestFitness - indiv[bestIndiv].Fitness()) > 0.01)
+		throw ErrorException("Problem reading checkpoint files.  Scores of stored trees don't match calculated scores.");
+	CalcAverageFitness();
+	globalBest = bestFitness;
+
+	//need to reset these here, although really only because asserts check that the values never decrease
+	rep_fraction_done = tot_fraction_done = 0.0;
+	}
+
 //Depending on the generation, output to various files during the GA search
 void Population::WriteGenerationOutput(){
 	if(conf->outputMostlyUselessFiles) 
 		OutputFate();
 	if(conf->logevery > 0 && !(gen % conf->logevery)) 
 		OutputLog();
+	if(Profiler::Enabled() && conf->profileReportInterval > 0 && (unsigned) stopwatch.SplitTime() >= lastProfileReport + conf->profileReportInterval)
+		OutputProfile();
+	if(conf->telemetryEvery > 0 && !(gen % conf->telemetryEvery) && telemetry.is_open())
+		OutputTelemetry();
 	if(conf->saveevery > 0 && !(gen % conf->saveevery)){
 		if(best_output & WRITE_CONTINUOUS){
 			string outname = besttreefile;
@@ -2728,6 +3012,7 @@ void Population::BetterFinalOptimization(){
 		outman.UserMessage("Time used = %d hours, %d minutes and %d seconds", hours, min, secs);
 	else
 		outman.UserMessage("Time used so far = %d hours, %d minutes and %d seconds", hours, min, secs);
+	OutputWorkSummary();
 
 	log << "Score after final optimization: " << indiv[bestIndiv].Fitness() << endl;
 	//not sure how this would be done partitioned
@@ -2749,87 +3034,76 @@ void Population::BetterFinalOptimization(){
 	if(conf->outputTreelog && treeLog.is_open())
 		AppendTreeToTreeLog(-1);
 
-#ifdef ENABLE_CUSTOM_PROFILER
-	char fname[100];
-	sprintf(fname, "%s.profileresults.log", conf->ofprefix.c_str());
+	if(Profiler::Enabled()){
+		char fname[100];
+		sprintf(fname, "%s.profileresults.log", conf->ofprefix.c_str());
 #ifdef BOINC
-	char physical_name[100];
-	boinc_resolve_filename(fname, physical_name, sizeof(physical_name));
-	ofstream prof(physical_name);
-	//MFILE prof;
-	//prof.open(physical_name, "w");
+		char physical_name[100];
+		boinc_resolve_filename(fname, physical_name, sizeof(physical_name));
+		ofstream prof(physical_name);
+		//MFILE prof;
+		//prof.open(physical_name, "w");
 #else
-	ofstream prof(fname);
+		ofstream prof(fname);
 #endif
 
-	/*
-//FROM WRITETREEFILE
+		/*
+	//FROM WRITETREEFILE
 #ifdef BOINC
-	char physical_name[100];
-	boinc_resolve_filename(fname, physical_name, sizeof(physical_name));
-	MFILE outf;
-	outf.open(physical_name, "w");
+		char physical_name[100];
+		boinc_resolve_filename(fname, physical_name, sizeof(physical_name));
+		MFILE outf;
+		outf.open(physical_name, "w");
 #else
-	ofstream outf;
-	outf.open( filename.c_str() );
-	outf.precision(8);
+		ofstream outf;
+		outf.open( filename.c_str() );
+		outf.precision(8);
 #endif
-//...
+	//...
 #ifdef BOINC
-	const char *s = trans.c_str();
-	outf.write(s, sizeof(char), trans.length());
-	s = str.c_str();
-	outf.write(s, sizeof(char), str.length());
-	theInd->treeStruct->root->MakeNewick(treeString, false, true);
-	size_t len = strlen(treeString);
-	outf.write(treeString, sizeof(char), len);
-	str = ";\nend;\n";
-	s = str.c_str();
-	outf.write(s, sizeof(char), str.length());
+		const char *s = trans.c_str();
+		outf.write(s, sizeof(char), trans.length());
+		s = str.c_str();
+		outf.write(s, sizeof(char), str.length());
+		theInd->treeStruct->root->MakeNewick(treeString, false, true);
+		outf.write(treeString.c_str(), sizeof(char), treeString.Length());
+		str = ";\nend;\n";
+		s = str.c_str();
+		outf.write(s, sizeof(char), str.length());
 #else
-	outf << trans;
-	outf << str;
-	outf.setf( ios::floatfield, ios::fixed );
-	outf.setf( ios::showpoint );
-	theInd->treeStruct->root->MakeNewick(treeString, false, true);
-	outf << treeString << ";\n";
-	outf << "end;\n";
+		outf << trans;
+		outf << str;
+		outf.setf( ios::floatfield, ios::fixed );
+		outf.setf( ios::showpoint );
+		theInd->treeStruct->root->MakeNewick(treeString, false, true);
+		outf << treeString << ";\n";
+		outf << "end;\n";
 #endif	
-*/
-	char str[256];
-	sprintf(str, "dataset: %s\tstart:%s\n", conf->datafname.c_str(), conf->streefname.c_str());
-	
-	prof << "dataset: " << conf->datafname << "\t" << "start: " << conf->streefname << endl;
-	prof << "seed: " << conf->randseed << "\t" << "refine: " << (conf->refineStart == true) << endl;
-	prof << "start prec: " << conf->startOptPrec << "\t" << "final prec: " << adap->branchOptPrecision << endl;
+	*/
+		char str[256];
+		sprintf(str, "dataset: %s\tstart:%s\n", conf->datafname.c_str(), conf->streefname.c_str());
+		
+		prof << "dataset: " << conf->datafname << "\t" << "start: " << conf->streefname << endl;
+		prof << "seed: " << conf->randseed << "\t" << "refine: " << (conf->refineStart == true) << endl;
+		prof << "start prec: " << conf->startOptPrec << "\t" << "final prec: " << adap->branchOptPrecision << endl;
 
 #ifdef SINGLE_PRECISION_FLOATS
-	prof << "Single precision\n";
+		prof << "Single precision\n";
 #else
-	prof << "Double precision\n";
-#endif
-	unsigned s = stopwatch.SplitTime();
-	prof << "Total Runtime: " << s << "\tnumgen: " << gen << "\tFinalScore: " << indiv[bestIndiv].Fitness() << "\n";
-	outman.SetOutputStream(prof);
-	indiv[bestIndiv].modPart.OutputHumanReadableModelReportWithParams();
-
-	prof << "Function\t\tcalls\ttime\tTperC\t%runtime" << endl;
-	ProfIntInt.Report(prof, s);
-	ProfIntTerm.Report(prof, s);
-	ProfTermTerm.Report(prof, s);
-	ProfRescale.Report(prof, s);
-	ProfScoreInt.Report(prof, s);
-	ProfScoreTerm.Report(prof, s);
-	ProfIntDeriv.Report(prof, s);
-	ProfTermDeriv.Report(prof, s);
-	ProfCalcPmat.Report(prof, s);
-	ProfCalcEigen.Report(prof, s);
-	ProfModDeriv.Report(prof, s);
-	ProfNewton.Report(prof, s);
-	ProfEQVectors.Report(prof, s);
-	prof.close();
-	outman.SetOutputStream(cout);
+		prof << "Double precision\n";
 #endif
+		unsigned s = stopwatch.SplitTime();
+		prof << "Total Runtime: " << s << "\tnumgen: " << gen << "\tFinalScore: " << indiv[bestIndiv].Fitness() << "\n";
+		outman.SetOutputStream(prof);
+		indiv[bestIndiv].modPart.OutputHumanReadableModelReportWithParams();
+
+		prof << "\n";
+		Profiler::ReportAll(prof, s);
+		prof << "\n";
+		OutputMutationWork(prof);
+		prof.close();
+		outman.SetOutputStream(cout);
+		}
 	/*	cout << "intterm calls " << inttermcalls << " time " << inttermtime/(double)(ticspersec.QuadPart) << endl;
 	cout << "termterm calls " << termtermcalls << " time " << termtermtime/(double)(ticspersec.QuadPart) << endl;
 	cout << "rescale calls " << rescalecalls << " time " << rescaletime/(double)(ticspersec.QuadPart) << " numrescales " << numactualrescales << endl;
@@ -2914,6 +3188,7 @@ void Population::FinalOptimization(){
 		outman.UserMessage("Time used = %d hours, %d minutes and %d seconds", hours, min, secs);
 	else 
 		outman.UserMessage("Time used so far = %d hours, %d minutes and %d seconds", hours, min, secs);
+	OutputWorkSummary();
 		
 	log << "Score after final optimization: " << indiv[bestIndiv].Fitness() << endl;
 #ifdef MAC_FRONTEND
@@ -2924,41 +3199,31 @@ void Population::FinalOptimization(){
 
 	outman.unsetf(ios::fixed);
 	
-#ifdef ENABLE_CUSTOM_PROFILER
-	char fname[100];
-	sprintf(fname, "%s.profileresults.log", conf->ofprefix.c_str());
-	ofstream prof(fname);
-	prof << "dataset: " << conf->datafname << "\t" << "start: " << conf->streefname << endl;
-	prof << "seed: " << conf->randseed << "\t" << "refine: " << (conf->refineStart == true) << endl;
-	prof << "start prec: " << conf->startOptPrec << "\t" << "final prec: " << adap->branchOptPrecision << endl;
+	if(Profiler::Enabled()){
+		char fname[100];
+		sprintf(fname, "%s.profileresults.log", conf->ofprefix.c_str());
+		ofstream prof(fname);
+		prof << "dataset: " << conf->datafname << "\t" << "start: " << conf->streefname << endl;
+		prof << "seed: " << conf->randseed << "\t" << "refine: " << (conf->refineStart == true) << endl;
+		prof << "start prec: " << conf->startOptPrec << "\t" << "final prec: " << adap->branchOptPrecision << endl;
 
 #ifdef SINGLE_PRECISION_FLOATS
-	prof << "Single precision\n";
+		prof << "Single precision\n";
 #else
-	prof << "Double precision\n";
-#endif
-	unsigned s = stopwatch.SplitTime();
-	prof << "Total Runtime: " << s << "\tnumgen: " << gen << "\tFinalScore: " << indiv[bestIndiv].Fitness() << "\n";
-	outman.SetOutputStream(prof);
-	indiv[bestIndiv].modPart.OutputHumanReadableModelReportWithParams();
-
-	prof << "Function\t\tcalls\ttime\tTperC\t%runtime" << endl;
-	ProfIntInt.Report(prof, s);
-	ProfIntTerm.Report(prof, s);
-	ProfTermTerm.Report(prof, s);
-	ProfRescale.Report(prof, s);
-	ProfScoreInt.Report(prof, s);
-	ProfScoreTerm.Report(prof, s);
-	ProfIntDeriv.Report(prof, s);
-	ProfTermDeriv.Report(prof, s);
-	ProfCalcPmat.Report(prof, s);
-	ProfCalcEigen.Report(prof, s);
-	ProfModDeriv.Report(prof, s);
-	ProfNewton.Report(prof, s);
-	ProfEQVectors.Report(prof, s);
-	prof.close();
-	outman.SetOutputStream(cout);
+		prof << "Double precision\n";
 #endif
+		unsigned s = stopwatch.SplitTime();
+		prof << "Total Runtime: " << s << "\tnumgen: " << gen << "\tFinalScore: " << indiv[bestIndiv].Fitness() << "\n";
+		outman.SetOutputStream(prof);
+		indiv[bestIndiv].modPart.OutputHumanReadableModelReportWithParams();
+
+		prof << "\n";
+		Profiler::ReportAll(prof, s);
+		prof << "\n";
+		OutputMutationWork(prof);
+		prof.close();
+		outman.SetOutputStream(cout);
+		}
 	/*	cout << "intterm calls " << inttermcalls << " time " << inttermtime/(double)(ticspersec.QuadPart) << endl;
 	cout << "termterm calls " << termtermcalls << " time " << termtermtime/(double)(ticspersec.QuadPart) << endl;
 	cout << "rescale calls " << rescalecalls << " time " << rescaletime/(double)(ticspersec.QuadPart) << " numrescales " << numactualrescales << endl;
@@ -3027,6 +3292,9 @@ int Population::EvaluateStoredTrees(bool report){
 			outman.UserMessage("");
 			}
 
+		if(storedTrees.size() > 1)
+			ReportReplicateRFDistances();
+
 		if(conf->searchReps > 1)
 			outman.UserMessage("\nParameter estimates across search replicates:");
 		else 
@@ -3133,7 +3401,6 @@ void Population::Bootstrap(){
 		[pool release];
 #endif
 		if(conf->restart == false){
-			outman.UserMessage("\nBootstrap reweighting...");
 			//if this is the first rep use the bootstrapseed if one was specified,
 			//or the current seed (which could have come from a specified randseed or could have been generated randomly)
 			if(nextBootstrapSeed == 0){
@@ -3143,6 +3410,11 @@ void Population::Bootstrap(){
 				else
 					nextBootstrapSeed = rnd.seed();
 				}
+			//the candidate starting trees are optimized and scored once, before any replicate that isn't
+			//already underway.  The population is empty at this point, even after a restart
+			if(conf->rellBootstrapReps > 0 && rellScreenDone == false)
+				ScreenBootstrapStartingTrees();
+			outman.UserMessage("\nBootstrap reweighting...");
 			lastBootstrapSeed = nextBootstrapSeed;
 			nextBootstrapSeed = dataPart->BootstrapReweight(lastBootstrapSeed, conf->resampleProportion);
 			}
@@ -3357,7 +3629,8 @@ void Population::PerformSearch(){
 
 		//output site likelihoods if requested
 		if(conf->outputSitelikelihoods > 0){
-			outman.UserMessage("Saving site likelihoods to file %s.sitelikes.log ...", conf->ofprefix.c_str());
+			bool binary = (conf->siteLikelihoodFormat == "binary");
+			outman.UserMessage("Saving site likelihoods to file %s.sitelikes.%s ...", conf->ofprefix.c_str(), (binary ? "bin" : "log"));
 			for( int set = 0;set < dataPart->NumSubsets();set++){ 
 				if( dataPart->GetSubset(set)->DidUseDefaultWeightsets() == true)
 					outman.UserMessage("WARNING: Site likelihoods are being output when wtset %s is in effect.\n Sites with weight > 1 will only be output once!", dataPart->GetSubset(set)->WeightsetName().c_str());
@@ -3375,7 +3648,11 @@ void Population::PerformSearch(){
 			ofstream ordered;
 			indiv[bestIndiv].treeStruct->ofprefix = conf->ofprefix;
 			string oname = indiv[bestIndiv].treeStruct->ofprefix + ".sitelikes.log";
-			if(currentSearchRep == 1){
+			if(binary){
+				//the binary file stays open across search reps.  After a restart it is continued
+				siteLikeOut.Open(conf->ofprefix + ".sitelikes.bin", dataPart, conf->outputSitelikelihoods, currentSearchRep > 1);
+				}
+			else if(currentSearchRep == 1){
 				ordered.open(oname.c_str());
 				ordered << "Tree\t-lnL\tSite\t-lnL";
 				if(conf->outputSitelikelihoods > 1) 
@@ -3385,10 +3662,14 @@ void Population::PerformSearch(){
 				}
 	
 			indiv[bestIndiv].treeStruct->Score();
-			ordered.open(oname.c_str(), ios::app);
-			ordered.precision(12);
-			ordered << currentSearchRep << "\t" << -indiv[bestIndiv].treeStruct->lnL << "\n";
-			ordered.close();
+			if(binary)
+				siteLikeOut.WriteTree(currentSearchRep, -indiv[bestIndiv].treeStruct->lnL, "");
+			else{
+				ordered.open(oname.c_str(), ios::app);
+				ordered.precision(12);
+				ordered << currentSearchRep << "\t" << -indiv[bestIndiv].treeStruct->lnL << "\n";
+				ordered.close();
+				}
 			}
 
 		//warn if the normal auto-term conditions weren't used
@@ -3531,6 +3812,9 @@ void Population::PerformSearch(){
 				}
 			}
 
+		if(conf->rellBootstrapReps > 0 && conf->bootstrapReps == 0 && prematureTermination == false && currentSearchRep == conf->searchReps)
+			RELLBootstrap();
+
 		if(conf->inferInternalStateProbs == true){
 			//don't infer internals states unless at least one rep successfully completed
 			if((prematureTermination == false && currentSearchRep == conf->searchReps) || (prematureTermination && storedTrees.size() > 0)){
@@ -3604,15 +3888,20 @@ void Population::OptimizeInputAndWriteSitelikelihoods(){
 	//find out how many trees we have
 	GarliReader & reader = GarliReader::GetInstance();
 	const NxsTreesBlock *treesblock = reader.GetTreesBlock(reader.GetTaxaBlock(0), reader.GetNumTreesBlocks(reader.GetTaxaBlock(0)) - 1);
-	if(treesblock == NULL || !strcmp(conf->streefname.c_str(), "random") || !strcmp(conf->streefname.c_str(), "stepwise"))
+	if(treesblock == NULL || StartingTreeIsGenerated(conf->streefname))
 		throw ErrorException("You must specify a nexus treefile to use this runmode.");
 	int numTrees = treesblock->GetNumTrees();
 
+	bool binary = (conf->siteLikelihoodFormat == "binary");
 	string oname = conf->ofprefix + ".sitelikes.log";
 	ofstream ordered;
-	ordered.open(oname.c_str());
-	ordered << "Tree\t-lnL\tSite\t-lnL\n";
-	ordered.close();
+	if(binary)
+		siteLikeOut.Open(conf->ofprefix + ".sitelikes.bin", dataPart, max((int)conf->outputSitelikelihoods, 1), false);
+	else{
+		ordered.open(oname.c_str());
+		ordered << "Tree\t-lnL\tSite\t-lnL\n";
+		ordered.close();
+		}
 
 	bestIndiv = 0;
 	conf->searchReps = numTrees;
@@ -3633,10 +3922,14 @@ void Population::OptimizeInputAndWriteSitelikelihoods(){
 		indiv[0].treeStruct->ofprefix = conf->ofprefix;
 		indiv[0].treeStruct->Score();
 		
-		ordered.open(oname.c_str(), ios::app);
-		ordered.precision(10);
-		ordered << t << "\t" << -indiv[0].treeStruct->lnL << "\n";
-		ordered.close();
+		if(binary)
+			siteLikeOut.WriteTree(t, -indiv[0].treeStruct->lnL, "");
+		else{
+			ordered.open(oname.c_str(), ios::app);
+			ordered.precision(10);
+			ordered << t << "\t" << -indiv[0].treeStruct->lnL << "\n";
+			ordered.close();
+			}
 
 		Individual *repResult = new Individual(&indiv[0]);
 		storedTrees.push_back(repResult);
@@ -3649,6 +3942,7 @@ void Population::OptimizeInputAndWriteSitelikelihoods(){
 		outman.UserMessage("\nNOTE: collapsebranches setting ignored when writing and comparing optimized trees...");
 	outman.UserMessage("\nWriting optimized trees and models to %s.all.tre", besttreefile.c_str());
 	WriteStoredTrees(besttreefile.c_str());
+	siteLikeOut.Close();
 	FinalizeOutputStreams(0);
 	FinalizeOutputStreams(1);
 	FinalizeOutputStreams(2);
@@ -3670,11 +3964,16 @@ void Population::OptimizeInputAndWriteSitelikelihoodsAndTryRootings(){
 	bestIndiv = 0;
 
 	//start the sitelike file
+	bool binary = (conf->siteLikelihoodFormat == "binary");
 	string oname = conf->ofprefix + ".sitelikes.log";
 	ofstream ordered;
-	ordered.open(oname.c_str());
-	ordered << "Tree\t-lnL\tSite\t-lnL\n";
-	ordered.close();
+	if(binary)
+		siteLikeOut.Open(conf->ofprefix + ".sitelikes.bin", dataPart, 1, false);
+	else{
+		ordered.open(oname.c_str());
+		ordered << "Tree\t-lnL\tSite\t-lnL\n";
+		ordered.close();
+		}
 
 	Tree::useOptBoundedForBlen = true;
 
@@ -3716,12 +4015,16 @@ void Population::OptimizeInputAndWriteSitelikelihoodsAndTryRootings(){
 	indiv[0].treeStruct->Score();
 	
 	//put the score of the initial indiv in the file
-	ordered.open(oname.c_str(), ios::app);
-	ordered.precision(10);
-	ordered << "0\t" << -indiv[0].treeStruct->lnL << "\t";
 	indiv[0].treeStruct->root->MakeNewick(treeString, false, true, false);
-	ordered << treeString << "\n";
-	ordered.close();
+	if(binary)
+		siteLikeOut.WriteTree(0, -indiv[0].treeStruct->lnL, treeString.c_str());
+	else{
+		ordered.open(oname.c_str(), ios::app);
+		ordered.precision(10);
+		ordered << "0\t" << -indiv[0].treeStruct->lnL << "\t";
+		ordered << treeString << "\n";
+		ordered.close();
+		}
 
 	//store the indiv 
 	Individual *repResult = new Individual(&indiv[0]);
@@ -3776,12 +4079,16 @@ void Population::OptimizeInputAndWriteSitelikelihoodsAndTryRootings(){
 		indiv1Tree->Score();
 
 		//add the total score and the tree
-		ordered.open(oname.c_str(), ios::app);
-		ordered.precision(10);
-		ordered << tnum << "\t" << -indiv1Tree->lnL << "\t";
 		indiv[1].treeStruct->root->MakeNewick(treeString, false, true, false);
-		ordered << treeString << "\n";
-		ordered.close();
+		if(binary)
+			siteLikeOut.WriteTree(tnum, -indiv1Tree->lnL, treeString.c_str());
+		else{
+			ordered.open(oname.c_str(), ios::app);
+			ordered.precision(10);
+			ordered << tnum << "\t" << -indiv1Tree->lnL << "\t";
+			ordered << treeString << "\n";
+			ordered.close();
+			}
 
 		//store the indiv and write the tree to file
 		repResult = new Individual(&indiv[1]);
@@ -3797,6 +4104,7 @@ void Population::OptimizeInputAndWriteSitelikelihoodsAndTryRootings(){
 		outman.UserMessage("\nNOTE: collapsebranches setting ignored when writing and comparing optimized trees...");
 	outman.UserMessage("\nWriting optimized trees and models to %s.all.tre", besttreefile.c_str());
 	WriteStoredTrees(besttreefile.c_str());
+	siteLikeOut.Close();
 	FinalizeOutputStreams(0);
 	FinalizeOutputStreams(1);
 	FinalizeOutputStreams(2);
@@ -4347,6 +4655,7 @@ void Population::PerformMutation(int indNum){
 
 	//FLOAT_TYPE beforeScore;
 	bool recomPerformed;
+	MutationWork before = WorkSnapshot();
 
 	switch(ind->mutation_type){
 /*		case Individual::exNNI: //exNNI and exlimSPR trump all other mutation types
@@ -4378,9 +4687,8 @@ void Population::PerformMutation(int indNum){
 		default:
 			if(ind->recombinewith>-1){// perform recombination
 				Individual *recompar=&indiv[ind->recombinewith];
-				//don't want to standardize biparts anymore
-				ind->treeStruct->CalcBipartitions(false);
-				recompar->treeStruct->CalcBipartitions(false);
+				//the bipartitions are calculated (if they aren't already current) within the recombination
+				//itself, so there is no need to do it here
 				ind->CrossOverWith( *recompar, adap->branchOptPrecision);
 				ind->accurateSubtrees=false;
 //				ind->treeStruct->calcs=calcCount;
@@ -4430,6 +4738,8 @@ void Population::PerformMutation(int indNum){
 					}
 				}
 			}
+
+		AccountMutationWork(ind, before);
 		
 		//check the accuracy of the subtrees
 		#ifndef NDEBUG
@@ -4438,6 +4748,36 @@ void Population::PerformMutation(int indNum){
 		#endif
 	}
 
+MutationWork Population::WorkSnapshot() const{
+	MutationWork w;
+	w.lnlEvals = CountLnLEvals.Total();
+	w.clas = CountClaIntInt.Total() + CountClaIntTerm.Total() + CountClaTermTerm.Total();
+	w.pmats = CountPmats.Total();
+	w.nrIterations = CountNRIterations.Total();
+	return w;
+	}
+
+//attributes the work done since the snapshot to the type of mutation that was just performed.  The
+//individual keeps its share so that keepTrack can pass it to the adaptation along with the improvement
+void Population::AccountMutationWork(Individual *ind, const MutationWork &before){
+	MutationWork after = WorkSnapshot();
+	MutationWork done;
+	done.lnlEvals = after.lnlEvals - before.lnlEvals;
+	done.clas = after.clas - before.clas;
+	done.pmats = after.pmats - before.pmats;
+	done.nrIterations = after.nrIterations - before.nrIterations;
+	ind->mutation_work = done.Cost();
+
+	int cat = MutationCategory(ind->mutation_type);
+	if(cat < 0) return;
+	MutationWork &tot = mutationWork[cat];
+	tot.num++;
+	tot.lnlEvals += done.lnlEvals;
+	tot.clas += done.clas;
+	tot.pmats += done.pmats;
+	tot.nrIterations += done.nrIterations;
+	}
+
 void Population::NextGeneration(){
 
 	DetermineParentage();
@@ -4721,6 +5061,209 @@ void Population::FinishBootstrapRep(const Individual *ind, int rep){
 
 	if(conf->outputPhylipTree)
 		WritePhylipTree(bootLogPhylip);
+
+	if(conf->outputSplitFrequencies){
+		bootSplits.AddTree(theInd->treeStruct);
+		//rewrite the summaries of the bootstrap trees completed so far.  These are small relative to
+		//the tree file, so just overwrite them each time
+		WriteSplitSummaries(bootSplits, "boot", "bootstrap");
+		}
+	}
+
+//write the split frequency table (ofprefix.<suffix>.splits.log) and majority rule consensus (ofprefix.<suffix>.con.tre) of a set of trees
+void Population::WriteSplitSummaries(const SplitTable &table, const char *suffix, const char *description){
+	char filename[1024];
+	sprintf(filename, "%s.%s.splits.log", conf->ofprefix.c_str(), suffix);
+	ofstream splitOut(filename);
+	table.WriteSplitFrequencies(splitOut);
+	splitOut.close();
+
+	string con;
+	table.MajorityRuleConsensus(con);
+	sprintf(filename, "%s.%s.con.tre", conf->ofprefix.c_str(), suffix);
+	ofstream conOut(filename);
+	dataPart->BeginNexusTreesBlock(conOut);
+	conOut << "[majority rule consensus of " << table.NumTrees() << " " << description << " trees.  Internal node labels are the percentage of trees containing each clade]\n";
+	conOut << "tree majrule = [&U] " << con << ";\nend;\n";
+	conOut.close();
+	}
+
+//RELL bootstrap (Kishino, Miyata and Hasegawa 1990) over the trees found by the search replicates.  Rather than
+//searching each resampled dataset, the per-pattern likelihoods of each tree are calculated once and each replicate
+//only reweights them, so all replicates share one likelihood calculation per tree.  The parameters and branch
+//lengths are not reoptimized for each replicate, and only the search replicate trees are candidates, so this
+//is a quick approximation of bootstrap support that improves with the number of search replicates.
+void Population::RELLBootstrap(){
+	int numTrees = (int) storedTrees.size();
+	if(numTrees < 2){
+		outman.UserMessage("\nNOTE: RELL bootstrapping requires more than one search replicate (searchreps > 1).  Skipping it.");
+		return;
+		}
+	outman.UserMessage("\nPerforming %d RELL bootstrap replicates over the trees from %d search replicates...", conf->rellBootstrapReps, numTrees);
+
+	vector< vector< vector<FLOAT_TYPE> > > siteLikes;
+	CaptureRELLSiteLikelihoods(storedTrees, siteLikes);
+
+	//the datasets are drawn in the same way and from the same seeds as a normal bootstrap run would
+	RELLSupport(storedTrees, siteLikes, (conf->bootstrapSeed > 0 ? conf->bootstrapSeed : rnd.seed()), "search replicate");
+	}
+
+//fills siteLikes[tree][subset][pattern] with the per-pattern lnL of each tree, which don't depend on the pattern counts
+void Population::CaptureRELLSiteLikelihoods(const vector<Individual *> &trees, vector< vector< vector<FLOAT_TYPE> > > &siteLikes){
+	//the trees passed in don't have clas assigned, so free up any used by the population
+	for(int i = 0;i < total_size;i++){
+		if(indiv[i].treeStruct != NULL)
+			indiv[i].treeStruct->MakeAllNodesDirty();
+		if(newindiv[i].treeStruct != NULL)
+			newindiv[i].treeStruct->MakeAllNodesDirty();
+		}
+
+	siteLikes.clear();
+	siteLikes.resize(trees.size());
+	for(int t = 0;t < (int) trees.size();t++){
+		Individual tempInd;
+		tempInd.DuplicateIndivWithoutCLAs(trees[t]);
+		tempInd.treeStruct->AssignCLAsFromMaster();
+		tempInd.treeStruct->siteLikeCapture = &siteLikes[t];
+		tempInd.treeStruct->sitelikeLevel = 1;
+		tempInd.treeStruct->Score();
+		tempInd.treeStruct->siteLikeCapture = NULL;
+		tempInd.treeStruct->RemoveTreeFromAllClas();
+		assert((int) siteLikes[t].size() == dataPart->NumSubsets());
+		}
+	}
+
+//the tree with the highest lnL under the current pattern counts.  Ties go to the earlier tree
+int Population::RELLBestTree(const vector< vector< vector<FLOAT_TYPE> > > &siteLikes) const{
+	int numTrees = (int) siteLikes.size();
+	vector<double> scores(numTrees, 0.0);
+	for(int p = 0;p < dataPart->NumSubsets();p++){
+		const SequenceData *curData = dataPart->GetSubset(p);
+		const int *counts = curData->GetCounts();
+		int nchar = curData->NChar();
+		for(int t = 0;t < numTrees;t++){
+			const FLOAT_TYPE *likes = &siteLikes[t][p][0];
+			double sum = 0.0;
+			for(int c = 0;c < nchar;c++)
+				sum += counts[c] * likes[c];
+			scores[t] += sum;
+			}
+		}
+	int bestTree = 0;
+	for(int t = 1;t < numTrees;t++)
+		if(scores[t] > scores[bestTree]) bestTree = t;
+	return bestTree;
+	}
+
+//Draws conf->rellBootstrapReps resampled datasets from the seed chain starting at seed, and reports how often 
+//each tree has the best RELL score and the splits of the winners.  Every replicate is just a count vector
+//applied to the same per-pattern likelihoods, so they all share the one likelihood calculation per tree.
+void Population::RELLSupport(const vector<Individual *> &trees, const vector< vector< vector<FLOAT_TYPE> > > &siteLikes, int seed, const char *description){
+	int numTrees = (int) trees.size();
+	vector<int> wins(numTrees, 0);
+	for(unsigned rep = 0;rep < conf->rellBootstrapReps;rep++){
+		for(int p = 0;p < dataPart->NumSubsets();p++)
+			seed = dataPart->GetSubset(p)->BootstrapReweight(seed, conf->resampleProportion);
+		wins[RELLBestTree(siteLikes)]++;
+		}
+	for(int p = 0;p < dataPart->NumSubsets();p++)
+		dataPart->GetSubset(p)->RestoreOriginalCounts();
+
+	outman.UserMessage("RELL bootstrap proportions of the %s trees:", description);
+	SplitTable rellSplits;
+	for(int t = 0;t < numTrees;t++){
+		outman.UserMessage("Tree %d : %.3f", t + 1, wins[t] / (double) conf->rellBootstrapReps);
+		if(wins[t] == 0) continue;
+		Individual tempInd;
+		tempInd.DuplicateIndivWithoutCLAs(trees[t]);
+		if(conf->collapseBranches){
+			int num = 0;
+			tempInd.treeStruct->root->CollapseMinLengthBranches(num);
+			}
+		for(int w = 0;w < wins[t];w++)
+			rellSplits.AddTree(tempInd.treeStruct);
+		}
+	outman.UserMessage("Saving RELL split frequencies to %s.rell.splits.log and consensus to %s.rell.con.tre", conf->ofprefix.c_str(), conf->ofprefix.c_str());
+	WriteSplitSummaries(rellSplits, "rell", "RELL bootstrap");
+	}
+
+//RELL screening for a bootstrap run.  Each tree in the Nexus streefname file is optimized once on the original
+//data and its per-pattern likelihoods are kept.  The RELL support of the candidates over rellbootstrapreps
+//resampled datasets (the same datasets that the full searches will use) is reported before any search runs,
+//and each full bootstrap search starts from the candidate with the best RELL score on its own dataset.
+void Population::ScreenBootstrapStartingTrees(){
+	rellScreenDone = true;
+	GarliReader & reader = GarliReader::GetInstance();
+	const NxsTreesBlock *treesblock = (startingTreeInNCL ? reader.GetTreesBlock(reader.GetTaxaBlock(0), reader.GetNumTreesBlocks(reader.GetTaxaBlock(0)) - 1) : NULL);
+	int numTrees = (treesblock == NULL ? 0 : treesblock->GetNumTrees());
+	if(numTrees < 2){
+		outman.UserMessage("\nNOTE: RELL screening of bootstrap starting trees requires more than one tree in the streefname file.  Skipping it.");
+		return;
+		}
+	outman.UserMessage("\nOptimizing %d candidate starting trees for RELL screening of the bootstrap replicates...", numTrees);
+
+	//the candidates are compared on the original data.  Whatever replicate comes next reweights again
+	for(int p = 0;p < dataPart->NumSubsets();p++)
+		dataPart->GetSubset(p)->RestoreOriginalCounts();
+
+	vector<Individual *> candidates;
+	for(int t = 1;t <= numTrees;t++){
+		outman.UserMessage("Optimizing candidate tree %d ...", t);
+		SeedPopulationWithStartingTree(t);
+		bestIndiv = 0;
+		BetterFinalOptimization();
+		candidates.push_back(new Individual(&indiv[0]));
+		Reset();
+		}
+	CaptureRELLSiteLikelihoods(candidates, rellCandidateLikes);
+
+	//the support summary is only written when the run starts from the first replicate.  After a restart it already exists
+	if(currentBootstrapRep == 1)
+		RELLSupport(candidates, rellCandidateLikes, nextBootstrapSeed, "candidate starting");
+
+	for(vector<Individual*>::iterator it = candidates.begin();it != candidates.end();it++){
+		delete (*it)->treeStruct;
+		(*it)->treeStruct = NULL;
+		delete (*it);
+		}
+	}
+
+//Robinson-Foulds distances between the trees found by each search replicate, which shows how 
+//different they are rather than just whether they are identical
+void Population::ReportReplicateRFDistances(){
+	SplitTable repSplits;
+	for(unsigned r=0;r<storedTrees.size();r++){
+		if(conf->collapseBranches){
+			//as when checking for identical topologies above, compare the trees with zero length branches collapsed
+			Individual tempInd;
+			tempInd.DuplicateIndivWithoutCLAs(storedTrees[r]);
+			int num = 0;
+			tempInd.treeStruct->root->CollapseMinLengthBranches(num);
+			repSplits.AddTree(tempInd.treeStruct);
+			}
+		else
+			repSplits.AddTree(storedTrees[r]->treeStruct);
+		}
+	vector< vector<int> > dists;
+	repSplits.PairwiseRFDistances(dists);
+
+	outman.UserMessage("\nRobinson-Foulds distances between search replicates:");
+	char cStr[20];
+	string line = "     ";
+	for(unsigned r=0;r<storedTrees.size() - 1;r++){
+		sprintf(cStr, " %5d", r + 1);
+		line += cStr;
+		}
+	outman.UserMessage("%s", line.c_str());
+	for(unsigned r=1;r<storedTrees.size();r++){
+		sprintf(cStr, "rep%2d", r + 1);
+		line = cStr;
+		for(unsigned r2=0;r2<r;r2++){
+			sprintf(cStr, " %5d", dists[r][r2]);
+			line += cStr;
+			}
+		outman.UserMessage("%s", line.c_str());
+		}
 	}
 
 bool Population::OutgroupRoot(Individual *ind, int indnum){
@@ -4824,8 +5367,7 @@ void Population::WriteTreeFile( const char* treefname, int indnum, bool collapse
 	s = str.c_str();
 	outf.write(s, sizeof(char), str.length());
 	theInd->treeStruct->root->MakeNewick(treeString, false, true);
-	size_t len = strlen(treeString);
-	outf.write(treeString, sizeof(char), len);
+	outf.write(treeString.c_str(), sizeof(char), treeString.Length());
 	str = ";\nend;\n";
 	s = str.c_str();
 	outf.write(s, sizeof(char), str.length());
@@ -4996,7 +5538,7 @@ void Population::WriteStoredTrees( const char* treefname ){
 //on the fly and outputs everything to the string passed in, which needs to 
 //be already open
 void Population::WritePhylipTree(ofstream &phytree){
-	char *loc=treeString;
+	const char *loc=treeString.c_str();
 	NxsString temp;
 	while(*loc){
 		if(*loc == ':'){
@@ -5032,11 +5574,10 @@ void Population::WritePhylipTree(ofstream &phytree){
 	}
 
 
-char * Population::MakeNewick(int i, bool internalNodes)
+const char * Population::MakeNewick(int i, bool internalNodes)
 {
 	indiv[i].treeStruct->root->MakeNewick(treeString, internalNodes, true);
-	assert(!treeString[stringSize-1]);
-	return treeString;
+	return treeString.c_str();
 }
 
 //DZ 7-7 This function will get rid of multiple references to the same treeStruct
@@ -5044,52 +5585,29 @@ char * Population::MakeNewick(int i, bool internalNodes)
 //Not the most elegant, but it works.
 void Population::EliminateDuplicateTreeReferences(){
 
-	bool dupe;
-	vector<Tree *> tstructs;
+	//a set makes checking whether a treeStruct has already been encountered a log time
+	//lookup rather than a scan over all of those encountered so far
+	set<Tree *> tstructs;
 	
 	//go through the indiv array
 	for(unsigned i=0;i<conf->nindivs;i++){
 		//check if we have already encountered this treeStruct
-		dupe=false;
-		for(vector<Tree *>::iterator tit=tstructs.begin();tit!=tstructs.end();tit++){
-			if(indiv[i].treeStruct==(*tit)){
-				dupe=true;
-				indiv[i].treeStruct=NULL;
-				break;
-				}
-			}
-		if(dupe==false){
-			tstructs.push_back(indiv[i].treeStruct);
-			}
+		if(tstructs.insert(indiv[i].treeStruct).second == false)
+			indiv[i].treeStruct=NULL;
 		}
 	
 	//go through the newindiv array
 	for(unsigned i=0;i<conf->nindivs;i++){
 		//check if we have already encountered this treeStruct
-		dupe=false;
-		for(vector<Tree *>::iterator tit=tstructs.begin();tit!=tstructs.end();tit++){
-			if(newindiv[i].treeStruct==(*tit)){
-				dupe=true;
-				newindiv[i].treeStruct=NULL;
-				break;
-				}
-			}
-		if(dupe==false){
-			tstructs.push_back(newindiv[i].treeStruct);
-			}
+		if(tstructs.insert(newindiv[i].treeStruct).second == false)
+			newindiv[i].treeStruct=NULL;
 		}
 		
 	//go through the unusedTree vector
-	for(vector<Tree*>::iterator vit=unusedTrees.begin();vit!=unusedTrees.end();vit++){
-		dupe=false;
-		for(vector<Tree *>::iterator tit=tstructs.begin();tit!=tstructs.end();tit++){
-			if((*vit)==(*tit)){
-				dupe=true;
-				unusedTrees.erase(vit);
-				vit--;
-				break;
-				}
-			}
+	for(vector<Tree*>::iterator vit=unusedTrees.begin();vit!=unusedTrees.end();){
+		if(tstructs.find(*vit) != tstructs.end())
+			vit = unusedTrees.erase(vit);
+		else vit++;
 		}
 
 	}
@@ -5219,14 +5737,14 @@ int Population::GetNBestIndivIndices(int** indiv_list, int n)	{
 
 int Population::GetSpecifiedTreeStrings(char** tree_strings_, int n, int* indiv_list)	{
 	char*& tree_strings = *tree_strings_;
-	int buf_size = 0;
-	for (int i = 0; i < n; ++i)	// calc the buff size
-		buf_size += (int) strlen(MakeNewick(indiv_list[i], true)) + 1;
-	char* p = tree_strings = new char[buf_size+1];
-	for (int i = 0; i < n; ++i)
-		p += strlen(strcpy(p, MakeNewick(indiv_list[i], true))) + 1;
-	*p = 0;
-	assert(p-tree_strings == buf_size);
+	//each tree is only described once, and the null separated strings collected as they are made
+	NewickBuffer all;
+	for (int i = 0; i < n; ++i){
+		MakeNewick(indiv_list[i], true);
+		all.Append(treeString.c_str(), treeString.Length() + 1);
+		}
+	tree_strings = new char[all.Length() + 1];
+	memcpy(tree_strings, all.c_str(), all.Length() + 1);
 	return 0;
 }
 
@@ -5291,6 +5809,126 @@ void Population::OutputLog()	{
 		log << "Final\t" << BestFitness() << "\t" << stopwatch.SplitTime() << "\t" << adap->branchOptPrecision << endl;
 		}
 	}
+//writes the profiler timings and counters so far (profile = 1) next to the log file.  The file is
+//overwritten every profilereportinterval seconds, so it always holds the totals for the whole run
+void Population::OutputProfile(){
+	char suffix[100];
+	char fname[500];
+	sprintf(suffix, "profile0%d.log", rank);
+	DetermineFilename(log_output, fname, suffix);
+	ofstream prof(fname);
+	unsigned s = stopwatch.SplitTime();
+	prof << "gen: " << gen << "\ttime: " << s << "\tbest lnL: " << BestFitness() << "\n\n";
+	Profiler::ReportAll(prof, s);
+	prof << "\n";
+	OutputMutationWork(prof);
+	prof.close();
+	lastProfileReport = s;
+	}
+
+//the work attributed to each category of mutation over the whole run.  Work done outside of mutations
+//(optimization passes, scoring the starting tree, etc.) is the difference from the counter totals
+void Population::OutputMutationWork(ostream &out) const{
+	out << setw(16) << left << "Mutation" << right << "\t" << setw(12) << "num" << "\t" << setw(14) << "lnL evals" << "\t" << setw(14) << "CLA calcs";
+	out << "\t" << setw(14) << "pmat builds" << "\t" << setw(14) << "NR iters" << "\t" << setw(12) << "work/mut" << endl;
+	for(int m = 0;m < NUM_MUTATION_CATEGORIES;m++){
+		const MutationWork &w = mutationWork[m];
+		out << setw(16) << left << mutationCategoryNames[m] << right << "\t" << setw(12) << w.num << "\t" << setw(14) << w.lnlEvals << "\t" << setw(14) << w.clas;
+		out << "\t" << setw(14) << w.pmats << "\t" << setw(14) << w.nrIterations << "\t";
+		out << fixed << setprecision(1) << setw(12) << (w.num > 0 ? w.Cost() / (double) w.num : 0.0) << endl;
+		out.unsetf(ios::fixed);
+		}
+	}
+
+void Population::OutputWorkSummary(){
+	//totals for the whole run so far, in a fixed format that is read by tests/perf/runperf.sh
+	unsigned long long clas = CountClaIntInt.Total() + CountClaIntTerm.Total() + CountClaTermTerm.Total();
+	outman.UserMessage("Work summary: %llu likelihood evaluations, %llu CLA calculations, %llu KB peak memory", CountLnLEvals.Total(), clas, ProfilerPeakMemoryKB());
+	}
+
+void Population::BeginTelemetry(){
+	//the telemetry file is named and appended to in the same way as the log file
+	bool csv = (conf->telemetryFormat == "csv");
+	if(telemetry.is_open() == false){
+		char fname[500];
+		DetermineFilename(log_output, fname, (csv ? "telemetry.csv" : "telemetry.jsonl"));
+		bool append = ((log_output & APPEND) && FileExists(fname));
+		if(append)
+			telemetry.open(fname, ios::app);
+		else
+			telemetry.open(fname);
+		if(!telemetry.good()) throw ErrorException("problem opening telemetry file %s", fname);
+		telemetry.precision(10);
+
+		if(csv && !append){
+			telemetry << "gen,searchrep,bootrep,time_s,best_lnL,precision,lnl_evals,evals_per_s,clas,clas_free,clas_reserved,clas_temp_reserved,clas_max_used,clas_recycled";
+			for(int m = 0;m < NUM_MUTATION_CATEGORIES;m++)
+				telemetry << "," << mutationCategoryNames[m] << "_tried," << mutationCategoryNames[m] << "_improve," << mutationCategoryNames[m] << "_work";
+			const vector<ProfileCounter *> &counters = ProfileCounter::All();
+			for(vector<ProfileCounter *>::const_iterator it = counters.begin();it != counters.end();it++)
+				telemetry << "," << (*it)->Name();
+			const vector<Profiler *> &profs = Profiler::All();
+			for(vector<Profiler *>::const_iterator it = profs.begin();it != profs.end();it++)
+				telemetry << "," << (*it)->Name() << "_s";
+			telemetry << endl;
+			}
+		}
+	lastTelemetryEvals = CountLnLEvals.Total();
+	lastTelemetryStamp = ProfilerTimeStamp();
+	}
+
+//One JSON object or CSV line.  The mutation counts, improvements and work are for the current adaptation interval, and the
+//event counts and kernel times are totals for the whole run.  The evaluation rate is since the last output.
+void Population::OutputTelemetry(){
+	bool csv = (conf->telemetryFormat == "csv");
+	unsigned long long evals = CountLnLEvals.Total();
+	unsigned long long stamp = ProfilerTimeStamp();
+	double elapsed = (stamp - lastTelemetryStamp) / ProfilerTicksPerSecond();
+	double evalRate = (elapsed > 0.0 ? (evals - lastTelemetryEvals) / elapsed : 0.0);
+	lastTelemetryEvals = evals;
+	lastTelemetryStamp = stamp;
+
+	int clean = 0, tempRes = 0, res = 0, assigned = 0;
+	claMan->CountClaTotals(clean, tempRes, res, assigned);
+
+	int *mutNums[NUM_MUTATION_CATEGORIES] = {adap->randNNInum, adap->limSPRnum, adap->randSPRnum, adap->bipartRecomnum, adap->randRecomnum, adap->onlyBrlennum, adap->anyModelnum};
+	FLOAT_TYPE *mutImprove[NUM_MUTATION_CATEGORIES] = {adap->randNNI, adap->limSPR, adap->randSPR, adap->bipartRecom, adap->randRecom, adap->onlyBrlen, adap->anyModel};
+	FLOAT_TYPE *mutWork[NUM_MUTATION_CATEGORIES] = {adap->randNNIwork, adap->limSPRwork, adap->randSPRwork, adap->bipartRecomwork, adap->randRecomwork, adap->onlyBrlenwork, adap->anyModelwork};
+	const vector<ProfileCounter *> &counters = ProfileCounter::All();
+	const vector<Profiler *> &profs = Profiler::All();
+
+	if(csv){
+		telemetry << gen << "," << currentSearchRep << "," << currentBootstrapRep << "," << stopwatch.SplitTime() << "," << BestFitness() << "," << adap->branchOptPrecision;
+		telemetry << "," << evals << "," << evalRate;
+		telemetry << "," << claMan->NumClas() << "," << claMan->NumFreeClas() << "," << res << "," << tempRes << "," << claMan->MaxUsedClas() << "," << claMan->NumRecycledClas();
+		for(int m = 0;m < NUM_MUTATION_CATEGORIES;m++)
+			telemetry << "," << mutNums[m][0] << "," << mutImprove[m][0] << "," << mutWork[m][0];
+		for(vector<ProfileCounter *>::const_iterator it = counters.begin();it != counters.end();it++)
+			telemetry << "," << (*it)->Total();
+		for(vector<Profiler *>::const_iterator it = profs.begin();it != profs.end();it++)
+			telemetry << "," << (*it)->TotalSeconds();
+		}
+	else{
+		telemetry << "{\"gen\":" << gen << ",\"searchrep\":" << currentSearchRep << ",\"bootrep\":" << currentBootstrapRep << ",\"time_s\":" << stopwatch.SplitTime();
+		telemetry << ",\"best_lnL\":" << BestFitness() << ",\"precision\":" << adap->branchOptPrecision;
+		telemetry << ",\"lnl_evals\":" << evals << ",\"evals_per_s\":" << evalRate;
+		telemetry << ",\"clas\":{\"total\":" << claMan->NumClas() << ",\"free\":" << claMan->NumFreeClas() << ",\"reserved\":" << res << ",\"temp_reserved\":" << tempRes;
+		telemetry << ",\"max_used\":" << claMan->MaxUsedClas() << ",\"recycled\":" << claMan->NumRecycledClas() << "}";
+		telemetry << ",\"mutations\":{";
+		for(int m = 0;m < NUM_MUTATION_CATEGORIES;m++)
+			telemetry << (m > 0 ? "," : "") << "\"" << mutationCategoryNames[m] << "\":{\"tried\":" << mutNums[m][0] << ",\"improve\":" << mutImprove[m][0] << ",\"work\":" << mutWork[m][0] << "}";
+		telemetry << "},\"counts\":{";
+		for(vector<ProfileCounter *>::const_iterator it = counters.begin();it != counters.end();it++)
+			telemetry << (it != counters.begin() ? "," : "") << "\"" << (*it)->Name() << "\":" << (*it)->Total();
+		telemetry << "},\"kernel_s\":{";
+		for(vector<Profiler *>::const_iterator it = profs.begin();it != profs.end();it++)
+			telemetry << (it != profs.begin() ? "," : "") << "\"" << (*it)->Name() << "\":" << (*it)->TotalSeconds();
+		telemetry << "}}";
+		}
+	//flushed, since the file is meant to be followed while the run is going
+	telemetry << endl;
+	}
+
 /*
 int Population::ReplicateSpecifiedIndividuals(int count, int* which, const char* tree_string, FLOAT_TYPE *model_string){
 	assert(count > 0 && count <= (int)total_size);
@@ -5919,6 +6557,15 @@ void Population::keepTrack(){
 			if(typ&(Individual::bipartRecom)) adap->bipartRecomnum[0]++;
 			if(typ&(Individual::randRecom)) 	adap->randRecomnum[0]++;
 			if(typ&(Individual::anyModel))		adap->anyModelnum[0]++;
+
+			FLOAT_TYPE work = (FLOAT_TYPE) indiv[i].mutation_work;
+			if(typ&(Individual::randNNI)) 	adap->randNNIwork[0] += work;
+			if(typ&(Individual::randSPR)) 	adap->randSPRwork[0] += work;
+			if(typ&(Individual::limSPR))	 	adap->limSPRwork[0] += work;
+			if(typ == (Individual::brlen)) 	adap->onlyBrlenwork[0] += work;
+			if(typ&(Individual::bipartRecom)) adap->bipartRecomwork[0] += work;
+			if(typ&(Individual::randRecom)) 	adap->randRecomwork[0] += work;
+			if(typ&(Individual::anyModel))		adap->anyModelwork[0] += work;
 			}
 		}
 
@@ -7087,6 +7734,9 @@ void Population::InitializeOutputStreams(){
 		log << "gen\tbest_like\ttime\toptPrecision\n";
 		}
 
+	if(conf->telemetryEvery > 0 && log_output != DONT_OUTPUT)
+		BeginTelemetry();
+
 	//initialize the treelog
 	if(treelog_output != DONT_OUTPUT){
 		if(treeLog.is_open() == false){
@@ -7119,6 +7769,12 @@ void Population::InitializeOutputStreams(){
 				if(FileExists(temp_buf) && FileIsNexus(temp_buf)){
 					//this will verify whether we previously started a trees block in the bootstrap file
 					//if so, we shouldn't do so again.  If not, we need to start it now
+					//The split summaries are rewritten after each replicate, so they need the trees from before a restart
+					if(conf->outputSplitFrequencies && bootSplits.NumTrees() == 0){
+						int numRead = bootSplits.AddTreesFromFile(temp_buf);
+						if(numRead > 0)
+							outman.UserMessage("Read %d bootstrap trees from before the restart from %s", numRead, temp_buf);
+						}
 					bootLog.open(temp_buf, ios::app);
 					}
 				else{
@@ -7147,6 +7803,20 @@ void Population::InitializeOutputStreams(){
 			}
 		}
 
+	//from here on these are written by the background writer if asyncoutput is on (these do nothing for
+	//streams that aren't open or are already attached).  The writer may also be running just for binary
+	//site likelihoods
+	if(conf->asyncOutput){
+		asyncOut.Attach(fate);
+		asyncOut.Attach(log);
+		asyncOut.Attach(treeLog);
+		asyncOut.Attach(probLog);
+		asyncOut.Attach(bootLog);
+		asyncOut.Attach(bootLogPhylip);
+		asyncOut.Attach(swapLog);
+		asyncOut.Attach(telemetry);
+		}
+
 	ClearDebugLogs();
 	
 	#ifdef DEBUG_SCORES
@@ -7340,7 +8010,16 @@ void Population::FinalizeOutputStreams(int type){
 			(!prematureTermination &&
 			   ((repTerm && (log_output & FINALIZE_REP_TERM)) || (repsetTerm && (log_output & FINALIZE_REPSET_TERM)) || (fullTerm && (log_output & FINALIZE_FULL_TERM))))
 			) 
-			log.close();
+			asyncOut.Close(log);
+		}
+
+	//the telemetry follows the log
+	if(telemetry.is_open()){
+		if((prematureTermination && (log_output & FINALIZE_PREMATURE)) ||
+			(!prematureTermination &&
+			   ((repTerm && (log_output & FINALIZE_REP_TERM)) || (repsetTerm && (log_output & FINALIZE_REPSET_TERM)) || (fullTerm && (log_output & FINALIZE_FULL_TERM))))
+			) 
+			asyncOut.Close(telemetry);
 		}
 
 	if(fate.is_open()){
@@ -7348,7 +8027,7 @@ void Population::FinalizeOutputStreams(int type){
 			(!prematureTermination && 
 			   ((repTerm && (fate_output & FINALIZE_REP_TERM)) || (repsetTerm && (fate_output & FINALIZE_REPSET_TERM)) || (fullTerm && (fate_output & FINALIZE_FULL_TERM))))
 			) 
-			fate.close();
+			asyncOut.Close(fate);
 		}
 
 	if(probLog.is_open()){
@@ -7356,7 +8035,7 @@ void Population::FinalizeOutputStreams(int type){
 			(!prematureTermination && 
 				((repTerm && (problog_output & FINALIZE_REP_TERM)) || (repsetTerm && (problog_output & FINALIZE_REPSET_TERM)) || (fullTerm && (problog_output & FINALIZE_FULL_TERM))))
 			)
-			probLog.close();
+			asyncOut.Close(probLog);
 		}
 
 	if(swapLog.is_open()){
@@ -7364,7 +8043,7 @@ void Population::FinalizeOutputStreams(int type){
 			(!prematureTermination &&
 				((repTerm && (swaplog_output & FINALIZE_REP_TERM)) || (repsetTerm && (swaplog_output & FINALIZE_REPSET_TERM)) || (fullTerm && (swaplog_output & FINALIZE_FULL_TERM))))
 			)
-			swapLog.close();
+			asyncOut.Close(swapLog);
 		}
 
 	if(treeLog.is_open()){
@@ -7373,7 +8052,7 @@ void Population::FinalizeOutputStreams(int type){
 				((repTerm && (treelog_output & FINALIZE_REP_TERM)) || (repsetTerm && (treelog_output & FINALIZE_REPSET_TERM)) || (fullTerm && (treelog_output & FINALIZE_FULL_TERM))))
 			){
 			treeLog << "end;\n";
-			treeLog.close();
+			asyncOut.Close(treeLog);
 			}
 		}
 
@@ -7383,7 +8062,7 @@ void Population::FinalizeOutputStreams(int type){
 			   ((repTerm && (bootlog_output & FINALIZE_REP_TERM)) || (repsetTerm && (bootlog_output & FINALIZE_REPSET_TERM)) || (fullTerm && (bootlog_output & FINALIZE_FULL_TERM))))
 			){
 			bootLog << "end;\n";
-			bootLog.close();
+			asyncOut.Close(bootLog);
 			}
 		}
 
@@ -7392,9 +8071,13 @@ void Population::FinalizeOutputStreams(int type){
 			(!prematureTermination && 
 			   ((repTerm && (bootlog_output & FINALIZE_REP_TERM)) || (repsetTerm && (bootlog_output & FINALIZE_REPSET_TERM)) || (fullTerm && (bootlog_output & FINALIZE_FULL_TERM))))
 			)
-			bootLogPhylip.close();
+			asyncOut.Close(bootLogPhylip);
 		}
 
+	//binary site likelihoods are written after each search rep, so the file stays open until the end
+	if(fullTerm)
+		siteLikeOut.Close();
+
 	#ifdef DEBUG_SCORES
 	outf << "end;\n";
 	outf.close();
@@ -31,6 +31,10 @@ using namespace std;
 #include "individual.h"
 #include "stopwatch.h"
 #include "errorexception.h"
+#include "splittable.h"
+#include "checkpoint.h"
+#include "patternhash.h"
+#include "newick.h"
 
 class CondLikeArray;
 class Tree;
@@ -265,6 +269,20 @@ class PerturbManager{
 	};
 #endif
 
+//the likelihood work done while performing mutations, either a snapshot of the global counters or
+//the totals attributed to one category of mutation (see Population::PerformMutation)
+#define NUM_MUTATION_CATEGORIES 7
+struct MutationWork{
+	unsigned long long num;
+	unsigned long long lnlEvals;
+	unsigned long long clas;
+	unsigned long long pmats;
+	unsigned long long nrIterations;
+	MutationWork() : num(0), lnlEvals(0), clas(0), pmats(0), nrIterations(0){}
+	//roughly the number of passes over the site patterns, which is what adaptation weights by
+	unsigned long long Cost() const {return lnlEvals + clas + nrIterations;}
+	};
+
 class Population{
 
 private: 
@@ -329,10 +347,17 @@ private:
 	ofstream bootLog;
 	ofstream bootLogPhylip;
 	ofstream swapLog;
+	ofstream telemetry;//optional machine readable output every telemetryevery generations
+
+	//splits of the bootstrap trees written so far, for the split frequency and consensus output
+	SplitTable bootSplits;
+	//per-pattern lnL of the optimized candidate starting trees of a bootstrap run with RELL screening, [tree][subset][pattern]
+	vector< vector< vector<FLOAT_TYPE> > > rellCandidateLikes;
+	bool rellScreenDone;
 
 	string besttreefile;
-	char *treeString;
-	int stringSize;
+	//reused for every tree description written
+	NewickBuffer treeString;
 
 	//if the user killed the run
 	bool userTermination;
@@ -402,6 +427,13 @@ private:
 					//to codons or aminoacid
 
 	Stopwatch stopwatch;
+	unsigned lastProfileReport;//time of the last periodic profile report
+	unsigned long long lastTelemetryEvals;//likelihood evaluations and time stamp at the last telemetry output
+	unsigned long long lastTelemetryStamp;
+	MutationWork mutationWork[NUM_MUTATION_CATEGORIES];//totals for the whole run, in the order of mutationCategoryNames
+
+	CheckpointFile checkpointFile;
+	vector<PatternHash> checkpointHashes;//of each individual as last written, for incremental checkpoints
 
 #ifdef INCLUDE_PERTURBATION
 	Individual *allTimeBest; //this is only used for perturbation or ratcheting
@@ -413,16 +445,19 @@ private:
 			bestFitness(-(FLT_MAX)), bestIndiv(0), currentSearchRep(1), 
 			prevBestFitness(-(FLT_MAX)),indiv(NULL), newindiv(NULL),
 			cumfit(NULL), gen(0), paraMan(NULL), subtreeDefNumber(0), claMan(NULL), 
-			treeString(NULL), adap(NULL), rep_fraction_done(ZERO_POINT_ZERO), tot_fraction_done(ZERO_POINT_ZERO),
+			adap(NULL), rep_fraction_done(ZERO_POINT_ZERO), tot_fraction_done(ZERO_POINT_ZERO),
 			userTermination(false), timeTermination(false), genTermination(false), workPhaseTermination(false), restartedAfterTermination(false),
 			currentBootstrapRep(0), finishedRep(false), lastBootstrapSeed(0), nextBootstrapSeed(0), dataPart(NULL), rawPart(NULL), swapTermThreshold(0),
-			finishedGenerations(false), initialRefinePass(0), finalRefinePass(0)
+			finishedGenerations(false), initialRefinePass(0), finalRefinePass(0), rellScreenDone(false)
 #ifdef INCLUDE_PERTURBATION			 
 			pertMan(NULL), allTimeBest(NULL), bestSinceRestart(NULL),
 #endif
 			{
 			lastTopoImprove = 0;
 			lastPrecisionReduction = 0;
+			lastProfileReport = 0;
+			lastTelemetryEvals = 0;
+			lastTelemetryStamp = 0;
 			}
 
 		~Population();
@@ -448,11 +483,14 @@ private:
 		void ClearStoredTrees();
 
 		char *TreeStructToNewick(int i);
-		char *MakeNewick(int, bool);
+		const char *MakeNewick(int, bool);
 		void CreateGnuPlotFile();
 		void WritePopulationCheckpoint(OUTPUT_CLASS &out) ;
 
 		void ReadPopulationCheckpoint();
+		void WriteCheckpoint();
+		void ReadCheckpoint();
+		void ReadCheckpointIndividual(Individual *ind, CheckpointReader &in);
 		void WriteStateFiles();
 		bool ReadStateFiles();
 		void GetConstraints();
@@ -469,6 +507,8 @@ private:
 		void DetermineParentage();
 		void FindTreeStructsForNextGeneration();
 		void PerformMutation(int indNum);
+		MutationWork WorkSnapshot() const;
+		void AccountMutationWork(Individual *ind, const MutationWork &before);
 		void UpdateFractionDone(int phase);
 		FLOAT_TYPE GenerationFractionDone();
 		bool OutgroupRoot(Individual *ind, int indnum);
@@ -542,17 +582,30 @@ private:
 
 		void AppendTreeToTreeLog(int mutType, int indNum=-1);
 		void FinishBootstrapRep(const Individual *ind, int rep);
+		void WriteSplitSummaries(const SplitTable &table, const char *suffix, const char *description);
+		void ReportReplicateRFDistances();
+		void RELLBootstrap();
+		void CaptureRELLSiteLikelihoods(const vector<Individual *> &trees, vector< vector< vector<FLOAT_TYPE> > > &siteLikes);
+		int RELLBestTree(const vector< vector< vector<FLOAT_TYPE> > > &siteLikes) const;
+		void RELLSupport(const vector<Individual *> &trees, const vector< vector< vector<FLOAT_TYPE> > > &siteLikes, int seed, const char *description);
+		void ScreenBootstrapStartingTrees();
 		void UpdateTreeModels();
 		
 		void WriteGenerationOutput();
 		void OutputFate();
 		void OutputLog();
+		void OutputProfile();
+		void OutputWorkSummary();
+		void OutputMutationWork(ostream &out) const;
+		void BeginTelemetry();
+		void OutputTelemetry();
 		void OutputModelReport();
 
 		void OutputModelAddresses();
 		void OutputClaReport(Individual *arr);
 		void OutputFilesForScoreDebugging(Individual *ind=NULL, int num=0);
 		void RunTests();
+		void RunKernelBenchmark();
 		void GenerateTreesOnly(int nTrees);
 		void ApplyNSwaps(int numSwaps);
 		void SwapToCompletion(FLOAT_TYPE optPrecision);
@@ -0,0 +1,250 @@
+// GARLI version 2.1 source code
+// Copyright 2005-2014 Derrick J. Zwickl
+// email: garli.support@gmail.com
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <cstring>
+#include <iomanip>
+
+#ifdef UNIX
+#include <sys/resource.h>
+#endif
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#include "defs.h"
+#include "profiler.h"
+
+#ifdef ENABLE_CUSTOM_PROFILER
+bool Profiler::enabled = true;
+#else
+bool Profiler::enabled = false;
+#endif
+Profiler *Profiler::running[MAX_PROFILER_THREADS];
+bool Profiler::hwEnabled = false;
+
+static const char *hardwareEventNames[NUM_HW_EVENTS] = {"cycles", "instructions", "L1D misses", "LLC misses", "FLOPs"};
+
+#ifdef __linux__
+//Each thread opens its own group of events the first time that it reads them, since perf events count
+//a single thread.  hwGroup is the group leader, -1 if the thread couldn't open it and -2 if it hasn't
+//tried yet.  hwPosition is where each event is in the values read from the group, or -1 if it is missing
+static int hwGroup[MAX_PROFILER_THREADS];
+static int hwPosition[MAX_PROFILER_THREADS][NUM_HW_EVENTS];
+static unsigned long long hwRawFlopEvent = 0;
+
+static int OpenHardwareEvent(unsigned type, unsigned long long config, int groupFd){
+	perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = type;
+	attr.config = config;
+	attr.disabled = (groupFd == -1 ? 1 : 0);
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_GROUP;
+	return (int) syscall(__NR_perf_event_open, &attr, 0, -1, groupFd, 0);
+	}
+
+static void OpenHardwareGroup(int t){
+	unsigned types[NUM_HW_EVENTS] = {PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE, PERF_TYPE_RAW};
+	unsigned long long configs[NUM_HW_EVENTS] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+		PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+		PERF_COUNT_HW_CACHE_MISSES, hwRawFlopEvent};
+	hwGroup[t] = -1;
+	int num = 0;
+	for(int e = 0;e < NUM_HW_EVENTS;e++){
+		hwPosition[t][e] = -1;
+		if(e == HW_FLOPS && hwRawFlopEvent == 0) continue;
+		int fd = OpenHardwareEvent(types[e], configs[e], hwGroup[t]);
+		if(fd < 0){
+			//without cycles there is no group to put the others in
+			if(e == HW_CYCLES) return;
+			continue;
+			}
+		if(e == HW_CYCLES) hwGroup[t] = fd;
+		hwPosition[t][e] = num++;
+		}
+	ioctl(hwGroup[t], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(hwGroup[t], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	}
+
+void ProfilerReadHardwareCounters(int t, unsigned long long *values){
+	memset(values, 0, NUM_HW_EVENTS * sizeof(unsigned long long));
+	if(hwGroup[t] == -2) OpenHardwareGroup(t);
+	if(hwGroup[t] < 0) return;
+	//with PERF_FORMAT_GROUP the number of events comes first, then the value of each
+	unsigned long long buf[NUM_HW_EVENTS + 1];
+	if(read(hwGroup[t], buf, sizeof(buf)) <= 0) return;
+	for(int e = 0;e < NUM_HW_EVENTS;e++)
+		if(hwPosition[t][e] >= 0) values[e] = buf[1 + hwPosition[t][e]];
+	}
+
+bool Profiler::EnableHardwareCounters(unsigned long long rawFlopEvent){
+	hwRawFlopEvent = rawFlopEvent;
+	for(int t = 0;t < MAX_PROFILER_THREADS;t++)
+		hwGroup[t] = -2;
+	//check that this thread can open them, otherwise other threads won't be able to either
+	int t = ProfilerThread();
+	if(t < 0) return false;
+	OpenHardwareGroup(t);
+	hwEnabled = (hwGroup[t] >= 0);
+	return hwEnabled;
+	}
+#else
+void ProfilerReadHardwareCounters(int t, unsigned long long *values){
+	memset(values, 0, NUM_HW_EVENTS * sizeof(unsigned long long));
+	}
+
+bool Profiler::EnableHardwareCounters(unsigned long long rawFlopEvent){
+	return false;
+	}
+#endif
+
+//function statics, so that profilers defined as globals in other files can register themselves
+//regardless of the order in which globals are constructed
+vector<Profiler *> &Profiler::Registry(){
+	static vector<Profiler *> all;
+	return all;
+	}
+
+vector<ProfileCounter *> &ProfileCounter::Registry(){
+	static vector<ProfileCounter *> all;
+	return all;
+	}
+
+Profiler::Profiler(string n){
+	//the old reports padded names with spaces
+	name = n.substr(0, n.find_last_not_of(' ') + 1);
+	memset(slots, 0, sizeof(slots));
+	Registry().push_back(this);
+	}
+
+unsigned long long Profiler::NumCalls() const{
+	unsigned long long tot = 0;
+	for(int t = 0;t < MAX_PROFILER_THREADS;t++)
+		tot += slots[t].numCalls;
+	return tot;
+	}
+
+double Profiler::TotalSeconds() const{
+	unsigned long long tot = 0;
+	for(int t = 0;t < MAX_PROFILER_THREADS;t++)
+		tot += slots[t].totalTics;
+	return tot / ProfilerTicksPerSecond();
+	}
+
+double Profiler::SelfSeconds() const{
+	unsigned long long tot = 0;
+	for(int t = 0;t < MAX_PROFILER_THREADS;t++)
+		tot += slots[t].totalTics - slots[t].childTics;
+	return tot / ProfilerTicksPerSecond();
+	}
+
+void Profiler::Report(ostream &out, double progTime) const{
+	unsigned long long calls = NumCalls();
+	double seconds = TotalSeconds();
+	out << setw(16) << left << name << right << "\t" << setw(12) << calls << "\t";
+	out << fixed << setprecision(4) << setw(12) << seconds << "\t" << setw(12) << SelfSeconds() << "\t";
+	out << setw(12) << (calls > 0 ? 1.0e6 * seconds / calls : 0.0) << "\t";
+	out << setw(8) << setprecision(2) << (progTime > 0.0 ? 100.0 * seconds / progTime : 0.0) << endl;
+	out.unsetf(ios::fixed);
+	}
+
+unsigned long long Profiler::HardwareTotal(int e) const{
+	unsigned long long tot = 0;
+	for(int t = 0;t < MAX_PROFILER_THREADS;t++)
+		tot += slots[t].hwTotal[e];
+	return tot;
+	}
+
+void Profiler::ReportHardware(ostream &out) const{
+	unsigned long long calls = NumCalls();
+	double cycles = (double) HardwareTotal(HW_CYCLES);
+	out << setw(16) << left << name << right;
+	for(int e = 0;e < NUM_HW_EVENTS;e++)
+		out << "\t" << setw(14) << HardwareTotal(e);
+	out << fixed << setprecision(2) << "\t" << setw(8) << (cycles > 0.0 ? HardwareTotal(HW_INSTRUCTIONS) / cycles : 0.0);
+	out << "\t" << setw(10) << (cycles > 0.0 ? HardwareTotal(HW_FLOPS) / cycles : 0.0);
+	out << setprecision(0) << "\t" << setw(12) << (calls > 0 ? cycles / calls : 0.0) << endl;
+	out.unsetf(ios::fixed);
+	}
+
+void Profiler::ReportAll(ostream &out, double progTime){
+	out << setw(16) << left << "Function" << right << "\t" << setw(12) << "calls" << "\t" << setw(12) << "time(s)" << "\t" << setw(12) << "self(s)" << "\t" << setw(12) << "us/call" << "\t" << setw(8) << "%runtime" << endl;
+	vector<Profiler *> &all = Registry();
+	for(vector<Profiler *>::iterator it = all.begin();it != all.end();it++)
+		if((*it)->NumCalls() > 0) (*it)->Report(out, progTime);
+	out << endl;
+	if(hwEnabled){
+		//counts are inclusive of any nested sections
+		out << setw(16) << left << "Function" << right;
+		for(int e = 0;e < NUM_HW_EVENTS;e++)
+			out << "\t" << setw(14) << hardwareEventNames[e];
+		out << "\t" << setw(8) << "IPC" << "\t" << setw(10) << "FLOP/cycle" << "\t" << setw(12) << "cycles/call" << endl;
+		for(vector<Profiler *>::iterator it = all.begin();it != all.end();it++)
+			if((*it)->NumCalls() > 0) (*it)->ReportHardware(out);
+		out << endl;
+		}
+	ProfileCounter::ReportAll(out, progTime);
+	}
+
+ProfileCounter::ProfileCounter(string n) : name(n){
+	memset(counts, 0, sizeof(counts));
+	Registry().push_back(this);
+	}
+
+unsigned long long ProfileCounter::Total() const{
+	unsigned long long tot = 0;
+	for(int t = 0;t < MAX_PROFILER_THREADS;t++)
+		tot += counts[t];
+	return tot;
+	}
+
+void ProfileCounter::Report(ostream &out, double progTime) const{
+	unsigned long long tot = Total();
+	out << setw(16) << left << name << right << "\t" << setw(14) << tot << "\t";
+	out << fixed << setprecision(1) << setw(12) << (progTime > 0.0 ? tot / progTime : 0.0) << endl;
+	out.unsetf(ios::fixed);
+	}
+
+void ProfileCounter::ReportAll(ostream &out, double progTime){
+	out << setw(16) << left << "Counter" << right << "\t" << setw(14) << "count" << "\t" << setw(12) << "per second" << endl;
+	vector<ProfileCounter *> &all = Registry();
+	for(vector<ProfileCounter *>::iterator it = all.begin();it != all.end();it++)
+		(*it)->Report(out, progTime);
+	}
+
+unsigned long long ProfilerPeakMemoryKB(){
+#ifdef UNIX
+	rusage usage;
+	if(getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0;
+#ifdef __APPLE__
+	//bytes on OS X, KB elsewhere
+	return (unsigned long long) usage.ru_maxrss / 1024;
+#else
+	return (unsigned long long) usage.ru_maxrss;
+#endif
+#else
+	return 0;
+#endif
+	}
@@ -0,0 +1,191 @@
+// GARLI version 2.1 source code
+// Copyright 2005-2014 Derrick J. Zwickl
+// email: garli.support@gmail.com
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <string>
+#include <vector>
+#include <ostream>
+
+#ifdef _MSC_VER
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#include "defs.h"
+
+using namespace std;
+
+//threads beyond this aren't profiled
+#define MAX_PROFILER_THREADS 64
+
+//a monotonic time stamp, in units of ProfilerTicksPerSecond()
+inline unsigned long long ProfilerTimeStamp(){
+#ifdef _MSC_VER
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+	return (unsigned long long) now.QuadPart;
+#else
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (unsigned long long) now.tv_sec * 1000000000ULL + now.tv_nsec;
+#endif
+	}
+
+inline double ProfilerTicksPerSecond(){
+#ifdef _MSC_VER
+	LARGE_INTEGER freq;
+	QueryPerformanceFrequency(&freq);
+	return (double) freq.QuadPart;
+#else
+	return 1.0e9;
+#endif
+	}
+
+//each thread has its own slot in every profiler and counter, so nothing needs to be locked or atomic
+inline int ProfilerThread(){
+#ifdef OPEN_MP
+	int t = omp_get_thread_num();
+	return (t < MAX_PROFILER_THREADS ? t : -1);
+#else
+	return 0;
+#endif
+	}
+
+//the hardware events that can be counted around each profiled section (hardwarecounters = 1, Linux only).
+//There is no portable FLOP event, so FLOPs are only counted if a processor specific raw event code is
+//given (hardwarecounterflopevent)
+enum HardwareEvent{HW_CYCLES, HW_INSTRUCTIONS, HW_L1D_MISSES, HW_LLC_MISSES, HW_FLOPS, NUM_HW_EVENTS};
+
+//reads the current counts of the calling thread, which is thread t.  Events that aren't available read 0
+void ProfilerReadHardwareCounters(int t, unsigned long long *values);
+
+//Times a section of code between Start() and Stop().  Profiling is turned on at runtime (profile = 1, or
+//always if ENABLE_CUSTOM_PROFILER is defined) and otherwise Start and Stop return immediately.
+//Profilers may be nested, in which case the time spent in the inner one is also reported as the "child"
+//time of the outer, and may be used recursively, in which case only the outermost call is timed.
+//If hardware counters are also on, the events of the thread running the section are counted in the same
+//way as the time.  That costs a system call at each Start and Stop, and work that a section hands off to
+//other OpenMP threads isn't included.
+//All profilers and counters register themselves, and are reported together by ReportAll.
+class Profiler{
+	struct ThreadSlot{
+		unsigned long long numCalls;
+		unsigned long long totalTics;
+		unsigned long long childTics;
+		unsigned long long start;
+		int depth;
+		Profiler *parent;
+		unsigned long long hwTotal[NUM_HW_EVENTS];
+		unsigned long long hwStart[NUM_HW_EVENTS];
+		};
+
+	string name;
+	ThreadSlot slots[MAX_PROFILER_THREADS];
+
+	static bool enabled;
+	static bool hwEnabled;
+	//the innermost running profiler of each thread
+	static Profiler *running[MAX_PROFILER_THREADS];
+
+	static vector<Profiler *> &Registry();
+
+public:
+	Profiler(string n);
+
+	static void Enable(bool e){enabled = e;}
+	static bool Enabled() {return enabled;}
+	//returns false if the counters can't be opened, for example because of /proc/sys/kernel/perf_event_paranoid
+	static bool EnableHardwareCounters(unsigned long long rawFlopEvent);
+	static bool HardwareCountersEnabled() {return hwEnabled;}
+	static const vector<Profiler *> &All() {return Registry();}
+
+	void Start(){
+		if(!enabled) return;
+		int t = ProfilerThread();
+		if(t < 0) return;
+		ThreadSlot &s = slots[t];
+		s.numCalls++;
+		if(s.depth++ > 0) return;
+		s.parent = running[t];
+		running[t] = this;
+		if(hwEnabled)
+			ProfilerReadHardwareCounters(t, s.hwStart);
+		s.start = ProfilerTimeStamp();
+		}
+	void Stop(){
+		if(!enabled) return;
+		int t = ProfilerThread();
+		if(t < 0) return;
+		ThreadSlot &s = slots[t];
+		//started before profiling was turned on
+		if(s.depth == 0) return;
+		if(--s.depth > 0) return;
+		unsigned long long elapsed = ProfilerTimeStamp() - s.start;
+		s.totalTics += elapsed;
+		if(hwEnabled){
+			unsigned long long now[NUM_HW_EVENTS];
+			ProfilerReadHardwareCounters(t, now);
+			for(int e = 0;e < NUM_HW_EVENTS;e++)
+				s.hwTotal[e] += now[e] - s.hwStart[e];
+			}
+		running[t] = s.parent;
+		if(s.parent != NULL)
+			s.parent->slots[t].childTics += elapsed;
+		}
+
+	const string &Name() const {return name;}
+	unsigned long long NumCalls() const;
+	double TotalSeconds() const;
+	double SelfSeconds() const;
+	unsigned long long HardwareTotal(int e) const;
+
+	void Report(ostream &out, double progTime) const;
+	void ReportHardware(ostream &out) const;
+	static void ReportAll(ostream &out, double progTime);
+	};
+
+//Counts events (CLAs computed, pmats built, etc).  Unlike Profiler this is always on, since a count is
+//negligible next to the work being counted, and the totals are also used for the end of run work summary
+class ProfileCounter{
+	string name;
+	unsigned long long counts[MAX_PROFILER_THREADS];
+
+	static vector<ProfileCounter *> &Registry();
+
+public:
+	ProfileCounter(string n);
+
+	void Add(unsigned long long num = 1){
+		int t = ProfilerThread();
+		if(t >= 0) counts[t] += num;
+		}
+	const string &Name() const {return name;}
+	unsigned long long Total() const;
+	static const vector<ProfileCounter *> &All() {return Registry();}
+
+	void Report(ostream &out, double progTime) const;
+	static void ReportAll(ostream &out, double progTime);
+	};
+
+//the peak resident memory of the process so far, in KB, or 0 where it isn't available
+unsigned long long ProfilerPeakMemoryKB();
+
+#endif
@@ -24,6 +24,7 @@
 #include <algorithm>
 #include <functional>
 #include "rng.h"
+#include "checkpoint.h"
 #ifdef UNIX
 #include "unistd.h"
 #endif
@@ -229,16 +230,19 @@ class Swap{
 	unsigned short cutnum;
 	unsigned short brokenum;
 	unsigned short reconDist;
+	//added or incremented since the last incremental checkpoint
+	bool changed;
 
 public:
 	//default constructor does not initialize the bipart, since there would be some overhead
-	Swap() : count(0), cutnum(0), brokenum(0), reconDist(0){}
+	Swap() : count(0), cutnum(0), brokenum(0), reconDist(0), changed(false){}
 	Swap(Bipartition &swap, int cut, int broke, int dist){
 		b=&swap;
 		count=1;
 		cutnum=cut;
 		brokenum=broke;
 		reconDist=dist;
+		changed=false;
 		}
 	//copy constructor
 	Swap(const Swap &s){
@@ -247,6 +251,7 @@ public:
 		cutnum=s.cutnum;
 		brokenum=s.brokenum;
 		reconDist=s.reconDist;
+		changed=s.changed;
 		}
 	//this is just like the constructor, but doesn't require the bipartition
 	//to be allocated every time
@@ -256,14 +261,38 @@ public:
 		cutnum=cut;
 		brokenum=broke;
 		reconDist=dist;
+		changed=false;
 		}
 
 	Swap(FILE* &in){
 		b.BinaryInput(in);
 		intptr_t scalarSize = (intptr_t) &(reconDist) - (intptr_t) &(count) + sizeof(reconDist);
 		fread(&count, scalarSize, 1, in);
+		changed=false;
 		}
 
+	Swap(CheckpointReader &in){
+		for(int i=0;i<Bipartition::nBlocks;i++)
+			b.rep[i] = in.GetUInt64();
+		count = in.GetInt();
+		cutnum = in.GetInt();
+		brokenum = in.GetInt();
+		reconDist = in.GetInt();
+		changed = false;
+		}
+
+	void WriteCheckpoint(CheckpointWriter &out) const{
+		for(int i=0;i<Bipartition::nBlocks;i++)
+			out.PutUInt64(b.rep[i]);
+		out.PutInt(count);
+		out.PutInt(cutnum);
+		out.PutInt(brokenum);
+		out.PutInt(reconDist);
+		}
+
+	bool Changed() const {return changed;}
+	void SetChanged(bool c) {changed = c;}
+
 	void Increment(){
 		count++;	
 		}
@@ -297,7 +326,7 @@ public:
 		out.WRITE_TO_FILE(&count, (streamsize) scalarSize, 1);
 		}
 
-	unsigned BipartitionBlock(int block) const{
+	BipartBlock BipartitionBlock(int block) const{
 		return b.rep[block];	
 		}
 
@@ -345,11 +374,18 @@ class AttemptedSwapList{
 	list<list<Swap>::iterator> indeces;
 	unsigned unique;
 	unsigned total;
+	//for incremental checkpoints, the swaps that have changed since the last checkpoint and whether the
+	//list has been cleared since then
+	bool trackChanges;
+	vector<list<Swap>::iterator> changed;
+	bool clearedSinceCheckpoint;
 	
 public:
 
 	AttemptedSwapList(){
 		unique=total=0;
+		trackChanges=false;
+		clearedSinceCheckpoint=true;
 		}
 
 	int GetUnique() {return unique;}
@@ -359,6 +395,68 @@ public:
 		swaps.clear();
 		indeces.clear();
 		unique=total=0;
+		changed.clear();
+		clearedSinceCheckpoint=true;
+		}
+
+	void TrackChanges(bool t){
+		trackChanges=t;
+		changed.clear();
+		clearedSinceCheckpoint=true;
+		}
+
+	//writes the whole list, or with onlyChanged just the swaps added or incremented since the last checkpoint
+	void WriteCheckpoint(CheckpointWriter &out, bool onlyChanged){
+		bool complete = (onlyChanged == false || clearedSinceCheckpoint);
+		out.PutInt(Bipartition::nBlocks);
+		out.PutBool(complete);
+		if(complete){
+			out.PutInt(unique);
+			for(list<Swap>::iterator it=swaps.begin();it != swaps.end(); it++)
+				(*it).WriteCheckpoint(out);
+			}
+		else{
+			out.PutInt((int) changed.size());
+			for(vector<list<Swap>::iterator>::iterator it=changed.begin();it != changed.end(); it++)
+				(**it).WriteCheckpoint(out);
+			}
+		for(vector<list<Swap>::iterator>::iterator it=changed.begin();it != changed.end(); it++)
+			(**it).SetChanged(false);
+		changed.clear();
+		clearedSinceCheckpoint=false;
+		}
+
+	//reads either a complete list or the changes to apply to the current one
+	void ReadCheckpoint(CheckpointReader &in){
+		in.ExpectCount(Bipartition::nBlocks, "bipartition blocks");
+		bool complete = in.GetBool();
+		int num = in.GetInt();
+		if(complete){
+			ClearAttemptedSwaps();
+			for(int i=0;i<num;i++)
+				swaps.push_back(Swap(in));
+			}
+		else{
+			IndexSwaps();
+			for(int i=0;i<num;i++){
+				Swap s(in);
+				bool found;
+				list<Swap>::iterator it = FindSwap(s, found);
+				if(found) (*it).SetCount(s.Count());
+				else{
+					bool reindex = (it == swaps.begin());
+					swaps.insert(it, s);
+					unique++;
+					if(reindex) IndexSwaps();
+					}
+				}
+			}
+		unique = (unsigned) swaps.size();
+		total = 0;
+		for(list<Swap>::iterator it=swaps.begin();it != swaps.end(); it++) total += (*it).Count();
+		IndexSwaps();
+		changed.clear();
+		clearedSinceCheckpoint=false;
 		}
 
 	list<Swap>::iterator end(){
@@ -450,7 +548,7 @@ public:
 			bool reindex=false;
 			//if we're adding this before the first index, be sure to reindex
 			if(it == swaps.begin() && indeces.empty()==false) reindex=true;
-			swaps.insert(it, swap);
+			it = swaps.insert(it, swap);
 			unique++;
 			total++;
 			if(unique==100 || (unique % 1000)==0 || reindex==true) IndexSwaps(); 
@@ -459,6 +557,10 @@ public:
 			(*it).Increment();
 			total++;
 			}
+		if(trackChanges && (*it).Changed() == false){
+			(*it).SetChanged(true);
+			changed.push_back(it);
+			}
 		assert(swaps.size() == unique);
 		return (found == false);//return value is true if the swap is _unique_
 		}
@@ -20,6 +20,7 @@
 #include "defs.h"
 #include "sequencedata.h"
 #include "garlireader.h"
+#include "datacache.h"
 #include "rng.h"
 #include <iterator>
 
@@ -225,6 +226,24 @@ void AminoacidData::CalcEmpiricalFreqs(){
 	assert(fabs(freqTot - 1.0) < 1e-5);
 	}
 
+//these are written before the matrix, since they must be available when the base class
+//ReadCache calculates the empirical frequencies
+void CodonData::WriteCache(DataCacheWriter &out) const{
+	out.PutArray(empBaseFreqsPos1, 4);
+	out.PutArray(empBaseFreqsPos2, 4);
+	out.PutArray(empBaseFreqsPos3, 4);
+	out.PutArray(empBaseFreqsAllPos, 4);
+	DataMatrix::WriteCache(out);
+	}
+
+void CodonData::ReadCache(DataCacheReader &in){
+	in.GetArray(empBaseFreqsPos1, 4);
+	in.GetArray(empBaseFreqsPos2, 4);
+	in.GetArray(empBaseFreqsPos3, 4);
+	in.GetArray(empBaseFreqsAllPos, 4);
+	DataMatrix::ReadCache(in);
+	}
+
 void CodonData::CalcEmpiricalFreqs(){
 	if(empType == NOT_EMPIRICAL) return;
 
@@ -361,6 +380,31 @@ void NucleotideData::MakeAmbigStrings(){
 		}
 	}
 
+void NucleotideData::MakePackedTips(){
+	if(HasPackedTips())
+		return;
+	//unlike the ambiguity strings, every site takes the same space, so site i of every taxon can be found
+	//directly and no separate map is needed for OpenMP
+	packedTips.reserve(NTax());
+	for(int i=0;i<NTax();i++){
+		const unsigned char *thisdata=GetRow(i);
+		unsigned char *thisTip=new unsigned char[(NChar() + 1) / 2];
+		memset(thisTip, 0, (NChar() + 1) / 2);
+		for(int j=0;j<NChar();j++){
+			unsigned char code = thisdata[j] & 15;
+			//no states means missing
+			if(code == 0) code = 15;
+			thisTip[j >> 1] |= code << ((j & 1) << 2);
+			}
+		packedTips.push_back(thisTip);
+		}
+	//from here on the kernels and Matrix() read the packed tips, so the unpacked copy is freed.  Otherwise the
+	//data would take 1.5 bytes per site rather than half a byte
+	for(int j = 0; j < nTaxAllocated; j++)
+		MEM_DELETE_ARRAY(matrix[j]);
+	MEM_DELETE_ARRAY(matrix);
+	}
+
 void CodonData::FillCodonMatrixFromDNA(const NucleotideData *dnaData, bool ignoreStops){
 	//first we need to convert the nucleotide data to codons numbered 0-60 or 61 and assign them back to the terminals
 	//codons are ordered AAA, AAC, AAG, AAT, ACA, ... TTT
@@ -1409,23 +1453,7 @@ int NStateData::BootstrapReweight(int seedToUse, FLOAT_TYPE resampleProportion){
 	else
 		countsAlias = count;
 
-	//for nstate data this will include the conditioning chars, but they will
-	//have a resample prob of zero
-	FLOAT_TYPE *cumProbs = new FLOAT_TYPE[numPatterns];
-	
 	assert(origCountsAlias[0] > 0 && origCountsAlias[1] > 0);
-
-	for(int i = 0;i < numConditioningPatterns;i++)
-		cumProbs[i] = ZERO_POINT_ZERO;
-	cumProbs[numConditioningPatterns]=(FLOAT_TYPE) origCountsAlias[numConditioningPatterns] / ((FLOAT_TYPE) numNonMissingRealCountsInOrigMatrix);
-	for(int i=numConditioningPatterns + 1;i<numPatterns;i++){
-		cumProbs[i] = cumProbs[i-1] + (FLOAT_TYPE) origCountsAlias[i] / ((FLOAT_TYPE) numNonMissingRealCountsInOrigMatrix);
-		assert(origCountsAlias[i] > 0);
-		}
-	for(int q=numConditioningPatterns;q<numPatterns;q++) 
-		countsAlias[q]=0;
-	assert(FloatingPointEquals(cumProbs[numPatterns-1], ONE_POINT_ZERO, 1e-6));
-	cumProbs[numPatterns-1] = ONE_POINT_ZERO;
 		
 	//ofstream deb("counts.log", ios::app);
 
@@ -1433,15 +1461,11 @@ int NStateData::BootstrapReweight(int seedToUse, FLOAT_TYPE resampleProportion){
 	int numToSample = (int) (((FLOAT_TYPE)numNonMissingRealCountsInOrigMatrix * resampleProportion) + 0.5);
 	if(numToSample != numNonMissingRealCountsInOrigMatrix) outman.UserMessage("Resampling %d characters (%.2f%%).\n", numToSample, resampleProportion*100);
 
-	for(int c=0;c<numToSample;c++){
-		FLOAT_TYPE p=rnd.uniform();
-		int pat=0; 
-		while(p > cumProbs[pat]) pat++;
-		countsAlias[pat]++;
-		}
+	//the conditioning chars are not resampled
+	ResampleCounts(origCountsAlias + numConditioningPatterns, numPatterns - numConditioningPatterns, numToSample, countsAlias + numConditioningPatterns);
 /*
 	for(int i = 0;i < numPatterns;i++)
-		deb << i << "\t" << cumProbs[i] << "\t" << origCountsAlias[i] << "\t" << countsAlias[i] <<  endl;
+		deb << i << "\t" << origCountsAlias[i] << "\t" << countsAlias[i] <<  endl;
 */
 	//take a count of the number of chars that were actually resampled
 	nonZeroCharCount = 0;
@@ -1457,10 +1481,9 @@ int NStateData::BootstrapReweight(int seedToUse, FLOAT_TYPE resampleProportion){
 		}
 	if(datatype == ONLY_VARIABLE) 
 		assert(countsAlias[0] == 1);
-	assert(totCounts == numNonMissingRealCountsInOrigMatrix);
+	assert(totCounts == numToSample);
 	assert(nonZeroCharCount + numZero == numPatterns - numConditioningPatterns);
 
-	delete []cumProbs;
 	int nextSeed = rnd.seed();
 	rnd.set_seed(originalSeed);
 	return nextSeed;
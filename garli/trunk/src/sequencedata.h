@@ -153,12 +153,18 @@ inline char SequenceData::DatumToChar( unsigned char d ) const
 	return ch;
 }
 
+//packed tips (packedtipdata = 1) hold the bitwise nucleotide code of two sites per byte, the first in the low four bits
+inline unsigned char PackedTipState(const unsigned char *tip, int site){
+	return (tip[site >> 1] >> ((site & 1) << 2)) & 15;
+	}
+
 class NucleotideData : public SequenceData{
 
 	vector<char*> ambigStrings;
 #ifdef OPEN_MP
 	vector<unsigned*> ambigToCharMap;
 #endif
+	vector<unsigned char*> packedTips;
 
 public:		
 	NucleotideData() : SequenceData() {fullyAmbigChar = 15;}
@@ -170,6 +176,8 @@ public:
 		for(vector<unsigned*>::iterator delit=ambigToCharMap.begin();delit!=ambigToCharMap.end();delit++)
 			delete [](*delit);
 #endif
+		for(vector<unsigned char*>::iterator delit=packedTips.begin();delit!=packedTips.end();delit++)
+			delete [](*delit);
 		}
 	bool IsNucleotide() const {return true;}
 
@@ -177,6 +185,20 @@ public:
 	void CalcEmpiricalFreqs();
 	void CreateMatrixFromNCL(const NxsCharactersBlock *charblock, NxsUnsignedSet &charset);
 	void MakeAmbigStrings();
+	//an alternative to the ambiguity strings, used with packedtipdata = 1
+	void MakePackedTips();
+	bool HasPackedTips() const {return !packedTips.empty();}
+	const unsigned char *GetPackedTips(int i) const{
+		return packedTips[i];
+		}
+	//the unpacked matrix is deleted once the tips are packed (GetRow is then unavailable)
+	unsigned char Matrix( int i, int j ) const {
+		if(HasPackedTips()){
+			assert(j >= 0 && j < numPatterns);
+			return PackedTipState(packedTips[i], j);
+			}
+		return DataMatrix::Matrix(i, j);
+		}
 	void AddDummyRootToExistingMatrix();
 	char *GetAmbigString(int i) const{
 		return ambigStrings[i];
@@ -616,6 +638,25 @@ public:
 
 	CodonData(const NucleotideData *dat, int genCode, bool ignoreStops=false) : SequenceData(){
 		assert(dat->Dense() == false);
+		SetGeneticCode(genCode);
+		usePatternManager = dat->GetUsePatternManager();
+		FillCodonMatrixFromDNA(dat, ignoreStops);
+		CopyNamesFromOtherMatrix(dat);
+		empType = NOT_EMPIRICAL;
+		fullyAmbigChar = maxNumStates;
+		}
+
+	//for a matrix that will be filled from the data cache
+	CodonData(int genCode) : SequenceData(){
+		SetGeneticCode(genCode);
+		empType = NOT_EMPIRICAL;
+		fullyAmbigChar = maxNumStates;
+		}
+
+	~CodonData(){}
+	bool IsCodon() const {return true;}
+
+	void SetGeneticCode(int genCode){
 		if(genCode == GeneticCode::STANDARD){
 			code.SetStandardCode();
 			maxNumStates = 61;
@@ -631,17 +672,11 @@ public:
 		else{
 			throw ErrorException("Sorry, only the standard, vert mito and invert mito codes can be used with codon models");
 			}
-		usePatternManager = dat->GetUsePatternManager();
-		FillCodonMatrixFromDNA(dat, ignoreStops);
-		CopyNamesFromOtherMatrix(dat);
-		empType = NOT_EMPIRICAL;
-		fullyAmbigChar = maxNumStates;
 		}
-
-	~CodonData(){}
-	bool IsCodon() const {return true;}
-
 	void FillCodonMatrixFromDNA(const NucleotideData *, bool ignoreStops);
+	//the base frequencies by codon position can't be recalculated from the codon matrix, so are cached as well
+	void WriteCache(DataCacheWriter &out) const;
+	void ReadCache(DataCacheReader &in);
 	unsigned char CharToDatum(char c) const{
 		//this shouldn't be getting called, as it makes no sense for codon data
 		assert(0);
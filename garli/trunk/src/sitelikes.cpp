@@ -0,0 +1,108 @@
+// GARLI version 2.1 source code
+// Copyright 2005-2014 Derrick J. Zwickl
+// email: garli.support@gmail.com
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <cassert>
+
+#include "defs.h"
+#include "sitelikes.h"
+#include "sequencedata.h"
+#include "asyncoutput.h"
+#include "errorexception.h"
+
+SiteLikelihoodFile siteLikeOut;
+
+void SiteLikelihoodFile::Open(const string &filename, const DataPartition *data, int lev, bool append){
+	if(out.is_open())
+		return;
+	level = lev;
+	numSubsets = data->NumSubsets();
+	out.open(filename.c_str(), ios::binary | (append ? ios::app : ios::trunc));
+	if(!out.good())
+		throw ErrorException("Could not open site likelihood file %s for writing", filename.c_str());
+	asyncOut.Attach(out);
+	if(!append)
+		WriteHeader(data);
+	}
+
+void SiteLikelihoodFile::WriteHeader(const DataPartition *data){
+	record.Clear();
+	record.PutBytes("GARLISLK", 8);
+	record.BeginSection(CHECKPOINT_TAG('S', 'L', 'H', 'D'));
+	record.PutUInt32(SITELIKE_FORMAT_VERSION);
+	record.PutUInt32(level);
+	record.PutUInt32(numSubsets);
+	vector<int> origCols, patterns;
+	for(int p = 0;p < numSubsets;p++){
+		const SequenceData *curData = data->GetSubset(p);
+		//the same sites as the text output, which only includes the conditioning patterns when debugging
+		int startPat = (level > 1 ? 0 : curData->NumConditioningPatterns());
+		int endPat = curData->GapsIncludedNChar() + curData->NumConditioningPatterns();
+		origCols.clear();
+		patterns.clear();
+		for(int site = startPat;site < endPat;site++){
+			origCols.push_back(curData->OrigDataNumber(site) + 1);
+			patterns.push_back(curData->Number(site));
+			}
+		record.PutUInt32(curData->NChar());
+		record.PutInts(origCols.empty() ? NULL : &origCols[0], (int) origCols.size());
+		record.PutInts(patterns.empty() ? NULL : &patterns[0], (int) patterns.size());
+		}
+	record.EndSection();
+	out.write((const char *) record.Data(), record.Size());
+	out.flush();
+	}
+
+void SiteLikelihoodFile::WriteSubset(int subset, const vector<FLOAT_TYPE> &likes, const int *under1, const int *under2){
+	assert(out.is_open());
+	int num = (int) likes.size();
+	pending.BeginSection(CHECKPOINT_TAG('S', 'L', 'P', 'T'));
+	pending.PutUInt32(subset);
+	pending.PutInt(num);
+	for(int c = 0;c < num;c++)
+		pending.PutDouble(-likes[c]);
+	if(level > 1){
+		pending.PutInts(under1, num);
+		pending.PutInts(under2, under2 != NULL ? num : 0);
+		}
+	pending.EndSection();
+	}
+
+void SiteLikelihoodFile::WriteTree(int treeNum, double negLnL, const string &treeString){
+	assert(out.is_open());
+	record.Clear();
+	record.BeginSection(CHECKPOINT_TAG('S', 'L', 'T', 'R'));
+	record.PutInt(treeNum);
+	record.PutDouble(negLnL);
+	record.PutUInt32((unsigned) treeString.length());
+	record.PutBytes(treeString.data(), treeString.length());
+	record.Append(pending);
+	record.EndSection();
+	pending.Clear();
+	//one write per tree.  The flush hands it to the writer thread if that is running, and otherwise
+	//makes the file complete up to this tree
+	out.write((const char *) record.Data(), record.Size());
+	out.flush();
+	if(!out.good())
+		throw ErrorException("Problem writing site likelihoods to file.  Is the disk full?");
+	}
+
+void SiteLikelihoodFile::Close(){
+	pending.Clear();
+	if(out.is_open())
+		asyncOut.Close(out);
+	}
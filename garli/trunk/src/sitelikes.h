@@ -0,0 +1,81 @@
+// GARLI version 2.1 source code
+// Copyright 2005-2014 Derrick J. Zwickl
+// email: garli.support@gmail.com
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef SITE_LIKES_H
+#define SITE_LIKES_H
+
+#include <vector>
+#include <string>
+#include <fstream>
+
+#include "defs.h"
+#include "checkpoint.h"
+
+using namespace std;
+
+class DataPartition;
+
+#define SITELIKE_FORMAT_VERSION 1
+
+//Writes site likelihoods in a compact binary form (sitelikelihoodformat = binary) to <ofprefix>.sitelikes.bin,
+//rather than as text to <ofprefix>.sitelikes.log.  Values are stored once per unique pattern, and the map
+//from the sites of the original alignment to the patterns is stored once at the start of the file.  Each
+//tree is encoded in memory as it is scored and written with a single write, which goes through the
+//asyncoutput writer thread when that is running.
+//
+//The file uses the encoding of the checkpoint files (see checkpoint.h), so everything is little endian,
+//floating point values are doubles, and each section is a 4 byte tag followed by an 8 byte length, so that
+//anything unknown can be skipped.  An int array is an int32 count followed by the values.
+//	"GARLISLK"					8 byte magic
+//	section SLHD				written once
+//		uint32 version, uint32 level (outputsitelikelihoods), uint32 number of subsets
+//		for each subset:
+//			uint32 number of patterns
+//			int array: the original (1 based) column of each site in output order
+//			int array: the pattern of each of those sites, or -1 if it is entirely gaps
+//	section SLTR				one per tree, in the order the trees were scored
+//		int32 tree number, double -lnL, uint32 length and the characters of the tree description (may be empty)
+//		section SLPT			one per subset
+//			uint32 subset, int32 count and -lnL of each pattern
+//			if level > 1, int arrays of the underflow multipliers of each pattern (the second may be empty)
+//The -lnL of a site is then the value of its pattern in that subset, as in the text file.
+class SiteLikelihoodFile{
+	ofstream out;
+	int level;
+	int numSubsets;
+	CheckpointWriter pending;//the subsets of the tree being scored
+	CheckpointWriter record;
+
+	void WriteHeader(const DataPartition *data);
+
+public:
+	SiteLikelihoodFile() : level(0), numSubsets(0){}
+
+	//starts a new file, or with append continues one that was started by an earlier run (restarting
+	//from a checkpoint).  Does nothing if the file is already open
+	void Open(const string &filename, const DataPartition *data, int lev, bool append);
+	bool IsOpen() const {return out.is_open();}
+	void Close();
+
+	void WriteSubset(int subset, const vector<FLOAT_TYPE> &likes, const int *under1, const int *under2);
+	void WriteTree(int treeNum, double negLnL, const string &treeString);
+	};
+
+extern SiteLikelihoodFile siteLikeOut;
+
+#endif
@@ -0,0 +1,222 @@
+// GARLI version 2.1 source code
+// Copyright 2005-2014 Derrick J. Zwickl
+// email: garli.support@gmail.com
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <cstdio>
+
+#include "defs.h"
+#include "splittable.h"
+#include "tree.h"
+#include "treenode.h"
+#include "errorexception.h"
+
+void SplitTable::Clear(){
+	splits.clear();
+	counts.clear();
+	index.clear();
+	treeSplits.clear();
+	}
+
+int SplitTable::FindOrAddSplit(const Bipartition &bip){
+	vector<int> &bucket = index[bip.ComplementNormalizedHash()];
+	for(vector<int>::iterator it = bucket.begin();it != bucket.end();it++){
+		if(splits[*it].EqualsEquals(bip) || splits[*it].ComplementEqualsEquals(bip))
+			return *it;
+		}
+	splits.push_back(bip);
+	splits.back().Standardize();
+	counts.push_back(0);
+	bucket.push_back((int) splits.size() - 1);
+	return (int) splits.size() - 1;
+	}
+
+void SplitTable::AddSplitsInSubtree(const TreeNode *nd, vector<int> &ids){
+	if(nd->IsInternal()){
+		//splits separating fewer than two taxa from the rest can appear at the root of rooted trees,
+		//but are trivial
+		int numOn = nd->bipart->CountOnBits();
+		if(numOn > 1 && numOn < Bipartition::ntax - 1)
+			ids.push_back(FindOrAddSplit(*nd->bipart));
+		TreeNode *des = nd->left;
+		while(des != NULL){
+			AddSplitsInSubtree(des, ids);
+			des = des->next;
+			}
+		}
+	}
+
+int SplitTable::AddTree(Tree *t){
+	t->CalcBipartitions(true);
+	vector<int> ids;
+	TreeNode *nd = t->root->left;
+	while(nd != NULL){
+		AddSplitsInSubtree(nd, ids);
+		nd = nd->next;
+		}
+	//a split can appear twice if the tree has a basal bifurcation
+	sort(ids.begin(), ids.end());
+	ids.erase(unique(ids.begin(), ids.end()), ids.end());
+	for(vector<int>::iterator it = ids.begin();it != ids.end();it++)
+		counts[*it]++;
+	treeSplits.push_back(ids);
+	return (int) treeSplits.size() - 1;
+	}
+
+int SplitTable::AddTreesFromFile(const char *filename){
+	ifstream in(filename);
+	string line;
+	int num = 0;
+	while(getline(in, line)){
+		//tree lines look like "tree name = [&U] [comments] (newick);", and the description itself has no brackets
+		size_t start = line.find_first_not_of(" \t");
+		if(start == string::npos || line.compare(start, 5, "tree ") != 0)
+			continue;
+		size_t open = line.find('(', line.rfind(']') == string::npos ? start : line.rfind(']'));
+		if(open == string::npos)
+			continue;
+		//the last tree may be incomplete if the run was killed while writing it
+		try{
+			Tree t(line.c_str() + open, true, true);
+			AddTree(&t);
+			num++;
+			}
+		catch(ErrorException &){
+			break;
+			}
+		}
+	return num;
+	}
+
+int SplitTable::RFDistance(int tree1, int tree2) const{
+	const vector<int> &s1 = treeSplits[tree1];
+	const vector<int> &s2 = treeSplits[tree2];
+	//both are sorted, so the number shared can be found in a single merge-like pass
+	int shared = 0;
+	vector<int>::const_iterator it1 = s1.begin(), it2 = s2.begin();
+	while(it1 != s1.end() && it2 != s2.end()){
+		if(*it1 < *it2) it1++;
+		else if(*it2 < *it1) it2++;
+		else{
+			shared++;
+			it1++;
+			it2++;
+			}
+		}
+	return (int) (s1.size() + s2.size()) - 2 * shared;
+	}
+
+void SplitTable::PairwiseRFDistances(vector< vector<int> > &dists) const{
+	int num = NumTrees();
+	dists.assign(num, vector<int>(num, 0));
+#ifdef OPEN_MP
+#pragma omp parallel for schedule(dynamic)
+#endif
+	for(int t1 = 0;t1 < num;t1++){
+		for(int t2 = 0;t2 < t1;t2++){
+			int d = RFDistance(t1, t2);
+			dists[t1][t2] = d;
+			dists[t2][t1] = d;
+			}
+		}
+	}
+
+static bool CountGreaterThan(const pair<unsigned, int> &lhs, const pair<unsigned, int> &rhs){
+	//ties are broken by the order in which the splits were first seen
+	if(lhs.first != rhs.first) return lhs.first > rhs.first;
+	return lhs.second < rhs.second;
+	}
+
+void SplitTable::WriteSplitFrequencies(ofstream &out) const{
+	vector< pair<unsigned, int> > order;
+	for(int s = 0;s < NumSplits();s++)
+		order.push_back(pair<unsigned, int>(counts[s], s));
+	sort(order.begin(), order.end(), CountGreaterThan);
+
+	out << "Split frequencies from " << NumTrees() << " trees (" << NumSplits() << " distinct nontrivial splits)\n";
+	out << "split\tcount\tfrequency\n";
+	char freq[20];
+	for(vector< pair<unsigned, int> >::iterator it = order.begin();it != order.end();it++){
+		sprintf(freq, "%.4f", (*it).first / (double) NumTrees());
+		out << splits[(*it).second].Output() << "\t" << (*it).first << "\t" << freq << "\n";
+		}
+	out.flush();
+	}
+
+void SplitTable::AppendConsensusClade(int clade, const vector< vector<int> > &childClades, const vector< vector<int> > &childTaxa, string &newick) const{
+	//clade == -1 is the root
+	char num[20];
+	newick += "(";
+	bool first = true;
+	for(vector<int>::const_iterator it = childTaxa[clade + 1].begin();it != childTaxa[clade + 1].end();it++){
+		if(!first) newick += ",";
+		sprintf(num, "%d", *it);
+		newick += num;
+		first = false;
+		}
+	for(vector<int>::const_iterator it = childClades[clade + 1].begin();it != childClades[clade + 1].end();it++){
+		if(!first) newick += ",";
+		AppendConsensusClade(*it, childClades, childTaxa, newick);
+		first = false;
+		}
+	newick += ")";
+	if(clade >= 0){
+		sprintf(num, "%d", (int) (100.0 * counts[clade] / NumTrees()));
+		newick += num;
+		}
+	}
+
+void SplitTable::MajorityRuleConsensus(string &newick) const{
+	newick.clear();
+	int ntax = Bipartition::ntax;
+
+	//The splits are standardized to contain taxon 1, so if the consensus tree is rooted at taxon 1 the
+	//taxa NOT in each split form a clade.  Collect the majority splits ordered by the size of those clades,
+	//so that the first larger clade containing a given clade is its parent.
+	vector< pair<int, int> > bySize;
+	for(int s = 0;s < NumSplits();s++){
+		if(2 * counts[s] > (unsigned) NumTrees())
+			bySize.push_back(pair<int, int>(ntax - splits[s].CountOnBits(), s));
+		}
+	sort(bySize.begin(), bySize.end());
+
+	//entry 0 is the root, entry c+1 is split c
+	vector< vector<int> > childClades(NumSplits() + 1);
+	vector< vector<int> > childTaxa(NumSplits() + 1);
+	for(unsigned c = 0;c < bySize.size();c++){
+		int parent = -1;
+		const Bipartition &cl = splits[bySize[c].second];
+		for(unsigned p = c + 1;p < bySize.size();p++){
+			//the clade is contained in the larger one if the larger's split is contained in this split
+			if(splits[bySize[p].second].IsASubsetOf(cl)){
+				parent = bySize[p].second;
+				break;
+				}
+			}
+		childClades[parent + 1].push_back(bySize[c].second);
+		}
+	for(int t = 1;t <= ntax;t++){
+		int parent = -1;
+		for(unsigned c = 0;c < bySize.size();c++){
+			if(splits[bySize[c].second].ContainsTaxon(t) == false){
+				parent = bySize[c].second;
+				break;
+				}
+			}
+		childTaxa[parent + 1].push_back(t);
+		}
+	AppendConsensusClade(-1, childClades, childTaxa, newick);
+	}
@@ -0,0 +1,73 @@
+// GARLI version 2.1 source code
+// Copyright 2005-2014 Derrick J. Zwickl
+// email: garli.support@gmail.com
+//
+//  This program is free software: you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation, either version 3 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef SPLIT_TABLE_H
+#define SPLIT_TABLE_H
+
+#include <vector>
+#include <map>
+#include <string>
+#include <fstream>
+
+using namespace std;
+
+#include "bipartition.h"
+
+class Tree;
+class TreeNode;
+
+//Collects the nontrivial splits (bipartitions) of a set of trees, for example search replicates or
+//bootstrap replicates.  Each distinct split is stored once, standardized to contain taxon 1, and
+//looked up by its hash.  Each tree is kept as a sorted list of the indeces of its splits, which
+//allows Robinson-Foulds distances between any two trees to be calculated in linear time.
+class SplitTable{
+	vector<Bipartition> splits;
+	vector<unsigned> counts;
+	//hash of the split -> indeces of splits with that hash (almost always only one)
+	map<unsigned long long, vector<int> > index;
+	//sorted split indeces for each tree added
+	vector< vector<int> > treeSplits;
+
+	int FindOrAddSplit(const Bipartition &bip);
+	void AddSplitsInSubtree(const TreeNode *nd, vector<int> &ids);
+	void AppendConsensusClade(int clade, const vector< vector<int> > &childClades, const vector< vector<int> > &childTaxa, string &newick) const;
+
+public:
+	SplitTable() {}
+
+	void Clear();
+	//the tree's bipartitions will be recalculated (standardized) if necessary.  Returns the index of the tree
+	int AddTree(Tree *t);
+	//adds the trees in a nexus tree file written by the program itself (numerical taxa, one tree per line,
+	//such as the bootstrap tree file).  Returns the number added
+	int AddTreesFromFile(const char *filename);
+	int NumTrees() const {return (int) treeSplits.size();}
+	int NumSplits() const {return (int) splits.size();}
+
+	//the number of splits found in one tree or the other but not both
+	int RFDistance(int tree1, int tree2) const;
+	//fills a symmetric matrix of distances between all of the trees, in parallel if OpenMP is enabled
+	void PairwiseRFDistances(vector< vector<int> > &dists) const;
+
+	//table of all splits, most frequent first, with their counts and proportions
+	void WriteSplitFrequencies(ofstream &out) const;
+	//newick string (with numerical taxa) of the majority rule consensus of all trees added.
+	//Internal nodes are labeled with the percentage of trees containing that clade
+	void MajorityRuleConsensus(string &newick) const;
+	};
+
+#endif
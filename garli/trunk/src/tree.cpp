@@ -36,6 +36,8 @@ using namespace std;
 #include "tree.h"
 #include "reconnode.h"
 #include "garlireader.h"
+#include "checkpoint.h"
+#include "sitelikes.h"
 
 #include "utility.h"
 Profiler ProfIntInt   ("ClaIntInt     ");
@@ -45,6 +47,11 @@ Profiler ProfRescale  ("Rescale       ");
 Profiler ProfScoreInt ("ScoreInt      ");
 Profiler ProfScoreTerm("ScoreTerm     ");
 Profiler ProfEQVectors("EQVectors     ");
+ProfileCounter CountClaIntInt("ClaIntInt");
+ProfileCounter CountClaIntTerm("ClaIntTerm");
+ProfileCounter CountClaTermTerm("ClaTermTerm");
+ProfileCounter CountRescales("Rescales");
+ProfileCounter CountLnLEvals("LnLEvals");
 
 extern bool swapBasedTerm;
 
@@ -275,13 +282,20 @@ void Tree::SetTreeStatics(ClaManager *claMan, const DataPartition *data, const G
 //description, and reads and advances the string up to the next non-blen character.  The string that
 //was interpreted as the branch length is placed into the NxsString passed in
 double ReadBranchlength(const char *&s, NxsString &blen){
+	//the usual case of a plain number directly followed by the next token is converted in place
+	const char *end;
+	double len;
+	if(ParseDouble(s + 1, end, len) && (*end == ')' || *end == ',' || *end == ';' || *end == '\0')){
+		blen.assign(s + 1, end - (s + 1));
+		s = end;
+		return len;
+		}
 	blen = "";
 	while(*(s+1) && *(s+1)!=')'&& *(s+1)!=',' && *(s+1)!=';'){
 		blen += *(s+1);
 		s++;
 		}
 	s++;
-	double len;
 	if(NxsString::to_double(blen.c_str(), &len) == false)
 		throw ErrorException("Problem reading tree description.  Illegal branch-length specification: \"%s\"", blen.c_str());
 	return len;
@@ -399,17 +413,12 @@ Tree::Tree(const char* s, bool numericalTaxa, bool allowPolytomies /*=false*/, b
 				
 				//add an internal node with the nodenum specified in the string - this is my non-standard hack
 				if(term == false){
-					NxsString num;
-					num = *s;
-					while(isdigit(*(s+1))){
-						assert(*s);
-						num += *++s;
-						}
-					int internalnodeNum = atoi( num.c_str() );
+					//the digits were already counted above
+					int internalnodeNum = atoi(s);
 	                temp=temp->AddDes(allNodes[internalnodeNum]);
 	               	numBranchesAdded++;
 					numNodesAdded++;
-	                s++;							
+	                s += (i > 0 ? i : 1);
 					}
 				else{//add a terminal node
 					// read taxon name
@@ -417,11 +426,12 @@ Tree::Tree(const char* s, bool numericalTaxa, bool allowPolytomies /*=false*/, b
 					name = *s;
 					int taxonnodeNum;
 					if(numericalTaxa==true){
-						while(isdigit(*(s+1))){
-							assert(*s);
-							name += *++s;
-							}						
-						taxonnodeNum = atoi( name.c_str() );
+						//the number is read directly, and the name only kept for messages
+						const char *start = s;
+						taxonnodeNum = (isdigit(*s) ? *s - '0' : 0);
+						while(isdigit(*(s+1)))
+							taxonnodeNum = taxonnodeNum * 10 + (*++s - '0');
+						name.assign(start, s + 1 - start);
 						if(taxonnodeNum == 0) throw ErrorException("Unexpected character(s) found in tree description \"%s!\"", name.c_str());
 						if(taxonnodeNum > numTipsTotal) throw ErrorException("Taxon number in tree description (%d) is greater than\n\tnumber of taxa in dataset!", taxonnodeNum);
 						}
@@ -598,9 +608,14 @@ void Tree::AllocateTree(bool withExtraNode){
 
 	calcs=0;
 	sitelikeLevel = 0;
+	siteLikeCapture = NULL;
 	numBranchesAdded=0;
 	taxtags=new int[numTipsTotal+1];
 	bipartCond = DIRTY;
+	adjustedCut = adjustedBroken = -1;
+	adjustedFrom[0] = adjustedFrom[1] = NULL;
+	bipartHashValid = false;
+	constraintConflictsValid = false;
 
 #ifdef EQUIV_CALCS
 	//need to do the root too, since that node is sometimes stolen
@@ -619,16 +634,28 @@ void Tree::AssignDataToTips(){
 		for(int t=1;t<=dataPart->NTax();t++){
 			//if(isNucleotide){
 			if(modSpecSet.GetModSpec(claSpecs[c].modelIndex)->IsNucleotide()){
+				const NucleotideData *nuc = static_cast<const NucleotideData *>(curData);
+				if(nuc->HasPackedTips()){
+					allNodes[t]->tipData.push_back(NULL);
+					allNodes[t]->packedTipData.push_back(nuc->GetPackedTips(t-1));
+#ifdef OPEN_MP
+					//site i of packed tips is found directly, so no map is needed
+					allNodes[t]->ambigMap.push_back(NULL);
+#endif
+					continue;
+					}
 				//allNodes[t]->tipData=static_cast<const NucleotideData *>(curData)->GetAmbigString(t-1);
-				allNodes[t]->tipData.push_back(static_cast<const NucleotideData *>(curData)->GetAmbigString(t-1));
+				allNodes[t]->tipData.push_back(nuc->GetAmbigString(t-1));
+				allNodes[t]->packedTipData.push_back(NULL);
 #ifdef OPEN_MP
 				//allNodes[t]->ambigMap=static_cast<const NucleotideData *>(curData)->GetAmbigToCharMap(t-1);
-				allNodes[t]->ambigMap.push_back(static_cast<const NucleotideData *>(curData)->GetAmbigToCharMap(t-1));
+				allNodes[t]->ambigMap.push_back(nuc->GetAmbigToCharMap(t-1));
 #endif
 				}
 			else{
 				//allNodes[t]->tipData=(char *)(curData)->GetRow(t-1);
 				allNodes[t]->tipData.push_back((char *)(curData)->GetRow(t-1));
+				allNodes[t]->packedTipData.push_back(NULL);
 	#ifdef OPEN_MP
 				//even though there is no ambig map for non-nuc data, we need to put a dummy into the vector
 				//so that the data index matches up with the correct element in the vector
@@ -990,6 +1017,10 @@ void Tree::RandomlyAttachTipWithConstraints(int nodenum, int &placeInAllNodes, B
 		connector->dlen = (connector->dlen > min_brlen ? connector->dlen : min_brlen);
 		connector->left=connector->right=NULL;
 		connector->AddDes(nd);
+		//the connector isn't in the tree until a branch is chosen, and its anc may still point into whatever tree 
+		//the node was last used in.  Cut it loose, so that AdjustBipartsForSwap only adjusts the path from the 
+		//attachment point to the root, rather than the stale path above the connector
+		connector->anc=NULL;
 		
 		//select a branch to break with the connector
 		int k;
@@ -997,6 +1028,10 @@ void Tree::RandomlyAttachTipWithConstraints(int nodenum, int &placeInAllNodes, B
 		bool compat;
 		Bipartition proposed;
 		nd->CalcBipartition(false);
+		//the tree doesn't change until a valid branch is found, so the conflicts of its current bipartitions only need to
+		//be found once.  Nodes off of the path to the root from the broken branch will have the same bipartitions once
+		//the tip is added (the new taxon is outside of all of them), so only the path needs to be checked for each branch
+		CacheConstraintConflicts(mask);
 
 		do{
 			k = rnd.random_int( numBranchesAdded ) + 1;
@@ -1015,11 +1050,12 @@ void Tree::RandomlyAttachTipWithConstraints(int nodenum, int &placeInAllNodes, B
 				//if the taxon being added isn't in the backbone, it can go anywhere
 				if(((*conit).IsBackbone() == false) || (*conit).GetBackboneMask()->ContainsTaxon(nd->nodeNum)){
 					ReconNode broken(otherDes->nodeNum, 0, 0.0, false);
-					compat = SwapAllowedByConstraint((*conit), nd, &broken, proposed, mask);
+					compat = SwapAllowedByConstraint((*conit), nd, &broken, proposed, mask, (int) (conit - constraints.begin()));
 					if(compat == false) break;
 					}
 				}
 			}while(compat == false);
+		ClearConstraintConflicts();
 
 		// replace puts connection in the tree where otherDes had been
 		otherDes->SubstituteNodeWithRespectToAnc(connector);
@@ -1142,6 +1178,14 @@ void Tree::RecombineWith( Tree *t, bool sameModel, FLOAT_TYPE optPrecision ){
 
 TreeNode *Tree::ContainsBipartition(const Bipartition &bip){
 	//note that this doesn't work for terminals (but there's no reason to call for them anyway)
+
+	//if the bipartitions are standardized the hash table can be used rather than walking the tree
+	if(bipartCond == CLEAN_STANDARDIZED){
+		TreeNode *nd = FindBipartitionInHash(bip, false);
+		if(nd != NULL && nd->IsInternal()) return nd;
+		return NULL;
+		}
+
 	//find a taxon that appears "on" in the bipartition
 
 	//turning this back on
@@ -1167,45 +1211,11 @@ TreeNode *Tree::ContainsBipartitionOrComplement(const Bipartition &bip){
 	//NOTE: This requires that the bipartitions are "standardized" meaning that
 	//the one bit is always "on".  In general in other places we do not need that
 	//to be the case
-	if(bipartCond != CLEAN_STANDARDIZED){
-		if(bipartCond == CLEAN_UNSTANDARDIZED)
-			root->StandardizeBipartition();
-		else
-			CalcBipartitions(true);		
-		}
+	CalcBipartitions(true);
 
-	//find a taxon that appears "on" in the bipartition
-	int tax=bip.FirstPresentTaxon();
-	
-	//now start moving down the tree from that taxon until a bipart that
-	//conflicts or a match is found
-	//7/17/07 changing this to start from the trivial terminal branch, rather
-	//then its anc
-	TreeNode *nd=allNodes[tax];
-	while(nd->anc){
-		if(nd->bipart->IsASubsetOf(bip) == false) break;
-		else if(nd->bipart->EqualsEquals(bip)) return nd;
-		else nd=nd->anc;
-		}
-		
-	//find a taxon that is NOT "on" in the bipartition
-	tax=bip.FirstNonPresentTaxon();
-	
-	//now start moving down the tree from that taxon until a bipart that
-	//conflicts or a match is found
-	//7/17/07 changing this to start from the trivial terminal branch, rather
-	//then its anc
-	nd=allNodes[tax];
-	while(nd->anc){
-		//if(nd->bipart->ComplementIsASubsetOf(bip) == false){
-		if(bip.IsASubsetOf(*nd->bipart) == false){
-			return NULL;
-			}
-		else if(nd->bipart->EqualsEquals(bip)) return nd;
-		else nd=nd->anc;
-		}
-		
-	return NULL;
+	//this used to walk down the tree from a taxon in the bipartition and one not in it, comparing
+	//at each node.  The hash table makes it a constant time lookup
+	return FindBipartitionInHash(bip, true);
 	}
 
 TreeNode *Tree::ContainsMaskedBipartitionOrComplement(const Bipartition &bip, const Bipartition &mask){
@@ -1215,12 +1225,7 @@ TreeNode *Tree::ContainsMaskedBipartitionOrComplement(const Bipartition &bip, co
 	//NOTE: This requires that the bipartitions are "standardized" meaning that
 	//the one bit is always "on".  In general in other places we do not want that
 	//to be the case
-	if(bipartCond != CLEAN_STANDARDIZED){
-		if(bipartCond == CLEAN_UNSTANDARDIZED)
-			root->StandardizeBipartition();
-		else
-			CalcBipartitions(true);		
-		}
+	CalcBipartitions(true);
 
 	//find a taxon that appears "on" in the bipartition and is on in the mask
 	Bipartition temp = bip;
@@ -1329,12 +1334,7 @@ bool Tree::IdenticalTopology(const TreeNode *other){
 	//NOTE: This requires that the bipartitions are "standardized" meaning that
 	//the one bit is always "on".  In general in other places we do not need that
 	//to be the case
-	if(bipartCond != CLEAN_STANDARDIZED){
-		if(bipartCond == CLEAN_UNSTANDARDIZED)
-			root->StandardizeBipartition();
-		else
-			CalcBipartitions(true);		
-		}
+	CalcBipartitions(true);
 	
 	if(other->IsRoot() == false){
 		if(other->IsTerminal()) return true;
@@ -1367,12 +1367,7 @@ bool Tree::IdenticalTopologyAllowingRerooting(const TreeNode *other){
 	//NOTE: This requires that the bipartitions are "standardized" meaning that
 	//the one bit is always "on".  In general in other places we do not need that
 	//to be the case
-	if(bipartCond != CLEAN_STANDARDIZED){
-		if(bipartCond == CLEAN_UNSTANDARDIZED)
-			root->StandardizeBipartition();
-		else
-			CalcBipartitions(true);		
-		}
+	CalcBipartitions(true);
 
 	if(other->IsTerminal()) return true;
 	if(other->IsRoot() == false)
@@ -1475,6 +1470,16 @@ int Tree::BipartitionBasedRecombination( Tree *t, bool sameModel, FLOAT_TYPE opt
 		MimicTopo(fromnode, 1, sameModel);
 		if(sameModel==true) CopyClaIndecesInSubtree(fromnode, true);
 		else DirtyNodesInSubtree(tonode);
+
+		//the subtree has the same bipartition as the one it replaced, so nothing outside of it has changed and
+		//the (standardized) bipartitions within it are the same as in the source tree
+		if(t->bipartCond == CLEAN_STANDARDIZED){
+			CopyBipartsInSubtree(fromnode);
+			bipartCond = CLEAN_STANDARDIZED;
+			bipartHashValid = false;
+			}
+		else
+			bipartCond = DIRTY;
 		
 		//try branch length optimization of tonode's branch, to make sure it fits in it's new tree background 
 		SweepDirtynessOverTree(tonode);
@@ -1482,7 +1487,6 @@ int Tree::BipartitionBasedRecombination( Tree *t, bool sameModel, FLOAT_TYPE opt
 		OptimizeBranchesWithinRadius(tonode, optPrecision, 0, NULL);
 
 		Score(tonode->nodeNum);
-		bipartCond = DIRTY;
 		}
 	else return -1;
 	return 1;
@@ -1532,12 +1536,7 @@ void Tree::DeterministicSwapperByCut(Individual *source, double optPrecision, in
 		sprintf(str, "determCut%d.%f.log", range, optPrecision);
 	FILE *log = fopen(str, "w");
 	
-	//allocate a treeString
-	double taxsize=log10((double) ((double)dataPart->NTax())*dataPart->NTax()*2);
-	int stringSize=(int)((dataPart->NTax()*2)*(10+DEF_PRECISION));
-	char *treeString=new char[stringSize];
-	stringSize--;
-	treeString[stringSize]='\0';
+	NewickBuffer treeString;
 	bool newBest=false;
 	attemptedSwaps.ClearAttemptedSwaps();
 	
@@ -1614,7 +1613,6 @@ void Tree::DeterministicSwapperByCut(Individual *source, double optPrecision, in
 
 	better << "end;";
 	better.close();
-	delete []treeString;
 	fclose(log);
 
 	tempIndiv.treeStruct->RemoveTreeFromAllClas();
@@ -1669,12 +1667,7 @@ void Tree::DeterministicSwapperByDist(Individual *source, double optPrecision, i
 		sprintf(str, "determDist%d.%f.log", range, optPrecision);
 	FILE *log = fopen(str, "w");
 	
-	//allocate a treeString
-	double taxsize=log10((double) ((double)dataPart->NTax())*dataPart->NTax()*2);
-	int stringSize=(int)((dataPart->NTax()*2)*(10+DEF_PRECISION));
-	char *treeString=new char[stringSize];
-	stringSize--;
-	treeString[stringSize]='\0';
+	NewickBuffer treeString;
 	bool newBest=false;
 	attemptedSwaps.ClearAttemptedSwaps();
 	int startC, c=1;
@@ -1758,7 +1751,6 @@ void Tree::DeterministicSwapperByDist(Individual *source, double optPrecision, i
 
 	better << "end;";
 	better.close();
-	delete []treeString;
 	fclose(log);
 
 	tempIndiv.treeStruct->RemoveTreeFromAllClas();
@@ -1826,12 +1818,7 @@ void Tree::DeterministicSwapperRandom(Individual *source, double optPrecision, i
 	sprintf(str, "determRand%d.%f.log", range, optPrecision);
 	FILE *log = fopen(str, "w");
 
-	//allocate a treeString
-	double taxsize=log10((double) ((double)dataPart->NTax())*dataPart->NTax()*2);
-	int stringSize=(int)((dataPart->NTax()*2)*(10+DEF_PRECISION));
-	char *treeString=new char[stringSize];
-	stringSize--;
-	treeString[stringSize]='\0';
+	NewickBuffer treeString;
 	bool newBest=false;
 	attemptedSwaps.ClearAttemptedSwaps();
 	int c=1;
@@ -1917,7 +1904,6 @@ void Tree::DeterministicSwapperRandom(Individual *source, double optPrecision, i
 
 					better << "end;";
 					better.close();
-					delete []treeString;
 					fclose(log);
 
 					tempIndiv.treeStruct->RemoveTreeFromAllClas();
@@ -2015,12 +2001,7 @@ void Tree::GenerateTopologiesAtSprDistance(Individual *source, double optPrecisi
 	sprintf(str, "allswaps.SPR%d.log", range);
 	FILE *log = fopen(str, "w");
 
-	//allocate a treeString
-	double taxsize=log10((double) ((double)dataPart->NTax())*dataPart->NTax()*2);
-	int stringSize=(int)((dataPart->NTax()*2)*(10+DEF_PRECISION));
-	char *treeString=new char[stringSize];
-	stringSize--;
-	treeString[stringSize]='\0';
+	NewickBuffer treeString;
 	//bool newBest=false;
 
 	int acceptedSwaps = 0;
@@ -2296,6 +2277,7 @@ void Tree::GatherValidReconnectionNodes(int maxDist, TreeNode *cut, const TreeNo
 			}
 		if(!bypass && sprRang.size() != 0){
 			Bipartition proposed;
+			CacheConstraintConflicts(partialMask);
 			listIt it=sprRang.begin();
 			do{
 				TreeNode* broken=allNodes[it->nodeNum];
@@ -2312,7 +2294,7 @@ void Tree::GatherValidReconnectionNodes(int maxDist, TreeNode *cut, const TreeNo
 
 				for(vector<Constraint>::iterator conit=constraints.begin();conit!=constraints.end();conit++){
 //					calls++;
-					allowed = SwapAllowedByConstraint((*conit), cut, &*it, proposed, partialMask); 
+					allowed = SwapAllowedByConstraint((*conit), cut, &*it, proposed, partialMask, (int) (conit - constraints.begin())); 
 					if(!allowed) break;
 					}
 //				if(allowed) ok++;
@@ -2320,6 +2302,9 @@ void Tree::GatherValidReconnectionNodes(int maxDist, TreeNode *cut, const TreeNo
 				if(!allowed) it=sprRang.RemoveElement(it);
 				else it++;
 				}while(it != sprRang.end());
+			ClearConstraintConflicts();
+			//undo the last adjustment, so that the swap about to be done can update the bipartitions incrementally
+			CalcBipartitions(true);
 			}
 /*		if(bypass)
 			outman.UserMessage("%d max range, %d attach, %d calls, %d ok, %d bad, BYPASSED", maxDist, attach, calls, ok, bad);
@@ -2672,7 +2657,9 @@ int Tree::SPRMutate(int cutnum, ReconNode *broke, FLOAT_TYPE optPrecision, int s
 		else 
 			OptimizeBranchesWithinRadius(connector, optPrecision, subtreeNode, NULL);
 		}
-	bipartCond = DIRTY;
+	//sib has taken the place of the connector (or is attached to the root or subtreeNode), so its anc is
+	//where cut used to be
+	UpdateBipartsForSwap(cut, sib->anc);
 
 //#ifdef EXTRA_ROOT_OPT
 	if(createTopologyOnly == false && cut == dummyRoot){
@@ -2995,16 +2982,149 @@ void Tree::LoadConstraints(ifstream &con, int nTaxa){
 void Tree::AdjustBipartsForSwap(int cut, int broken){
 	//first be sure the biparts are current
 	CalcBipartitions(true);
-	if(allNodes[cut]->anc->IsNotRoot()) allNodes[cut]->anc->RecursivelyAddOrRemoveSubtreeFromBipartitions(*(allNodes[cut]->bipart));
-	if(allNodes[broken]->anc->IsNotRoot()) allNodes[broken]->anc->RecursivelyAddOrRemoveSubtreeFromBipartitions(*(allNodes[cut]->bipart));
+	//remember where the flipping actually started, which is what AdjustedSwapAllowedByCachedConstraint needs
+	adjustedFrom[0] = adjustedFrom[1] = NULL;
+	if(allNodes[cut]->anc->IsNotRoot()){
+		adjustedFrom[0] = allNodes[cut]->anc;
+		adjustedFrom[0]->RecursivelyAddOrRemoveSubtreeFromBipartitions(*(allNodes[cut]->bipart));
+		}
+	if(allNodes[broken]->anc->IsNotRoot()){
+		adjustedFrom[1] = allNodes[broken]->anc;
+		adjustedFrom[1]->RecursivelyAddOrRemoveSubtreeFromBipartitions(*(allNodes[cut]->bipart));
+		}
+	adjustedCut = cut;
+	adjustedBroken = broken;
 	bipartCond = TEMP_ADJUSTED;
 	}
 
+//the bit flipping done by AdjustBipartsForSwap is its own inverse, so as long as the topology hasn't
+//changed in the meantime doing it again restores the real standardized bipartitions.  This only touches
+//the nodes on the paths to the root rather than the whole tree.
+void Tree::UndoAdjustBipartsForSwap(){
+	assert(bipartCond == TEMP_ADJUSTED);
+	assert(adjustedCut > 0 && adjustedBroken > 0);
+	for(int p = 0;p < 2;p++)
+		if(adjustedFrom[p] != NULL) adjustedFrom[p]->RecursivelyAddOrRemoveSubtreeFromBipartitions(*(allNodes[adjustedCut]->bipart));
+	adjustedCut = adjustedBroken = -1;
+	adjustedFrom[0] = adjustedFrom[1] = NULL;
+	bipartCond = CLEAN_STANDARDIZED;
+	}
+
+//Called after an SPR or NNI has actually been done, with cut now attached to its new connector (cut->anc) and 
+//oldAnc being the node that cut's old connector used to hang from.  If the bipartitions were clean before the 
+//swap they are brought up to date by only visiting the nodes on the path between the old and new attachment points.
+//Each of those either gained or lost the cut taxa, which is just a flip of those bits.  Nodes below the point where 
+//the two paths meet are unaffected.  This works for standardized bipartitions too, since flipping a complemented 
+//bipartition gives the complement of the flipped one, which Standardize fixes.
+void Tree::UpdateBipartsForSwap(TreeNode *cut, TreeNode *oldAnc){
+	if(bipartCond != CLEAN_STANDARDIZED && bipartCond != CLEAN_UNSTANDARDIZED){
+		bipartCond = DIRTY;
+		return;
+		}
+	bool standardized = (bipartCond == CLEAN_STANDARDIZED);
+	TreeNode *connector = cut->anc;
+	bipartHashValid = false;
+
+	TreeNode *a = oldAnc;
+	TreeNode *b = connector->anc;
+	int depthA = NodesToRoot(a);
+	int depthB = NodesToRoot(b);
+	while(a != b){
+		if(depthA >= depthB){
+			//the connector can fall on this path if cut was moved onto its old ancestor's branch.  
+			//It is filled in below from its children
+			if(a != connector){
+				a->bipart->EqualsXOR(*cut->bipart);
+				if(standardized) a->bipart->Standardize();
+				}
+			a = a->anc;
+			depthA--;
+			}
+		else{
+			b->bipart->EqualsXOR(*cut->bipart);
+			if(standardized) b->bipart->Standardize();
+			b = b->anc;
+			depthB--;
+			}
+		}
+
+	//cut and its new sister are disjoint, so the XOR of the two is their union (or the complement
+	//of it if they were standardized, which Standardize takes care of)
+	TreeNode *sister = (connector->left == cut ? connector->right : connector->left);
+	*connector->bipart = *cut->bipart;
+	connector->bipart->EqualsXOR(*sister->bipart);
+	if(standardized) connector->bipart->Standardize();
+	}
+
+//after BipartitionBasedRecombination copies a subtree with a matching bipartition from another
+//tree the bipartitions within the subtree can just be copied over too, since the nodeNums match.
+//The bipartitions of both trees must be in the same condition.
+void Tree::CopyBipartsInSubtree(const TreeNode *from){
+	*allNodes[from->nodeNum]->bipart = *from->bipart;
+	if(from->left->IsInternal()) CopyBipartsInSubtree(from->left);
+	if(from->right->IsInternal()) CopyBipartsInSubtree(from->right);
+	}
+
+//fill the bipartition hash table from the current (standardized) bipartitions.  The table is at least twice
+//the number of nodes, so probe sequences are short.  The root isn't included, since its bipartition is trivial.
+void Tree::BuildBipartitionHash(){
+	assert(bipartCond == CLEAN_STANDARDIZED);
+	unsigned size = 1;
+	while(size < 2 * (unsigned) numNodesTotal) size <<= 1;
+	bipartHashNodes.assign(size, -1);
+	bipartHashKeys.assign(size, 0);
+
+	TreeNode *nd = root->left;
+	while(nd != NULL){
+		AddSubtreeToBipartitionHash(nd);
+		nd = nd->next;
+		}
+	bipartHashValid = true;
+	}
+
+void Tree::AddSubtreeToBipartitionHash(TreeNode *nd){
+	unsigned mask = (unsigned) bipartHashNodes.size() - 1;
+	unsigned long long key = nd->bipart->ComplementNormalizedHash();
+	unsigned slot = (unsigned) key & mask;
+	while(bipartHashNodes[slot] != -1)
+		slot = (slot + 1) & mask;
+	bipartHashNodes[slot] = nd->nodeNum;
+	bipartHashKeys[slot] = key;
+
+	TreeNode *des = nd->left;
+	while(des != NULL){
+		AddSubtreeToBipartitionHash(des);
+		des = des->next;
+		}
+	}
+
+//returns the node with the bipartition or its complement, or NULL if it isn't in the tree.  
+//The bipartitions must be standardized.
+//the key is the same for a bipartition and its complement, so unless orComplement is true a node is only
+//returned if its bipartition is in the same orientation as bip
+TreeNode *Tree::FindBipartitionInHash(const Bipartition &bip, bool orComplement){
+	assert(bipartCond == CLEAN_STANDARDIZED);
+	if(bipartHashValid == false) BuildBipartitionHash();
+
+	unsigned mask = (unsigned) bipartHashNodes.size() - 1;
+	unsigned long long key = bip.ComplementNormalizedHash();
+	unsigned slot = (unsigned) key & mask;
+	while(bipartHashNodes[slot] != -1){
+		if(bipartHashKeys[slot] == key){
+			TreeNode *nd = allNodes[bipartHashNodes[slot]];
+			if(nd->bipart->EqualsEquals(bip) || (orComplement && nd->bipart->ComplementEqualsEquals(bip)))
+				return nd;
+			}
+		slot = (slot + 1) & mask;
+		}
+	return NULL;
+	}
+
 //test whether the attachment of branch "cut" (subtree or tip) to branch "broken" (subtree or tip) is allowed by
 //any constraints.  The general purpose Constraint::BipartitionIsCompatibleWithConstraint function (which takes care of
 //positive and negative constraints, backbone or not) is called to check if the bipartition created by the union
 //of cut and broken is itself allowable.  Depending on the type of constraint, other checks may also need to be done.
-bool Tree::SwapAllowedByConstraint(const Constraint &constr, TreeNode *cut, ReconNode *broken, const Bipartition &proposed, const Bipartition *partialMask) {
+bool Tree::SwapAllowedByConstraint(const Constraint &constr, TreeNode *cut, ReconNode *broken, const Bipartition &proposed, const Bipartition *partialMask, int conNum /*=-1*/) {
 	//for a normal positive constraint with no mask we only need to check the bipartition about to be created
 	if(constr.IsPositive() && !constr.IsBackbone() && partialMask==NULL)
 		return constr.BipartitionIsCompatibleWithConstraint(proposed, NULL);
@@ -3029,7 +3149,11 @@ bool Tree::SwapAllowedByConstraint(const Constraint &constr, TreeNode *cut, Reco
 			//that really only requires a single adjustment
 			//AdjustBipartsForSwap(cut->nodeNum, broken->nodeNum);
 			
-			compat = RecursiveAllowedByConstraintWithMask(constr, &jointMask, root);
+			//if the conflicts of the unadjusted tree were cached by the caller, only the adjusted nodes need to be checked
+			if(conNum >= 0 && constraintConflictsValid && bipartCond == TEMP_ADJUSTED)
+				compat = AdjustedSwapAllowedByCachedConstraint(constr, conNum, &jointMask);
+			else
+				compat = RecursiveAllowedByConstraintWithMask(constr, &jointMask, root);
 			}
 		else{
 			Tree propTree;
@@ -3126,6 +3250,77 @@ bool Tree::RecursiveAllowedByConstraintWithMask(const Constraint &constr, const
 	return compat;
 	}
 
+//like RecursiveAllowedByConstraintWithMask, but visits the whole tree and turns on the bit of each node that conflicts
+void Tree::RecursiveMarkConstraintConflicts(const Constraint &constr, const Bipartition *jointMask, const TreeNode *nd, vector<BipartBlock> &conflicts){
+	if(nd->IsNotRoot())
+		if(constr.BipartitionIsCompatibleWithConstraint(*nd->bipart, jointMask) == false)
+			conflicts[nd->nodeNum / Bipartition::blockBits] |= ((BipartBlock) 1 << (nd->nodeNum % Bipartition::blockBits));
+
+	TreeNode *des = nd->left;
+	while(des != NULL){
+		if(des->IsInternal()) RecursiveMarkConstraintConflicts(constr, jointMask, des, conflicts);
+		des = des->next;
+		}
+	}
+
+//Checking whether a swap is allowed by a constraint generally means checking every bipartition in the tree after the
+//swap.  But AdjustBipartsForSwap only changes the bipartitions on the paths from the cut and broken nodes to the root, 
+//so if many swaps are to be checked against the same tree (and same mask) the conflicts of the unadjusted bipartitions 
+//can be found once here.  AdjustedSwapAllowedByCachedConstraint then only needs to check the adjusted nodes, plus a 
+//few bitwise ops to see whether anything else conflicts.  Must be cleared with ClearConstraintConflicts when the tree
+//or mask change.
+void Tree::CacheConstraintConflicts(const Bipartition *partialMask){
+	CalcBipartitions(true);
+	int nWords = (numNodesTotal + Bipartition::blockBits - 1) / Bipartition::blockBits;
+	constraintConflicts.resize(constraints.size());
+	swapAdjustedNodes.assign(nWords, 0);
+	Bipartition jointMask;
+	for(unsigned c = 0;c < constraints.size();c++){
+		constraintConflicts[c].assign(nWords, 0);
+		//if there isn't a meaningful intersection the whole tree is compatible, and the cache won't be used anyway
+		if(jointMask.MakeJointMask(constraints[c], partialMask))
+			RecursiveMarkConstraintConflicts(constraints[c], &jointMask, root, constraintConflicts[c]);
+		}
+	constraintConflictsValid = true;
+	}
+
+//The bipartitions must currently be adjusted by AdjustBipartsForSwap, and the cache filled by CacheConstraintConflicts before the 
+//adjustment.  Only the paths that were really flipped are visited, starting from the nodes recorded by the adjustment (nothing 
+//for a tip that isn't attached yet).  Nodes on both paths to the root were flipped twice and are unchanged.
+bool Tree::AdjustedSwapAllowedByCachedConstraint(const Constraint &constr, int conNum, const Bipartition *jointMask){
+	assert(constraintConflictsValid && bipartCond == TEMP_ADJUSTED);
+	const vector<BipartBlock> &conflicts = constraintConflicts[conNum];
+	
+	//mark the nodes whose bipartitions were actually changed by the adjustment
+	TreeNode *adjustedPaths[2] = {adjustedFrom[0], adjustedFrom[1]};
+	for(int p = 0;p < 2;p++){
+		for(TreeNode *nd = adjustedPaths[p];nd != NULL && nd->IsNotRoot();nd = nd->anc)
+			swapAdjustedNodes[nd->nodeNum / Bipartition::blockBits] ^= ((BipartBlock) 1 << (nd->nodeNum % Bipartition::blockBits));
+		}
+
+	//any conflict at an unchanged node will still be there after the swap
+	bool compat = true;
+	for(unsigned w = 0;w < conflicts.size();w++){
+		if(conflicts[w] & ~swapAdjustedNodes[w]){
+			compat = false;
+			break;
+			}
+		}
+
+	//check the adjusted nodes, clearing the marks as we go
+	for(int p = 0;p < 2;p++){
+		for(TreeNode *nd = adjustedPaths[p];nd != NULL && nd->IsNotRoot();nd = nd->anc){
+			BipartBlock bit = ((BipartBlock) 1 << (nd->nodeNum % Bipartition::blockBits));
+			BipartBlock &word = swapAdjustedNodes[nd->nodeNum / Bipartition::blockBits];
+			if(word & bit){
+				if(compat) compat = constr.BipartitionIsCompatibleWithConstraint(*nd->bipart, jointMask);
+				word &= ~bit;
+				}
+			}
+		}
+	return compat;
+	}
+
 //DJZ 8-11-04  This version is only for the master doing SPRs on nodes that aren't in a subtree when subtree
 //mode is on.  Basically the only difference is that if the ancestor of the cut node is the root, we need to 
 //choose one of the other nonSubtree nodes to make a connector to avoid screwing up the subtree partitioning
@@ -3262,7 +3457,16 @@ void Tree::MimicTopo(const Tree *source){
 	numNodesAdded=source->numNodesAdded;
 	numTipsAdded=source->numTipsAdded;
 	numBranchesAdded=source->numBranchesAdded;
-	bipartCond = DIRTY;
+
+	//if the source's bipartitions are current just copy them, since they match node for node
+	if(source->bipartCond == CLEAN_STANDARDIZED || source->bipartCond == CLEAN_UNSTANDARDIZED){
+		for(int i=0;i<numNodesTotal;i++)
+			*allNodes[i]->bipart = *allNs[i]->bipart;
+		bipartCond = source->bipartCond;
+		bipartHashValid = false;
+		}
+	else
+		bipartCond = DIRTY;
 	}
 
 //this version is used for just copying a subtree,
@@ -3802,6 +4006,7 @@ void Tree::GetTotalScore(CondLikeArraySet *partialCLAset, CondLikeArraySet *chil
 	CondLikeArray *partialCLA=NULL, *childCLA=NULL;
 	FLOAT_TYPE modlnL;
 	lnL = ZERO_POINT_ZERO;
+	CountLnLEvals.Add();
 
 	//NOTE: for sitelike output the caller should already have set the sitelike mode on the tree and prepared
 	//the sitelike output file (ofprefix + ".sitelikes.log"), adding a header or clearing it out first.  The sitelike
@@ -3833,7 +4038,9 @@ void Tree::GetTotalScore(CondLikeArraySet *partialCLAset, CondLikeArraySet *chil
 			}	
 		else{
 			ProfScoreTerm.Start();
-			if(isNucleotide)
+			if(isNucleotide && child->packedTipData[(*specs).dataIndex] != NULL)
+				modlnL = GetScorePartialTerminalPacked(partialCLA, &Lprmat[0], child->packedTipData[(*specs).dataIndex], (*specs).modelIndex, (*specs).dataIndex);
+			else if(isNucleotide)
 				modlnL = GetScorePartialTerminalRateHet(partialCLA, &Lprmat[0], child->tipData[(*specs).dataIndex], (*specs).modelIndex, (*specs).dataIndex);
 			else if(mod->IsOrientedGap()){
 				modlnL = GetScorePartialTerminalOrientedGap(partialCLA, &Lprmat[0], child->tipData[(*specs).dataIndex], (*specs).modelIndex, (*specs).dataIndex);
@@ -3879,6 +4086,9 @@ int Tree::FillStatewiseUnscaledPosteriors(CondLikeArraySet *partialCLAset, CondL
 		if(childCLA!=NULL){//if child is internal
 			GetStatewiseUnscaledPosteriorsPartialInternalNState(destCLA, partialCLA, childCLA, &Lprmat[0], (*specs).modelIndex, (*specs).dataIndex);
 			}	
+		else if(child->packedTipData[(*specs).dataIndex] != NULL){
+			GetStatewiseUnscaledPosteriorsPartialTerminalPacked(destCLA, partialCLA, &Lprmat[0], child->packedTipData[(*specs).dataIndex], (*specs).modelIndex, (*specs).dataIndex);
+			}
 		else{
 			GetStatewiseUnscaledPosteriorsPartialTerminalNState(destCLA, partialCLA, &Lprmat[0], child->tipData[(*specs).dataIndex], (*specs).modelIndex, (*specs).dataIndex);
 			}
@@ -3906,6 +4116,7 @@ void Tree::UpdateCLAs(CondLikeArraySet *destCLAset, CondLikeArraySet *firstCLAse
 		if(firstCLAset!=NULL && secCLAset!=NULL){
 			//two internal children
 			ProfIntInt.Start();
+			CountClaIntInt.Add();
 
 			if(isNucleotide)
 				CalcFullCLAInternalInternal(destCLA, firstCLA, secCLA, &Lprmat[0], &Rprmat[0], (*specs).modelIndex, (*specs).dataIndex);
@@ -3920,7 +4131,11 @@ void Tree::UpdateCLAs(CondLikeArraySet *destCLAset, CondLikeArraySet *firstCLAse
 		else if(firstCLAset==NULL && secCLAset==NULL){
 			//two terminal children
 			ProfTermTerm.Start();
-			if(isNucleotide)
+			CountClaTermTerm.Add();
+			//tips of a subset are either all packed or all not
+			if(isNucleotide && firstChild->packedTipData[(*specs).dataIndex] != NULL)
+				CalcFullCLATerminalTerminalPacked(destCLA, &Lprmat[0], &Rprmat[0], firstChild->packedTipData[(*specs).dataIndex], secChild->packedTipData[(*specs).dataIndex], (*specs).modelIndex, (*specs).dataIndex);
+			else if(isNucleotide)
 				CalcFullCLATerminalTerminal(destCLA, &Lprmat[0], &Rprmat[0], firstChild->tipData[(*specs).dataIndex], secChild->tipData[(*specs).dataIndex], (*specs).modelIndex, (*specs).dataIndex);
 			else if(mod->IsOrientedGap())
 				CalcFullCLAOrientedGap(destCLA, &Lprmat[0], &Rprmat[0], NULL, NULL, firstChild->tipData[(*specs).dataIndex], secChild->tipData[(*specs).dataIndex], (*specs).modelIndex, (*specs).dataIndex);
@@ -3932,6 +4147,7 @@ void Tree::UpdateCLAs(CondLikeArraySet *destCLAset, CondLikeArraySet *firstCLAse
 		else{
 			//one terminal, one internal
 			ProfIntTerm.Start();
+			CountClaIntTerm.Add();
 
 			if(isNucleotide == false){
 				if(mod->IsOrientedGap()){
@@ -3947,6 +4163,12 @@ void Tree::UpdateCLAs(CondLikeArraySet *destCLAset, CondLikeArraySet *firstCLAse
 						CalcFullCLAInternalTerminalNState(destCLA, firstCLA, &Lprmat[0], &Rprmat[0], secChild->tipData[(*specs).dataIndex], (*specs).modelIndex, (*specs).dataIndex);
 					}
 				}
+			else if((firstCLA==NULL ? firstChild : secChild)->packedTipData[(*specs).dataIndex] != NULL){
+				if(firstCLA==NULL)
+					CalcFullCLAInternalTerminalPacked(destCLA, secCLA, &Rprmat[0], &Lprmat[0], firstChild->packedTipData[(*specs).dataIndex], (*specs).modelIndex, (*specs).dataIndex);
+				else
+					CalcFullCLAInternalTerminalPacked(destCLA, firstCLA, &Lprmat[0], &Rprmat[0], secChild->packedTipData[(*specs).dataIndex], (*specs).modelIndex, (*specs).dataIndex);
+				}
 			else{
 	#ifdef OPEN_MP
 				if(firstCLA==NULL){
@@ -3974,11 +4196,18 @@ void Tree::UpdateCLAs(CondLikeArraySet *destCLAset, CondLikeArraySet *firstCLAse
 			}
 		if(destCLA->rescaleRank >= rescaleEvery){
 			ProfRescale.Start();
-			if(isNucleotide)
-				RescaleRateHet(destCLA, (*specs).dataIndex);
-			else
-				RescaleRateHetNState(destCLA, (*specs).dataIndex);
-
+			CountRescales.Add();
+			try{
+				if(isNucleotide)
+					RescaleRateHet(destCLA, (*specs).dataIndex);
+				else
+					RescaleRateHetNState(destCLA, (*specs).dataIndex);
+				}
+			catch(int){
+				//the rescaling frequency is being changed and the scoring redone, so the profiler needs to be stopped
+				ProfRescale.Stop();
+				throw;
+				}
 			ProfRescale.Stop();
 			}
 		}
@@ -4465,6 +4694,9 @@ void Tree::SwapAndFreeNodes(TreeNode *cop){
 	}
 
 void Tree::CalcBipartitions(bool standardize){
+	if(bipartCond == TEMP_ADJUSTED)
+		UndoAdjustBipartsForSwap();
+
 	if(!(bipartCond == CLEAN_STANDARDIZED && standardize == true) &&
 		!(bipartCond == CLEAN_UNSTANDARDIZED && standardize == false)){
 
@@ -4474,6 +4706,7 @@ void Tree::CalcBipartitions(bool standardize){
 			root->CalcBipartition(standardize);
 		if(standardize)	bipartCond = CLEAN_STANDARDIZED;
 		else bipartCond = CLEAN_UNSTANDARDIZED;
+		bipartHashValid = false;
 		}
 //	root->VerifyBipartition(standardize);
 	}
@@ -4696,7 +4929,12 @@ void Tree::RerootHere(int newroot){
 
 	//this is necessary to properly dirty clas
 	TreeNode *lastOnPath=nroot;
-	while(lastOnPath->anc != root) lastOnPath = lastOnPath->anc;
+	vector<TreeNode *> path;
+	path.push_back(lastOnPath);
+	while(lastOnPath->anc != root){
+		lastOnPath = lastOnPath->anc;
+		path.push_back(lastOnPath);
+		}
 	SweepDirtynessOverTree(lastOnPath);
 
 	//first trace down to the old root and fix all the blens
@@ -4785,8 +5023,25 @@ void Tree::RerootHere(int newroot){
 	
 	SwapNodeDataForReroot(nroot);
 
+	//Rerooting doesn't change the bipartitions in the tree, but the branches along the path have shifted by
+	//one node, in the same way that the blens were flipped above.  The nroot node is now where the old root
+	//was and gets the bipartition of the last node on the path.  Unstandardized bipartitions are also 
+	//now oriented the other way, so they need to be complemented.
+	if(bipartCond == CLEAN_STANDARDIZED || bipartCond == CLEAN_UNSTANDARDIZED){
+		Bipartition *last = path.back()->bipart;
+		for(int p = (int) path.size() - 1;p > 0;p--)
+			path[p]->bipart = path[p - 1]->bipart;
+		path[0]->bipart = last;
+		if(bipartCond == CLEAN_UNSTANDARDIZED){
+			for(vector<TreeNode *>::iterator it = path.begin();it != path.end();it++)
+				(*it)->bipart->Complement();
+			}
+		bipartHashValid = false;
+		}
+	else
+		bipartCond = DIRTY;
+
 	root->CheckTreeFormation();
-	bipartCond = DIRTY;
 //	MakeAllNodesDirty();
 //	Score();
 	}
@@ -5241,6 +5496,17 @@ void Tree::OutputSiteLikelihoods(int partNum, vector<FLOAT_TYPE> &likes, const i
 	const SequenceData *data = dataPart->GetSubset(partNum);
 
 	assert(sitelikeLevel != 0);
+	if(siteLikeCapture != NULL){
+		if((int) siteLikeCapture->size() <= partNum)
+			siteLikeCapture->resize(partNum + 1);
+		(*siteLikeCapture)[partNum] = likes;
+		return;
+		}
+	//binary output, which the population has already started
+	if(siteLikeOut.IsOpen()){
+		siteLikeOut.WriteSubset(partNum, likes, under1, under2);
+		return;
+		}
 	//a negative sitelike level means append, but the absolute value meanings are the same
 	bool append = sitelikeLevel < 0;
 	int effectiveSitelikeLevel = abs(sitelikeLevel);
@@ -5906,6 +6172,129 @@ FLOAT_TYPE Tree::GetScorePartialTerminalRateHet(const CondLikeArray *partialCLA,
 	return totallnL;
 	}
 	
+//Fills the lookup table used by the kernels for packed nucleotide tips (see NucleotideData::MakePackedTips)
+//from a pmat or derivative matrix.  Entry (code*nRateCats + r)*4 + from is the sum of mat[16*r + 4*from + to]
+//over the states "to" in the 4 bit code, so any site of a packed tip takes a single lookup and no branching.
+//Missing data (and code 0, which is stored as 15) get ambigValue, which is 1 for a pmat and 0 for derivatives
+void Tree::FillPackedTipTable(const FLOAT_TYPE *mat, int nRateCats, FLOAT_TYPE ambigValue, FLOAT_TYPE *table){
+	for(int code=0;code<16;code++){
+		for(int r=0;r<nRateCats;r++){
+			for(int from=0;from<4;from++){
+				FLOAT_TYPE sum = ZERO_POINT_ZERO;
+				if(code == 0 || code == 15)
+					sum = ambigValue;
+				else{
+					//summed in increasing state order, as the ambiguity strings are
+					for(int to=0;to<4;to++)
+						if(code & (1 << to)) sum += mat[16*r + 4*from + to];
+					}
+				table[(code*nRateCats + r)*4 + from] = sum;
+				}
+			}
+		}
+	}
+
+//the same as GetScorePartialTerminalRateHet, but for a tip with packed data
+FLOAT_TYPE Tree::GetScorePartialTerminalPacked(const CondLikeArray *partialCLA, const FLOAT_TYPE *prmat, const unsigned char *Ldata, int modIndex, int dataIndex){
+	const FLOAT_TYPE *partial=partialCLA->arr;
+	const int *underflow_mult=partialCLA->underflow_mult;
+	const SequenceData *data = dataPart->GetSubset(dataIndex);
+	Model *mod = modPart->GetModel(modIndex);
+	const int nRateCats=mod->NRateCats();
+	const int stride=4*nRateCats;
+
+	const int nchar=data->NChar();
+
+	const int *countit=data->GetCounts();
+	
+	const FLOAT_TYPE *rateProb=mod->GetRateProbs();
+
+	const int lastConst=data->LastConstant();
+	const int *conBases=data->GetConstStates();
+	const FLOAT_TYPE prI=mod->PropInvar();
+
+	FLOAT_TYPE freqs[4];
+	for(int i=0;i<4;i++) 
+		freqs[i]=mod->StateFreq(i);
+
+	FLOAT_TYPE *table = mod->PackedTipTables();
+	FillPackedTipTable(prmat, nRateCats, ONE_POINT_ZERO, table);
+
+#ifdef UNIX
+	posix_madvise((void*)partial, nchar*4*nRateCats*sizeof(FLOAT_TYPE), POSIX_MADV_SEQUENTIAL);
+#endif
+
+	int firstSite = 0;
+#ifdef ALLOW_SINGLE_SITE
+	if(siteToScore > 0) firstSite = siteToScore;
+#endif
+
+	FLOAT_TYPE siteL, unscaledlnL, totallnL = ZERO_POINT_ZERO, grandSumlnL=ZERO_POINT_ZERO;
+	FLOAT_TYPE La, Lc, Lg, Lt;
+
+	vector<FLOAT_TYPE> siteLikes(nchar);
+
+	for(int i=0;i<nchar;i++){
+#ifdef USE_COUNTS_IN_BOOT
+		if(countit[i] > 0){
+#else
+		if(1){
+#endif
+			const FLOAT_TYPE *tip = &table[PackedTipState(Ldata, i + firstSite) * stride];
+			La=Lc=Lg=Lt=ZERO_POINT_ZERO;
+			for(int rate=0;rate<nRateCats;rate++){
+				La  += tip[0] * partial[0] * rateProb[rate];
+				Lc  += tip[1] * partial[1] * rateProb[rate];
+				Lg  += tip[2] * partial[2] * rateProb[rate];
+				Lt  += tip[3] * partial[3] * rateProb[rate];
+				tip += 4;
+				partial += 4;
+				}
+			if((mod->NoPinvInModel() == false) && (i<=lastConst)){
+				FLOAT_TYPE btot=0.0;
+				if(conBases[i]&1) btot+=freqs[0];
+				if(conBases[i]&2) btot+=freqs[1];
+				if(conBases[i]&4) btot+=freqs[2];
+				if(conBases[i]&8) btot+=freqs[3];
+				if(underflow_mult[i]==0)
+					siteL  = ((La*freqs[0]+Lc*freqs[1]+Lg*freqs[2]+Lt*freqs[3]) + prI*btot);
+				else 
+					siteL  = ((La*freqs[0]+Lc*freqs[1]+Lg*freqs[2]+Lt*freqs[3]) + (prI*btot*exp((FLOAT_TYPE)underflow_mult[i])));
+				}
+			else
+				siteL  = ((La*freqs[0]+Lc*freqs[1]+Lg*freqs[2]+Lt*freqs[3]));
+			
+			unscaledlnL = (log(siteL) - underflow_mult[i]);
+			totallnL += (countit[i] * unscaledlnL);
+
+#ifdef ALLOW_SINGLE_SITE
+			if(siteToScore > -1) break;
+#endif
+			}
+#ifdef OPEN_MP
+		else{
+			//see GetScorePartialTerminalRateHet
+			partial += stride;
+			}
+#endif
+#ifdef LUMP_LIKES
+		if((i + 1) % LUMP_FREQ == 0){
+			grandSumlnL += totallnL;
+			totallnL = ZERO_POINT_ZERO;
+			}
+#endif
+		if(sitelikeLevel != 0)
+			siteLikes[i] = unscaledlnL;
+		}
+#ifdef LUMP_LIKES
+	totallnL += grandSumlnL;
+#endif
+	if(sitelikeLevel != 0){
+		OutputSiteLikelihoods(dataIndex, siteLikes, underflow_mult, NULL);
+		}
+	return totallnL;
+	}
+	
 FLOAT_TYPE Tree::GetScorePartialInternalRateHet(const CondLikeArray *partialCLA, const CondLikeArray *childCLA, const FLOAT_TYPE *prmat, int modIndex, int dataIndex){
 	//this function assumes that the pmat is arranged with the 16 entries for the
 	//first rate, followed by 16 for the second, etc.
@@ -6396,6 +6785,60 @@ void Tree::GetStatewiseUnscaledPosteriorsPartialTerminalNState(CondLikeArray *de
 		}
 	}
 
+//the same as GetStatewiseUnscaledPosteriorsPartialTerminalNState, but for a nucleotide tip with packed data
+void Tree::GetStatewiseUnscaledPosteriorsPartialTerminalPacked(CondLikeArray *destCLA, const CondLikeArray *partialCLA, const FLOAT_TYPE *prmat, const unsigned char *Ldata, int modIndex, int dataIndex){
+	FLOAT_TYPE *dest=destCLA->arr;
+	const FLOAT_TYPE *partial=partialCLA->arr;
+	const int *underflow_mult=partialCLA->underflow_mult;
+
+	const SequenceData *data = dataPart->GetSubset(dataIndex);
+	Model *mod = modPart->GetModel(modIndex);
+
+	const int nRateCats = mod->NRateCats();
+	const int stride = 4*nRateCats;
+	const int nchar = data->NChar();
+
+	const FLOAT_TYPE *rateProb=mod->GetRateProbs();
+	const int lastConst=data->LastConstant();
+	const int *conStates=data->GetConstStates();
+	const FLOAT_TYPE prI=mod->PropInvar();
+
+	FLOAT_TYPE freqs[4];
+	for(int i=0;i<4;i++) 
+		freqs[i]=mod->StateFreq(i);
+
+	FLOAT_TYPE *table = mod->PackedTipTables();
+	FillPackedTipTable(prmat, nRateCats, ONE_POINT_ZERO, table);
+
+	for(int d = 0;d < nchar * 4;d++)
+		dest[d] = ZERO_POINT_ZERO;
+
+	for(int i=0;i<nchar;i++){
+		const FLOAT_TYPE *tip = &table[PackedTipState(Ldata, i) * stride];
+		for(int rate=0;rate<nRateCats;rate++){
+			for(int from=0;from<4;from++)
+				dest[from] += tip[from] * partial[from] * freqs[from] * rateProb[rate];
+			tip += 4;
+			partial += 4;
+			}
+
+		if((mod->NoPinvInModel() == false) && (i<=lastConst)){
+			FLOAT_TYPE pinvRescaler = ONE_POINT_ZERO;
+			if(underflow_mult[i] != 0)
+				pinvRescaler = exp((FLOAT_TYPE)underflow_mult[i]);
+			if(conStates[i]&1)
+				dest[0] += prI * freqs[0] * pinvRescaler;
+			if(conStates[i]&2) 
+				dest[1] += prI * freqs[1] * pinvRescaler;
+			if(conStates[i]&4) 
+				dest[2] += prI * freqs[2] * pinvRescaler;
+			if(conStates[i]&8) 
+				dest[3] += prI * freqs[3] * pinvRescaler;
+			}
+		dest += 4;
+		}
+	}
+
 void Tree::LocalMove(){
 	assert(0);
 	//This is not working
@@ -6769,6 +7212,7 @@ void Tree::NNIMutate(int node, int branch, FLOAT_TYPE optPrecision, int subtreeN
 #endif
 
 	OptimizeBranchesWithinRadius(connector, optPrecision, subtreeNode, NULL);
+	UpdateBipartsForSwap(cut, sib->anc);
 	}
 
 /*
@@ -6882,6 +7326,54 @@ void Tree::ReadBinaryFormattedTree(FILE *in){
 		}
 	}
 
+static int CheckpointNodeNum(const TreeNode *nd){
+	return (nd == NULL ? -1 : nd->nodeNum);
+	}
+
+void Tree::WriteCheckpoint(CheckpointWriter &out) const{
+	out.PutInt(numTipsTotal);
+	out.PutInt(numNodesTotal);
+	out.PutDouble(lnL);
+	out.PutInt(numTipsAdded);
+	out.PutInt(numNodesAdded);
+	out.PutInt(numBranchesAdded);
+	for(int i=0;i<numNodesTotal;i++){
+		const TreeNode *nd = allNodes[i];
+		out.PutInt(CheckpointNodeNum(nd->left));
+		out.PutInt(CheckpointNodeNum(nd->right));
+		out.PutInt(CheckpointNodeNum(nd->prev));
+		out.PutInt(CheckpointNodeNum(nd->next));
+		out.PutInt(CheckpointNodeNum(nd->anc));
+		out.PutDouble(nd->dlen);
+		}
+	}
+
+void Tree::ReadCheckpoint(CheckpointReader &in){
+	//this checks that the checkpoint was written for the same dataset
+	in.ExpectCount(numTipsTotal, "taxa");
+	in.ExpectCount(numNodesTotal, "tree nodes");
+	lnL = in.GetDouble();
+	numTipsAdded = in.GetInt();
+	numNodesAdded = in.GetInt();
+	numBranchesAdded = in.GetInt();
+	TreeNode **links[5];
+	for(int i=0;i<numNodesTotal;i++){
+		TreeNode *nd = allNodes[i];
+		links[0] = &nd->left;
+		links[1] = &nd->right;
+		links[2] = &nd->prev;
+		links[3] = &nd->next;
+		links[4] = &nd->anc;
+		for(int l = 0;l < 5;l++){
+			int num = in.GetInt();
+			if(num < -1 || num >= numNodesTotal)
+				throw ErrorException("Checkpoint file is corrupt (bad tree node number).\n\tUnfortunately you'll need to start the run again from scratch.");
+			*links[l] = (num < 0 ? NULL : allNodes[num]);
+			}
+		nd->dlen = in.GetDouble();
+		}
+	}
+
 FLOAT_TYPE Tree::OptimizeInsertDeleteRates(FLOAT_TYPE prec, int modnum){
 	FLOAT_TYPE improve = 0.0;
 	FLOAT_TYPE insProp, del;
@@ -7182,7 +7674,7 @@ FLOAT_TYPE Tree::OptimizeRelativeNucRates(FLOAT_TYPE prec, int modnum){
 		ofstream modlog("models.log", ios::app);
 		modlog << lnL << "\t" << modstr.c_str() << "\t";
 
-		char treeString[5000];
+		NewickBuffer treeString;
 		modlog.setf( ios::floatfield, ios::fixed );
 		modlog.setf( ios::showpoint );
 		root->MakeNewick(treeString, false, true);
@@ -7816,6 +8308,62 @@ void Tree::CalcFullCLATerminalTerminal(CondLikeArray *destCLA, const FLOAT_TYPE
 		destCLA->rescaleRank=2;
 	}
 
+//the same as CalcFullCLATerminalTerminal, for two tips with packed data.  Each site is just the product of
+//two table entries, whatever the ambiguity of the tips
+void Tree::CalcFullCLATerminalTerminalPacked(CondLikeArray *destCLA, const FLOAT_TYPE *Lpr, const FLOAT_TYPE *Rpr, const unsigned char *Ldata, const unsigned char *Rdata, int modIndex, int dataIndex){
+	FLOAT_TYPE *dest=destCLA->arr;
+
+	const SequenceData *data = dataPart->GetSubset(dataIndex);
+	Model *mod = modPart->GetModel(modIndex);
+
+	const int nRateCats = mod->NRateCats();
+	const int stride = 4*nRateCats;
+	const int nchar = data->NChar();
+	const int *counts = data->GetCounts();
+
+	FLOAT_TYPE *Ltable = mod->PackedTipTables();
+	FLOAT_TYPE *Rtable = Ltable + 16*stride;
+	FillPackedTipTable(Lpr, nRateCats, ONE_POINT_ZERO, Ltable);
+	FillPackedTipTable(Rpr, nRateCats, ONE_POINT_ZERO, Rtable);
+
+#ifdef UNIX
+	posix_madvise(dest, nchar*4*nRateCats*sizeof(FLOAT_TYPE), POSIX_MADV_SEQUENTIAL);
+#endif
+
+	int firstSite = 0;
+#ifdef ALLOW_SINGLE_SITE
+	if(siteToScore > 0) firstSite = siteToScore;
+#endif
+
+	for(int i=0;i<nchar;i++){
+#ifdef USE_COUNTS_IN_BOOT
+		if(counts[i] > 0){
+#else
+		if(1){
+#endif
+			const FLOAT_TYPE *left = &Ltable[PackedTipState(Ldata, i + firstSite) * stride];
+			const FLOAT_TYPE *right = &Rtable[PackedTipState(Rdata, i + firstSite) * stride];
+			for(int q=0;q<stride;q++)
+				dest[q] = left[q] * right[q];
+			dest += stride;
+#ifdef ALLOW_SINGLE_SITE
+			if(siteToScore > -1) break;
+#endif
+			}
+#ifdef OPEN_MP
+		else{
+			//see CalcFullCLATerminalTerminal
+			dest += stride;
+			}
+#endif
+		}
+		
+	for(int site=0;site<nchar;site++){
+		destCLA->underflow_mult[site]=0;
+		}
+	destCLA->rescaleRank=2;
+	}
+
 void Tree::CalcFullCLATerminalTerminalNState(CondLikeArray *destCLA, const FLOAT_TYPE *Lpr, const FLOAT_TYPE *Rpr, const char *Ldata, const char *Rdata, int modIndex, int dataIndex){
 	//this function assumes that the pmat is arranged with the 16 entries for the
 	//first rate, followed by 16 for the second, etc.
@@ -8271,6 +8819,71 @@ void Tree::CalcFullCLAInternalTerminal(CondLikeArray *destCLA, const CondLikeArr
 	destCLA->rescaleRank=LCLA->rescaleRank+2;
 	} 
 
+//the same as CalcFullCLAInternalTerminal, for a tip with packed data.  Since site i of the tip can be found
+//directly no ambiguity map is needed with OpenMP
+void Tree::CalcFullCLAInternalTerminalPacked(CondLikeArray *destCLA, const CondLikeArray *LCLA, const FLOAT_TYPE *pr1, const FLOAT_TYPE *pr2, const unsigned char *dat2, int modIndex, int dataIndex){
+	FLOAT_TYPE *des=destCLA->arr;
+	FLOAT_TYPE *dest=des;
+	const FLOAT_TYPE *CL=LCLA->arr;
+	const FLOAT_TYPE *CL1=CL;
+
+	const SequenceData *data = dataPart->GetSubset(dataIndex);
+	Model *mod = modPart->GetModel(modIndex);	
+
+	const int nchar = data->NChar();
+	const int nRateCats = mod->NRateCats();
+	const int stride = 4*nRateCats;
+	const int *counts = data->GetCounts();
+
+	FLOAT_TYPE *table = mod->PackedTipTables();
+	FillPackedTipTable(pr2, nRateCats, ONE_POINT_ZERO, table);
+
+#ifdef UNIX	
+	posix_madvise(dest, nchar*4*nRateCats*sizeof(FLOAT_TYPE), POSIX_MADV_SEQUENTIAL);
+	posix_madvise((void*)CL1, nchar*4*nRateCats*sizeof(FLOAT_TYPE), POSIX_MADV_SEQUENTIAL);	
+#endif
+
+	int firstSite = 0;
+#ifdef ALLOW_SINGLE_SITE
+	if(siteToScore > 0) firstSite = siteToScore;
+#endif
+
+#ifdef OMP_INTTERMCLA
+	#pragma omp parallel for private(dest, CL1)
+	for(int i=0;i<nchar;i++){
+		dest=&des[stride*i];
+		CL1=&CL[stride*i];
+#else
+	for(int i=0;i<nchar;i++){
+#endif
+#ifdef USE_COUNTS_IN_BOOT
+		if(counts[i] > 0){
+#else
+		if(1){
+#endif
+			const FLOAT_TYPE *tip = &table[PackedTipState(dat2, i + firstSite) * stride];
+			for(int r=0;r<nRateCats;r++){
+				const FLOAT_TYPE *p = &pr1[16*r];
+				const FLOAT_TYPE *c = &CL1[4*r];
+				dest[4*r]   = ( p[0]*c[0]+p[1]*c[1]+p[2]*c[2]+p[3]*c[3]) * tip[4*r];
+				dest[4*r+1] = ( p[4]*c[0]+p[5]*c[1]+p[6]*c[2]+p[7]*c[3]) * tip[4*r+1];
+				dest[4*r+2] = ( p[8]*c[0]+p[9]*c[1]+p[10]*c[2]+p[11]*c[3]) * tip[4*r+2];
+				dest[4*r+3] = ( p[12]*c[0]+p[13]*c[1]+p[14]*c[2]+p[15]*c[3]) * tip[4*r+3];
+				}
+			dest += stride;
+			CL1 += stride;
+#ifdef ALLOW_SINGLE_SITE
+			if(siteToScore > -1) break;
+#endif
+			}
+		}
+		
+	for(int i=0;i<nchar;i++)
+		destCLA->underflow_mult[i]=LCLA->underflow_mult[i];
+	
+	destCLA->rescaleRank=LCLA->rescaleRank+2;
+	} 
+
 void Tree::CalcFullCLAInternalTerminalNState(CondLikeArray *destCLA, const CondLikeArray *LCLA, const FLOAT_TYPE *pr1, const FLOAT_TYPE *pr2, char *dat2, int modIndex, int dataIndex){
 	//this function assumes that the pmat is arranged with the 16 entries for the
 	//first rate, followed by 16 for the second, etc.
@@ -43,6 +43,8 @@ class ClaManager;
 class GeneralGamlConfig;
 class ModelPartition;
 class Individual;
+class CheckpointWriter;
+class CheckpointReader;
 extern rng rnd;
 
 #define RESCALE_ARRAY_LENGTH 90
@@ -111,6 +113,8 @@ class Tree{
 		//it is NOT PERSISTENT, so after OutputSitelikes is called it is reset to 0
 		int sitelikeLevel;
 		string ofprefix;
+		//if set, the site likelihoods of each subset are stored here (in packed pattern order) rather than written out
+		vector< vector<FLOAT_TYPE> > *siteLikeCapture;
 
 	enum{//the directions for sweeping of CLAs
 		DOWN = 1,
@@ -125,6 +129,24 @@ class Tree{
 		CLEAN_UNSTANDARDIZED = 2,
 		TEMP_ADJUSTED = 3
 		}bipartCond;
+	//the cut and broken nodes passed to the last AdjustBipartsForSwap, so that
+	//it can be cheaply undone rather than recalculating all bipartitions
+	int adjustedCut, adjustedBroken;
+	//the nodes that the flipping of each path started from, or NULL if that path wasn't flipped
+	TreeNode *adjustedFrom[2];
+	//an open addressing hash table of the nodeNums of all nodes in the tree, keyed by the complement normalized
+	//hash of their bipartition.  It is only valid if bipartCond is CLEAN_STANDARDIZED and bipartHashValid is true,
+	//and is built on demand by the ContainsBipartition functions
+	vector<int> bipartHashNodes;
+	vector<unsigned long long> bipartHashKeys;
+	bool bipartHashValid;
+	//for each constraint, a bitset with a bit per nodeNum that is on if the current bipartition of that node conflicts
+	//with the constraint.  Filled by CacheConstraintConflicts before checking many swaps against a fixed tree, so 
+	//that only the nodes whose bipartitions are changed by a swap need to be checked again
+	vector< vector<BipartBlock> > constraintConflicts;
+	vector<BipartBlock> swapAdjustedNodes;
+	bool constraintConflictsValid;
+
 		
 	public: 
 		//construction and allocation functions
@@ -157,6 +179,8 @@ class Tree{
 		void SwapAndFreeNodes(TreeNode *cop);
 		void OutputBinaryFormattedTree(OUTPUT_CLASS &) const;
 		void ReadBinaryFormattedTree(FILE *);
+		void WriteCheckpoint(CheckpointWriter &out) const;
+		void ReadCheckpoint(CheckpointReader &in);
 
 		//functions for copying trees
 		void MimicTopologyButNotInternNodeNums(TreeNode *copySource,TreeNode *replicate,int &placeInAllNodes);
@@ -198,7 +222,7 @@ class Tree{
 
 		//functions for dealing with constraints and bipartitions
 		static void LoadConstraints(ifstream &con, int nTaxa);
-		bool SwapAllowedByConstraint(const Constraint &constr, TreeNode *cut, ReconNode *broken, const Bipartition &proposed, const Bipartition *partialMask);
+		bool SwapAllowedByConstraint(const Constraint &constr, TreeNode *cut, ReconNode *broken, const Bipartition &proposed, const Bipartition *partialMask, int conNum=-1);
 		
 		//functions for determining if adding a particular taxon to a particular place in a growing tree is allowed by any constraints
 		//this is used if the taxon to be added is NOT already in the tree (so not for testing the allowability of swaps)
@@ -209,6 +233,10 @@ class Tree{
 		bool TaxonAdditionAllowedByNegativeBackboneConstraintWithMask(Constraint *constr, Bipartition *mask, TreeNode *toAdd, TreeNode *broken);
 		
 		bool RecursiveAllowedByConstraintWithMask(const Constraint &constr, const Bipartition *partialMask, const TreeNode *nd);
+		void RecursiveMarkConstraintConflicts(const Constraint &constr, const Bipartition *jointMask, const TreeNode *nd, vector<BipartBlock> &conflicts);
+		void CacheConstraintConflicts(const Bipartition *partialMask);
+		void ClearConstraintConflicts() {constraintConflictsValid = false;}
+		bool AdjustedSwapAllowedByCachedConstraint(const Constraint &constr, int conNum, const Bipartition *jointMask);
 		//bool RecursiveAllowedByNegativeConstraintWithMask(Constraint *constr, Bipartition *mask, TreeNode *nd);
 		void CalcBipartitions(bool standardize);
 		void OutputBipartitions();
@@ -216,6 +244,12 @@ class Tree{
 		TreeNode *ContainsBipartitionOrComplement(const Bipartition &bip);
 		TreeNode *ContainsMaskedBipartitionOrComplement(const Bipartition &bip, const Bipartition &mask);
 		void AdjustBipartsForSwap(int cut, int broken);
+		void UndoAdjustBipartsForSwap();
+		void UpdateBipartsForSwap(TreeNode *cut, TreeNode *oldAnc);
+		void CopyBipartsInSubtree(const TreeNode *from);
+		void BuildBipartitionHash();
+		void AddSubtreeToBipartitionHash(TreeNode *nd);
+		TreeNode *FindBipartitionInHash(const Bipartition &bip, bool orComplement);
 
 		// functions for computing likelihood
 		bool ConditionalLikelihood(int direction, TreeNode* nd);	
@@ -227,6 +261,14 @@ class Tree{
 		int Score(int rootNodeNum =0);
 
 		FLOAT_TYPE GetScorePartialTerminalOrientedGap(const CondLikeArray *partialCLA, const FLOAT_TYPE *prmat, const char *Ldata, int modIndex, int dataIndex);
+
+		//versions of the nucleotide terminal functions for tips stored as packed 4 bit codes (packedtipdata)
+		static void FillPackedTipTable(const FLOAT_TYPE *mat, int nRateCats, FLOAT_TYPE ambigValue, FLOAT_TYPE *table);
+		FLOAT_TYPE GetScorePartialTerminalPacked(const CondLikeArray *partialCLA, const FLOAT_TYPE *prmat, const unsigned char *Ldata, int modIndex, int dataIndex);
+		void GetDerivsPartialTerminalPacked(const CondLikeArray *partialCLA, const FLOAT_TYPE *prmat, const FLOAT_TYPE *d1mat, const FLOAT_TYPE *d2mat, const unsigned char *Ldata, FLOAT_TYPE &d1Tot, FLOAT_TYPE &d2Tot, int modIndex, int dataIndex);
+		void CalcFullCLATerminalTerminalPacked(CondLikeArray *destCLA, const FLOAT_TYPE *Lpr, const FLOAT_TYPE *Rpr, const unsigned char *Ldata, const unsigned char *Rdata, int modIndex, int dataIndex);
+		void CalcFullCLAInternalTerminalPacked(CondLikeArray *destCLA, const CondLikeArray *LCLA, const FLOAT_TYPE *pr1, const FLOAT_TYPE *pr2, const unsigned char *dat2, int modIndex, int dataIndex);
+		void GetStatewiseUnscaledPosteriorsPartialTerminalPacked(CondLikeArray *destCLA, const CondLikeArray *partialCLA, const FLOAT_TYPE *prmat, const unsigned char *Ldata, int modIndex, int dataIndex);
 	
 		//functions to optimize blens and params
 		pair<FLOAT_TYPE, FLOAT_TYPE> CalcDerivativesRateHet(TreeNode *nd1, TreeNode *nd2);
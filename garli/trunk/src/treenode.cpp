@@ -128,10 +128,7 @@ char *TreeNode::MakeNewick(char *s, bool internalNodes, bool branchLengths, bool
 		if(anc){
 			if(branchLengths==true){
 				*s++=':';
-				if(highPrec == false)
-					sprintf(s, "%.8lf", dlen);
-				else sprintf(s, "%.10lf", dlen);
-				while(*s)s++;
+				s += FormatFixed(dlen, (highPrec ? 10 : 8), s);
 				}
 			}
 		else
@@ -144,10 +141,7 @@ char *TreeNode::MakeNewick(char *s, bool internalNodes, bool branchLengths, bool
 		while(*s)s++;
 		if(branchLengths==true){
 			*s++=':';
-			if(highPrec == false)
-				sprintf(s, "%.8lf", dlen);
-			else sprintf(s, "%.10lf", dlen);
-			while(*s)s++;
+			s += FormatFixed(dlen, (highPrec ? 10 : 8), s);
 			}
 		}
 		
@@ -163,6 +157,46 @@ char *TreeNode::MakeNewick(char *s, bool internalNodes, bool branchLengths, bool
 	return s;
 	}
 
+void TreeNode::MakeNewick(NewickBuffer &out, bool internalNodes, bool branchLengths, bool highPrec /*=false*/) const{
+	out.Clear();
+	AppendNewick(out, internalNodes, branchLengths, highPrec);
+	}
+
+//the same output as the char * version, without any limit on the length
+void TreeNode::AppendNewick(NewickBuffer &out, bool internalNodes, bool branchLengths, bool highPrec) const{
+	if(left){
+		if(internalNodes==true && nodeNum!=0)
+			out.AppendInt(nodeNum);
+		out.Append('(');
+		left->AppendNewick(out, internalNodes, branchLengths, highPrec);
+		if(anc){
+			if(branchLengths==true){
+				out.Append(':');
+				out.AppendFixed(dlen, (highPrec ? 10 : 8));
+				}
+			}
+		else
+			return;
+		}
+	else {
+		out.AppendInt(nodeNum);
+		if(branchLengths==true){
+			out.Append(':');
+			out.AppendFixed(dlen, (highPrec ? 10 : 8));
+			}
+		}
+
+	if(next){
+		out.Append(',');
+		next->AppendNewick(out, internalNodes, branchLengths, highPrec);
+		}
+	else {
+		if(anc){
+			out.Append(')');
+			}
+		}
+	}
+
 void TreeNode::MakeNewick(string &outStr, const DataPartition *data, bool internalNodes, bool branchLengths, bool taxonNames /*=false*/, bool highPrec /*=false*/) const{
 	char s[500];
 	if(left){
@@ -175,14 +209,8 @@ void TreeNode::MakeNewick(string &outStr, const DataPartition *data, bool intern
 		if(anc){
 			if(branchLengths==true){
 				outStr += ':';
-				if(highPrec == false){
-					sprintf(s, "%.8lf", dlen);
-					outStr += s;
-					}
-				else{
-					sprintf(s, "%.10lf", dlen);
-					outStr += s;
-					}
+				FormatFixed(dlen, (highPrec ? 10 : 8), s);
+				outStr += s;
 				}
 			}
 		else
@@ -199,10 +227,7 @@ void TreeNode::MakeNewick(string &outStr, const DataPartition *data, bool intern
 			}
 		if(branchLengths==true){
 			outStr += ':';
-			if(highPrec == false)
-				sprintf(s, "%.8lf", dlen);
-			else 
-				sprintf(s, "%.10lf", dlen);
+			FormatFixed(dlen, (highPrec ? 10 : 8), s);
 			outStr += s;
 			}
 		}
@@ -28,6 +28,7 @@ using namespace std;
 #include "condlike.h"
 #include "clamanager.h"
 #include "bipartition.h"
+#include "newick.h"
 
 class NucleotideData;
 class MFILE;
@@ -44,6 +45,8 @@ class TreeNode{
 		bool alreadyOptimized;
 		Bipartition *bipart;
 		vector<char *> tipData;
+		//for nucleotide subsets with packedtipdata = 1 this holds the tip data instead, and tipData is NULL
+		vector<const unsigned char *> packedTipData;
 #ifdef OPEN_MP
 		//unsigned *ambigMap;
 		vector<unsigned *> ambigMap;
@@ -76,6 +79,9 @@ class TreeNode{
 		void CollapseMinLengthBranches(int &);
 		//misc functions
 		char *MakeNewick(char *s, bool internalNodes, bool branchLengths, bool highPrec=false) const;
+		//replaces the contents of the buffer with the description of the tree below this node
+		void MakeNewick(NewickBuffer &out, bool internalNodes, bool branchLengths, bool highPrec=false) const;
+		void AppendNewick(NewickBuffer &out, bool internalNodes, bool branchLengths, bool highPrec) const;
 		void MakeNewick(string &outStr, const DataPartition *data, bool internalNodes, bool branchLengths, bool taxonNames = false, bool highPrec = false) const;
 		void MakeNewickForSubtree(char *s) const;
 		void MakeNewickForSubtree(string &s, const DataPartition *data, bool internalNodes, bool branchLengths, bool taxonNames = false, bool highPrec = false) const;
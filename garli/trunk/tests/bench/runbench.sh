@@ -0,0 +1,69 @@
+#!/bin/bash
+
+#Times the likelihood kernels for each of the configs in this directory, once for each number of
+#rate categories, and for synthetic DNA alignments of increasing numbers of patterns.  The results
+#of all of the runs are collected into bench.tsv, one line per kernel, for regression tracking.
+
+if [ $# -lt 2 ];
+then
+	echo Usage: pass two, or \(optionally\) more arguments:
+	echo        '$0 <path to tests directory with data and bench subdirectories> <path of garli-bench or GARLI binary> [optional: numbers of rate categories, default 1 4 8]'
+	exit 1
+fi
+
+TESTS_DIR=$1
+BENCH_BIN=$2
+shift; shift;
+RATE_CATS=${@:-1 4 8}
+
+#the number of sites in each synthetic alignment, and the number of taxa in them
+SYNTH_SITES=${SYNTH_SITES:-1000 10000 100000}
+SYNTH_TAXA=${SYNTH_TAXA:-16}
+
+echo "Linking to data ...."
+if [ -d data ];then
+	echo "data folder already exists"
+else
+	ln -sf $TESTS_DIR/data | exit 1
+fi
+
+#runs one benchmark config, passing the name of the run on to the output
+run_bench(){
+	conf=$1
+	name=$2
+	$BENCH_BIN --bench $conf
+	if [ ! $? -eq 0 ];then
+		echo "Benchmark $name failed"
+		exit 1
+	fi
+	prefix=`grep "^ofprefix" $conf | awk '{print $3}'`
+	tail -n +2 $prefix.bench.log | sed "s/^/$name	/" >> bench.tsv
+}
+
+printf "run\t" > bench.tsv
+echo "subset	datatype	states	ratecats	patterns	kernel	calls	total_s	ns_per_call	ns_per_pattern" >> bench.tsv
+
+for i in $TESTS_DIR/bench/*.conf
+do
+	base=${i/*\/}
+	base=${base/.conf/}
+	for r in $RATE_CATS
+	do
+		if [ $r -eq 1 ];then
+			sed -e "s/^numratecats.*/numratecats = 1/" -e "s/^ratehetmodel.*/ratehetmodel = none/" -e "s/^ofprefix.*/ofprefix = bench.$base.r$r/" $i > bench.$base.r$r.conf
+		else
+			sed -e "s/^numratecats.*/numratecats = $r/" -e "s/^ofprefix.*/ofprefix = bench.$base.r$r/" $i > bench.$base.r$r.conf
+		fi
+		run_bench bench.$base.r$r.conf $base.r$r
+	done
+done
+
+#random sequences, so that nearly every site is its own pattern
+for s in $SYNTH_SITES
+do
+	awk -v ntax=$SYNTH_TAXA -v nchar=$s 'BEGIN{srand(71); split("ACGT", b, ""); for(t = 1;t <= ntax;t++){printf(">t%d\n", t); for(c = 1;c <= nchar;c++) printf("%s", b[int(rand() * 4) + 1]); printf("\n");}}' > synth.$s.fas
+	sed -e "s|^datafname.*|datafname = synth.$s.fas|" -e "s/^ofprefix.*/ofprefix = bench.synth.$s/" $TESTS_DIR/bench/n.conf > bench.synth.$s.conf
+	run_bench bench.synth.$s.conf synth.$s
+done
+
+echo "Results are in bench.tsv"
@@ -0,0 +1,118 @@
+#!/bin/bash
+
+#Runs each of the configs in this directory, all with a fixed seed and number of generations so that the
+#work done is the same every time, and compares the wall time, likelihood evaluations per second, peak
+#memory, amount of work and final score against a stored baseline.  The results of this run are written
+#to perf.tsv.  If there isn't a baseline (or UPDATE_BASELINE is set) this run becomes the baseline.
+#Timings are only comparable on the same machine and build settings, so baselines aren't shared.
+
+if [ $# -lt 2 ];
+then
+	echo Usage: pass two, or \(optionally\) more arguments:
+	echo        '$0 <path to tests directory with data and perf subdirectories> <path of GARLI binary> [optional: GARLI command-line arguments]'
+	echo        'Environment: BASELINE (baseline file, default <tests>/perf/baseline.tsv), UPDATE_BASELINE,'
+	echo        '             TIME_TOL (0.15), MEM_TOL (0.10), WORK_TOL (0.02), SCORE_TOL (0.01)'
+	exit 1
+fi
+
+TESTS_DIR=$1
+GARLI_BIN=$2
+shift; shift;
+GARLI_ARGS=$@
+
+BASELINE=${BASELINE:-$TESTS_DIR/perf/baseline.tsv}
+#allowed proportional increases in time and memory, and in the number of CLA calculations
+TIME_TOL=${TIME_TOL:-0.15}
+MEM_TOL=${MEM_TOL:-0.10}
+WORK_TOL=${WORK_TOL:-0.02}
+#allowed absolute difference in final score.  The same seed and generations should give the same search
+SCORE_TOL=${SCORE_TOL:-0.01}
+
+echo "Linking to data ...."
+if [ -d data ];then
+	echo "data folder already exists"
+else
+	ln -sf $TESTS_DIR/data | exit 1
+fi
+
+#random sequences for the large dataset
+if [ ! -f synth.64x20000.fas ];then
+	awk -v ntax=64 -v nchar=20000 'BEGIN{srand(71); split("ACGT", b, ""); for(t = 1;t <= ntax;t++){printf(">t%d\n", t); for(c = 1;c <= nchar;c++) printf("%s", b[int(rand() * 4) + 1]); printf("\n");}}' > synth.64x20000.fas
+fi
+
+now(){
+	if [ -n "$EPOCHREALTIME" ];then
+		echo $EPOCHREALTIME
+	else
+		date +%s.%N 2> /dev/null | grep -v N || date +%s
+	fi
+}
+
+echo "run	wall_s	lnl_evals	evals_per_s	cla_calcs	peak_kb	score" > perf.tsv
+
+echo "**************************"
+echo "Running performance tests ..."
+echo "**************************"
+
+for i in $TESTS_DIR/perf/*.conf
+do
+	base=${i/*\/}
+	base=${base/.conf/}
+	echo "Running performance test $base"
+	echo "Running performance test $base" >&2
+
+	start=`now`
+	$GARLI_BIN $i $GARLI_ARGS > /dev/null
+	if [ ! $? -eq 0 ];then
+		echo "***Performance test $base failed to run***"
+		exit 1
+	fi
+	end=`now`
+
+	#Work summary: N likelihood evaluations, N CLA calculations, N KB peak memory
+	summary=`grep "Work summary" perf.$base.screen.log | tail -1`
+	score=`grep "Final score" perf.$base.screen.log | tail -1 | awk '{print $4}'`
+	echo "$base $start $end $summary $score" | awk '{wall = $3 - $2; printf("%s\t%.2f\t%s\t%.1f\t%s\t%s\t%s\n", $1, wall, $6, (wall > 0 ? $6 / wall : 0), $9, $12, $16)}' >> perf.tsv
+done
+
+if [ ! -f $BASELINE ] || [ -n "$UPDATE_BASELINE" ];then
+	cp perf.tsv $BASELINE
+	echo "Wrote new performance baseline to $BASELINE"
+	exit 0
+fi
+
+echo "**************************"
+echo "Comparing to $BASELINE ..."
+echo "**************************"
+
+awk -F'\t' -v ttol=$TIME_TOL -v mtol=$MEM_TOL -v wtol=$WORK_TOL -v stol=$SCORE_TOL '
+	function pct(cur, old){return (old > 0 ? 100 * (cur / old - 1) : 0)}
+	FNR == 1 {next}
+	FNR == NR {wall[$1] = $2; evals[$1] = $3; rate[$1] = $4; cla[$1] = $5; mem[$1] = $6; score[$1] = $7; next}
+	{
+	if(!($1 in wall)){
+		printf("%-10s not in baseline\n", $1);
+		next;
+		}
+	bad = "";
+	if($2 > wall[$1] * (1 + ttol)) bad = bad " wall time";
+	if($4 < rate[$1] * (1 - ttol)) bad = bad " evals/sec";
+	if(mem[$1] > 0 && $6 > mem[$1] * (1 + mtol)) bad = bad " memory";
+	if($5 > cla[$1] * (1 + wtol)) bad = bad " CLA calculations";
+	d = $7 - score[$1];
+	if(d > stol || d < -stol) bad = bad " score";
+	printf("%-10s wall %8.2f s (%+6.1f%%)  evals/s %10.1f (%+6.1f%%)  CLAs %12d (%+6.1f%%)  peak %8d KB (%+6.1f%%)  score %+.4f\n",
+		$1, $2, pct($2, wall[$1]), $4, pct($4, rate[$1]), $5, pct($5, cla[$1]), $6, pct($6, mem[$1]), d);
+	if(bad != ""){
+		printf("***Performance test %s failed:%s***\n", $1, bad);
+		failed = 1;
+		}
+	}
+	END {exit failed}' $BASELINE perf.tsv
+
+if [ ! $? -eq 0 ];then
+	echo "***Performance regression against $BASELINE***"
+	echo "(if the change is intended, rerun with UPDATE_BASELINE=1)"
+	exit 1
+fi
+echo "***Performance OK***"
@@ -20,7 +20,7 @@ fi
 #set this to move on to the next test after failing one
 #NO_EXIT_ON_ERR=1
 
-rm  -f *.log00.log *.screen.log *.best*.tre *.best*.tre.phy *.boot.tre *.boot.phy *treelog00.tre *treelog00.log *problog00.log *fate00.log .*lock* *swaplog* *.check out.* qout.* mpi_m* *SiteLikes.log *sitelikes.log *best.all.phy *best.phy *current.phy *internalstates.log
+rm  -f *.log00.log *.screen.log *.best*.tre *.best*.tre.phy *.boot.tre *.boot.phy *treelog00.tre *treelog00.log *problog00.log *fate00.log .*lock* *swaplog* *.check out.* qout.* mpi_m* *SiteLikes.log *sitelikes.log *sitelikes.bin *best.all.phy *best.phy *current.phy *internalstates.log cmp.* ref.* rej.* cache.* *.garlicache data/*.garlicache *.done *.run[0-9]*
 
 echo "Linking to data ...."
 if [ -d data ];then
@@ -67,6 +67,14 @@ if [ -d $TESTS_DIR/scoring ];then
 			if [[ ! $? -eq 0 && ! -n "$NO_EXIT_ON_ERR" ]];then
 				exit 1
 			fi
+
+			#the streaming reader falls back to NCL on anything it can't read, which would make the test pointless
+			if [[ ! `grep -i "streamingdatareader *= *1" $i | wc -l` -eq 0 && ! `grep "Streaming reader could not read" scr.$base.screen.log | wc -l` -eq 0 ]];then
+				echo "***Streaming reader was not used for $i ***"
+				if [[ ! -n "$NO_EXIT_ON_ERR" ]];then
+					exit 1
+				fi
+			fi
 	
 			#figure out what precision we can expect
 			if [ ! `grep "likelihood precision" scr.$base.screen.log | wc -l` -eq 0 ]
@@ -82,6 +90,16 @@ if [ -d $TESTS_DIR/scoring ];then
 				fi
 			fi
 
+			#binary site likelihoods are decoded into the text layout first, so that they are checked the same way
+			if [ ! `grep -i "sitelikelihoodformat *= *binary" $i | wc -l` -eq 0 ]
+			then
+				perl $TESTS_DIR/sitelikes2txt.pl scr.$base.sitelikes.bin scr.$base.sitelikes.log
+				if [[ ! $? -eq 0 && ! -n "$NO_EXIT_ON_ERR" ]];then
+					echo "***Decoding binary site likelihoods failed for $i ***"
+					exit 1
+				fi
+			fi
+
 			#sum up the individual site likes and the full likelihood, both appearing
 			#in column 2.  Divide by 2 for the full like.  Thus, this tests that both
 			#general scoring and sitelike output are correct.
@@ -131,6 +149,17 @@ if [ -d $TESTS_DIR/const ];then
 			exit 1
 		fi
 
+		#a verify config reads the resulting trees back in as starting trees with the same
+		#constraints, which fails if any of them doesn't actually satisfy the constraints
+		if [ -f $TESTS_DIR/const/verify/$base.conf ];then
+			echo "Verifying constraints on trees from $base"
+			$GARLI_BIN $TESTS_DIR/const/verify/$base.conf $GARLI_ARGS
+			if [[ ! $? -eq 0 && ! -n "$NO_EXIT_ON_ERR" ]];then
+				echo "***Trees from constraint test $base violate the constraints ***"
+				exit 1
+			fi
+		fi
+
 		#NEXUSvalidator gives a warning every time it reads a tree file
 		#without a taxa block.  So, shut it up initially and then if it
 		#fails let it output whatever error
@@ -145,6 +174,26 @@ if [ -d $TESTS_DIR/const ];then
 			fi
 	    	fi
 	done
+
+	#the verify step is only worth something if it catches a violation, so each config here
+	#reads in a tree that violates its constraints, and has to be rejected for that reason
+	if [ -d $TESTS_DIR/const/reject ];then
+		for i in $TESTS_DIR/const/reject/*.conf
+		do
+			base=${i/*\/}
+			base=${base/.conf/}
+			echo "Running constraint rejection test $base"
+			echo "Running constraint rejection test $base" >&2
+
+			$GARLI_BIN $i $GARLI_ARGS
+			if [[ $? -eq 0 || `grep "not compatible with constraint" rej.$base.screen.log | wc -l` -eq 0 ]];then
+				echo "***Constraint violation in $base was not detected ***"
+				if [[ ! -n "$NO_EXIT_ON_ERR" ]];then
+					exit 1
+				fi
+			fi
+		done
+	fi
 else
 	echo "No constraint tests found ..."
 fi
@@ -188,11 +237,171 @@ if [ -d $TESTS_DIR/output ];then
 			exit 1
 		fi
     	fi
+
+	#RELL bootstrap proportions have to add up to one, and the RELL consensus has to be a valid tree
+	if [ ! `grep -i "rellbootstrapreps *= *[1-9]" $i | wc -l` -eq 0 ]
+		then
+		sum=`grep "^Tree [0-9]* : " out.$base.screen.log | awk '{sum+=$4}END{printf("%.3f", sum)}'`
+		OK=`echo "$sum > 0.99 && $sum < 1.01" | bc`
+		RELLNEX=test.out.$base.rell.nex
+		cp $data $RELLNEX
+		cat out.$base.rell.con.tre | grep -iv nexus >> $RELLNEX
+		$NEXUS_VAL $RELLNEX 2> /dev/null
+		if [[ ! $? -eq 0 || ! $OK -eq 1 ]];then
+			echo "***RELL output of $base is wrong (proportions sum to $sum) ***"
+			if [[ ! -n "$NO_EXIT_ON_ERR" ]];then
+				exit 1
+			fi
+		fi
+	fi
+
+	#lines that have to appear in the screen log, for outputs that are known in advance
+	if [ -f $TESTS_DIR/output/expect/$base.txt ]
+		then
+		while read line
+		do
+			if [ `grep -F -x "$line" out.$base.screen.log | wc -l` -eq 0 ];then
+				echo "***Expected output \"$line\" not found for $base ***"
+				if [[ ! -n "$NO_EXIT_ON_ERR" ]];then
+					exit 1
+				fi
+			fi
+		done < $TESTS_DIR/output/expect/$base.txt
+	fi
+
+	#the replicates of a parallel run each write their own screen log, through their own writer thread
+	#with asyncoutput, and those have to be there and written out
+	if [ ! `grep -i "parallelreplicates *= *[2-9]" $i | wc -l` -eq 0 ]
+		then
+		reps=`grep -i "^searchreps" $i | awk '{print $3}'`
+		if [ ! `cat out.$base.run[0-9]*.screen.log | grep "^Replicate .* random seed" | wc -l` -eq $reps ];then
+			echo "***Missing or incomplete replicate screen logs for $base ***"
+			if [[ ! -n "$NO_EXIT_ON_ERR" ]];then
+				exit 1
+			fi
+		fi
+	fi
+
+	#binary site likelihoods must at least decode cleanly.  Their values are checked by the scoring tests
+	if [ ! `grep -i "sitelikelihoodformat *= *binary" $i | wc -l` -eq 0 ]
+		then
+		perl $TESTS_DIR/sitelikes2txt.pl out.$base.sitelikes.bin out.$base.sitelikes.log
+		if [[ ! $? -eq 0 && ! -n "$NO_EXIT_ON_ERR" ]];then
+			exit 1
+		fi
+	fi
 	done
 else
 	echo "No output tests found ..."
 fi
 
+echo "**************************"
+echo "Running comparison tests ..."
+echo "**************************"
+
+#each config here is run along with the config of the same name in compare/ref, which
+#should give exactly the same results by a different route (e.g. in parallel, or another data reader)
+if [ -d $TESTS_DIR/compare ];then
+
+	for i in $TESTS_DIR/compare/*.conf
+	do
+		base=${i/*\/}
+		base=${base/.conf/}
+		echo "Running comparison test $base"
+		echo "Running comparison test $base" >&2
+
+		$GARLI_BIN $TESTS_DIR/compare/ref/$base.conf $GARLI_ARGS
+		if [[ ! $? -eq 0 && ! -n "$NO_EXIT_ON_ERR" ]];then
+			exit 1
+		fi
+
+		$GARLI_BIN $i $GARLI_ARGS
+		if [[ ! $? -eq 0 && ! -n "$NO_EXIT_ON_ERR" ]];then
+			exit 1
+		fi
+
+		if [[ ! `grep -i "streamingdatareader *= *1" $i | wc -l` -eq 0 && ! `grep "Streaming reader could not read" cmp.$base.screen.log | wc -l` -eq 0 ]];then
+			echo "***Streaming reader was not used for $i ***"
+			if [[ ! -n "$NO_EXIT_ON_ERR" ]];then
+				exit 1
+			fi
+		fi
+
+		#the starting scores and the final trees, with their scores, must be identical
+		grep "Initial ln Likelihood" ref.$base.screen.log > ref.$base.compare
+		grep -i "^ *tree " ref.$base.best.tre >> ref.$base.compare
+		grep "Initial ln Likelihood" cmp.$base.screen.log > cmp.$base.compare
+		grep -i "^ *tree " cmp.$base.best.tre >> cmp.$base.compare
+		if [ -s ref.$base.compare ] && diff ref.$base.compare cmp.$base.compare
+		then
+			echo "***Comparison OK for $base ***"
+		else
+			echo "***Comparison test failed for $base ***"
+			if [[ ! -n "$NO_EXIT_ON_ERR" ]];then
+				exit 1
+			fi
+		fi
+	done
+else
+	echo "No comparison tests found ..."
+fi
+
+echo "**************************"
+echo "Running data cache tests ..."
+echo "**************************"
+
+#each config here is run twice starting without a usable cache, first building the cache and then using
+#it, and both runs must give exactly the same results.  If there is a config of the same name in cache/fill
+#it is run first, and builds a cache with different settings that the first run must not use
+if [ -d $TESTS_DIR/cache ];then
+
+	for i in $TESTS_DIR/cache/*.conf
+	do
+		base=${i/*\/}
+		base=${base/.conf/}
+		echo "Running data cache test $base"
+		echo "Running data cache test $base" >&2
+
+		rm -f *.garlicache data/*.garlicache
+		if [ -f $TESTS_DIR/cache/fill/$base.conf ];then
+			$GARLI_BIN $TESTS_DIR/cache/fill/$base.conf $GARLI_ARGS
+			if [[ ! $? -eq 0 && ! -n "$NO_EXIT_ON_ERR" ]];then
+				exit 1
+			fi
+		fi
+
+		for run in first second
+		do
+			$GARLI_BIN $i $GARLI_ARGS
+			if [[ ! $? -eq 0 && ! -n "$NO_EXIT_ON_ERR" ]];then
+				exit 1
+			fi
+			used=`grep "Using processed data from cache" cache.$base.screen.log | wc -l`
+			if [[ ( $run == first && ! $used -eq 0 ) || ( $run == second && $used -eq 0 ) ]];then
+				echo "***Data cache was wrongly used or ignored in the $run run of $base ***"
+				if [[ ! -n "$NO_EXIT_ON_ERR" ]];then
+					exit 1
+				fi
+			fi
+			grep "Initial ln Likelihood" cache.$base.screen.log > cache.$base.$run
+			grep -i "^ *tree " cache.$base.best.tre >> cache.$base.$run
+		done
+
+		if [ -s cache.$base.first ] && diff cache.$base.first cache.$base.second
+		then
+			echo "***Data cache OK for $base ***"
+		else
+			echo "***Data cache test failed for $base ***"
+			if [[ ! -n "$NO_EXIT_ON_ERR" ]];then
+				exit 1
+			fi
+		fi
+	done
+	rm -f data/*.garlicache
+else
+	echo "No data cache tests found ..."
+fi
+
 echo "**************************"
 echo "Running checkpoint tests ..."
 echo "**************************"
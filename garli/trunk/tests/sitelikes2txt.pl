@@ -0,0 +1,126 @@
+#!/usr/bin/perl
+
+#Decodes a binary site likelihood file (ofprefix.sitelikes.bin, written when sitelikelihoodformat = binary)
+#into the same layout as the text output (ofprefix.sitelikes.log), so that the scoring tests can check both
+#formats the same way.  The format is described in src/sitelikes.h.  Anything inconsistent in the file, such
+#as a section length or site count that doesn't match the header, is an error.
+
+use strict;
+use warnings;
+
+if(@ARGV != 2){
+	print STDERR "Usage: $0 <sitelikes.bin file> <text output file>\n";
+	exit 1;
+}
+
+my ($binName, $textName) = @ARGV;
+open(my $in, '<', $binName) or die "Could not open $binName: $!\n";
+binmode($in);
+my $buf;
+{
+	local $/;
+	$buf = <$in>;
+}
+close($in);
+
+my $pos = 0;
+
+sub Take{
+	my ($num, $what) = @_;
+	die "$binName: file ends in the middle of $what\n" if $pos + $num > length($buf);
+	my $bytes = substr($buf, $pos, $num);
+	$pos += $num;
+	return $bytes;
+}
+sub UInt32 {return unpack('V', Take(4, $_[0]));}
+sub Int32 {return unpack('l', pack('L', UInt32($_[0])));}
+sub Double {return unpack('d<', Take(8, $_[0]));}
+sub Ints{
+	my ($what) = @_;
+	my $num = Int32($what);
+	die "$binName: bad count $num for $what\n" if $num < 0;
+	return map { Int32($what) } 1 .. $num;
+}
+#sections are a four character tag followed by a 64 bit length, and the position where the section should end is returned
+sub Section{
+	my ($tag) = @_;
+	my $found = reverse(Take(4, "section tag"));
+	die "$binName: expected section $tag but found $found at offset " . ($pos - 4) . "\n" if $found ne $tag;
+	my ($low, $high) = unpack('VV', Take(8, "section length"));
+	my $end = $pos + $low + $high * 4294967296;
+	die "$binName: section $tag runs past the end of the file\n" if $end > length($buf);
+	return $end;
+}
+sub EndSection{
+	my ($tag, $end) = @_;
+	die "$binName: section $tag has " . ($end - $pos) . " unread bytes\n" if $pos != $end;
+}
+
+die "$binName: not a GARLI site likelihood file\n" if Take(8, "magic") ne 'GARLISLK';
+
+my $headEnd = Section('SLHD');
+my $version = UInt32("version");
+die "$binName: unknown site likelihood format version $version\n" if $version != 1;
+my $level = UInt32("level");
+my $numSubsets = UInt32("number of subsets");
+my (@nchar, @origCols, @patterns);
+for my $s (0 .. $numSubsets - 1){
+	$nchar[$s] = UInt32("subset $s header");
+	$origCols[$s] = [Ints("subset $s columns")];
+	$patterns[$s] = [Ints("subset $s patterns")];
+	die "$binName: subset $s has different numbers of columns and patterns\n" if @{$origCols[$s]} != @{$patterns[$s]};
+	foreach my $p (@{$patterns[$s]}){
+		die "$binName: subset $s pattern $p out of range\n" if $p < -1 || $p >= $nchar[$s];
+	}
+}
+EndSection('SLHD', $headEnd);
+
+open(my $out, '>', $textName) or die "Could not open $textName: $!\n";
+print $out "Tree\t-lnL\tSite\t-lnL";
+print $out "\tunder1\tunder2" if $level > 1;
+print $out "\n";
+
+my $numTrees = 0;
+while($pos < length($buf)){
+	my $treeEnd = Section('SLTR');
+	my $treeNum = Int32("tree number");
+	my $negLnL = Double("tree score");
+	my $strLen = UInt32("tree string length");
+	Take($strLen, "tree string");
+	my $subset = 0;
+	while($pos < $treeEnd){
+		my $partEnd = Section('SLPT');
+		my $s = UInt32("subset number");
+		die "$binName: tree $treeNum has subset $s out of order\n" if $s != $subset;
+		my $num = Int32("pattern count");
+		die "$binName: tree $treeNum subset $s has $num patterns, header says $nchar[$s]\n" if $num != $nchar[$s];
+		my @likes = map { Double("site likelihoods") } 1 .. $num;
+		my (@under1, @under2);
+		if($level > 1){
+			@under1 = Ints("underflow multipliers");
+			@under2 = Ints("underflow multipliers");
+		}
+		EndSection('SLPT', $partEnd);
+		for my $i (0 .. $#{$patterns[$s]}){
+			my $p = $patterns[$s][$i];
+			if($p == -1){
+				print $out "\t\t$origCols[$s][$i]\t-";
+				print $out "\t-\t-" if $level > 1;
+			}
+			else{
+				printf $out "\t\t%d\t%.8f", $origCols[$s][$i], $likes[$p];
+				if($level > 1){
+					print $out "\t$under1[$p]\t" . (@under2 ? $under2[$p] : '-');
+				}
+			}
+			print $out "\n";
+		}
+		$subset++;
+	}
+	die "$binName: tree $treeNum has $subset subsets, header says $numSubsets\n" if $subset != $numSubsets;
+	EndSection('SLTR', $treeEnd);
+	printf $out "%d\t%.10f\n", $treeNum, $negLnL;
+	$numTrees++;
+}
+close($out);
+die "$binName: no trees\n" if $numTrees == 0;